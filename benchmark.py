@@ -0,0 +1,131 @@
+import os, sys, time, shutil, tempfile, subprocess;
+
+
+
+# Benchmark settings
+thread_counts = [ 1, 2, 4, 8, 16, 32 ];
+total_renders = 256; # split between the threads, so perfect scaling halves the time at each step
+loop_count = 20000; # work done by each render
+repeat_count = 3; # the best time is kept
+
+
+
+# Template sources
+part_source = "<?= str(sum([ i * i for i in range({0:d}) ])) ?>\n";
+
+template_source = (
+	"<?\n"
+	"import threading;\n"
+	"\n"
+	"contexts = [ pyp.context() for i in range({0:d}) ];\n"
+	"\n"
+	"def render(context):\n"
+	"\twith context:\n"
+	"\t\tfor i in range({1:d}):\n"
+	"\t\t\tpyp.include(\"part.pyp\");\n"
+	"\n"
+	"threads = [ threading.Thread(target=render, args=(c,)) for c in contexts ];\n"
+	"for t in threads: t.start();\n"
+	"for t in threads: t.join();\n"
+	"for c in contexts: pyp.write(c.getvalue());\n"
+	"?>\n"
+);
+
+
+
+# Setup the files used by a mode
+def setup_template(directory, thread_count):
+	with open(os.path.join(directory, "part.pyp"), "w") as f:
+		f.write(part_source.format(loop_count));
+	with open(os.path.join(directory, "bench.pyp"), "w") as f:
+		f.write(template_source.format(thread_count, total_renders // thread_count));
+
+	return [ "bench.pyp", "bench.txt" ];
+
+def setup_batch(directory, thread_count):
+	with open(os.path.join(directory, "list.txt"), "w") as f_list:
+		for i in range(total_renders):
+			name = "part{0:d}".format(i);
+			with open(os.path.join(directory, name + ".pyp"), "w") as f:
+				f.write(part_source.format(loop_count));
+			f_list.write("{0:s}.pyp\t{0:s}.txt\n".format(name));
+
+	return [ "--batch", "list.txt", "--jobs", str(thread_count), "--workers", "thread" ];
+
+
+
+# Time a single configuration
+def run(executable, mode, thread_count):
+	# Setup
+	directory = tempfile.mkdtemp(prefix="pyp-bench-");
+	best = None;
+	try:
+		cmd = [ executable ] + modes[mode](directory, thread_count);
+
+		for i in range(repeat_count):
+			t = time.time();
+			p = subprocess.Popen(cmd, cwd=directory, stdout=subprocess.PIPE, stderr=subprocess.PIPE);
+			c = p.communicate();
+			t = time.time() - t;
+
+			if (p.returncode != 0):
+				sys.stderr.write(c[1].decode("utf-8", "replace"));
+				return None;
+			if (best is None or t < best): best = t;
+	finally:
+		shutil.rmtree(directory, True);
+
+	# Done
+	return best;
+
+
+
+# Modes
+modes = {
+	"template": setup_template, # one template, rendering includes from threads with pyp.context()
+	"batch": setup_batch, # one file per render, using thread workers
+};
+
+
+
+# Main
+def main():
+	# Usage
+	if (len(sys.argv) < 2):
+		sys.stdout.write("Usage:\n    {0:s} pyp-executable [{1:s}] [max-threads]\n".format(os.path.basename(sys.argv[0]), "|".join(sorted(modes.keys()))));
+		return -1;
+
+	# Arguments
+	executable = os.path.abspath(sys.argv[1]);
+	mode = "template";
+	max_threads = thread_counts[-1];
+	for arg in sys.argv[2 : ]:
+		if (arg in modes):
+			mode = arg;
+		else:
+			max_threads = int(arg, 10);
+
+	# Run
+	sys.stdout.write("mode={0:s} renders={1:d} loop={2:d}\n".format(mode, total_renders, loop_count));
+	sys.stdout.write("{0:>8s} {1:>10s} {2:>10s} {3:>12s}\n".format("threads", "seconds", "speedup", "efficiency"));
+	base = None;
+	for thread_count in thread_counts:
+		if (thread_count > max_threads): break;
+
+		t = run(executable, mode, thread_count);
+		if (t is None):
+			sys.stdout.write("{0:>8d} {1:>10s}\n".format(thread_count, "error"));
+			return 1;
+
+		if (base is None): base = t;
+		sys.stdout.write("{0:>8d} {1:>10.3f} {2:>10.2f} {3:>11.0f}%\n".format(thread_count, t, base / t, 100.0 * base / t / thread_count));
+		sys.stdout.flush();
+
+	# Done
+	return 0;
+
+
+
+# Execute
+if (__name__ == "__main__"): sys.exit(main());
+
@@ -11,6 +11,8 @@ build.py gcc x86 py3 release
 :: build.py gcc x64 py2 release
 :: build.py gcc x64 py3 debug
 :: build.py gcc x64 py3 release
+:: build.py gcc x64 py3t debug
+:: build.py gcc x64 py3t release
 
 :: VC9 X86
 build.py vc9 x86 py2 debug
@@ -36,4 +38,14 @@ build.py vc10 x64 py2 release
 build.py vc10 x64 py3 debug
 build.py vc10 x64 py3 release
 
+:: Importable modules
+build.py gcc x86 py2 release module
+build.py gcc x86 py3 release module
+build.py vc10 x64 py3 release module
+
+
+:: Embeddable libraries
+build.py gcc x86 py3 release dll
+build.py vc10 x64 py3 release dll
+
 
@@ -69,6 +69,19 @@ def validate(target_info):
 
 
 
+# Sources and resources built into the target
+def target_sources(target_info):
+	if (target_info["type"] in [ "module" , "dll" ]):
+		return [ i for i in sources if i not in library_excluded_sources ];
+	return sources;
+
+def target_resources(target_info):
+	if (target_info["type"] == "module"):
+		return [];
+	return resources;
+
+
+
 # Execute a command
 def run_command(cmd, **kwargs):
 	# Run the command
@@ -100,6 +113,10 @@ def gcc_compile(output_name, target_info):
 	if (target_info["type"] == "dll"):
 		output_name = os.path.join(project_directories["bin"], "{0:s}-{1:s}{2:s}".format(output_name, "-".join(descriptor), ".dll"));
 		descriptor.extend([ "dll", ]);
+	elif (target_info["type"] == "module"):
+		# Python imports the module by its own name, so each build gets a directory
+		output_name = os.path.join(project_directories["bin"], "{0:s}-{1:s}-module".format(output_name, "-".join(descriptor)), "{0:s}{1:s}".format(output_name, ".pyd"));
+		descriptor.extend([ "module", ]);
 	else:
 		output_name = os.path.join(project_directories["bin"], "{0:s}-{1:s}{2:s}".format(output_name, "-".join(descriptor), ".exe"));
 
@@ -116,12 +133,20 @@ def gcc_compile(output_name, target_info):
 	compiler_flags = [
 		"-I{0:s}".format(os.path.join(python_versions[target_info["python"]]["architectures"][target_info["architecture"]]["path"], "include")),
 	];
+	if ("defines" in python_versions[target_info["python"]]):
+		compiler_flags.extend([ "-D{0:s}".format(i) for i in python_versions[target_info["python"]]["defines"] ]);
 	linker_flags = [
 		"-L{0:s}".format(os.path.join(python_versions[target_info["python"]]["architectures"][target_info["architecture"]]["path"], "libs")),
 	];
 	linker_libraries = [
 		"-l{0:s}".format(python_versions[target_info["python"]]["architectures"][target_info["architecture"]]["library"]),
 	];
+	if (target_info["type"] == "module"):
+		compiler_flags.append("-DPYP_EXTENSION_MODULE");
+		linker_flags.append("-shared");
+	elif (target_info["type"] == "dll"):
+		compiler_flags.append("-DPYP_LIBRARY_BUILD");
+		linker_flags.append("-shared");
 	for info in [ compiler_global_info , compiler_info ]:
 		if ("compiler_flags" in info and target_info["mode"] in info["compiler_flags"]):
 			compiler_flags.extend(info["compiler_flags"][target_info["mode"]]);
@@ -132,19 +157,20 @@ def gcc_compile(output_name, target_info):
 
 
 
-	# New directory
+	# New directories
 	object_dir = os.path.join(project_directories["obj"], "-".join(descriptor));
-	try:
-		os.makedirs(object_dir);
-	except OSError:
-		pass;
+	for directory in [ object_dir , os.path.dirname(output_name) ]:
+		try:
+			os.makedirs(directory);
+		except OSError:
+			pass;
 
 
 
 	# Compile object files
 	object_filenames = [];
 	compilation_errors = 0;
-	for input in sources:
+	for input in target_sources(target_info):
 		# Setup command
 		object_file = os.path.join(object_dir, "{0:s}.obj".format(os.path.splitext(input)[0]));
 		object_filenames.append(object_file);
@@ -164,7 +190,7 @@ def gcc_compile(output_name, target_info):
 
 
 	# Compile resources
-	for input in resources:
+	for input in target_resources(target_info):
 		# Setup command
 		res_file = os.path.join(object_dir, "{0:s}.res".format(os.path.splitext(input)[0]));
 		coff_file = os.path.join(object_dir, "{0:s}.coff".format(os.path.splitext(input)[0]));
@@ -232,6 +258,10 @@ def vc_compile(output_name, target_info):
 	if (target_info["type"] == "dll"):
 		output_name = os.path.join(project_directories["bin"], "{0:s}-{1:s}{2:s}".format(output_name, "-".join(descriptor), ".dll"));
 		descriptor.extend([ "dll", ]);
+	elif (target_info["type"] == "module"):
+		# Python imports the module by its own name, so each build gets a directory
+		output_name = os.path.join(project_directories["bin"], "{0:s}-{1:s}-module".format(output_name, "-".join(descriptor)), "{0:s}{1:s}".format(output_name, ".pyd"));
+		descriptor.extend([ "module", ]);
 	else:
 		output_name = os.path.join(project_directories["bin"], "{0:s}-{1:s}{2:s}".format(output_name, "-".join(descriptor), ".exe"));
 
@@ -252,6 +282,8 @@ def vc_compile(output_name, target_info):
 	compiler_flags = [
 		"-I{0:s}".format(os.path.join(python_versions[target_info["python"]]["architectures"][target_info["architecture"]]["path"], "include")),
 	];
+	if ("defines" in python_versions[target_info["python"]]):
+		compiler_flags.extend([ "/D{0:s}".format(i) for i in python_versions[target_info["python"]]["defines"] ]);
 	linker_flags = [
 		"/LIBPATH:{0:s}".format(os.path.join(python_versions[target_info["python"]]["architectures"][target_info["architecture"]]["path"], "libs")),
 	];
@@ -259,6 +291,12 @@ def vc_compile(output_name, target_info):
 		"{0:s}.lib".format(python_versions[target_info["python"]]["architectures"][target_info["architecture"]]["library"]),
 	];
 	cvtres_flags = [];
+	if (target_info["type"] == "module"):
+		compiler_flags.append("/DPYP_EXTENSION_MODULE");
+		linker_flags.append("/DLL");
+	elif (target_info["type"] == "dll"):
+		compiler_flags.append("/DPYP_LIBRARY_BUILD");
+		linker_flags.append("/DLL");
 	for info in [ compiler_global_info , compiler_info ]:
 		if ("compiler_flags" in info and target_info["mode"] in info["compiler_flags"]):
 			compiler_flags.extend(info["compiler_flags"][target_info["mode"]]);
@@ -271,19 +309,20 @@ def vc_compile(output_name, target_info):
 
 
 
-	# New directory
+	# New directories
 	object_dir = os.path.join(project_directories["obj"], "-".join(descriptor));
-	try:
-		os.makedirs(object_dir);
-	except OSError:
-		pass;
+	for directory in [ object_dir , os.path.dirname(output_name) ]:
+		try:
+			os.makedirs(directory);
+		except OSError:
+			pass;
 
 
 
 	# Compile object files
 	object_filenames = [];
 	compilation_errors = 0;
-	for input in sources:
+	for input in target_sources(target_info):
 		# Setup command
 		object_file = os.path.join(object_dir, "{0:s}.obj".format(os.path.splitext(input)[0]));
 		pdb_file = os.path.join(object_dir, "{0:s}.pdb".format(os.path.splitext(input)[0]));
@@ -307,7 +346,7 @@ def vc_compile(output_name, target_info):
 
 
 	# Compile resources
-	for input in resources:
+	for input in target_resources(target_info):
 		# Setup command
 		res_file = os.path.join(object_dir, "{0:s}.res".format(os.path.splitext(input)[0]));
 		coff_file = os.path.join(object_dir, "{0:s}.coff".format(os.path.splitext(input)[0]));
@@ -368,7 +407,7 @@ def vc_compile(output_name, target_info):
 def main():
 	build_modes = [ "debug" , "release" ];
 	build_architectures = [ "x86" , "x64" ];
-	build_types = [ "application" , "dll" ];
+	build_types = [ "application" , "dll" , "module" ];
 	compiler_classes = {
 		"gcc": gcc_compile,
 		"vc": vc_compile,
@@ -406,7 +445,7 @@ def main():
 	exe_name = compiler_classes[compilers[target_info["compiler"]]["compiler_class"]]("pyp", target_info);
 
 	# Run
-	if (run_after and exe_name is not None):
+	if (run_after and exe_name is not None and target_info["type"] == "application"):
 		cmd = [ exe_name, "--version" ];
 		sys.stdout.write("{0:s}\n".format("=" * 80));
 		p = subprocess.Popen(cmd);
@@ -10,12 +10,31 @@ sources = [
 	r"PypDataBuffer.c",
 	r"PypDataBufferModifiers.c",
 	r"PypModule.c",
+	r"PypEngine.c",
+	r"PypBatch.c",
+	r"PypData.c",
+	r"PypServer.c",
+	r"PypWatch.c",
+	r"PypDependencies.c",
+	r"PypCache.c",
+	r"PypIncludePaths.c",
+	r"PypSlots.c",
+	r"PypFragments.c",
 	r"Memory.c",
 	r"Map.c",
 	r"CommandLine.c",
 	r"Unicode.c",
 	r"Path.c",
 	r"File.c",
+	r"Thread.c",
+	r"PypStats.c",
+	r"Hash.c",
+	r"PypExtension.c",
+	r"PypLibrary.c",
+];
+library_excluded_sources = [
+	# The importable module and the shared library are loaded by a host, so they have no entry point
+	r"Main.c",
 ];
 resources = [
 	r"Resources.rc",
@@ -54,6 +73,16 @@ python_versions = {
 			},
 		},
 	},
+	"3t": {
+		# Free-threaded build; the define is not set by the windows headers
+		"architectures": {
+			"x64": {
+				"library": "python313t",
+				"path": r"Z:\Code\Python313x64"
+			},
+		},
+		"defines": [ "Py_GIL_DISABLED", ],
+	},
 };
 compilers = {
 	"gcc": {
@@ -635,6 +635,7 @@ commandLineArgumentValuesDescriptorGet(const CommandLineArgumentValuesDescriptor
 // Command line getting
 CommandLine*
 commandLineGet(int argc, char** argv) {
+#ifdef _WIN32
 	// Vars
 	CommandLine* cl;
 	int argCount;
@@ -659,13 +660,62 @@ commandLineGet(int argc, char** argv) {
 	cl->argumentValues = argList;
 
 	return cl;
+#else
+	// Vars
+	CommandLine* cl;
+	cmd_char** argList;
+	size_t characterCount;
+	size_t bufferLength;
+	size_t errorCount;
+	int i;
+
+	// Assertions
+	assert(argv != NULL);
+
+	cl = memAlloc(CommandLine);
+	if (cl == NULL) return NULL; // error
+
+	// Arguments are decoded from UTF-8
+	argList = memAllocArray(cmd_char*, argc + 1);
+	if (argList == NULL) {
+		// Error
+		memFree(cl);
+		return NULL;
+	}
+	for (i = 0; i < argc; ++i) {
+		if (unicodeUTF8Decode(argv[i], &argList[i], &characterCount, &bufferLength, &errorCount) != UNICODE_OKAY) {
+			// Error
+			while (i > 0) memFree(argList[--i]);
+			memFree(argList);
+			memFree(cl);
+			return NULL;
+		}
+	}
+	argList[argc] = NULL;
+
+	// Set
+	cl->argumentCount = argc;
+	cl->argumentValues = argList;
+
+	return cl;
+#endif
 }
 
 void
 commandLineDestroy(CommandLine* cl) {
+#ifndef _WIN32
+	// Vars
+	int i;
+#endif
+
 	assert(cl != NULL);
 
+	#ifdef _WIN32
 	LocalFree(cl->argumentValues);
+	#else
+	for (i = 0; i < cl->argumentCount; ++i) memFree(cl->argumentValues[i]);
+	memFree(cl->argumentValues);
+	#endif
 
 	memFree(cl);
 }
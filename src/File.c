@@ -1,8 +1,44 @@
+#ifdef __linux__
+#define _GNU_SOURCE // syncfs, copy_file_range
+#endif
 #include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <process.h>
 #include <share.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include "File.h"
 #include "Unicode.h"
+#include "Memory.h"
 #include "PypTypes.h"
+#include "Thread.h"
+
+
+
+// Headers
+static FileOpenStatus fileTemporaryOpen(const unicode_char* filename, unicode_char** temporaryFilename, FILE** outputFile);
+static PypBool fileContentsEqual(FILE* stream, const unicode_char* filename);
+static PypBool fileReplace(const unicode_char* temporaryFilename, const unicode_char* filename);
+static void fileRemove(const unicode_char* filename);
+static PypBool fileStreamSync(FILE* stream);
+static int fileStagedSync(const unicode_char* stagedFilename, void* devices, size_t* deviceCount);
+#ifndef _WIN32
+static char* fileDirectoryName(const unicode_char* filename);
+static PypBool fileDirectorySync(const char* directory);
+#endif
+
+static volatile ThreadAtomic fileTemporaryCounter = 0;
 
 
 
@@ -30,6 +66,7 @@ fileOpen(const char* filename, const char* mode, FILE** outputFile) {
 
 FileOpenStatus
 fileOpenUnicode(const unicode_char* filename, const char* mode, FILE** outputFile) {
+#ifdef _WIN32
 	// Vars
 	unicode_char uMode[4];
 	unicode_char* uModePos = uMode;
@@ -64,6 +101,26 @@ fileOpenUnicode(const unicode_char* filename, const char* mode, FILE** outputFil
 
 	// Okay
 	return FILE_OPEN_OKAY;
+#else
+	// Vars
+	FileOpenStatus status;
+	char* filenameUTF8;
+	size_t filenameUTF8Length;
+	size_t errorCount;
+
+	// Assertions
+	assert(filename != NULL);
+	assert(mode != NULL);
+	assert(outputFile != NULL);
+
+	// Filenames are UTF-8 encoded bytes on POSIX systems
+	if (unicodeUTF8Encode(filename, &filenameUTF8, &filenameUTF8Length, &errorCount) != UNICODE_OKAY) return FILE_OPEN_ERROR; // error
+
+	// Open
+	status = fileOpen(filenameUTF8, mode, outputFile);
+	memFree(filenameUTF8);
+	return status;
+#endif
 }
 
 void
@@ -75,5 +132,754 @@ fileClose(FILE* file) {
 	fclose(file);
 }
 
+PypBool
+fileExistsUnicode(const unicode_char* filename) {
+#ifdef _WIN32
+	// Vars
+	DWORD attributes;
+
+	// Assertions
+	assert(filename != NULL);
+
+	attributes = GetFileAttributesW(filename);
+	return (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0);
+#else
+	// Vars
+	char* filenameUTF8;
+	size_t filenameUTF8Length;
+	size_t errorCount;
+	struct stat info;
+	PypBool exists;
+
+	// Assertions
+	assert(filename != NULL);
+
+	if (unicodeUTF8Encode(filename, &filenameUTF8, &filenameUTF8Length, &errorCount) != UNICODE_OKAY) return PYP_FALSE; // error
+
+	exists = (stat(filenameUTF8, &info) == 0 && !S_ISDIR(info.st_mode));
+	memFree(filenameUTF8);
+	return exists;
+#endif
+}
+
+PypBool
+fileStampUnicode(const unicode_char* filename, FileStamp* stamp) {
+#ifdef _WIN32
+	// Vars
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	DWORD error;
+
+	// Assertions
+	assert(filename != NULL);
+	assert(stamp != NULL);
+
+	stamp->exists = PYP_FALSE;
+	stamp->modified = 0;
+	stamp->size = 0;
+
+	if (!GetFileAttributesExW(filename, GetFileExInfoStandard, &info)) {
+		error = GetLastError();
+		return (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND);
+	}
+
+	stamp->exists = PYP_TRUE;
+	stamp->modified = (int64_t) (((uint64_t) info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime);
+	stamp->size = (int64_t) (((uint64_t) info.nFileSizeHigh << 32) | info.nFileSizeLow);
+	return PYP_TRUE;
+#else
+	// Vars
+	char* filenameUTF8;
+	size_t filenameUTF8Length;
+	size_t errorCount;
+	struct stat info;
+	int result;
+
+	// Assertions
+	assert(filename != NULL);
+	assert(stamp != NULL);
+
+	stamp->exists = PYP_FALSE;
+	stamp->modified = 0;
+	stamp->size = 0;
+
+	if (unicodeUTF8Encode(filename, &filenameUTF8, &filenameUTF8Length, &errorCount) != UNICODE_OKAY) return PYP_FALSE; // error
+
+	result = stat(filenameUTF8, &info);
+	memFree(filenameUTF8);
+	if (result != 0) return (errno == ENOENT || errno == ENOTDIR);
+
+	// Nanoseconds where they're kept, so a file rewritten within a second still gets a new stamp
+	stamp->exists = PYP_TRUE;
+	#if defined(__APPLE__)
+	stamp->modified = (int64_t) info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+	#elif defined(__linux__)
+	stamp->modified = (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+	#else
+	stamp->modified = (int64_t) info.st_mtime * 1000000000;
+	#endif
+	stamp->size = (int64_t) info.st_size;
+	return PYP_TRUE;
+#endif
+}
+
+
+
+// Outputs which are only replaced if their content changes, or once they're safely on disk
+FileOpenStatus
+fileOutputOpen(const unicode_char* filename, PypBool onlyIfChanged, FileOutputSync sync, FileOutput* output) {
+	// Assertions
+	assert(filename != NULL);
+	assert(output != NULL);
+
+	output->stream = NULL;
+	output->filename = filename;
+	output->temporaryFilename = NULL;
+	output->onlyIfChanged = onlyIfChanged;
+	output->sync = sync;
+	output->staged = PYP_FALSE;
+
+	// Written directly
+	if (!onlyIfChanged && sync == FILE_OUTPUT_SYNC_NONE) return fileOpenUnicode(filename, "wb", &output->stream);
+
+	// Staged under a name the committing process can work out on its own
+	if (sync == FILE_OUTPUT_SYNC_GROUP) {
+		if ((output->temporaryFilename = fileOutputStagedFilename(filename)) == NULL) return FILE_OPEN_ERROR; // error
+		if (fileOpenUnicode(output->temporaryFilename, "w+b", &output->stream) == FILE_OPEN_OKAY) return FILE_OPEN_OKAY;
+
+		// Error
+		memFree(output->temporaryFilename);
+		output->temporaryFilename = NULL;
+		return FILE_OPEN_ERROR;
+	}
+
+	// Written next to the output, so it can be renamed into place
+	return fileTemporaryOpen(filename, &output->temporaryFilename, &output->stream);
+}
+
+FileOutputStatus
+fileOutputClose(FileOutput* output) {
+	// Vars
+	PypBool unchanged;
+	PypBool okay;
+
+	// Assertions
+	assert(output != NULL);
+	assert(output->stream != NULL);
+
+	// Written directly
+	if (output->temporaryFilename == NULL) {
+		okay = (fclose(output->stream) == 0);
+		output->stream = NULL;
+		return okay ? FILE_OUTPUT_OKAY : FILE_OUTPUT_ERROR;
+	}
+
+	// Compare
+	okay = (fflush(output->stream) == 0);
+	unchanged = (okay && output->onlyIfChanged && fileContentsEqual(output->stream, output->filename));
+	if (okay && !unchanged && output->sync == FILE_OUTPUT_SYNC_FILE) okay = fileStreamSync(output->stream);
+	if (fclose(output->stream) != 0) okay = PYP_FALSE;
+	output->stream = NULL;
+
+	// Replace the old file only if something changed, so its modification time is otherwise kept
+	if (okay && !unchanged) {
+		if (output->sync == FILE_OUTPUT_SYNC_GROUP) {
+			// Renamed later by fileOutputCommit
+			output->staged = PYP_TRUE;
+		}
+		else {
+			okay = fileReplace(output->temporaryFilename, output->filename);
+			#ifndef _WIN32
+			if (okay && output->sync == FILE_OUTPUT_SYNC_FILE) {
+				// The rename itself is only durable once the directory is flushed
+				char* directory = fileDirectoryName(output->filename);
+				okay = (directory != NULL && fileDirectorySync(directory));
+				if (directory != NULL) memFree(directory);
+			}
+			#endif
+		}
+	}
+	if (!okay || unchanged) fileRemove(output->temporaryFilename);
+
+	// Done
+	memFree(output->temporaryFilename);
+	output->temporaryFilename = NULL;
+	if (!okay) return FILE_OUTPUT_ERROR;
+	return unchanged ? FILE_OUTPUT_UNCHANGED : FILE_OUTPUT_OKAY;
+}
+
+unicode_char*
+fileOutputStagedFilename(const unicode_char* filename) {
+	// Vars
+	static const char suffix[] = ".pyp-staged";
+	unicode_char* stagedFilename;
+	size_t filenameLength;
+	size_t i;
+
+	// Assertions
+	assert(filename != NULL);
+
+	// Fixed, so a batch parent can commit files its worker processes staged
+	filenameLength = wcslen(filename);
+	stagedFilename = memAllocArray(unicode_char, filenameLength + sizeof(suffix));
+	if (stagedFilename == NULL) return NULL; // error
+
+	memcpy(stagedFilename, filename, sizeof(unicode_char) * filenameLength);
+	for (i = 0; i < sizeof(suffix); ++i) stagedFilename[filenameLength + i] = (unsigned char) suffix[i];
+
+	return stagedFilename;
+}
+
+size_t
+fileOutputCommit(const unicode_char* const* filenames, size_t count, PypBool* committed) {
+	// Vars
+	unicode_char** stagedFilenames;
+	void* devices = NULL;
+	size_t deviceCount = 0;
+	size_t failureCount = 0;
+	size_t i;
+	#ifndef _WIN32
+	char** directories = NULL;
+	PypBool* directoriesSynced = NULL;
+	size_t directoryCount = 0;
+	size_t j;
+	#endif
+
+	// Assertions
+	assert(filenames != NULL || count == 0);
+	assert(committed != NULL || count == 0);
+
+	if (count == 0) return 0;
+
+	// Setup
+	stagedFilenames = memAllocArray(unicode_char*, count);
+	#ifdef __linux__
+	devices = memAllocArray(dev_t, count);
+	#endif
+	#ifndef _WIN32
+	directories = memAllocArray(char*, count);
+	directoriesSynced = memAllocArray(PypBool, count);
+	#endif
+	for (i = 0; i < count; ++i) {
+		committed[i] = PYP_FALSE;
+		if (stagedFilenames != NULL) stagedFilenames[i] = fileOutputStagedFilename(filenames[i]);
+	}
+
+	// Flush every staged file first, so the disk sees the whole group at once
+	for (i = 0; i < count; ++i) {
+		int sr;
+
+		if (stagedFilenames == NULL || stagedFilenames[i] == NULL) continue; // error
+		#ifdef __linux__
+		if (devices == NULL) continue; // error
+		#endif
+		#ifndef _WIN32
+		if (directories == NULL || directoriesSynced == NULL) continue; // error
+		#endif
+
+		sr = fileStagedSync(stagedFilenames[i], devices, &deviceCount);
+		if (sr == 0) {
+			// Nothing was staged because the output was unchanged
+			committed[i] = PYP_TRUE;
+			memFree(stagedFilenames[i]);
+			stagedFilenames[i] = NULL;
+		}
+		else if (sr < 0) {
+			// Error
+			fileRemove(stagedFilenames[i]);
+			memFree(stagedFilenames[i]);
+			stagedFilenames[i] = NULL;
+		}
+	}
+
+	// Rename each into place
+	for (i = 0; i < count; ++i) {
+		if (stagedFilenames == NULL || stagedFilenames[i] == NULL) continue;
+
+		if (fileReplace(stagedFilenames[i], filenames[i])) {
+			committed[i] = PYP_TRUE;
+		}
+		else {
+			// Error
+			fileRemove(stagedFilenames[i]);
+		}
+	}
+
+	#ifndef _WIN32
+	// Flush each directory renamed into once
+	for (i = 0; i < count; ++i) {
+		char* directory;
+
+		if (stagedFilenames == NULL || stagedFilenames[i] == NULL || !committed[i]) continue;
+
+		if ((directory = fileDirectoryName(filenames[i])) == NULL) {
+			// Error
+			committed[i] = PYP_FALSE;
+			continue;
+		}
+		for (j = 0; j < directoryCount && strcmp(directories[j], directory) != 0; ++j);
+		if (j < directoryCount) {
+			memFree(directory);
+		}
+		else {
+			directories[directoryCount] = directory;
+			directoriesSynced[directoryCount] = fileDirectorySync(directory);
+			++directoryCount;
+		}
+		committed[i] = directoriesSynced[j];
+	}
+	#endif
+
+	// Clean
+	for (i = 0; i < count; ++i) {
+		if (!committed[i]) ++failureCount;
+		if (stagedFilenames != NULL && stagedFilenames[i] != NULL) memFree(stagedFilenames[i]);
+	}
+	if (stagedFilenames != NULL) memFree(stagedFilenames);
+	if (devices != NULL) memFree(devices);
+	#ifndef _WIN32
+	for (j = 0; j < directoryCount; ++j) memFree(directories[j]);
+	if (directories != NULL) memFree(directories);
+	if (directoriesSynced != NULL) memFree(directoriesSynced);
+	#endif
+
+	// Done
+	return failureCount;
+}
+
+void
+fileOutputDiscard(const unicode_char* filename) {
+	// Vars
+	unicode_char* stagedFilename;
+
+	// Assertions
+	assert(filename != NULL);
+
+	if ((stagedFilename = fileOutputStagedFilename(filename)) == NULL) return; // error
+	fileRemove(stagedFilename);
+	memFree(stagedFilename);
+}
+
+FileOpenStatus
+fileTemporaryOpen(const unicode_char* filename, unicode_char** temporaryFilename, FILE** outputFile) {
+	// Vars
+	char suffix[64];
+	size_t filenameLength;
+	size_t suffixLength;
+	size_t attempt;
+	size_t i;
+	int fd;
+	#ifndef _WIN32
+	char* temporaryFilenameUTF8;
+	size_t temporaryFilenameUTF8Length;
+	size_t errorCount;
+	#endif
+
+	// Assertions
+	assert(filename != NULL);
+	assert(temporaryFilename != NULL);
+	assert(outputFile != NULL);
+
+	filenameLength = wcslen(filename);
+	*temporaryFilename = memAllocArray(unicode_char, filenameLength + sizeof(suffix));
+	if (*temporaryFilename == NULL) return FILE_OPEN_ERROR; // error
+	memcpy(*temporaryFilename, filename, sizeof(unicode_char) * filenameLength);
+
+	// The name only needs to be unlikely to collide; creation fails if it exists
+	for (attempt = 0; attempt < 100; ++attempt) {
+		#ifdef _WIN32
+		suffixLength = (size_t) sprintf(suffix, ".%lu-%lu.tmp", (unsigned long) _getpid(), (unsigned long) threadAtomicAdd(&fileTemporaryCounter, 1));
+		#else
+		suffixLength = (size_t) sprintf(suffix, ".%lu-%lu.tmp", (unsigned long) getpid(), (unsigned long) threadAtomicAdd(&fileTemporaryCounter, 1));
+		#endif
+		for (i = 0; i <= suffixLength; ++i) (*temporaryFilename)[filenameLength + i] = (unsigned char) suffix[i];
+
+		#ifdef _WIN32
+		fd = _wopen(*temporaryFilename, _O_RDWR | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+		if (fd >= 0) {
+			if ((*outputFile = _wfdopen(fd, L"w+b")) != NULL) return FILE_OPEN_OKAY;
+			_close(fd);
+			fileRemove(*temporaryFilename);
+			break;
+		}
+		if (errno != EEXIST) break;
+		#else
+		if (unicodeUTF8Encode(*temporaryFilename, &temporaryFilenameUTF8, &temporaryFilenameUTF8Length, &errorCount) != UNICODE_OKAY) break; // error
+
+		fd = open(temporaryFilenameUTF8, O_RDWR | O_CREAT | O_EXCL, 0666);
+		if (fd >= 0) {
+			if ((*outputFile = fdopen(fd, "w+b")) != NULL) {
+				memFree(temporaryFilenameUTF8);
+				return FILE_OPEN_OKAY;
+			}
+			close(fd);
+			unlink(temporaryFilenameUTF8);
+			memFree(temporaryFilenameUTF8);
+			break;
+		}
+		memFree(temporaryFilenameUTF8);
+		if (errno != EEXIST) break;
+		#endif
+	}
+
+	// Error
+	memFree(*temporaryFilename);
+	*temporaryFilename = NULL;
+	return FILE_OPEN_ERROR;
+}
+
+PypBool
+fileContentsEqual(FILE* stream, const unicode_char* filename) {
+	// Vars
+	char buffer1[8192];
+	char buffer2[8192];
+	FILE* existing;
+	size_t length1;
+	size_t length2;
+	PypBool equal = PYP_FALSE;
+
+	// Assertions
+	assert(stream != NULL);
+	assert(filename != NULL);
+
+	// A missing file is always different
+	if (fileOpenUnicode(filename, "rb", &existing) != FILE_OPEN_OKAY) return PYP_FALSE;
+	rewind(stream);
+
+	// Compare until the first difference
+	while (1) {
+		length1 = fread(buffer1, sizeof(char), sizeof(buffer1), stream);
+		length2 = fread(buffer2, sizeof(char), sizeof(buffer2), existing);
+		if (length1 != length2 || memcmp(buffer1, buffer2, length1) != 0) break;
+		if (length1 < sizeof(buffer1)) {
+			equal = (!ferror(stream) && !ferror(existing));
+			break;
+		}
+	}
+
+	// Done
+	fclose(existing);
+	return equal;
+}
+
+PypBool
+fileReplace(const unicode_char* temporaryFilename, const unicode_char* filename) {
+#ifdef _WIN32
+	return MoveFileExW(temporaryFilename, filename, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	// Vars
+	char* temporaryFilenameUTF8 = NULL;
+	char* filenameUTF8 = NULL;
+	size_t length;
+	size_t errorCount;
+	struct stat info;
+	PypBool okay = PYP_FALSE;
+
+	if (
+		unicodeUTF8Encode(temporaryFilename, &temporaryFilenameUTF8, &length, &errorCount) == UNICODE_OKAY &&
+		unicodeUTF8Encode(filename, &filenameUTF8, &length, &errorCount) == UNICODE_OKAY
+	) {
+		// Keep the permissions of the file being replaced
+		if (stat(filenameUTF8, &info) == 0) chmod(temporaryFilenameUTF8, info.st_mode & 07777);
+
+		okay = (rename(temporaryFilenameUTF8, filenameUTF8) == 0);
+	}
+
+	// Done
+	if (temporaryFilenameUTF8 != NULL) memFree(temporaryFilenameUTF8);
+	if (filenameUTF8 != NULL) memFree(filenameUTF8);
+	return okay;
+#endif
+}
+
+void
+fileRemove(const unicode_char* filename) {
+#ifdef _WIN32
+	_wremove(filename);
+#else
+	// Vars
+	char* filenameUTF8;
+	size_t filenameUTF8Length;
+	size_t errorCount;
+
+	if (unicodeUTF8Encode(filename, &filenameUTF8, &filenameUTF8Length, &errorCount) != UNICODE_OKAY) return; // error
+	unlink(filenameUTF8);
+	memFree(filenameUTF8);
+#endif
+}
+
+
+
+// Flushing to disk
+PypBool
+fileStreamSync(FILE* stream) {
+	assert(stream != NULL);
+
+	#ifdef _WIN32
+	return (_commit(_fileno(stream)) == 0);
+	#else
+	return (fsync(fileno(stream)) == 0);
+	#endif
+}
+
+int
+fileStagedSync(const unicode_char* stagedFilename, void* devices, size_t* deviceCount) {
+	// Vars
+	int fd;
+	int result = 1;
+	#ifndef _WIN32
+	char* filenameUTF8;
+	size_t filenameUTF8Length;
+	size_t errorCount;
+	#endif
+	#ifdef __linux__
+	dev_t* deviceList = (dev_t*) devices;
+	struct stat info;
+	size_t i;
+	#endif
+
+	// Assertions
+	assert(stagedFilename != NULL);
+	assert(deviceCount != NULL);
+
+	// Open; missing means nothing was staged
+	#ifdef _WIN32
+	fd = _wopen(stagedFilename, _O_RDWR | _O_BINARY);
+	if (fd < 0) return (errno == ENOENT) ? 0 : -1;
+	#else
+	if (unicodeUTF8Encode(stagedFilename, &filenameUTF8, &filenameUTF8Length, &errorCount) != UNICODE_OKAY) return -1; // error
+	fd = open(filenameUTF8, O_RDONLY);
+	memFree(filenameUTF8);
+	if (fd < 0) return (errno == ENOENT) ? 0 : -1;
+	#endif
+
+	// Flush
+	#ifdef _WIN32
+	if (_commit(fd) != 0) result = -1;
+	_close(fd);
+	#elif defined(__linux__)
+	// One syncfs per filesystem covers every file staged on it
+	if (fstat(fd, &info) != 0) {
+		result = -1;
+	}
+	else {
+		for (i = 0; i < *deviceCount && deviceList[i] != info.st_dev; ++i);
+		if (i == *deviceCount) {
+			if (syncfs(fd) != 0) result = -1;
+			else deviceList[(*deviceCount)++] = info.st_dev;
+		}
+	}
+	close(fd);
+	#else
+	if (fsync(fd) != 0) result = -1;
+	close(fd);
+	#endif
+
+	// Done
+	return result;
+}
+
+#ifndef _WIN32
+char*
+fileDirectoryName(const unicode_char* filename) {
+	// Vars
+	char* directory;
+	size_t directoryLength;
+	size_t errorCount;
+	char* separator;
+
+	// Assertions
+	assert(filename != NULL);
+
+	if (unicodeUTF8Encode(filename, &directory, &directoryLength, &errorCount) != UNICODE_OKAY) return NULL; // error
+
+	// Strip the last component; the encoded name is always long enough to hold "."
+	separator = strrchr(directory, '/');
+	if (separator == NULL) strcpy(directory, ".");
+	else if (separator == directory) directory[1] = '\x00';
+	else *separator = '\x00';
+
+	return directory;
+}
+
+PypBool
+fileDirectorySync(const char* directory) {
+	// Vars
+	int fd;
+	PypBool okay;
+
+	// Assertions
+	assert(directory != NULL);
+
+	if ((fd = open(directory, O_RDONLY)) < 0) return PYP_FALSE; // error
+	okay = (fsync(fd) == 0);
+	close(fd);
+
+	return okay;
+}
+#endif
+
+
+
+// Copying
+PypBool
+fileStreamCopy(FILE* source, FILE* target) {
+	// Vars
+	long int start;
+	#ifdef _WIN32
+	char buffer[16384];
+	size_t length;
+	#endif
+
+	// Assertions
+	assert(source != NULL);
+	assert(target != NULL);
+
+	if (fflush(target) != 0 || (start = ftell(source)) < 0) return PYP_FALSE; // error
+
+	#ifdef _WIN32
+	// Buffered
+	while ((length = fread(buffer, sizeof(char), sizeof(buffer), source)) > 0) {
+		if (fwrite(buffer, sizeof(char), length, target) != length) return PYP_FALSE; // error
+	}
+	return !ferror(source);
+	#else
+	// The stream may have read ahead, so the descriptor is moved back to its logical position
+	if (lseek(fileno(source), start, SEEK_SET) < 0) return PYP_FALSE; // error
+	if (!fileDescriptorCopy(fileno(source), fileno(target))) return PYP_FALSE; // error
+	return (fseek(source, 0, SEEK_END) == 0);
+	#endif
+}
+
+
+
+// Complete reads and writes on pipes
+PypBool
+fileDescriptorWrite(int fd, const void* data, size_t length) {
+	// Vars
+	const char* pos = (const char*) data;
+	#ifdef _WIN32
+	int count;
+	#else
+	ssize_t count;
+	#endif
+
+	while (length > 0) {
+		#ifdef _WIN32
+		count = _write(fd, pos, (length > 0x40000000) ? 0x40000000 : (unsigned int) length);
+		if (count < 0) return PYP_FALSE; // error
+		#else
+		count = write(fd, pos, length);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			return PYP_FALSE; // error
+		}
+		#endif
+		pos += count;
+		length -= (size_t) count;
+	}
+
+	return PYP_TRUE;
+}
+
+PypBool
+fileDescriptorReadUpTo(int fd, void* data, size_t length, size_t* readLength) {
+	// Vars
+	char* pos = (char*) data;
+	#ifdef _WIN32
+	int count;
+	#else
+	ssize_t count;
+	#endif
+
+	*readLength = 0;
+	while (length > 0) {
+		#ifdef _WIN32
+		count = _read(fd, pos, (length > 0x40000000) ? 0x40000000 : (unsigned int) length);
+		if (count < 0) return PYP_FALSE; // error
+		#else
+		count = read(fd, pos, length);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			return PYP_FALSE; // error
+		}
+		#endif
+		if (count == 0) break; // end of file
+		pos += count;
+		length -= (size_t) count;
+		*readLength += (size_t) count;
+	}
+
+	return PYP_TRUE;
+}
+
+#ifndef _WIN32
+PypBool
+fileDescriptorRead(int fd, void* data, size_t length) {
+	// Vars
+	char* pos = (char*) data;
+	ssize_t count;
+
+	while (length > 0) {
+		count = read(fd, pos, length);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			return PYP_FALSE; // error
+		}
+		if (count == 0) return PYP_FALSE; // end of file
+		pos += count;
+		length -= (size_t) count;
+	}
+
+	return PYP_TRUE;
+}
+
+PypBool
+fileDescriptorCopy(int sourceFd, int targetFd) {
+	// Vars
+	char buffer[16384];
+	ssize_t length;
+	ssize_t writeLength;
+	size_t offset;
+
+	#ifdef __linux__
+	// In the kernel where possible; copy_file_range needs two regular files, sendfile only a regular source
+	while (1) {
+		length = copy_file_range(sourceFd, NULL, targetFd, NULL, 1 << 30, 0);
+		if (length == 0) return PYP_TRUE;
+		if (length < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP || errno == EBADF) break; // fallback
+			return PYP_FALSE; // error
+		}
+	}
+	while (1) {
+		length = sendfile(targetFd, sourceFd, NULL, 1 << 30);
+		if (length == 0) return PYP_TRUE;
+		if (length < 0) {
+			if (errno == EINTR || errno == EAGAIN) continue;
+			if (errno == EINVAL || errno == ENOSYS) break; // fallback
+			return PYP_FALSE; // error
+		}
+	}
+	#endif
+
+	// Read and write
+	while ((length = read(sourceFd, buffer, sizeof(buffer))) != 0) {
+		if (length < 0) {
+			if (errno == EINTR) continue;
+			return PYP_FALSE; // error
+		}
+		for (offset = 0; offset < (size_t) length; ) {
+			writeLength = write(targetFd, &buffer[offset], (size_t) length - offset);
+			if (writeLength < 0 && errno == EINTR) continue;
+			if (writeLength <= 0) return PYP_FALSE; // error
+			offset += (size_t) writeLength;
+		}
+	}
+
+	return PYP_TRUE;
+}
+#endif
+
 
 
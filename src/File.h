@@ -4,7 +4,9 @@
 
 
 #include <stdio.h>
+#include <stdint.h>
 #include "Unicode.h"
+#include "PypTypes.h"
 
 
 
@@ -13,10 +15,54 @@ typedef enum FileOpenStatus_ {
 	FILE_OPEN_ERROR = 0x1,
 } FileOpenStatus;
 
+typedef enum FileOutputStatus_ {
+	FILE_OUTPUT_OKAY = 0x0,
+	FILE_OUTPUT_UNCHANGED = 0x1,
+	FILE_OUTPUT_ERROR = 0x2,
+} FileOutputStatus;
+
+typedef enum FileOutputSync_ {
+	FILE_OUTPUT_SYNC_NONE = 0x0,
+	FILE_OUTPUT_SYNC_FILE = 0x1, // each output is flushed to disk before it's renamed into place
+	FILE_OUTPUT_SYNC_GROUP = 0x2, // outputs are left staged until fileOutputCommit flushes and renames them together
+} FileOutputSync;
+
+typedef struct FileOutput_ {
+	FILE* stream;
+	const unicode_char* filename; // must stay valid until closed
+	unicode_char* temporaryFilename; // NULL if the file is written directly
+	PypBool onlyIfChanged;
+	FileOutputSync sync;
+	PypBool staged; // set when closing left the output staged for fileOutputCommit
+} FileOutput;
+
+typedef struct FileStamp_ {
+	PypBool exists;
+	int64_t modified; // in the finest unit the platform keeps; only compared for equality
+	int64_t size;
+} FileStamp;
+
 
 FileOpenStatus fileOpen(const char* filename, const char* mode, FILE** outputFile);
 FileOpenStatus fileOpenUnicode(const unicode_char* filename, const char* mode, FILE** outputFile);
 void fileClose(FILE* file);
+PypBool fileExistsUnicode(const unicode_char* filename); // true for anything which can be opened as a file, which excludes directories
+PypBool fileStampUnicode(const unicode_char* filename, FileStamp* stamp); // a missing file is stamped as missing, which isn't an error
+
+FileOpenStatus fileOutputOpen(const unicode_char* filename, PypBool onlyIfChanged, FileOutputSync sync, FileOutput* output);
+FileOutputStatus fileOutputClose(FileOutput* output);
+unicode_char* fileOutputStagedFilename(const unicode_char* filename);
+size_t fileOutputCommit(const unicode_char* const* filenames, size_t count, PypBool* committed); // returns the number of failures
+void fileOutputDiscard(const unicode_char* filename);
+
+PypBool fileStreamCopy(FILE* source, FILE* target); // copies the rest of source, in the kernel where possible
+
+PypBool fileDescriptorWrite(int fd, const void* data, size_t length);
+PypBool fileDescriptorReadUpTo(int fd, void* data, size_t length, size_t* readLength); // stops short only at the end of the file
+#ifndef _WIN32
+PypBool fileDescriptorRead(int fd, void* data, size_t length);
+PypBool fileDescriptorCopy(int sourceFd, int targetFd);
+#endif
 
 
 
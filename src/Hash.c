@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <string.h>
+#include "Hash.h"
+
+
+
+// Headers
+static void hashBlock(HashState* hash, const unsigned char* block);
+
+static const uint32_t hashRoundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define HASH_ROTATE(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+
+
+// Hashing
+void
+hashInit(HashState* hash) {
+	assert(hash != NULL);
+
+	hash->state[0] = 0x6a09e667;
+	hash->state[1] = 0xbb67ae85;
+	hash->state[2] = 0x3c6ef372;
+	hash->state[3] = 0xa54ff53a;
+	hash->state[4] = 0x510e527f;
+	hash->state[5] = 0x9b05688c;
+	hash->state[6] = 0x1f83d9ab;
+	hash->state[7] = 0x5be0cd19;
+	hash->length = 0;
+	hash->blockLength = 0;
+}
+
+void
+hashUpdate(HashState* hash, const void* data, size_t length) {
+	// Vars
+	const unsigned char* pos = (const unsigned char*) data;
+	size_t count;
+
+	// Assertions
+	assert(hash != NULL);
+	assert(data != NULL || length == 0);
+
+	hash->length += length;
+
+	// Finish a partial block
+	if (hash->blockLength > 0) {
+		count = 64 - hash->blockLength;
+		if (count > length) count = length;
+		memcpy(&hash->block[hash->blockLength], pos, count);
+		hash->blockLength += count;
+		pos += count;
+		length -= count;
+
+		if (hash->blockLength < 64) return;
+		hashBlock(hash, hash->block);
+		hash->blockLength = 0;
+	}
+
+	// Whole blocks
+	for (; length >= 64; pos += 64, length -= 64) {
+		hashBlock(hash, pos);
+	}
+
+	// Remainder
+	memcpy(hash->block, pos, length);
+	hash->blockLength = length;
+}
+
+void
+hashFinish(HashState* hash, unsigned char* digest) {
+	// Vars
+	uint64_t bitLength;
+	int i;
+
+	// Assertions
+	assert(hash != NULL);
+	assert(digest != NULL);
+
+	bitLength = hash->length * 8;
+
+	// Padding, then the length in bits
+	hash->block[hash->blockLength++] = 0x80;
+	if (hash->blockLength > 56) {
+		memset(&hash->block[hash->blockLength], 0, 64 - hash->blockLength);
+		hashBlock(hash, hash->block);
+		hash->blockLength = 0;
+	}
+	memset(&hash->block[hash->blockLength], 0, 56 - hash->blockLength);
+	for (i = 0; i < 8; ++i) {
+		hash->block[63 - i] = (unsigned char) (bitLength >> (i * 8));
+	}
+	hashBlock(hash, hash->block);
+
+	// Big endian output
+	for (i = 0; i < 8; ++i) {
+		digest[i * 4] = (unsigned char) (hash->state[i] >> 24);
+		digest[i * 4 + 1] = (unsigned char) (hash->state[i] >> 16);
+		digest[i * 4 + 2] = (unsigned char) (hash->state[i] >> 8);
+		digest[i * 4 + 3] = (unsigned char) (hash->state[i]);
+	}
+}
+
+void
+hashBlock(HashState* hash, const unsigned char* block) {
+	// Vars
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t t1, t2;
+	int i;
+
+	// Message schedule
+	for (i = 0; i < 16; ++i) {
+		w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) | ((uint32_t) block[i * 4 + 2] << 8) | ((uint32_t) block[i * 4 + 3]);
+	}
+	for (i = 16; i < 64; ++i) {
+		t1 = HASH_ROTATE(w[i - 2], 17) ^ HASH_ROTATE(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		t2 = HASH_ROTATE(w[i - 15], 7) ^ HASH_ROTATE(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		w[i] = t1 + w[i - 7] + t2 + w[i - 16];
+	}
+
+	// Rounds
+	a = hash->state[0];
+	b = hash->state[1];
+	c = hash->state[2];
+	d = hash->state[3];
+	e = hash->state[4];
+	f = hash->state[5];
+	g = hash->state[6];
+	h = hash->state[7];
+	for (i = 0; i < 64; ++i) {
+		t1 = h + (HASH_ROTATE(e, 6) ^ HASH_ROTATE(e, 11) ^ HASH_ROTATE(e, 25)) + ((e & f) ^ (~e & g)) + hashRoundConstants[i] + w[i];
+		t2 = (HASH_ROTATE(a, 2) ^ HASH_ROTATE(a, 13) ^ HASH_ROTATE(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	hash->state[0] += a;
+	hash->state[1] += b;
+	hash->state[2] += c;
+	hash->state[3] += d;
+	hash->state[4] += e;
+	hash->state[5] += f;
+	hash->state[6] += g;
+	hash->state[7] += h;
+}
+
+
+
+// Formatting
+void
+hashToHex(const unsigned char* digest, char* hex) {
+	// Vars
+	static const char digits[] = "0123456789abcdef";
+	size_t i;
+
+	// Assertions
+	assert(digest != NULL);
+	assert(hex != NULL);
+
+	for (i = 0; i < HASH_DIGEST_LENGTH; ++i) {
+		hex[i * 2] = digits[digest[i] >> 4];
+		hex[i * 2 + 1] = digits[digest[i] & 0x0F];
+	}
+	hex[HASH_HEX_LENGTH] = '\x00';
+}
+
@@ -0,0 +1,33 @@
+#ifndef __HASH_H
+#define __HASH_H
+
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+#define HASH_DIGEST_LENGTH 32
+#define HASH_HEX_LENGTH (HASH_DIGEST_LENGTH * 2)
+
+typedef struct HashState_ {
+	uint32_t state[8];
+	uint64_t length; // bytes hashed so far
+	unsigned char block[64];
+	size_t blockLength;
+} HashState;
+
+
+
+// SHA-256
+void hashInit(HashState* hash);
+void hashUpdate(HashState* hash, const void* data, size_t length);
+void hashFinish(HashState* hash, unsigned char* digest);
+
+void hashToHex(const unsigned char* digest, char* hex);
+
+
+
+#endif
+
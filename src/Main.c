@@ -12,6 +12,12 @@
 #include "PypDataBufferModifiers.h"
 #include "CommandLine.h"
 #include "PypModule.h"
+#include "PypEngine.h"
+#include "PypBatch.h"
+#include "PypData.h"
+#include "PypServer.h"
+#include "PypWatch.h"
+#include "PypStats.h"
 #include "Path.h"
 #include "File.h"
 #include "../res/Resources.h"
@@ -28,9 +34,10 @@ typedef struct ArgumentError_ {
 int main(int argc, char** argv);
 static int mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const CommandLineArgumentValuesDescriptor* clvd);
 static CommandLineDescriptor* commandLineSetup();
-static PypTagGroup* tagsInit(const PypProcessingInfo* piCodeBlock, const PypProcessingInfo* piCodeExpression, int allowContinuation);
 static void usage(const cmd_char* applicationName, const CommandLineDescriptor* cld, FILE* outputStream);
 static int compareCmdStringToCharString(const cmd_char* cmdString, const char* charString);
+static const char* argumentNumericValue(const cmd_char* argument, long int* numericValue);
+static const char* argumentThresholdsValue(const cmd_char* argument, long int* thresholds, size_t thresholdCount);
 
 static ArgumentError* errorListExtend(const char* message);
 static void errorListDelete(ArgumentError* errorList);
@@ -146,25 +153,47 @@ main(int argc, char** argv) {
 int
 mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const CommandLineArgumentValuesDescriptor* clvd) {
 	// Vars
-	PypProcessingInfo* piMain = NULL;
-	PypProcessingInfo* piCodeBlock = NULL;
-	PypProcessingInfo* piCodeExpression = NULL;
-	PypTagGroup* optimizedTags = NULL;
-	PypPythonState* pythonState = NULL;
-	PypReaderSettings* readSettings = NULL;
+	PypEngine* engine = NULL;
+	PypEngineSettings engineSettings;
+	PypBatch* batch = NULL;
+	PypBatchSettings batchSettings;
+	PypDataSettings dataSettings;
+	PypServerSettings serverSettings;
+	PypWatchSettings watchSettings;
+	PyObject* globals = NULL;
 	FILE* inputStream = NULL;
 	FILE* outputStream = NULL;
+	FileOutput output;
 	cmd_char* inputFilename = NULL;
 	cmd_char* outputFilename = NULL;
+	cmd_char* batchFilename = NULL;
+	cmd_char* dataFilename = NULL;
+	cmd_char* outputPattern = NULL;
+	cmd_char* serverSocket = NULL;
+	cmd_char* clientSocket = NULL;
+	cmd_char* dependencyFilename = NULL;
+	PypDependencies* dependencies = NULL;
+	cmd_char* cacheDirectory = NULL;
+	char* cacheKey = NULL;
+	PypSize cacheMaxSize = 0;
+	const char* cacheOptions[10];
+	PypCacheStatus cs;
+	cmd_char* fragmentCacheDirectory = NULL;
+	PypCache* fragmentCache = NULL;
+	PypSize fragmentCacheMemory = 32 * 1024 * 1024;
+	char* preludeModules = NULL;
+	char* includePath = NULL;
+	char* globalsSource = NULL;
+	PypBool showStats = PYP_FALSE;
+	PypBool startupProfile = PYP_FALSE;
+	PypStatsValue startTime = pypStatsClock();
+	PypBool watch = PYP_FALSE;
 	int returnCode = 0;
 
 	CommandLineArgumentValue* v;
-	PypReaderFlags flags = PYP_READER_FLAG_ON_UNCLOSED_TAG_ERROR | PYP_READER_FLAG_ON_CONTINUATION_UNMATCHED_TAG_ERROR | PYP_READER_FLAG_ON_CONTINUATION_MISMATCHED_TAG_ERROR;
-	PypSize readBlockCount = 2;
-	PypSize readBlockSize = 10240;
-	int allowContinuation = 1;
+	long int numericValue;
+	const char* numericError;
 	FILE* errorStream = stderr;
-	PypDataBufferModifier inlineErrorEscapeFunction = NULL;
 	char* encodingDefault = "utf-8";
 	char* encodingErrorModeDefault = "strict";
 	char* encoding = encodingDefault;
@@ -172,7 +201,29 @@ mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const Com
 	ArgumentError* errorFirst = NULL;
 	ArgumentError** errorNext = &errorFirst;
 
+	// Defaults
+	pypEngineSettingsInit(&engineSettings);
+	pypBatchSettingsInit(&batchSettings);
+	pypDataSettingsInit(&dataSettings);
+	pypServerSettingsInit(&serverSettings);
+	pypWatchSettingsInit(&watchSettings);
+
 	// Read arguments
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "batch")) != NULL && v->defined) {
+		batchFilename = v->value;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "serve")) != NULL && v->defined) {
+		serverSocket = v->value;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "data")) != NULL && v->defined) {
+		dataFilename = v->value;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "output-pattern")) != NULL && v->defined) {
+		outputPattern = v->value;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "client")) != NULL && v->defined) {
+		clientSocket = v->value;
+	}
 	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "input")) != NULL && v->defined) {
 		inputFilename = v->value;
 		if (compareCmdStringToCharString(inputFilename, "-") == 0) {
@@ -184,7 +235,7 @@ mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const Com
 			inputStream = stdin;
 		}
 	}
-	else {
+	else if (batchFilename == NULL && serverSocket == NULL) {
 		// Error
 		*errorNext = errorListExtend("Missing input target");
 		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
@@ -200,89 +251,92 @@ mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const Com
 			outputStream = stdout;
 		}
 	}
-	else {
+	else if (batchFilename == NULL && serverSocket == NULL && dataFilename == NULL) {
 		// Error
 		*errorNext = errorListExtend("Missing output target");
 		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
 	}
+	if (batchFilename != NULL && (inputFilename != NULL || outputFilename != NULL)) {
+		// Error
+		*errorNext = errorListExtend("Input and output targets cannot be used with a batch list");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+	}
+	if (serverSocket != NULL && (inputFilename != NULL || outputFilename != NULL || batchFilename != NULL)) {
+		// Error
+		*errorNext = errorListExtend("Input and output targets cannot be used with a server");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+	}
+	if (clientSocket != NULL && (serverSocket != NULL || batchFilename != NULL)) {
+		// Error
+		*errorNext = errorListExtend("A client can only send a single input and output target");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+	}
+	if (dataFilename != NULL) {
+		if (batchFilename != NULL || serverSocket != NULL || clientSocket != NULL) {
+			// Error
+			*errorNext = errorListExtend("Data records can only be rendered here, with a single input target");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		if (inputStream != NULL) {
+			// Error
+			*errorNext = errorListExtend("Data records need an input file");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		if (outputFilename != NULL) {
+			// Error
+			*errorNext = errorListExtend("Output targets can't be used with data records; each record's output is named by the output pattern");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		if (outputPattern == NULL) {
+			// Error
+			*errorNext = errorListExtend("Data records need an output pattern");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	else if (outputPattern != NULL) {
+		// Error
+		*errorNext = errorListExtend("An output pattern can only be used with data records");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+	}
 
 	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "no-continuations")) != NULL && v->defined) {
-		allowContinuation = 0;
+		engineSettings.allowContinuation = PYP_FALSE;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "async")) != NULL && v->defined) {
+		#ifdef PYP_ASYNC_SUPPORTED
+		engineSettings.allowTopLevelAwait = PYP_TRUE;
+		#else
+		*errorNext = errorListExtend("Async templates require Python 3.8 or newer");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		#endif
 	}
 	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "read-block-size")) != NULL && v->defined) {
-		char* value = NULL;
-		size_t outputLength;
-		size_t errorCount;
-
-		if (unicodeUTF8Encode(v->value, &value, &outputLength, &errorCount) == UNICODE_OKAY) {
-			char* valueEnd = value;
-			long int numericValue;
-
-			numericValue = strtol(value, &valueEnd, 10);
-			if (valueEnd == value || *valueEnd != '\x00') {
-				// Error
-				*errorNext = errorListExtend("Invalid numeric format");
-				if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
-			}
-			else if (numericValue <= 0) {
-				// Error
-				*errorNext = errorListExtend("Invalid numeric value");
-				if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
-			}
-			else {
-				// Apply value
-				readBlockSize = numericValue;
-				if (readBlockSize <= 0) {
-					// Strange overflow error
-					*errorNext = errorListExtend("Value overflow");
-					if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
-				}
-			}
-
-			// Clean
-			memFree(value);
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			engineSettings.readBlockSize = numericValue;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
 		}
 	}
 	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "read-block-count")) != NULL && v->defined) {
-		char* value = NULL;
-		size_t outputLength;
-		size_t errorCount;
-
-		if (unicodeUTF8Encode(v->value, &value, &outputLength, &errorCount) == UNICODE_OKAY) {
-			char* valueEnd = value;
-			long int numericValue;
-
-			numericValue = strtol(value, &valueEnd, 10);
-			if (valueEnd == value || *valueEnd != '\x00') {
-				// Error
-				*errorNext = errorListExtend("Invalid numeric format");
-				if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
-			}
-			else if (numericValue <= 0) {
-				// Error
-				*errorNext = errorListExtend("Invalid numeric value");
-				if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
-			}
-			else {
-				// Apply value
-				readBlockCount = numericValue;
-				if (readBlockCount <= 0) {
-					// Strange overflow error
-					*errorNext = errorListExtend("Value overflow");
-					if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
-				}
-			}
-
-			// Clean
-			memFree(value);
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			engineSettings.readBlockCount = numericValue;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
 		}
 	}
 	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "inline-errors")) != NULL && v->defined) {
 		errorStream = NULL;
+		batchSettings.inlineErrors = PYP_TRUE;
 	}
 	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "inline-error-modifer")) != NULL && v->defined) {
 		if (compareCmdStringToCharString(outputFilename, "html") == 0) {
-			inlineErrorEscapeFunction = pypDataBufferModifyToEscapedHTML;
+			engineSettings.inlineErrorEscapeFunction = pypDataBufferModifyToEscapedHTML;
 		}
 		else if (compareCmdStringToCharString(outputFilename, "none") != 0) {
 			// Invalid value
@@ -300,6 +354,298 @@ mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const Com
 		size_t errorCount;
 		unicodeUTF8Encode(v->value, &encodingErrorMode, &outputLength, &errorCount);
 	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "prelude")) != NULL && v->defined) {
+		size_t outputLength;
+		size_t errorCount;
+		unicodeUTF8Encode(v->value, &preludeModules, &outputLength, &errorCount);
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "jobs")) != NULL && v->defined) {
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			batchSettings.workerCount = numericValue;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "workers")) != NULL && v->defined) {
+		if (compareCmdStringToCharString(v->value, "thread") == 0) {
+			#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+			batchSettings.workerMode = PYP_BATCH_WORKER_THREAD;
+			if (dataFilename != NULL) {
+				// Error
+				*errorNext = errorListExtend("Data records are only rendered by worker processes");
+				if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+			}
+			#else
+			*errorNext = errorListExtend("Thread workers require Python 3.12 or newer");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+			#endif
+		}
+		else if (compareCmdStringToCharString(v->value, "process") != 0) {
+			// Invalid value
+			*errorNext = errorListExtend("Invalid worker type");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "batch-order")) != NULL && v->defined) {
+		if (compareCmdStringToCharString(v->value, "size") == 0) {
+			batchSettings.order = PYP_BATCH_ORDER_SIZE;
+		}
+		else if (compareCmdStringToCharString(v->value, "input") != 0) {
+			// Invalid value
+			*errorNext = errorListExtend("Invalid batch order");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "worker-max-jobs")) != NULL && v->defined) {
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			batchSettings.workerMaxJobs = numericValue;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "worker-max-memory")) != NULL && v->defined) {
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			batchSettings.workerMaxMemory = (size_t) numericValue * 1024;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "serve-fork")) != NULL && v->defined) {
+		serverSettings.forkPerRequest = PYP_TRUE;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "globals")) != NULL && v->defined) {
+		size_t outputLength;
+		size_t errorCount;
+		unicodeUTF8Encode(v->value, &globalsSource, &outputLength, &errorCount);
+		if (batchFilename != NULL || serverSocket != NULL) {
+			// Error
+			*errorNext = errorListExtend("Globals can only be used with a single input and output target");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "watch")) != NULL && v->defined) {
+		watch = PYP_TRUE;
+		if (serverSocket != NULL || clientSocket != NULL || dataFilename != NULL || inputStream != NULL || outputStream != NULL) {
+			// Error
+			*errorNext = errorListExtend("Watching requires input and output files, or a batch list");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		if (globalsSource != NULL) {
+			// Error
+			*errorNext = errorListExtend("Globals can't be used while watching");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "watch-debounce")) != NULL && v->defined) {
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			watchSettings.debounceMilliseconds = (unsigned long) numericValue;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "skip-unchanged")) != NULL && v->defined) {
+		engineSettings.outputOnlyIfChanged = PYP_TRUE;
+		if (outputStream != NULL || clientSocket != NULL) {
+			// Error
+			*errorNext = errorListExtend("Unchanged outputs can only be skipped when rendering to output files here");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "sync")) != NULL && v->defined) {
+		if (compareCmdStringToCharString(v->value, "file") == 0) {
+			engineSettings.outputSync = FILE_OUTPUT_SYNC_FILE;
+		}
+		else if (compareCmdStringToCharString(v->value, "group") == 0) {
+			// Only a batch run commits staged outputs; anything else flushes each file
+			engineSettings.outputSync = (batchFilename != NULL && !watch) ? FILE_OUTPUT_SYNC_GROUP : FILE_OUTPUT_SYNC_FILE;
+		}
+		else if (compareCmdStringToCharString(v->value, "none") != 0) {
+			// Invalid value
+			*errorNext = errorListExtend("Invalid sync mode");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		if (engineSettings.outputSync != FILE_OUTPUT_SYNC_NONE && (outputStream != NULL || clientSocket != NULL)) {
+			// Error
+			*errorNext = errorListExtend("Outputs can only be synced to disk when rendering to output files here");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "sync-group")) != NULL && v->defined) {
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			batchSettings.syncGroupSize = (size_t) numericValue;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "cache")) != NULL && v->defined) {
+		cacheDirectory = v->value;
+		if (serverSocket != NULL || clientSocket != NULL) {
+			// Error
+			*errorNext = errorListExtend("The render cache can't be used with a server");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		else if (inputStream != NULL || outputStream != NULL || globalsSource != NULL || dataFilename != NULL) {
+			// Error
+			*errorNext = errorListExtend("The render cache needs input and output files, and can't be used with globals or data records");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "cache-max-size")) != NULL && v->defined) {
+		if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			cacheMaxSize = (PypSize) numericValue * 1024 * 1024;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "cache-key")) != NULL && v->defined) {
+		size_t outputLength;
+		size_t errorCount;
+		unicodeUTF8Encode(v->value, &cacheKey, &outputLength, &errorCount);
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "fragment-cache")) != NULL && v->defined) {
+		fragmentCacheDirectory = v->value;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "fragment-cache-memory")) != NULL && v->defined) {
+		if (compareCmdStringToCharString(v->value, "0") == 0) {
+			// Only the directory, if there is one
+			fragmentCacheMemory = 0;
+		}
+		else if ((numericError = argumentNumericValue(v->value, &numericValue)) == NULL) {
+			fragmentCacheMemory = (PypSize) numericValue * 1024 * 1024;
+		}
+		else {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "depfile")) != NULL && v->defined) {
+		dependencyFilename = v->value;
+		if (serverSocket != NULL || clientSocket != NULL || batchFilename != NULL || dataFilename != NULL) {
+			// Error
+			*errorNext = errorListExtend("A dependency file can only be written for a single input and output target; batch lists take one per line");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		else if (outputStream != NULL) {
+			// Error
+			*errorNext = errorListExtend("A dependency file needs an output file to name as its target");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "include-path")) != NULL && v->defined) {
+		size_t outputLength;
+		size_t errorCount;
+		engineSettings.includePath = v->value;
+		unicodeUTF8Encode(v->value, &includePath, &outputLength, &errorCount);
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "chdir")) != NULL && v->defined) {
+		engineSettings.changeWorkingDirectory = PYP_TRUE;
+		#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+		if (batchSettings.workerMode == PYP_BATCH_WORKER_THREAD) {
+			// Error
+			*errorNext = errorListExtend("Thread workers share the working directory, so it can't be changed for each template");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+		#endif
+	}
+
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "stats")) != NULL && v->defined) {
+		showStats = PYP_TRUE;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "startup-profile")) != NULL && v->defined) {
+		startupProfile = PYP_TRUE;
+		engineSettings.python.importTime = PYP_TRUE;
+	}
+
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "python-isolated")) != NULL && v->defined) {
+		engineSettings.python.isolated = PYP_TRUE;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "python-no-site")) != NULL && v->defined) {
+		engineSettings.python.noSite = PYP_TRUE;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "python-home")) != NULL && v->defined) {
+		engineSettings.python.home = v->value;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "python-path")) != NULL && v->defined) {
+		engineSettings.python.path = v->value;
+	}
+
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "gc-off-during-render")) != NULL && v->defined) {
+		engineSettings.python.gc.disableDuringRender = PYP_TRUE;
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "gc-freeze")) != NULL && v->defined) {
+		#ifdef PYP_GC_FREEZE_SUPPORTED
+		engineSettings.python.gc.freeze = PYP_TRUE;
+		#else
+		*errorNext = errorListExtend("Freezing the garbage collector requires Python 3.7 or newer");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		#endif
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "gc-collect-between")) != NULL && v->defined) {
+		batchSettings.gcCollect = PYP_TRUE;
+		if (batchFilename == NULL) {
+			// Error
+			*errorNext = errorListExtend("Collecting between renders needs a batch list");
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "gc-threshold")) != NULL && v->defined) {
+		if ((numericError = argumentThresholdsValue(v->value, engineSettings.python.gc.thresholds, sizeof(engineSettings.python.gc.thresholds) / sizeof(engineSettings.python.gc.thresholds[0]))) != NULL) {
+			// Error
+			*errorNext = errorListExtend(numericError);
+			if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		}
+	}
+	if ((v = commandLineArgumentValuesDescriptorGet(clvd, "memoize-expressions")) != NULL && v->defined) {
+		#ifdef PYP_MEMOIZE_SUPPORTED
+		engineSettings.python.memoizeExpressions = PYP_TRUE;
+		#else
+		*errorNext = errorListExtend("Memoizing expressions requires Python 3.4 or newer");
+		if (*errorNext != NULL) errorNext = &(*errorNext)->nextSibling;
+		#endif
+	}
+	engineSettings.python.gc.timed = (showStats || startupProfile);
+
+	engineSettings.encoding = encoding;
+	engineSettings.encodingErrorMode = encodingErrorMode;
+
+	// Data records are split between as many workers as a batch list
+	dataSettings.workerCount = batchSettings.workerCount;
+	dataSettings.workerMaxJobs = batchSettings.workerMaxJobs;
+	dataSettings.workerMaxMemory = batchSettings.workerMaxMemory;
+
+	// Everything besides the files read which changes the output of a cached render
+	cacheOptions[0] = PY_VERSION;
+	cacheOptions[1] = encoding;
+	cacheOptions[2] = encodingErrorMode;
+	cacheOptions[3] = engineSettings.allowContinuation ? "continuations" : "no-continuations";
+	cacheOptions[4] = engineSettings.allowTopLevelAwait ? "async" : "sync";
+	cacheOptions[5] = (errorStream != NULL) ? "errors" : ((engineSettings.inlineErrorEscapeFunction != NULL) ? "inline-errors-html" : "inline-errors");
+	cacheOptions[6] = (preludeModules != NULL) ? preludeModules : "";
+	cacheOptions[7] = (cacheKey != NULL) ? cacheKey : "";
+	cacheOptions[8] = (includePath != NULL) ? includePath : "";
+	cacheOptions[9] = engineSettings.changeWorkingDirectory ? "chdir" : "no-chdir";
 
 
 
@@ -312,27 +658,224 @@ mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const Com
 		for (error = errorFirst; error != NULL; error = error->nextSibling) {
 			fprintf(stderr, "  %s\n", error->message);
 		}
-
-		// Done
+
+		// Done
+		returnCode = -1;
+	}
+	else if (cacheDirectory != NULL && (cs = pypCacheCreate(cacheDirectory, cacheOptions, sizeof(cacheOptions) / sizeof(cacheOptions[0]), cacheMaxSize, &engineSettings.cache)) != PYP_CACHE_OKAY) {
+		// Error
+		fprintf(stderr, "Cache error: %s\n", pypCacheStatusDescription(cs));
+		returnCode = -1;
+	}
+	else if (fragmentCacheDirectory != NULL && (cs = pypCacheCreate(fragmentCacheDirectory, cacheOptions, sizeof(cacheOptions) / sizeof(cacheOptions[0]), cacheMaxSize, &fragmentCache)) != PYP_CACHE_OKAY) {
+		// Error
+		fprintf(stderr, "Fragment cache error: %s\n", pypCacheStatusDescription(cs));
+		returnCode = -1;
+	}
+	else if ((fragmentCacheMemory > 0 || fragmentCache != NULL) && (engineSettings.fragments = pypFragmentsCreate(fragmentCacheMemory, fragmentCache)) == NULL) {
+		// Error
+		fprintf(stderr, "Processing setup error; likely ran out of memory\n");
+		returnCode = -1;
+	}
+	else if (batchFilename != NULL) {
+		PypBatchStatus bs;
+		size_t errorLine = 0;
+		size_t failureCount = 0;
+
+		// Load the list before anything else
+		if ((batch = pypBatchCreate()) == NULL || (bs = pypBatchLoad(batch, batchFilename, &errorLine)) == PYP_BATCH_ERROR_MEMORY) {
+			// Error
+			fprintf(stderr, "Batch setup error; likely ran out of memory\n");
+			returnCode = -1;
+		}
+		else if (bs == PYP_BATCH_ERROR_OPEN) {
+			// Error
+			fprintf(stderr, "Error opening batch list file\n");
+			returnCode = -1;
+		}
+		else if (bs != PYP_BATCH_OKAY) {
+			// Error
+			fprintf(stderr, "Invalid batch list entry on line %lu\n", (unsigned long int) errorLine);
+			returnCode = -1;
+		}
+		else if ((engine = pypEngineCreate(&engineSettings, argv[0])) == NULL) {
+			// Error
+			fprintf(stderr, "Processing setup error; likely ran out of memory\n");
+			returnCode = -1;
+		}
+		else if (preludeModules != NULL && pypEngineImportPrelude(engine, preludeModules) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Error importing prelude modules\n");
+			returnCode = -1;
+		}
+		else if (watch && pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Python setup error\n");
+			returnCode = -1;
+		}
+		else if (watch) {
+			PypWatchStatus ws;
+
+			// Re-render entries as the files they read change, until interrupted
+			if ((ws = pypWatchRun(batch, engine, &watchSettings, stderr)) != PYP_WATCH_OKAY) {
+				fprintf(stderr, "Watch error: %s\n", pypWatchStatusDescription(ws));
+				returnCode = -1;
+			}
+		}
+		else {
+			// Execute
+			bs = pypBatchRun(batch, engine, &batchSettings, stderr, &failureCount);
+			if (bs != PYP_BATCH_OKAY) {
+				fprintf(stderr, "An error occured during batch execution: %s\n", (bs == PYP_BATCH_ERROR_WORKER) ? "Worker process error" : (bs == PYP_BATCH_ERROR_PYTHON) ? "Python setup error" : "Memory error");
+				returnCode = -1;
+			}
+			else if (failureCount > 0) {
+				returnCode = 1;
+			}
+		}
+	}
+	else if (serverSocket != NULL) {
+		PypServerStatus ss;
+
+		if ((engine = pypEngineCreate(&engineSettings, argv[0])) == NULL) {
+			// Error
+			fprintf(stderr, "Processing setup error; likely ran out of memory\n");
+			returnCode = -1;
+		}
+		else if (preludeModules != NULL && pypEngineImportPrelude(engine, preludeModules) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Error importing prelude modules\n");
+			returnCode = -1;
+		}
+		else if (pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Python setup error\n");
+			returnCode = -1;
+		}
+		else if ((ss = pypServerRun(engine, serverSocket, &serverSettings, stderr)) != PYP_SERVER_OKAY) {
+			// Error
+			fprintf(stderr, "Server error: %s\n", pypServerStatusDescription(ss));
+			returnCode = -1;
+		}
+	}
+	else if (dataFilename != NULL) {
+		PypDataStatus ds;
+		size_t failureCount = 0;
+
+		if ((engine = pypEngineCreate(&engineSettings, argv[0])) == NULL) {
+			// Error
+			fprintf(stderr, "Processing setup error; likely ran out of memory\n");
+			returnCode = -1;
+		}
+		else if (preludeModules != NULL && pypEngineImportPrelude(engine, preludeModules) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Error importing prelude modules\n");
+			returnCode = -1;
+		}
+		else if (globalsSource != NULL && pypEngineGlobalsParse(engine, globalsSource, &globals) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Invalid globals; expected a dict literal\n");
+			returnCode = -1;
+		}
+		else if ((ds = pypDataRun(engine, inputFilename, dataFilename, outputPattern, globals, &dataSettings, errorStream, stderr, &failureCount)) != PYP_DATA_OKAY) {
+			// Error
+			fprintf(stderr, "An error occured while rendering data records: %s\n", pypDataStatusDescription(ds));
+			returnCode = -1;
+		}
+		else if (failureCount > 0) {
+			returnCode = 1;
+		}
+	}
+	else if (watch) {
+		PypWatchStatus ws;
+
+		if ((batch = pypBatchCreate()) == NULL || pypBatchAdd(batch, inputFilename, outputFilename, dependencyFilename) != PYP_BATCH_OKAY) {
+			// Error
+			fprintf(stderr, "Watch setup error; likely ran out of memory\n");
+			returnCode = -1;
+		}
+		else if ((engine = pypEngineCreate(&engineSettings, argv[0])) == NULL) {
+			// Error
+			fprintf(stderr, "Processing setup error; likely ran out of memory\n");
+			returnCode = -1;
+		}
+		else if (preludeModules != NULL && pypEngineImportPrelude(engine, preludeModules) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Error importing prelude modules\n");
+			returnCode = -1;
+		}
+		else if (pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) {
+			// Error
+			fprintf(stderr, "Python setup error\n");
+			returnCode = -1;
+		}
+		else if ((ws = pypWatchRun(batch, engine, &watchSettings, stderr)) != PYP_WATCH_OKAY) {
+			// Error
+			fprintf(stderr, "Watch error: %s\n", pypWatchStatusDescription(ws));
+			returnCode = -1;
+		}
+	}
+	else if (clientSocket != NULL) {
+		PypServerRequest request;
+		PypServerStatus ss;
+		PypReadStatus rs = PYP_READ_OKAY;
+
+		// The server does the rendering, so python isn't started here
+		request.inputFilename = inputFilename;
+		request.outputFilename = outputFilename;
+		request.inputStream = inputStream;
+		request.outputStream = outputStream;
+		request.globals = globalsSource;
+
+		if ((ss = pypServerSend(clientSocket, &request, stderr, &rs)) != PYP_SERVER_OKAY) {
+			// Error
+			fprintf(stderr, "Error sending to the server: %s\n", pypServerStatusDescription(ss));
+			returnCode = -1;
+		}
+		else if (rs != PYP_READ_OKAY) {
+			fprintf(stderr, "An error occured during execution: %s\n", pypReadStatusDescription(rs));
+			returnCode = 1;
+		}
+	}
+	else if ((engine = pypEngineCreate(&engineSettings, argv[0])) == NULL) {
+		// Error
+		fprintf(stderr, "Processing setup error; likely ran out of memory\n");
 		returnCode = -1;
 	}
-	else if (
-		(piMain = pypProcessingInfoCreate(NULL, NULL, inlineErrorEscapeFunction, NULL)) == NULL ||
-		(piCodeBlock = pypProcessingInfoCreate(pypDataBufferModifyExecuteCode, NULL, NULL, pypDataBufferModifyToString)) == NULL ||
-		(piCodeExpression = pypProcessingInfoCreate(pypDataBufferModifyExecuteExpression, NULL, NULL, pypDataBufferModifyToString)) == NULL ||
-		(optimizedTags = tagsInit(piCodeBlock, piCodeExpression, allowContinuation)) == NULL ||
-		(readSettings = pypReaderSettingsCreate(flags, readBlockCount, readBlockSize)) == NULL ||
-		(pythonState = pypModulePythonSetup(argv[0])) == NULL ||
-		pythonState->status != PYP_MODULE_SETUP_STATUS_OKAY
-	) {
+	else if (preludeModules != NULL && pypEngineImportPrelude(engine, preludeModules) != PYP_ENGINE_OKAY) {
+		// Error
+		fprintf(stderr, "Error importing prelude modules\n");
+		returnCode = -1;
+	}
+	else if (globalsSource != NULL && pypEngineGlobalsParse(engine, globalsSource, &globals) != PYP_ENGINE_OKAY) {
+		// Error
+		fprintf(stderr, "Invalid globals; expected a dict literal\n");
+		returnCode = -1;
+	}
+	else if (dependencyFilename != NULL && (dependencies = pypDependenciesCreate()) == NULL) {
 		// Error
 		fprintf(stderr, "Processing setup error; likely ran out of memory\n");
 		returnCode = -1;
 	}
+	else if (engine->cache != NULL) {
+		PypReadStatus rs;
+
+		// Cached outputs are looked up before anything is rendered
+		rs = pypEngineRenderFile(engine, inputFilename, outputFilename, errorStream, dependencies);
+		if (rs != PYP_READ_OKAY) {
+			fprintf(stderr, "An error occured during execution: %s\n", pypReadStatusDescription(rs));
+			returnCode = 1;
+		}
+		else if (dependencies != NULL && !pypDependenciesWriteMakefile(dependencies, outputFilename, dependencyFilename)) {
+			// Error
+			fprintf(stderr, "Error writing dependency file\n");
+			returnCode = 1;
+		}
+	}
 	else {
 		if (
 			(inputStream == NULL && fileOpenUnicode(inputFilename, "rb", &inputStream) != FILE_OPEN_OKAY) ||
-			(outputStream == NULL && fileOpenUnicode(outputFilename, "wb", &outputStream) != FILE_OPEN_OKAY)
+			(outputStream == NULL && (pypEngineOutputOpen(engine, outputFilename, &output) != FILE_OPEN_OKAY || (outputStream = output.stream) == NULL))
 		) {
 			if (inputStream == NULL) {
 				// Error opening input
@@ -347,91 +890,55 @@ mainInner(int argc, cmd_char** argv, const CommandLineDescriptor* cld, const Com
 			returnCode = -1;
 		}
 		else {
-			PypModuleExecutionInfo exeInfo;
-
-			// Set error messages
-			readSettings->errorMessages[PYP_READER_ERROR_ID_UNCLOSED_TAG] = "Unclosed tag\n";
-			readSettings->errorMessages[PYP_READER_ERROR_ID_CONTINUATION_UNMATCHED_OPENING_TAG] = "Invalid tag opening continuation\n";
-			readSettings->errorMessages[PYP_READER_ERROR_ID_CONTINUATION_MISMATCHED_OPENING_TAG] = "Mismatched tag continuation opening\n";
-			readSettings->errorMessages[PYP_READER_ERROR_ID_CONTINUATION_MISMATCHED_CLOSING_TAG] = "Mismatched tag continuation closing\n";
-
-			// Execution setup
-			if (pypModuleExecutionInfoCreate(
-				&exeInfo,
-				readSettings,
-				piMain,
-				piCodeBlock,
-				piCodeExpression,
-				optimizedTags,
-				inputStream,
-				outputStream,
-				errorStream,
-				NULL,
-				inputFilename,
-				encoding,
-				encodingErrorMode,
-				pythonState
-			) == NULL) {
-				// Error
-				fprintf(stderr, "Execution setup error; likely ran out of memory\n");
-				returnCode = -1;
-			}
-			else {
-				PypReadStatus rs;
-
-				// Setup pyp
-				pypModulePythonInit(&exeInfo);
-
-				// Execute
-				rs = pypIncludeFromExecutionInfo(&exeInfo);
-				if (rs != PYP_READ_OKAY) {
-					const char* errorMessage = NULL;
-
-					switch (rs) {
-						case PYP_READ_ERROR_MEMORY:
-							errorMessage = "Memory error";
-						break;
-						case PYP_READ_ERROR_OPEN:
-							errorMessage = "File open error";
-						break;
-						case PYP_READ_ERROR_READ:
-							errorMessage = "Read error";
-						break;
-						case PYP_READ_ERROR_WRITE:
-							errorMessage = "Write error";
-						break;
-						case PYP_READ_ERROR_DIRECTORY:
-							errorMessage = "Directory error";
-						break;
-						default:
-							errorMessage = "Error";
-						break;
-					}
-
-					fprintf(stderr, "An error occured during execution: %s\n", errorMessage);
-					returnCode = 1;
-				}
+			PypReadStatus rs;
 
-				// Deinit python
-				pypModulePythonDeinit(&exeInfo);
-				pypModuleExecutionInfoClean(&exeInfo);
+			// Execute
+			rs = pypEngineRenderWithGlobals(engine, inputStream, outputStream, errorStream, inputFilename, globals, dependencies);
+			if (outputStream != stdout) {
+				rs = pypEngineOutputClose(&output, rs);
+				outputStream = NULL;
+			}
+			if (rs != PYP_READ_OKAY) {
+				fprintf(stderr, "An error occured during execution: %s\n", pypReadStatusDescription(rs));
+				returnCode = 1;
+			}
+			else if (dependencies != NULL && !pypDependenciesWriteMakefile(dependencies, outputFilename, dependencyFilename)) {
+				// Error
+				fprintf(stderr, "Error writing dependency file\n");
+				returnCode = 1;
 			}
 		}
 	}
 
+	// Stats
+	if (showStats && errorFirst == NULL) pypStatsPrint(stderr);
+	if (engineSettings.cache != NULL) {
+		fprintf(stderr, "Cache: %lld hits, %lld misses\n", (long long int) pypStatsGet(PYP_STATS_CACHE_HITS), (long long int) pypStatsGet(PYP_STATS_CACHE_MISSES));
+		pypCacheTrim(engineSettings.cache);
+	}
+	if (fragmentCache != NULL) pypCacheTrim(fragmentCache);
+
 	// Clean
 	if (encoding != encodingDefault) memFree(encoding);
 	if (encodingErrorMode != encodingErrorModeDefault) memFree(encodingErrorMode);
+	if (preludeModules != NULL) memFree(preludeModules);
+	if (includePath != NULL) memFree(includePath);
+	if (globalsSource != NULL) memFree(globalsSource);
+	if (cacheKey != NULL) memFree(cacheKey);
+	if (globals != NULL) Py_DECREF(globals);
 	if (inputStream != NULL && inputStream != stdin) fclose(inputStream);
 	if (outputStream != NULL && outputStream != stdout) fclose(outputStream);
-	if (pythonState != NULL) pypModulePythonFinalize(pythonState);
-	if (readSettings != NULL) pypReaderSettingsDelete(readSettings);
-	if (optimizedTags != NULL) pypTagGroupDeleteTree(optimizedTags);
-	if (piMain != NULL) pypProcessingInfoDelete(piMain);
-	if (piCodeBlock != NULL) pypProcessingInfoDelete(piCodeBlock);
-	if (piCodeExpression != NULL) pypProcessingInfoDelete(piCodeExpression);
+	if (engine != NULL) pypEngineDelete(engine);
+	if (batch != NULL) pypBatchDelete(batch);
+	if (dependencies != NULL) pypDependenciesDelete(dependencies);
+	if (engineSettings.cache != NULL) pypCacheDelete(engineSettings.cache);
+	if (engineSettings.fragments != NULL) pypFragmentsDelete(engineSettings.fragments);
+	if (fragmentCache != NULL) pypCacheDelete(fragmentCache);
 	errorListDelete(errorFirst);
 
+	// Last, so python's finalization is included
+	if (startupProfile) pypStatsTimersPrint(stderr, pypStatsClock() - startTime);
+
 	// Done
 	return returnCode;
 }
@@ -502,6 +1009,13 @@ commandLineSetup() {
 			"Disable tag continuations",
 			NULL
 		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"async",
+			"async",
+			NULL,
+			"Allow await at the top level of code tags; each tag runs on an event loop until it completes",
+			NULL
+		) == NULL ||
 		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
 			"inline-errors",
 			"inline-errors",
@@ -530,6 +1044,265 @@ commandLineSetup() {
 			"Method dealing with encoding errors; available values are the same as python's .encode values; default is \"strict\"",
 			"mode"
 		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"prelude",
+			"prelude",
+			NULL,
+			"A comma separated list of modules to import before rendering; they are available to every template",
+			"modules"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"include-path",
+			"include-path",
+			"I",
+			"Directories searched in order for included files which aren't found next to the including file, separated like PYTHONPATH",
+			"paths"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"chdir",
+			"chdir",
+			NULL,
+			"Change the working directory to each template's directory while it renders, for templates which open files relative to it; can't be used with thread workers",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"batch",
+			"batch",
+			NULL,
+			"Render every entry of a list file; each line is an input path and an output path separated by a tab, optionally followed by a tab and a dependency file path",
+			"path"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"data",
+			"data",
+			NULL,
+			"Render the input once for each line of a JSON Lines file; each object's keys are added to a copy of the globals for its render",
+			"path"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"output-pattern",
+			"output-pattern",
+			NULL,
+			"The output path of each data record, formatted with the record's keys as python's str.format does, e.g. \"out/{slug}.html\"",
+			"pattern"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"jobs",
+			"jobs",
+			"j",
+			"The number of worker processes used to render a batch list or data records; default is 1",
+			"count"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"workers",
+			"workers",
+			NULL,
+			"How batch workers are run; available values are \"process\", \"thread\" (a sub-interpreter per thread; Python 3.12+); default is \"process\"",
+			"type"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"batch-order",
+			"batch-order",
+			NULL,
+			"The order batch entries are started in; available values are \"input\", \"size\" (largest first); default is \"input\"",
+			"order"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"worker-max-jobs",
+			"worker-max-jobs",
+			NULL,
+			"Replace a worker process after it has rendered this many files or data records",
+			"count"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"worker-max-memory",
+			"worker-max-memory",
+			NULL,
+			"Replace a worker process once its peak memory usage reaches this many megabytes",
+			"size"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"sync",
+			"sync",
+			NULL,
+			"How outputs are made crash safe; available values are \"none\", \"file\" (each output is flushed to disk, then renamed into place), \"group\" (batch outputs are staged, then flushed and renamed in groups; the same as \"file\" otherwise); default is \"none\"",
+			"mode"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"sync-group",
+			"sync-group",
+			NULL,
+			"The number of batch outputs committed together with group sync; default is 64",
+			"count"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"stats",
+			"stats",
+			NULL,
+			"Print render, include and code execution counts to stderr when done",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"startup-profile",
+			"startup-profile",
+			NULL,
+			"Print how long each startup phase took to stderr when done, along with python's own timing of each import",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"python-isolated",
+			"python-isolated",
+			NULL,
+			"Start python in isolated mode, which ignores PYTHON* environment variables and the user site directory",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"python-no-site",
+			"python-no-site",
+			NULL,
+			"Don't import the site module at startup, which skips scanning sys.path for .pth files and site-packages",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"python-home",
+			"python-home",
+			NULL,
+			"The prefix python's standard library is installed under, instead of searching for it",
+			"directory"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"python-path",
+			"python-path",
+			NULL,
+			"The entire sys.path, separated like PYTHONPATH, instead of computing it at startup",
+			"paths"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"gc-off-during-render",
+			"gc-off-during-render",
+			NULL,
+			"Turn off python's automatic garbage collection while each template renders, and back on after; templates can do the same with pyp.gc_disable()",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"gc-freeze",
+			"gc-freeze",
+			NULL,
+			"Exclude every object created by python's startup and the prelude from garbage collection; Python 3.7+",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"gc-collect-between",
+			"gc-collect-between",
+			NULL,
+			"Run a full garbage collection after each batch list entry",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"gc-threshold",
+			"gc-threshold",
+			NULL,
+			"Up to three comma separated garbage collection thresholds, as taken by gc.set_threshold; empty values are left as they are, and 0 turns automatic collection off",
+			"counts"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"memoize-expressions",
+			"memoize-expressions",
+			NULL,
+			"Reuse the output of expression tags which only read immutable values, until one of them changes; Python 3.4+",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"globals",
+			"globals",
+			NULL,
+			"A python dict literal of extra globals for the template, such as {\"name\": \"value\"}",
+			"dict"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"serve",
+			"serve",
+			NULL,
+			"Keep python running and render requests sent to a unix domain socket until interrupted",
+			"socket"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"serve-fork",
+			"serve-fork",
+			NULL,
+			"Render each server request in a forked copy of the server, so requests can't affect each other",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"client",
+			"client",
+			NULL,
+			"Send the input and output targets to a server started with --serve instead of rendering them here",
+			"socket"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"watch",
+			"watch",
+			NULL,
+			"Keep running, and render outputs again when their input or any file they include changes (Linux only)",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"watch-debounce",
+			"watch-debounce",
+			NULL,
+			"How long to wait for more changes before rendering again, in milliseconds; default is 100",
+			"milliseconds"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"skip-unchanged",
+			"skip-unchanged",
+			NULL,
+			"Render each output to a temporary file, and only replace the output if its content changed; unchanged outputs keep their modification time",
+			NULL
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"cache",
+			"cache",
+			NULL,
+			"Reuse outputs from a cache directory, which may be shared, when the input, the files it read and the options are unchanged; files opened by code must be passed to pyp.depend",
+			"directory"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"cache-max-size",
+			"cache-max-size",
+			NULL,
+			"Remove the least recently used cache entries after the run once the cache is larger than this many megabytes",
+			"size"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"cache-key",
+			"cache-key",
+			NULL,
+			"Extra text which is part of every cache key, for inputs pyp can't see, such as environment variables",
+			"text"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"fragment-cache",
+			"fragment-cache",
+			NULL,
+			"Also keep the output of pyp.cache regions in a directory, which may be shared, so later runs reuse it",
+			"directory"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"fragment-cache-memory",
+			"fragment-cache-memory",
+			NULL,
+			"Keep up to this many megabytes of pyp.cache region output in memory, forgetting the oldest first; 0 turns it off; default is 32",
+			"size"
+		) == NULL ||
+		commandLineDescriptorArgumentAdd(commandLineDescriptor, commandLineNameSeparator,
+			"depfile",
+			"depfile",
+			NULL,
+			"Write a makefile rule naming the output as the target and every file read to render it as prerequisites",
+			"path"
+		) == NULL ||
 		// Ordered arguments
 		commandLineDescriptorOrderedArgumentAdd(
 			commandLineDescriptor,
@@ -551,176 +1324,6 @@ commandLineSetup() {
 
 
 
-// Setup python
-PypTagGroup*
-tagsInit(const PypProcessingInfo* piCodeBlock, const PypProcessingInfo* piCodeExpression, int allowContinuation) {
-	// Vars
-	PypTagGroup* tgLevel1 = NULL;
-	PypTagGroup* tgLevel2 = NULL;
-	PypTagGroup* tgCloser = NULL;
-	PypTagGroup* tgEscapes = NULL;
-	PypTagGroup* tgOptimized = NULL;
-	PypTag* tag = NULL;
-
-	// Assertions
-	assert(piCodeBlock != NULL || piCodeExpression != NULL);
-
-
-	// Create basic tag structure
-	if ((tgLevel1 = pypTagGroupCreate()) == NULL) goto cleanup;
-	if ((tgLevel2 = pypTagGroupCreate()) == NULL) goto cleanup;
-
-
-
-	//{ Main tag <? ?>
-	if (piCodeBlock != NULL) {
-		if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
-
-		if ((tag = pypTagCreate("<?", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgLevel2)) == NULL) goto cleanup;
-		pypTagGroupAddTag(tgLevel1, tag);
-		pypSetProcessingInfo(tag, piCodeBlock);
-
-		if ((tag = pypTagCreate("?>", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-		pypTagGroupAddTag(tgCloser, tag);
-
-		if (allowContinuation) {
-			if ((tag = pypTagCreate("<?...", 0, PYP_TAG_FLAG_CONTINUATION, tgCloser, tgLevel2)) == NULL) goto cleanup;
-			pypTagGroupAddTag(tgLevel1, tag);
-			pypSetProcessingInfo(tag, piCodeBlock);
-
-			if ((tag = pypTagCreate("...?>", 0, PYP_TAG_FLAG_CONTINUATION, NULL, NULL)) == NULL) goto cleanup;
-			pypTagGroupAddTag(tgCloser, tag);
-		}
-	}
-	//}
-
-	//{ Main eval tag <?= ?>
-	if (piCodeExpression != NULL) {
-		if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
-
-		if ((tag = pypTagCreate("<?=", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgLevel2)) == NULL) goto cleanup;
-		pypTagGroupAddTag(tgLevel1, tag);
-		pypSetProcessingInfo(tag, piCodeExpression);
-
-		if ((tag = pypTagCreate("?>", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-		pypTagGroupAddTag(tgCloser, tag);
-
-		if (allowContinuation) {
-			if ((tag = pypTagCreate("<?=...", 0, PYP_TAG_FLAG_CONTINUATION, tgCloser, tgLevel2)) == NULL) goto cleanup;
-			pypTagGroupAddTag(tgLevel1, tag);
-			pypSetProcessingInfo(tag, piCodeExpression);
-
-			if ((tag = pypTagCreate("...?>", 0, PYP_TAG_FLAG_CONTINUATION, NULL, NULL)) == NULL) goto cleanup;
-			pypTagGroupAddTag(tgCloser, tag);
-		}
-	}
-	//}
-
-	//{ Single ' quoted string
-	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
-	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
-
-	if ((tag = pypTagCreate("\'", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgLevel2, tag);
-
-	if ((tag = pypTagCreate("\'", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\r", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\\\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgEscapes, tag);
-
-	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgEscapes, tag);
-	//}
-
-	//{ Single " quoted string
-	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
-	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
-
-	if ((tag = pypTagCreate("\"", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgLevel2, tag);
-
-	if ((tag = pypTagCreate("\"", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\r", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\\\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgEscapes, tag);
-
-	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgEscapes, tag);
-	//}
-
-	//{ Triple ' quoted string
-	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
-	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
-
-	if ((tag = pypTagCreate("\'\'\'", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgLevel2, tag);
-
-	if ((tag = pypTagCreate("\'\'\'", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgEscapes, tag);
-	//}
-
-	//{ Triple " quoted string
-	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
-	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
-
-	if ((tag = pypTagCreate("\"\"\"", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgLevel2, tag);
-
-	if ((tag = pypTagCreate("\"\"\"", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgCloser, tag);
-
-	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
-	pypTagGroupAddTag(tgEscapes, tag);
-	//}
-
-
-
-
-	// Optimize
-	tgOptimized = pypTagGroupOptimize(tgLevel1);
-	if (tgOptimized == NULL) goto cleanup;
-
-
-	// Delete setup group tree
-	pypTagGroupDeleteTree(tgLevel1);
-
-
-	// Done
-	return tgOptimized;
-
-
-	// Depending on where the error occured, this might not free all the memory created
-	// Though this is not really a problem, since the application will exit on error
-	cleanup:
-	if (tgLevel1 != NULL) pypTagGroupDeleteTree(tgLevel1);
-	return NULL;
-}
-
-
-
 // Usage info
 void
 usage(const cmd_char* applicationName, const CommandLineDescriptor* cld, FILE* outputStream) {
@@ -833,6 +1436,76 @@ compareCmdStringToCharString(const cmd_char* cmdString, const char* charString)
 
 
 
+// Numeric arguments
+const char*
+argumentNumericValue(const cmd_char* argument, long int* numericValue) {
+	// Vars
+	char* value = NULL;
+	char* valueEnd;
+	size_t outputLength;
+	size_t errorCount;
+	const char* error = NULL;
+
+	// Assertions
+	assert(argument != NULL);
+	assert(numericValue != NULL);
+
+	if (unicodeUTF8Encode(argument, &value, &outputLength, &errorCount) != UNICODE_OKAY) return "Memory error"; // error
+
+	valueEnd = value;
+	*numericValue = strtol(value, &valueEnd, 10);
+	if (valueEnd == value || *valueEnd != '\x00') {
+		error = "Invalid numeric format";
+	}
+	else if (*numericValue <= 0) {
+		error = "Invalid numeric value";
+	}
+
+	// Clean
+	memFree(value);
+	return error;
+}
+
+const char*
+argumentThresholdsValue(const cmd_char* argument, long int* thresholds, size_t thresholdCount) {
+	// Vars
+	char* value = NULL;
+	char* pos;
+	char* valueEnd;
+	size_t outputLength;
+	size_t errorCount;
+	size_t i;
+	const char* error = NULL;
+
+	// Assertions
+	assert(argument != NULL);
+	assert(thresholds != NULL);
+
+	if (unicodeUTF8Encode(argument, &value, &outputLength, &errorCount) != UNICODE_OKAY) return "Memory error"; // error
+
+	// Comma separated; empty entries keep their value
+	for (i = 0, pos = value; error == NULL; ++i, pos = valueEnd + 1) {
+		if (i >= thresholdCount) {
+			error = "Too many garbage collection thresholds";
+			break;
+		}
+
+		valueEnd = pos;
+		if (*pos != ',' && *pos != '\x00') {
+			thresholds[i] = strtol(pos, &valueEnd, 10);
+			if (valueEnd == pos || (*valueEnd != ',' && *valueEnd != '\x00')) error = "Invalid numeric format";
+			else if (thresholds[i] < 0) error = "Invalid numeric value";
+		}
+		if (*valueEnd == '\x00') break;
+	}
+
+	// Clean
+	memFree(value);
+	return error;
+}
+
+
+
 // Error list
 ArgumentError*
 errorListExtend(const char* message) {
@@ -231,7 +231,8 @@ void mapHelperDeleteUnicode(unicode_char* key);
 				} \
 				(*ptrEntry) = (*ptrEntry)->nextSibling; \
 				\
-				/* Delete */ \
+				/* Delete; the value is handed back instead */ \
+				mapName##KeyDeleteFunction(deletionEntry->key); \
 				memFree(deletionEntry); \
 				\
 				/* Return value */ \
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "Thread.h"
 
 
 
@@ -52,6 +53,7 @@ static int memoryMapKeyCompareFunction(const void* key1, const void* key2);
 static void memoryMapSetup();
 
 static MemoryMap* globalMemoryMap = NULL;
+static ThreadMutex globalMemoryMapMutex = THREAD_MUTEX_INITIALIZER;
 
 
 
@@ -267,6 +269,7 @@ memoryCustomMalloc_(size_t size) {
 	void* memory;
 
 	// Setup
+	threadMutexLock(&globalMemoryMapMutex);
 	memoryMapSetup();
 
 	// Malloc
@@ -293,6 +296,7 @@ memoryCustomMalloc_(size_t size) {
 	}
 
 	// Done
+	threadMutexUnlock(&globalMemoryMapMutex);
 	return memory;
 }
 
@@ -306,6 +310,7 @@ memoryCustomRealloc_(void* ptr, size_t size) {
 	assert(ptr != NULL);
 	assert(size > 0);
 
+	threadMutexLock(&globalMemoryMapMutex);
 	memoryMapSetup();
 
 	// Map
@@ -341,12 +346,14 @@ memoryCustomRealloc_(void* ptr, size_t size) {
 	}
 
 	// Done
+	threadMutexUnlock(&globalMemoryMapMutex);
 	return memory;
 }
 
 // Custom free function
 void
 memoryCustomFree_(void* ptr) {
+	threadMutexLock(&globalMemoryMapMutex);
 	memoryMapSetup();
 
 	// Free
@@ -371,6 +378,8 @@ memoryCustomFree_(void* ptr) {
 		status = memoryMapRemove(globalMemoryMap, ptr);
 		assert(status == MEMORY_MAP_FOUND);
 	}
+
+	threadMutexUnlock(&globalMemoryMapMutex);
 }
 
 // Dump memory statistics
@@ -14,13 +14,13 @@
 	( (type*) memoryCustomMalloc_(sizeof(type)) )
 
 #define memAllocArray(type, count) \
-	( (type*) memoryCustomMalloc_(sizeof(type) * count) )
+	( (type*) memoryCustomMalloc_(sizeof(type) * (count)) )
 
 #define memRealloc(type, ptr) \
 	( (type*) memoryCustomRealloc_(ptr, sizeof(type)) )
 
 #define memReallocArray(ptr, type, count) \
-	( (type*) memoryCustomRealloc_(ptr, sizeof(type) * count) )
+	( (type*) memoryCustomRealloc_(ptr, sizeof(type) * (count)) )
 
 #define memFree(x) \
 	( memoryCustomFree_(x) )
@@ -40,13 +40,13 @@ void memoryCustomFree_(void* ptr);
 	( (type*) malloc(sizeof(type)) )
 
 #define memAllocArray(type, count) \
-	( (type*) malloc(sizeof(type) * count) )
+	( (type*) malloc(sizeof(type) * (count)) )
 
 #define memRealloc(ptr, type) \
 	( (type*) realloc(ptr, sizeof(type)) )
 
 #define memReallocArray(ptr, type, count) \
-	( (type*) realloc(ptr, sizeof(type) * count) )
+	( (type*) realloc(ptr, sizeof(type) * (count)) )
 
 #define memFree(x) \
 	( free(x) )
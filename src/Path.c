@@ -4,6 +4,9 @@
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#else
+#include <errno.h>
+#include <unistd.h>
 #endif
 #include <stdio.h>
 
@@ -20,6 +23,9 @@ typedef struct PathComponent_ {
 #ifdef _WIN32
 static int getDriveLabel(const char* path, PathComponent** pc);
 static void normalizePathComponent(const char* path, size_t* start, size_t* length);
+#else
+static PathStatus getCurrentWorkingDirectoryPosix(char** path, size_t* pathLength);
+static PathStatus absolutePathPosix(const char* path, char** absolutePath, size_t* absolutePathLength);
 #endif
 
 #ifdef _WIN32
@@ -97,6 +103,77 @@ normalizePathComponent(const char* path, size_t* start, size_t* length) {
 		--i;
 	}
 }
+#else
+PathStatus
+getCurrentWorkingDirectoryPosix(char** path, size_t* pathLength) {
+	// Vars
+	size_t space = 256;
+	char* pathNew;
+
+	// Assertions
+	assert(path != NULL);
+	assert(pathLength != NULL);
+
+	// Grow until it fits
+	while (1) {
+		pathNew = memAllocArray(char, space);
+		if (pathNew == NULL) return PATH_ERROR_MEMORY; // error
+
+		if (getcwd(pathNew, space) != NULL) break;
+
+		// Retry
+		memFree(pathNew);
+		if (errno != ERANGE) return PATH_ERROR_GENERIC; // error
+		space *= 2;
+	}
+
+	// Okay
+	*path = pathNew;
+	*pathLength = strlen(pathNew);
+	return PATH_OKAY;
+}
+
+PathStatus
+absolutePathPosix(const char* path, char** absolutePath, size_t* absolutePathLength) {
+	// Vars
+	PathStatus status;
+	char* cwd;
+	char* joined;
+	size_t cwdLength;
+	size_t pathLength;
+	size_t filenameOffset;
+
+	// Assertions
+	assert(path != NULL);
+	assert(absolutePath != NULL);
+	assert(absolutePathLength != NULL);
+
+	// Already absolute
+	if (pathCharIsSeparatorAnsi(path[0])) {
+		return pathNormalize(path, absolutePath, absolutePathLength, &filenameOffset);
+	}
+
+	// Join with the current directory
+	status = getCurrentWorkingDirectoryPosix(&cwd, &cwdLength);
+	if (status != PATH_OKAY) return status; // error
+
+	pathLength = strlen(path);
+	joined = memAllocArray(char, cwdLength + pathLength + 2);
+	if (joined == NULL) {
+		// Error
+		memFree(cwd);
+		return PATH_ERROR_MEMORY;
+	}
+	memcpy(joined, cwd, sizeof(char) * cwdLength);
+	joined[cwdLength] = pathSeparator;
+	memcpy(&joined[cwdLength + 1], path, sizeof(char) * (pathLength + 1));
+	memFree(cwd);
+
+	// Normalize
+	status = pathNormalize(joined, absolutePath, absolutePathLength, &filenameOffset);
+	memFree(joined);
+	return status;
+}
 #endif
 
 
@@ -320,8 +397,7 @@ pathGetCurrentWorkingDirectoryAnsi(char** path, size_t* pathLength) {
 	*pathLength = space;
 	return PATH_OKAY;
 #else
-	// Not implemented
-	return PATH_ERROR_NOT_IMPLEMENTED;
+	return getCurrentWorkingDirectoryPosix(path, pathLength);
 #endif
 }
 
@@ -349,8 +425,30 @@ pathGetCurrentWorkingDirectoryUnicode(unicode_char** path, size_t* pathLength) {
 	*pathLength = space;
 	return PATH_OKAY;
 #else
-	// Not implemented
-	return PATH_ERROR_NOT_IMPLEMENTED;
+	// Vars
+	PathStatus status;
+	char* pathAnsi;
+	size_t pathAnsiLength;
+	size_t outputCharacterCount;
+	size_t errorCount;
+
+	// Assertions
+	assert(path != NULL);
+	assert(pathLength != NULL);
+
+	// Get and decode
+	status = getCurrentWorkingDirectoryPosix(&pathAnsi, &pathAnsiLength);
+	if (status != PATH_OKAY) return status; // error
+
+	if (unicodeUTF8DecodeLength(pathAnsi, pathAnsiLength, path, &outputCharacterCount, pathLength, &errorCount) != UNICODE_OKAY) {
+		// Error
+		memFree(pathAnsi);
+		return PATH_ERROR_MEMORY;
+	}
+
+	// Okay
+	memFree(pathAnsi);
+	return PATH_OKAY;
 #endif
 }
 
@@ -358,16 +456,37 @@ PathStatus
 pathSetCurrentWorkingDirectoryAnsi(const char* path) {
 	assert(path != NULL);
 
+	#ifdef _WIN32
 	if (SetCurrentDirectoryA(path) == 0) return PATH_ERROR_GENERIC;
+	#else
+	if (chdir(path) != 0) return PATH_ERROR_GENERIC;
+	#endif
 	return PATH_OKAY;
 }
 
 PathStatus
 pathSetCurrentWorkingDirectoryUnicode(const unicode_char* path) {
+#ifdef _WIN32
 	assert(path != NULL);
 
 	if (SetCurrentDirectoryW(path) == 0) return PATH_ERROR_GENERIC;
 	return PATH_OKAY;
+#else
+	// Vars
+	PathStatus status;
+	char* pathAnsi;
+	size_t pathAnsiLength;
+	size_t errorCount;
+
+	// Assertions
+	assert(path != NULL);
+
+	// Encode and set
+	if (unicodeUTF8Encode(path, &pathAnsi, &pathAnsiLength, &errorCount) != UNICODE_OKAY) return PATH_ERROR_MEMORY; // error
+	status = pathSetCurrentWorkingDirectoryAnsi(pathAnsi);
+	memFree(pathAnsi);
+	return status;
+#endif
 }
 
 PathStatus
@@ -390,8 +509,7 @@ pathAbsoluteAnsi(const char* path, char** absolutePath, size_t* absolutePathLeng
 	*absolutePathLength = space;
 	return PATH_OKAY;
 #else
-	// Not implemented
-	return PATH_ERROR_NOT_IMPLEMENTED;
+	return absolutePathPosix(path, absolutePath, absolutePathLength);
 #endif
 }
 
@@ -415,11 +533,78 @@ pathAbsoluteUnicode(const unicode_char* path, unicode_char** absolutePath, size_
 	*absolutePathLength = space;
 	return PATH_OKAY;
 #else
-	// Not implemented
-	return PATH_ERROR_NOT_IMPLEMENTED;
+	// Vars
+	PathStatus status;
+	char* pathAnsi;
+	char* absPathAnsi;
+	size_t pathAnsiLength;
+	size_t absPathAnsiLength;
+	size_t outputCharacterCount;
+	size_t errorCount;
+
+	// Encode
+	if (unicodeUTF8Encode(path, &pathAnsi, &pathAnsiLength, &errorCount) != UNICODE_OKAY) return PATH_ERROR_MEMORY; // error
+
+	// Absolute
+	status = absolutePathPosix(pathAnsi, &absPathAnsi, &absPathAnsiLength);
+	memFree(pathAnsi);
+	if (status != PATH_OKAY) return status; // error
+
+	// Decode
+	if (unicodeUTF8DecodeLength(absPathAnsi, absPathAnsiLength, absolutePath, &outputCharacterCount, absolutePathLength, &errorCount) != UNICODE_OKAY) {
+		// Error
+		memFree(absPathAnsi);
+		return PATH_ERROR_MEMORY;
+	}
+
+	// Done
+	memFree(absPathAnsi);
+	return PATH_OKAY;
 #endif
 }
 
+PathStatus
+pathJoinUnicode(const unicode_char* directory, size_t directoryLength, const unicode_char* path, unicode_char** joinedPath, size_t* joinedPathLength) {
+	// Vars
+	PathStatus status;
+	unicode_char* joined;
+	size_t pathLength;
+
+	// Assertions
+	assert(directory != NULL);
+	assert(path != NULL);
+	assert(joinedPath != NULL);
+	assert(joinedPathLength != NULL);
+
+	// The directory is ignored
+	if (pathIsAbsoluteUnicode(path)) return pathAbsoluteUnicode(path, joinedPath, joinedPathLength);
+
+	// Join
+	pathLength = getUnicodeCharStringLength(path);
+	joined = memAllocArray(unicode_char, directoryLength + pathLength + 2);
+	if (joined == NULL) return PATH_ERROR_MEMORY; // error
+	memcpy(joined, directory, sizeof(unicode_char) * directoryLength);
+	joined[directoryLength] = pathSeparator;
+	memcpy(&joined[directoryLength + 1], path, sizeof(unicode_char) * (pathLength + 1));
+
+	// Already absolute, so this only normalizes it
+	status = pathAbsoluteUnicode(joined, joinedPath, joinedPathLength);
+	memFree(joined);
+	return status;
+}
+
+int
+pathIsAbsoluteUnicode(const unicode_char* path) {
+	assert(path != NULL);
+
+	#ifdef _WIN32
+	// Drive label
+	if (((path[0] >= 'A' && path[0] <= 'Z') || (path[0] >= 'a' && path[0] <= 'z')) && path[1] == ':') return 1;
+	#endif
+
+	return pathCharIsSeparatorUnicode(path[0]);
+}
+
 int
 pathCharIsSeparatorAnsi(char c) {
 	return (
@@ -24,6 +24,8 @@ PathStatus pathSetCurrentWorkingDirectoryAnsi(const char* path);
 PathStatus pathSetCurrentWorkingDirectoryUnicode(const unicode_char* path);
 PathStatus pathAbsoluteAnsi(const char* path, char** absolutePath, size_t* absolutePathLength);
 PathStatus pathAbsoluteUnicode(const unicode_char* path, unicode_char** absolutePath, size_t* absolutePathLength);
+PathStatus pathJoinUnicode(const unicode_char* directory, size_t directoryLength, const unicode_char* path, unicode_char** joinedPath, size_t* joinedPathLength); // directory must be absolute
+int pathIsAbsoluteUnicode(const unicode_char* path);
 int pathCharIsSeparatorAnsi(char c);
 int pathCharIsSeparatorUnicode(unicode_char c);
 
@@ -0,0 +1,1152 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <Python.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+#include "PypBatch.h"
+#include "Memory.h"
+#include "File.h"
+#include "Thread.h"
+#include "PypStats.h"
+
+
+
+// Headers
+typedef struct PypBatchOrderEntry_ {
+	size_t index;
+	PypSize size;
+} PypBatchOrderEntry;
+
+static PypBool pypBatchLineAdd(PypBatch* batch, const char* line, size_t lineLength);
+static PypBatchJob* pypBatchJobNew(PypBatch* batch);
+static PypSize pypBatchFileSize(const unicode_char* filename);
+static int pypBatchOrderCompare(const void* a, const void* b);
+static size_t* pypBatchOrderCreate(PypBatch* batch, PypBatchOrder order);
+static PypBool pypBatchJobExecute(PypBatchJob* job, PypEngine* engine, const PypBatchSettings* settings);
+static void pypBatchJobComplete(PypBatch* batch, const PypEngine* engine, const PypBatchSettings* settings, PypBatchJob* job);
+static void pypBatchCommit(PypBatch* batch);
+static void pypBatchReport(PypBatch* batch, FILE* reportStream, size_t* failureCount);
+static PypBatchStatus pypBatchRunSerial(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, const size_t* order, FILE* reportStream, size_t* failureCount);
+
+#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+typedef struct PypBatchThreadShared_ {
+	PypBatch* batch;
+	PypEngine* engine;
+	const PypBatchSettings* settings;
+	const size_t* order;
+	FILE* reportStream;
+	size_t* failureCount;
+	size_t jobNext;
+	PypBatchStatus status;
+	ThreadMutex mutex;
+} PypBatchThreadShared;
+
+static PypBatchStatus pypBatchRunThreads(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, const size_t* order, FILE* reportStream, size_t* failureCount);
+static void pypBatchThreadMain(void* data);
+#endif
+
+#ifndef _WIN32
+typedef struct PypBatchProcessShared_ {
+	PypBatch* batch;
+	PypEngine* engine;
+	const PypBatchSettings* settings;
+	FILE* reportStream;
+	size_t* failureCount;
+} PypBatchProcessShared;
+
+typedef struct PypBatchWorker_ {
+	pid_t pid;
+	int commandFd;
+	int resultFd;
+	size_t jobIndex;
+	PypBool active;
+	PypBool busy;
+} PypBatchWorker;
+
+typedef struct PypBatchResultHeader_ {
+	uint32_t jobIndex;
+	uint32_t status;
+	uint32_t retiring;
+	uint32_t textLength;
+	PypStatsValue stats[PYP_STATS_COUNTER_COUNT]; // counted since the previous result
+} PypBatchResultHeader;
+
+static PypBatchStatus pypBatchRunWorkers(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, const size_t* order, FILE* reportStream, size_t* failureCount);
+static uint32_t pypBatchProcessExecute(void* data, size_t jobIndex, char** text, size_t* textLength);
+static void pypBatchProcessComplete(void* data, size_t jobIndex, uint32_t status, char* text, size_t textLength, PypBool workerLost);
+static void pypBatchProcessReport(void* data);
+static PypBool pypBatchWorkerStart(PypBatchWorker* workers, size_t workerCount, size_t workerId, const PypBatchPool* pool);
+static void pypBatchWorkerMain(int commandFd, int resultFd, const PypBatchPool* pool);
+static void pypBatchWorkerStop(PypBatchWorker* worker);
+static PypBool pypBatchWorkerAssign(PypBatchWorker* worker, size_t jobIndex);
+static PypBool pypBatchWorkerOverMemory(size_t maxMemory);
+#endif
+
+
+
+// Settings
+void
+pypBatchSettingsInit(PypBatchSettings* settings) {
+	assert(settings != NULL);
+
+	settings->workerCount = 1;
+	settings->workerMode = PYP_BATCH_WORKER_PROCESS;
+	settings->order = PYP_BATCH_ORDER_INPUT;
+	settings->workerMaxJobs = 0;
+	settings->workerMaxMemory = 0;
+	settings->inlineErrors = PYP_FALSE;
+	settings->syncGroupSize = 64;
+	settings->gcCollect = PYP_FALSE;
+}
+
+
+
+// Creation
+PypBatch*
+pypBatchCreate() {
+	// Vars
+	PypBatch* batch;
+
+	// Create
+	batch = memAlloc(PypBatch);
+	if (batch == NULL) return NULL; // error
+
+	batch->jobs = NULL;
+	batch->jobCount = 0;
+	batch->jobCapacity = 0;
+	batch->reportNext = 0;
+	batch->commitPending = NULL;
+	batch->commitPendingCount = 0;
+
+	// Done
+	return batch;
+}
+
+void
+pypBatchDelete(PypBatch* batch) {
+	// Vars
+	size_t i;
+
+	// Assertions
+	assert(batch != NULL);
+
+	// Delete
+	for (i = 0; i < batch->jobCount; ++i) {
+		memFree(batch->jobs[i].inputFilename);
+		memFree(batch->jobs[i].outputFilename);
+		if (batch->jobs[i].dependencyFilename != NULL) memFree(batch->jobs[i].dependencyFilename);
+		memFree(batch->jobs[i].inputFilenameUTF8);
+		if (batch->jobs[i].errorText != NULL) memFree(batch->jobs[i].errorText);
+	}
+	if (batch->jobs != NULL) memFree(batch->jobs);
+	memFree(batch);
+}
+
+
+
+// Loading
+PypBatchStatus
+pypBatchLoad(PypBatch* batch, const unicode_char* listFilename, size_t* errorLine) {
+	// Vars
+	FILE* listStream;
+	char* text = NULL;
+	size_t textLength = 0;
+	size_t textCapacity = 4096;
+	size_t readLength;
+	size_t lineStart;
+	size_t lineEnd;
+	size_t lineNumber = 0;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(listFilename != NULL);
+	assert(errorLine != NULL);
+
+	*errorLine = 0;
+
+	// Read the entire list
+	if (fileOpenUnicode(listFilename, "rb", &listStream) != FILE_OPEN_OKAY) return PYP_BATCH_ERROR_OPEN; // error
+	while (1) {
+		if (text == NULL || textLength == textCapacity) {
+			char* textNew;
+
+			if (text == NULL) {
+				textNew = memAllocArray(char, textCapacity);
+			}
+			else {
+				textCapacity *= 2;
+				textNew = memReallocArray(text, char, textCapacity);
+			}
+			if (textNew == NULL) {
+				// Error
+				if (text != NULL) memFree(text);
+				fclose(listStream);
+				return PYP_BATCH_ERROR_MEMORY;
+			}
+			text = textNew;
+		}
+
+		readLength = fread(&text[textLength], sizeof(char), textCapacity - textLength, listStream);
+		if (readLength == 0) break;
+		textLength += readLength;
+	}
+	fclose(listStream);
+
+	// Lines are "input<TAB>output", optionally followed by "<TAB>dependency file"; blank lines and lines starting with "#" are skipped
+	for (lineStart = 0; lineStart < textLength; lineStart = lineEnd + 1) {
+		size_t lineLength;
+
+		++lineNumber;
+		for (lineEnd = lineStart; lineEnd < textLength && text[lineEnd] != '\n'; ++lineEnd);
+
+		lineLength = lineEnd - lineStart;
+		if (lineLength > 0 && text[lineStart + lineLength - 1] == '\r') --lineLength;
+		if (lineLength == 0 || text[lineStart] == '#') continue;
+
+		if (!pypBatchLineAdd(batch, &text[lineStart], lineLength)) {
+			// Error
+			memFree(text);
+			*errorLine = lineNumber;
+			return PYP_BATCH_ERROR_FORMAT;
+		}
+	}
+
+	// Done
+	memFree(text);
+	return PYP_BATCH_OKAY;
+}
+
+PypBool
+pypBatchLineAdd(PypBatch* batch, const char* line, size_t lineLength) {
+	// Vars
+	PypBatchJob* job;
+	size_t separator;
+	size_t outputEnd;
+	size_t outputCharacterCount;
+	size_t bufferLength;
+	size_t errorCount;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(line != NULL);
+
+	// Find separator
+	for (separator = 0; separator < lineLength && line[separator] != '\t'; ++separator);
+	if (separator == 0 || separator + 1 >= lineLength) return PYP_FALSE; // error
+	for (outputEnd = separator + 1; outputEnd < lineLength && line[outputEnd] != '\t'; ++outputEnd);
+	if (outputEnd == separator + 1 || (outputEnd < lineLength && outputEnd + 1 >= lineLength)) return PYP_FALSE; // error
+
+	// Setup
+	if ((job = pypBatchJobNew(batch)) == NULL) return PYP_FALSE; // error
+
+	if (
+		(job->inputFilenameUTF8 = memAllocArray(char, separator + 1)) == NULL ||
+		unicodeUTF8DecodeLength(line, separator, &job->inputFilename, &outputCharacterCount, &bufferLength, &errorCount) != UNICODE_OKAY ||
+		unicodeUTF8DecodeLength(&line[separator + 1], outputEnd - separator - 1, &job->outputFilename, &outputCharacterCount, &bufferLength, &errorCount) != UNICODE_OKAY ||
+		(outputEnd < lineLength && unicodeUTF8DecodeLength(&line[outputEnd + 1], lineLength - outputEnd - 1, &job->dependencyFilename, &outputCharacterCount, &bufferLength, &errorCount) != UNICODE_OKAY)
+	) {
+		// Error
+		if (job->inputFilenameUTF8 != NULL) memFree(job->inputFilenameUTF8);
+		if (job->inputFilename != NULL) memFree(job->inputFilename);
+		if (job->outputFilename != NULL) memFree(job->outputFilename);
+		return PYP_FALSE;
+	}
+	memcpy(job->inputFilenameUTF8, line, sizeof(char) * separator);
+	job->inputFilenameUTF8[separator] = '\x00';
+
+	// Done
+	++batch->jobCount;
+	return PYP_TRUE;
+}
+
+
+
+PypBatchStatus
+pypBatchAdd(PypBatch* batch, const unicode_char* inputFilename, const unicode_char* outputFilename, const unicode_char* dependencyFilename) {
+	// Vars
+	PypBatchJob* job;
+	size_t inputLength;
+	size_t outputLength;
+	size_t dependencyLength = 0;
+	size_t utf8Length;
+	size_t errorCount;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(inputFilename != NULL);
+	assert(outputFilename != NULL);
+
+	// Setup
+	if ((job = pypBatchJobNew(batch)) == NULL) return PYP_BATCH_ERROR_MEMORY; // error
+
+	inputLength = wcslen(inputFilename) + 1;
+	outputLength = wcslen(outputFilename) + 1;
+	if (dependencyFilename != NULL) dependencyLength = wcslen(dependencyFilename) + 1;
+	if (
+		(job->inputFilename = memAllocArray(unicode_char, inputLength)) == NULL ||
+		(job->outputFilename = memAllocArray(unicode_char, outputLength)) == NULL ||
+		(dependencyFilename != NULL && (job->dependencyFilename = memAllocArray(unicode_char, dependencyLength)) == NULL) ||
+		unicodeUTF8Encode(inputFilename, &job->inputFilenameUTF8, &utf8Length, &errorCount) != UNICODE_OKAY
+	) {
+		// Error
+		if (job->inputFilename != NULL) memFree(job->inputFilename);
+		if (job->outputFilename != NULL) memFree(job->outputFilename);
+		if (job->dependencyFilename != NULL) memFree(job->dependencyFilename);
+		return PYP_BATCH_ERROR_MEMORY;
+	}
+	memcpy(job->inputFilename, inputFilename, sizeof(unicode_char) * inputLength);
+	memcpy(job->outputFilename, outputFilename, sizeof(unicode_char) * outputLength);
+	if (dependencyFilename != NULL) memcpy(job->dependencyFilename, dependencyFilename, sizeof(unicode_char) * dependencyLength);
+
+	// Done
+	++batch->jobCount;
+	return PYP_BATCH_OKAY;
+}
+
+PypBatchJob*
+pypBatchJobNew(PypBatch* batch) {
+	// Vars
+	PypBatchJob* job;
+
+	// Assertions
+	assert(batch != NULL);
+
+	// Extend
+	if (batch->jobCount == batch->jobCapacity) {
+		PypBatchJob* jobsNew;
+		size_t capacityNew = (batch->jobCapacity == 0) ? 16 : batch->jobCapacity * 2;
+
+		jobsNew = (batch->jobs == NULL) ? memAllocArray(PypBatchJob, capacityNew) : memReallocArray(batch->jobs, PypBatchJob, capacityNew);
+		if (jobsNew == NULL) return NULL; // error
+		batch->jobs = jobsNew;
+		batch->jobCapacity = capacityNew;
+	}
+
+	// Setup; it's counted once its file names are set
+	job = &batch->jobs[batch->jobCount];
+	job->inputFilename = NULL;
+	job->outputFilename = NULL;
+	job->dependencyFilename = NULL;
+	job->inputFilenameUTF8 = NULL;
+	job->inputSize = 0;
+	job->status = PYP_READ_OKAY;
+	job->complete = PYP_FALSE;
+	job->workerLost = PYP_FALSE;
+	job->errorText = NULL;
+	job->errorTextLength = 0;
+
+	// Done
+	return job;
+}
+
+
+
+// Ordering
+PypSize
+pypBatchFileSize(const unicode_char* filename) {
+	// Vars
+	FILE* f;
+	long int size;
+
+	// Open and seek; missing files sort last and fail when rendered
+	if (fileOpenUnicode(filename, "rb", &f) != FILE_OPEN_OKAY) return 0;
+	size = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : 0;
+	fclose(f);
+
+	return (size > 0) ? (PypSize) size : 0;
+}
+
+int
+pypBatchOrderCompare(const void* a, const void* b) {
+	const PypBatchOrderEntry* e1 = (const PypBatchOrderEntry*) a;
+	const PypBatchOrderEntry* e2 = (const PypBatchOrderEntry*) b;
+
+	// Largest first, then by list position
+	if (e1->size != e2->size) return (e1->size > e2->size) ? -1 : 1;
+	return (e1->index < e2->index) ? -1 : (e1->index > e2->index);
+}
+
+size_t*
+pypBatchOrderCreate(PypBatch* batch, PypBatchOrder order) {
+	// Vars
+	size_t* indices;
+	PypBatchOrderEntry* entries;
+	size_t i;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(batch->jobCount > 0);
+
+	// Create
+	indices = memAllocArray(size_t, batch->jobCount);
+	if (indices == NULL) return NULL; // error
+
+	if (order != PYP_BATCH_ORDER_SIZE) {
+		// List order
+		for (i = 0; i < batch->jobCount; ++i) indices[i] = i;
+		return indices;
+	}
+
+	// Longest first, so large pages don't end up as the tail of the run
+	entries = memAllocArray(PypBatchOrderEntry, batch->jobCount);
+	if (entries == NULL) {
+		// Error
+		memFree(indices);
+		return NULL;
+	}
+	for (i = 0; i < batch->jobCount; ++i) {
+		batch->jobs[i].inputSize = pypBatchFileSize(batch->jobs[i].inputFilename);
+		entries[i].index = i;
+		entries[i].size = batch->jobs[i].inputSize;
+	}
+	qsort(entries, batch->jobCount, sizeof(PypBatchOrderEntry), pypBatchOrderCompare);
+	for (i = 0; i < batch->jobCount; ++i) indices[i] = entries[i].index;
+	memFree(entries);
+
+	// Done
+	return indices;
+}
+
+
+
+// Execution
+PypBatchStatus
+pypBatchRun(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, FILE* reportStream, size_t* failureCount) {
+	// Vars
+	PypBatchStatus status;
+	size_t* order;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+	assert(reportStream != NULL);
+	assert(failureCount != NULL);
+
+	*failureCount = 0;
+	batch->reportNext = 0;
+	if (batch->jobCount == 0) return PYP_BATCH_OKAY;
+
+	// Workers start from a running interpreter, rather than each starting their own
+	if (settings->workerCount > 1 && batch->jobCount > 1 && pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) return PYP_BATCH_ERROR_PYTHON; // error
+
+	// Order
+	order = pypBatchOrderCreate(batch, settings->order);
+	if (order == NULL) return PYP_BATCH_ERROR_MEMORY; // error
+
+	// Staged outputs are committed in groups
+	if (engine->outputSync == FILE_OUTPUT_SYNC_GROUP) {
+		assert(settings->syncGroupSize > 0);
+		batch->commitPendingCount = 0;
+		if ((batch->commitPending = memAllocArray(size_t, settings->syncGroupSize)) == NULL) {
+			// Error
+			memFree(order);
+			return PYP_BATCH_ERROR_MEMORY;
+		}
+	}
+
+	// Run
+	#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+	if (settings->workerMode == PYP_BATCH_WORKER_THREAD && settings->workerCount > 1 && batch->jobCount > 1) {
+		status = pypBatchRunThreads(batch, engine, settings, order, reportStream, failureCount);
+	}
+	else
+	#endif
+	#ifndef _WIN32
+	if (settings->workerCount > 1 && batch->jobCount > 1) {
+		status = pypBatchRunWorkers(batch, engine, settings, order, reportStream, failureCount);
+	}
+	else
+	#endif
+	{
+		status = pypBatchRunSerial(batch, engine, settings, order, reportStream, failureCount);
+	}
+
+	// The last partial group
+	if (batch->commitPending != NULL) {
+		pypBatchCommit(batch);
+		pypBatchReport(batch, reportStream, failureCount);
+		memFree(batch->commitPending);
+		batch->commitPending = NULL;
+	}
+
+	// Done
+	memFree(order);
+	return status;
+}
+
+PypBool
+pypBatchJobExecute(PypBatchJob* job, PypEngine* engine, const PypBatchSettings* settings) {
+	// Vars
+	FILE* errorStream = NULL;
+	PypDependencies* dependencies = NULL;
+	long int errorTextLength;
+
+	// Assertions
+	assert(job != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+
+	// Errors are captured so they can be reported in list order
+	if (!settings->inlineErrors && (errorStream = tmpfile()) == NULL) return PYP_FALSE; // error
+	if (job->dependencyFilename != NULL && (dependencies = pypDependenciesCreate()) == NULL) {
+		// Error
+		if (errorStream != NULL) fclose(errorStream);
+		return PYP_FALSE;
+	}
+
+	// Render
+	job->status = pypEngineRenderFile(engine, job->inputFilename, job->outputFilename, errorStream, dependencies);
+	if (dependencies != NULL) {
+		if (job->status == PYP_READ_OKAY && !pypDependenciesWriteMakefile(dependencies, job->outputFilename, job->dependencyFilename)) job->status = PYP_READ_ERROR_WRITE;
+		pypDependenciesDelete(dependencies);
+	}
+
+	// Garbage from this entry is cleared before the next, instead of during it
+	if (settings->gcCollect) pypEngineGcCollect(engine);
+	if (errorStream == NULL) return PYP_TRUE;
+
+	// Read captured errors
+	fflush(errorStream);
+	errorTextLength = ftell(errorStream);
+	if (errorTextLength > 0 && (job->errorText = memAllocArray(char, errorTextLength)) != NULL) {
+		rewind(errorStream);
+		job->errorTextLength = fread(job->errorText, sizeof(char), errorTextLength, errorStream);
+	}
+	fclose(errorStream);
+
+	// Done
+	return PYP_TRUE;
+}
+
+void
+pypBatchJobComplete(PypBatch* batch, const PypEngine* engine, const PypBatchSettings* settings, PypBatchJob* job) {
+	// Assertions
+	assert(batch != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+	assert(job != NULL);
+
+	// Written in place
+	if (batch->commitPending == NULL) {
+		job->complete = PYP_TRUE;
+		return;
+	}
+
+	// Whatever a lost worker staged may be partial
+	if (job->workerLost) {
+		fileOutputDiscard(job->outputFilename);
+		job->complete = PYP_TRUE;
+		return;
+	}
+
+	// Reported once its group is committed
+	batch->commitPending[batch->commitPendingCount] = (size_t) (job - batch->jobs);
+	++batch->commitPendingCount;
+	if (batch->commitPendingCount >= settings->syncGroupSize) pypBatchCommit(batch);
+}
+
+void
+pypBatchCommit(PypBatch* batch) {
+	// Vars
+	const unicode_char** filenames;
+	PypBool* committed;
+	PypBatchJob* job;
+	size_t i;
+
+	// Assertions
+	assert(batch != NULL);
+
+	if (batch->commitPendingCount == 0) return;
+
+	// Flush and rename together
+	filenames = memAllocArray(const unicode_char*, batch->commitPendingCount);
+	committed = memAllocArray(PypBool, batch->commitPendingCount);
+	if (filenames != NULL && committed != NULL) {
+		for (i = 0; i < batch->commitPendingCount; ++i) {
+			filenames[i] = batch->jobs[batch->commitPending[i]].outputFilename;
+		}
+		fileOutputCommit(filenames, batch->commitPendingCount, committed);
+	}
+
+	// Complete
+	for (i = 0; i < batch->commitPendingCount; ++i) {
+		job = &batch->jobs[batch->commitPending[i]];
+		if (filenames == NULL || committed == NULL) {
+			// Error
+			fileOutputDiscard(job->outputFilename);
+			if (job->status == PYP_READ_OKAY) job->status = PYP_READ_ERROR_MEMORY;
+		}
+		else if (!committed[i] && job->status == PYP_READ_OKAY) {
+			job->status = PYP_READ_ERROR_WRITE;
+		}
+		job->complete = PYP_TRUE;
+	}
+	batch->commitPendingCount = 0;
+
+	// Clean
+	if (filenames != NULL) memFree(filenames);
+	if (committed != NULL) memFree(committed);
+}
+
+void
+pypBatchReport(PypBatch* batch, FILE* reportStream, size_t* failureCount) {
+	// Vars
+	PypBatchJob* job;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(reportStream != NULL);
+	assert(failureCount != NULL);
+
+	// Report every completed job which has no incomplete job before it
+	for (; batch->reportNext < batch->jobCount; ++batch->reportNext) {
+		job = &batch->jobs[batch->reportNext];
+		if (!job->complete) break;
+
+		if (job->errorTextLength > 0) fwrite(job->errorText, sizeof(char), job->errorTextLength, reportStream);
+		if (job->workerLost) {
+			fprintf(reportStream, "Error rendering \"%s\": Worker terminated unexpectedly\n", job->inputFilenameUTF8);
+			++(*failureCount);
+		}
+		else if (job->status != PYP_READ_OKAY) {
+			fprintf(reportStream, "Error rendering \"%s\": %s\n", job->inputFilenameUTF8, pypReadStatusDescription(job->status));
+			++(*failureCount);
+		}
+
+		// Release
+		if (job->errorText != NULL) {
+			memFree(job->errorText);
+			job->errorText = NULL;
+			job->errorTextLength = 0;
+		}
+	}
+	fflush(reportStream);
+}
+
+PypBatchStatus
+pypBatchRunSerial(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, const size_t* order, FILE* reportStream, size_t* failureCount) {
+	// Vars
+	size_t i;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+	assert(order != NULL);
+
+	// Render each
+	for (i = 0; i < batch->jobCount; ++i) {
+		if (!pypBatchJobExecute(&batch->jobs[order[i]], engine, settings)) return PYP_BATCH_ERROR_MEMORY; // error
+		pypBatchJobComplete(batch, engine, settings, &batch->jobs[order[i]]);
+		pypBatchReport(batch, reportStream, failureCount);
+	}
+
+	// Done
+	return PYP_BATCH_OKAY;
+}
+
+
+
+// Worker threads
+#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+PypBatchStatus
+pypBatchRunThreads(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, const size_t* order, FILE* reportStream, size_t* failureCount) {
+	// Vars
+	PypBatchThreadShared shared;
+	Thread* threads;
+	size_t threadCount;
+	size_t threadsStarted = 0;
+	PyThreadState* mainThreadState;
+	size_t i;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+	assert(order != NULL);
+
+	// Setup
+	threadCount = (settings->workerCount < batch->jobCount) ? settings->workerCount : batch->jobCount;
+	threads = memAllocArray(Thread, threadCount);
+	if (threads == NULL) return PYP_BATCH_ERROR_MEMORY; // error
+
+	shared.batch = batch;
+	shared.engine = engine;
+	shared.settings = settings;
+	shared.order = order;
+	shared.reportStream = reportStream;
+	shared.failureCount = failureCount;
+	shared.jobNext = 0;
+	shared.status = PYP_BATCH_OKAY;
+	threadMutexInit(&shared.mutex);
+
+	// Each thread runs its own interpreter; the main interpreter is released until they finish
+	mainThreadState = PyEval_SaveThread();
+	for (i = 0; i < threadCount; ++i) {
+		if (threadCreate(&threads[i], pypBatchThreadMain, &shared) != THREAD_OKAY) break;
+		++threadsStarted;
+	}
+	for (i = 0; i < threadsStarted; ++i) {
+		threadJoin(&threads[i]);
+	}
+	PyEval_RestoreThread(mainThreadState);
+
+	// Jobs left over if no thread could start
+	if (shared.status == PYP_BATCH_OKAY && shared.jobNext < batch->jobCount) shared.status = PYP_BATCH_ERROR_WORKER;
+
+	// Done
+	threadMutexDestroy(&shared.mutex);
+	memFree(threads);
+	return shared.status;
+}
+
+void
+pypBatchThreadMain(void* data) {
+	// Vars
+	PypBatchThreadShared* shared = (PypBatchThreadShared*) data;
+	PypEngine* worker;
+	PypBatchJob* job;
+	PypBool okay;
+
+	// Assertions
+	assert(shared != NULL);
+
+	// Interpreter
+	if ((worker = pypEngineWorkerCreate(shared->engine)) == NULL) {
+		// Error
+		threadMutexLock(&shared->mutex);
+		shared->status = PYP_BATCH_ERROR_WORKER;
+		threadMutexUnlock(&shared->mutex);
+		return;
+	}
+
+	// Take jobs until none are left
+	while (1) {
+		threadMutexLock(&shared->mutex);
+		if (shared->jobNext >= shared->batch->jobCount || shared->status != PYP_BATCH_OKAY) {
+			threadMutexUnlock(&shared->mutex);
+			break;
+		}
+		job = &shared->batch->jobs[shared->order[shared->jobNext]];
+		++shared->jobNext;
+		threadMutexUnlock(&shared->mutex);
+
+		// Render
+		okay = pypBatchJobExecute(job, worker, shared->settings);
+
+		// Report
+		threadMutexLock(&shared->mutex);
+		if (!okay) shared->status = PYP_BATCH_ERROR_MEMORY;
+		pypBatchJobComplete(shared->batch, shared->engine, shared->settings, job);
+		pypBatchReport(shared->batch, shared->reportStream, shared->failureCount);
+		threadMutexUnlock(&shared->mutex);
+	}
+
+	// Clean
+	pypEngineDelete(worker);
+}
+#endif
+
+
+
+// Worker processes
+#ifndef _WIN32
+PypBatchStatus
+pypBatchRunWorkers(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, const size_t* order, FILE* reportStream, size_t* failureCount) {
+	// Vars
+	PypBatchProcessShared shared;
+	PypBatchPool pool;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+	assert(order != NULL);
+
+	// Setup
+	shared.batch = batch;
+	shared.engine = engine;
+	shared.settings = settings;
+	shared.reportStream = reportStream;
+	shared.failureCount = failureCount;
+
+	pool.jobCount = batch->jobCount;
+	pool.order = order;
+	pool.workerCount = settings->workerCount;
+	pool.workerMaxJobs = settings->workerMaxJobs;
+	pool.workerMaxMemory = settings->workerMaxMemory;
+	pool.executeFunction = pypBatchProcessExecute;
+	pool.completeFunction = pypBatchProcessComplete;
+	pool.reportFunction = pypBatchProcessReport;
+	pool.data = &shared;
+
+	// Run
+	return pypBatchPoolRun(&pool);
+}
+
+uint32_t
+pypBatchProcessExecute(void* data, size_t jobIndex, char** text, size_t* textLength) {
+	// Vars
+	PypBatchProcessShared* shared = (PypBatchProcessShared*) data;
+	PypBatchJob* job = &shared->batch->jobs[jobIndex];
+
+	// Render
+	if (!pypBatchJobExecute(job, shared->engine, shared->settings)) job->status = PYP_READ_ERROR_MEMORY;
+
+	// The captured errors are sent along
+	*text = job->errorText;
+	*textLength = job->errorTextLength;
+	job->errorText = NULL;
+	job->errorTextLength = 0;
+	return (uint32_t) job->status;
+}
+
+void
+pypBatchProcessComplete(void* data, size_t jobIndex, uint32_t status, char* text, size_t textLength, PypBool workerLost) {
+	// Vars
+	PypBatchProcessShared* shared = (PypBatchProcessShared*) data;
+	PypBatchJob* job = &shared->batch->jobs[jobIndex];
+
+	// Complete
+	job->status = workerLost ? PYP_READ_ERROR : (PypReadStatus) status;
+	job->workerLost = workerLost;
+	job->errorText = text;
+	job->errorTextLength = textLength;
+	pypBatchJobComplete(shared->batch, shared->engine, shared->settings, job);
+}
+
+void
+pypBatchProcessReport(void* data) {
+	// Vars
+	PypBatchProcessShared* shared = (PypBatchProcessShared*) data;
+
+	// Ordered reporting
+	pypBatchReport(shared->batch, shared->reportStream, shared->failureCount);
+}
+
+PypBatchStatus
+pypBatchPoolRun(const PypBatchPool* pool) {
+	// Vars
+	PypBatchWorker* workers;
+	struct pollfd* pollFds;
+	size_t* pollWorkers;
+	size_t workerCount;
+	size_t jobNext = 0;
+	size_t jobsCompleted = 0;
+	size_t pollCount;
+	size_t i;
+	void (*previousSigpipe)(int);
+	PypBatchStatus status = PYP_BATCH_OKAY;
+
+	// Assertions
+	assert(pool != NULL);
+	assert(pool->executeFunction != NULL);
+	assert(pool->completeFunction != NULL);
+
+	if (pool->jobCount == 0) return PYP_BATCH_OKAY;
+
+	// Create
+	workerCount = (pool->workerCount < pool->jobCount) ? pool->workerCount : pool->jobCount;
+	workers = memAllocArray(PypBatchWorker, workerCount);
+	pollFds = memAllocArray(struct pollfd, workerCount);
+	pollWorkers = memAllocArray(size_t, workerCount);
+	if (workers == NULL || pollFds == NULL || pollWorkers == NULL) {
+		// Error
+		if (workers != NULL) memFree(workers);
+		if (pollFds != NULL) memFree(pollFds);
+		if (pollWorkers != NULL) memFree(pollWorkers);
+		return PYP_BATCH_ERROR_MEMORY;
+	}
+	for (i = 0; i < workerCount; ++i) {
+		workers[i].active = PYP_FALSE;
+		workers[i].busy = PYP_FALSE;
+	}
+
+	// A worker dying shouldn't take the parent with it
+	previousSigpipe = signal(SIGPIPE, SIG_IGN);
+
+	// Start workers after all setup is complete, so the warm interpreter state is shared copy-on-write
+	for (i = 0; i < workerCount; ++i) {
+		if (!pypBatchWorkerStart(workers, workerCount, i, pool)) {
+			status = PYP_BATCH_ERROR_WORKER;
+			goto cleanup;
+		}
+		if (pypBatchWorkerAssign(&workers[i], (pool->order != NULL) ? pool->order[jobNext] : jobNext)) ++jobNext;
+	}
+
+	// Process results
+	while (jobsCompleted < pool->jobCount) {
+		// Poll busy workers
+		pollCount = 0;
+		for (i = 0; i < workerCount; ++i) {
+			if (!workers[i].busy) continue;
+			pollFds[pollCount].fd = workers[i].resultFd;
+			pollFds[pollCount].events = POLLIN;
+			pollFds[pollCount].revents = 0;
+			pollWorkers[pollCount] = i;
+			++pollCount;
+		}
+		if (pollCount == 0) {
+			// Jobs remain but no worker could be started
+			status = PYP_BATCH_ERROR_WORKER;
+			goto cleanup;
+		}
+		if (poll(pollFds, pollCount, -1) < 0) {
+			if (errno == EINTR) continue;
+			status = PYP_BATCH_ERROR_WORKER;
+			goto cleanup;
+		}
+
+		for (i = 0; i < pollCount; ++i) {
+			PypBatchWorker* worker = &workers[pollWorkers[i]];
+			PypBatchResultHeader header;
+			char* text = NULL;
+			PypBool retire = PYP_FALSE;
+
+			if (pollFds[i].revents == 0) continue;
+
+			// Read result
+			if (
+				fileDescriptorRead(worker->resultFd, &header, sizeof(header)) &&
+				header.jobIndex == worker->jobIndex &&
+				(header.textLength == 0 || (text = memAllocArray(char, header.textLength)) != NULL) &&
+				fileDescriptorRead(worker->resultFd, text, header.textLength)
+			) {
+				retire = (header.retiring != 0);
+				pypStatsMerge(header.stats);
+				(pool->completeFunction)(pool->data, worker->jobIndex, header.status, text, header.textLength, PYP_FALSE);
+			}
+			else {
+				// The worker crashed or the pipe broke
+				if (text != NULL) memFree(text);
+				retire = PYP_TRUE;
+				(pool->completeFunction)(pool->data, worker->jobIndex, 0, NULL, 0, PYP_TRUE);
+			}
+			worker->busy = PYP_FALSE;
+			++jobsCompleted;
+
+			// Recycle
+			if (retire) {
+				pypBatchWorkerStop(worker);
+				if (jobNext < pool->jobCount && !pypBatchWorkerStart(workers, workerCount, pollWorkers[i], pool)) continue;
+			}
+
+			// Next job
+			if (jobNext < pool->jobCount) {
+				if (pypBatchWorkerAssign(worker, (pool->order != NULL) ? pool->order[jobNext] : jobNext)) ++jobNext;
+			}
+			else if (worker->active) {
+				pypBatchWorkerStop(worker);
+			}
+		}
+
+		// Completed jobs may be reported in order now
+		if (pool->reportFunction != NULL) (pool->reportFunction)(pool->data);
+	}
+
+
+	// Cleanup
+	cleanup:
+	for (i = 0; i < workerCount; ++i) {
+		if (workers[i].active) pypBatchWorkerStop(&workers[i]);
+	}
+	signal(SIGPIPE, previousSigpipe);
+	memFree(workers);
+	memFree(pollFds);
+	memFree(pollWorkers);
+	return status;
+}
+
+PypBool
+pypBatchWorkerStart(PypBatchWorker* workers, size_t workerCount, size_t workerId, const PypBatchPool* pool) {
+	// Vars
+	PypBatchWorker* worker;
+	int commandPipe[2];
+	int resultPipe[2];
+	pid_t pid;
+	size_t i;
+
+	// Assertions
+	assert(workers != NULL);
+	assert(workerId < workerCount);
+	assert(pool != NULL);
+
+	worker = &workers[workerId];
+
+	// Pipes
+	if (pipe(commandPipe) != 0) return PYP_FALSE; // error
+	if (pipe(resultPipe) != 0) {
+		// Error
+		close(commandPipe[0]);
+		close(commandPipe[1]);
+		return PYP_FALSE;
+	}
+
+	// Fork
+	fflush(NULL);
+	#if PY_VERSION_HEX >= 0x03070000
+	PyOS_BeforeFork();
+	#endif
+	pid = fork();
+	if (pid == 0) {
+		// Child
+		#if PY_VERSION_HEX >= 0x03070000
+		PyOS_AfterFork_Child();
+		#else
+		PyOS_AfterFork();
+		#endif
+
+		// Siblings' pipes must be closed, otherwise they never see end-of-file
+		for (i = 0; i < workerCount; ++i) {
+			if (i == workerId || !workers[i].active) continue;
+			close(workers[i].commandFd);
+			close(workers[i].resultFd);
+		}
+		close(commandPipe[1]);
+		close(resultPipe[0]);
+
+		pypBatchWorkerMain(commandPipe[0], resultPipe[1], pool);
+		_exit(0);
+	}
+	#if PY_VERSION_HEX >= 0x03070000
+	PyOS_AfterFork_Parent();
+	#endif
+
+	// Parent
+	close(commandPipe[0]);
+	close(resultPipe[1]);
+	if (pid < 0) {
+		// Error
+		close(commandPipe[1]);
+		close(resultPipe[0]);
+		return PYP_FALSE;
+	}
+
+	worker->pid = pid;
+	worker->commandFd = commandPipe[1];
+	worker->resultFd = resultPipe[0];
+	worker->active = PYP_TRUE;
+	worker->busy = PYP_FALSE;
+	return PYP_TRUE;
+}
+
+void
+pypBatchWorkerMain(int commandFd, int resultFd, const PypBatchPool* pool) {
+	// Vars
+	PypBatchResultHeader header;
+	uint32_t jobIndex;
+	size_t jobsDone = 0;
+	char* text;
+	size_t textLength;
+	PyObject* stream;
+	PypStatsValue statsReported[PYP_STATS_COUNTER_COUNT];
+	PypBool sent;
+	size_t i;
+
+	// Counts inherited from the parent are not sent back
+	pypStatsSnapshot(statsReported);
+
+	// Jobs until the parent closes the command pipe or the worker should be recycled
+	while (fileDescriptorRead(commandFd, &jobIndex, sizeof(jobIndex))) {
+		if (jobIndex >= pool->jobCount) break;
+
+		text = NULL;
+		textLength = 0;
+		header.status = (pool->executeFunction)(pool->data, jobIndex, &text, &textLength);
+		++jobsDone;
+
+		// Send result
+		header.jobIndex = jobIndex;
+		header.retiring = (
+			(pool->workerMaxJobs > 0 && jobsDone >= pool->workerMaxJobs) ||
+			(pool->workerMaxMemory > 0 && pypBatchWorkerOverMemory(pool->workerMaxMemory))
+		);
+		header.textLength = (uint32_t) textLength;
+		pypStatsSnapshot(header.stats);
+		for (i = 0; i < PYP_STATS_COUNTER_COUNT; ++i) {
+			header.stats[i] -= statsReported[i];
+			statsReported[i] += header.stats[i];
+		}
+		sent = (
+			fileDescriptorWrite(resultFd, &header, sizeof(header)) &&
+			fileDescriptorWrite(resultFd, text, textLength)
+		);
+
+		// Clean
+		if (text != NULL) memFree(text);
+		if (!sent || header.retiring) break;
+	}
+
+	// Python's own buffered streams are not flushed by _exit
+	if ((stream = PySys_GetObject("stdout")) != NULL) Py_XDECREF(PyObject_CallMethod(stream, "flush", NULL));
+	if ((stream = PySys_GetObject("stderr")) != NULL) Py_XDECREF(PyObject_CallMethod(stream, "flush", NULL));
+	PyErr_Clear();
+	fflush(NULL);
+
+	close(commandFd);
+	close(resultFd);
+}
+
+void
+pypBatchWorkerStop(PypBatchWorker* worker) {
+	// Vars
+	int status;
+
+	// Assertions
+	assert(worker != NULL);
+	assert(worker->active);
+
+	// Closing the command pipe tells the worker to exit
+	close(worker->commandFd);
+	close(worker->resultFd);
+	while (waitpid(worker->pid, &status, 0) < 0 && errno == EINTR);
+
+	worker->active = PYP_FALSE;
+	worker->busy = PYP_FALSE;
+}
+
+PypBool
+pypBatchWorkerAssign(PypBatchWorker* worker, size_t jobIndex) {
+	// Vars
+	uint32_t index = (uint32_t) jobIndex;
+
+	// Assertions
+	assert(worker != NULL);
+
+	if (!worker->active || !fileDescriptorWrite(worker->commandFd, &index, sizeof(index))) return PYP_FALSE;
+
+	worker->jobIndex = jobIndex;
+	worker->busy = PYP_TRUE;
+	return PYP_TRUE;
+}
+
+PypBool
+pypBatchWorkerOverMemory(size_t maxMemory) {
+	// Vars
+	struct rusage usage;
+	size_t peak;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return PYP_FALSE;
+
+	// Peak resident size; reported in bytes on OS X and kilobytes elsewhere
+	peak = (size_t) usage.ru_maxrss;
+	#ifdef __APPLE__
+	peak /= 1024;
+	#endif
+
+	return (peak >= maxMemory);
+}
+#endif
+
+
+
@@ -0,0 +1,103 @@
+#ifndef __PYP_BATCH_H
+#define __PYP_BATCH_H
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include "PypTypes.h"
+#include "PypReader.h"
+#include "PypEngine.h"
+#include "Unicode.h"
+
+
+
+typedef enum PypBatchStatus_ {
+	PYP_BATCH_OKAY = 0x0,
+	PYP_BATCH_ERROR_MEMORY = 0x1,
+	PYP_BATCH_ERROR_OPEN = 0x2,
+	PYP_BATCH_ERROR_FORMAT = 0x3,
+	PYP_BATCH_ERROR_WORKER = 0x4,
+	PYP_BATCH_ERROR_PYTHON = 0x5,
+} PypBatchStatus;
+
+typedef enum PypBatchOrder_ {
+	PYP_BATCH_ORDER_INPUT = 0x0,
+	PYP_BATCH_ORDER_SIZE = 0x1,
+} PypBatchOrder;
+
+typedef enum PypBatchWorkerMode_ {
+	PYP_BATCH_WORKER_PROCESS = 0x0,
+	PYP_BATCH_WORKER_THREAD = 0x1,
+} PypBatchWorkerMode;
+
+typedef struct PypBatchSettings_ {
+	size_t workerCount;
+	PypBatchWorkerMode workerMode;
+	PypBatchOrder order;
+	size_t workerMaxJobs; // 0 for no limit
+	size_t workerMaxMemory; // in kilobytes; 0 for no limit
+	PypBool inlineErrors;
+	size_t syncGroupSize; // outputs committed together when the engine uses group sync
+	PypBool gcCollect; // run a full collection after each entry
+} PypBatchSettings;
+
+typedef struct PypBatchJob_ {
+	unicode_char* inputFilename;
+	unicode_char* outputFilename;
+	unicode_char* dependencyFilename; // if not NULL, a makefile rule listing every file read is written here
+	char* inputFilenameUTF8;
+	PypSize inputSize;
+
+	PypReadStatus status;
+	PypBool complete;
+	PypBool workerLost;
+	char* errorText;
+	PypSize errorTextLength;
+} PypBatchJob;
+
+// Worker processes forked from the running interpreter, each handed the next job by index as it becomes free
+typedef uint32_t (*PypBatchPoolExecuteFunction)(void* data, size_t jobIndex, char** text, size_t* textLength); // in the worker; text is memAlloc'd or NULL, and is sent back to the parent with the returned status
+typedef void (*PypBatchPoolCompleteFunction)(void* data, size_t jobIndex, uint32_t status, char* text, size_t textLength, PypBool workerLost); // in the parent; takes text, which is NULL if the worker died during the job
+typedef void (*PypBatchPoolReportFunction)(void* data); // in the parent, after each round of completed jobs
+
+typedef struct PypBatchPool_ {
+	size_t jobCount;
+	const size_t* order; // if not NULL, the job indices in the order they are handed out
+	size_t workerCount;
+	size_t workerMaxJobs; // 0 for no limit
+	size_t workerMaxMemory; // in kilobytes; 0 for no limit
+	PypBatchPoolExecuteFunction executeFunction;
+	PypBatchPoolCompleteFunction completeFunction;
+	PypBatchPoolReportFunction reportFunction; // may be NULL
+	void* data;
+} PypBatchPool;
+
+typedef struct PypBatch_ {
+	PypBatchJob* jobs;
+	size_t jobCount;
+	size_t jobCapacity;
+	size_t reportNext;
+	size_t* commitPending; // finished jobs whose outputs are still staged
+	size_t commitPendingCount;
+} PypBatch;
+
+
+
+void pypBatchSettingsInit(PypBatchSettings* settings);
+
+PypBatch* pypBatchCreate();
+void pypBatchDelete(PypBatch* batch);
+PypBatchStatus pypBatchLoad(PypBatch* batch, const unicode_char* listFilename, size_t* errorLine);
+PypBatchStatus pypBatchAdd(PypBatch* batch, const unicode_char* inputFilename, const unicode_char* outputFilename, const unicode_char* dependencyFilename);
+
+PypBatchStatus pypBatchRun(PypBatch* batch, PypEngine* engine, const PypBatchSettings* settings, FILE* reportStream, size_t* failureCount);
+
+#ifndef _WIN32
+PypBatchStatus pypBatchPoolRun(const PypBatchPool* pool);
+#endif
+
+
+
+#endif
+
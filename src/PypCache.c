@@ -0,0 +1,730 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#endif
+#include "PypCache.h"
+#include "Memory.h"
+#include "File.h"
+#include "Path.h"
+#include "Thread.h"
+
+
+
+// Changing anything about how entries are keyed or stored should change this
+#define PYP_CACHE_FORMAT "pyp-cache-1"
+
+
+
+// Headers
+#ifndef _WIN32
+typedef struct PypCacheEntry_ {
+	char* path;
+	PypSize size;
+	time_t time;
+} PypCacheEntry;
+
+static PypBool pypCacheManifestDigest(PypCache* cache, const unicode_char* inputFilename, unsigned char* digest);
+static PypBool pypCacheResultDigest(const unsigned char* manifestDigest, char* const* filenames, size_t count, unsigned char* digest);
+static void pypCacheFragmentDigest(PypCache* cache, const unsigned char* fragmentDigest, unsigned char* digest);
+static int pypCacheFileDigest(const char* filename, unsigned char* digest);
+static char* pypCachePath(PypCache* cache, const unsigned char* digest, const char* extension);
+static char* pypCacheManifestRead(const char* path, size_t* count, char*** filenames);
+static PypBool pypCachePublish(const char* path, int sourceFd, const char* data, size_t dataLength);
+static PypBool pypCacheDirectoryCreate(const char* path, size_t length);
+static int pypCacheEntryCompare(const void* a, const void* b);
+
+static volatile ThreadAtomic pypCacheTemporaryCounter = 0;
+#endif
+
+
+
+// Creation
+#ifdef _WIN32
+PypCacheStatus
+pypCacheCreate(const unicode_char* directory, const char* const* options, size_t optionCount, PypSize maxSize, PypCache** cache) {
+	*cache = NULL;
+	return PYP_CACHE_ERROR_UNSUPPORTED;
+}
+#else
+PypCacheStatus
+pypCacheCreate(const unicode_char* directory, const char* const* options, size_t optionCount, PypSize maxSize, PypCache** cache) {
+	// Vars
+	HashState hash;
+	size_t directoryLength;
+	size_t errorCount;
+	struct stat info;
+	size_t i;
+
+	// Assertions
+	assert(directory != NULL);
+	assert(options != NULL || optionCount == 0);
+	assert(cache != NULL);
+
+	// Create
+	*cache = memAlloc(PypCache);
+	if (*cache == NULL) return PYP_CACHE_ERROR_MEMORY; // error
+	(*cache)->maxSize = maxSize;
+
+	if (unicodeUTF8Encode(directory, &(*cache)->directory, &directoryLength, &errorCount) != UNICODE_OKAY) {
+		// Error
+		memFree(*cache);
+		*cache = NULL;
+		return PYP_CACHE_ERROR_MEMORY;
+	}
+	while (directoryLength > 1 && (*cache)->directory[directoryLength - 1] == '/') {
+		(*cache)->directory[--directoryLength] = '\x00';
+	}
+
+	// The directory may be shared, so it's fine if it already exists
+	if (
+		!pypCacheDirectoryCreate((*cache)->directory, directoryLength) ||
+		stat((*cache)->directory, &info) != 0 ||
+		!S_ISDIR(info.st_mode)
+	) {
+		// Error
+		pypCacheDelete(*cache);
+		*cache = NULL;
+		return PYP_CACHE_ERROR_DIRECTORY;
+	}
+
+	// Options are hashed once
+	hashInit(&hash);
+	hashUpdate(&hash, PYP_CACHE_FORMAT, sizeof(PYP_CACHE_FORMAT));
+	for (i = 0; i < optionCount; ++i) {
+		hashUpdate(&hash, options[i], strlen(options[i]) + 1);
+	}
+	hashFinish(&hash, (*cache)->optionsDigest);
+
+	// Done
+	return PYP_CACHE_OKAY;
+}
+#endif
+
+void
+pypCacheDelete(PypCache* cache) {
+	// Assertions
+	assert(cache != NULL);
+
+	// Delete
+	memFree(cache->directory);
+	memFree(cache);
+}
+
+
+
+// Access
+#ifdef _WIN32
+PypCacheFetchStatus
+pypCacheFetch(PypCache* cache, const unicode_char* inputFilename, FILE* outputStream, PypDependencies* dependencies) {
+	return PYP_CACHE_FETCH_MISS;
+}
+
+PypBool
+pypCacheStore(PypCache* cache, const unicode_char* inputFilename, PypDependencies* dependencies, const unicode_char* outputFilename, time_t renderStart) {
+	return PYP_FALSE;
+}
+
+void
+pypCacheTrim(PypCache* cache) {
+}
+
+PypBool
+pypCacheFragmentFetch(PypCache* cache, const unsigned char* digest, PypChar** data, PypSize* dataLength) {
+	return PYP_FALSE;
+}
+
+PypBool
+pypCacheFragmentStore(PypCache* cache, const unsigned char* digest, const PypChar* data, PypSize dataLength) {
+	return PYP_FALSE;
+}
+#else
+PypCacheFetchStatus
+pypCacheFetch(PypCache* cache, const unicode_char* inputFilename, FILE* outputStream, PypDependencies* dependencies) {
+	// Vars
+	unsigned char manifestDigest[HASH_DIGEST_LENGTH];
+	unsigned char resultDigest[HASH_DIGEST_LENGTH];
+	char* manifestPath = NULL;
+	char* resultPath = NULL;
+	char* manifest = NULL;
+	char** filenames = NULL;
+	size_t filenameCount = 0;
+	unicode_char* filename;
+	size_t filenameLength;
+	size_t bufferLength;
+	size_t errorCount;
+	int resultFd = -1;
+	PypCacheFetchStatus status = PYP_CACHE_FETCH_MISS;
+	size_t i;
+
+	// Assertions
+	assert(cache != NULL);
+	assert(inputFilename != NULL);
+	assert(outputStream != NULL);
+
+	// The manifest lists the files read the last time this input was rendered with these options
+	if (
+		!pypCacheManifestDigest(cache, inputFilename, manifestDigest) ||
+		(manifestPath = pypCachePath(cache, manifestDigest, "manifest")) == NULL ||
+		(manifest = pypCacheManifestRead(manifestPath, &filenameCount, &filenames)) == NULL
+	) {
+		goto cleanup;
+	}
+
+	// Their current contents select the output
+	if (
+		!pypCacheResultDigest(manifestDigest, filenames, filenameCount, resultDigest) ||
+		(resultPath = pypCachePath(cache, resultDigest, "output")) == NULL ||
+		(resultFd = open(resultPath, O_RDONLY)) < 0
+	) {
+		goto cleanup;
+	}
+
+	// Copy
+	status = PYP_CACHE_FETCH_ERROR;
+	if (fflush(outputStream) != 0 || !fileDescriptorCopy(resultFd, fileno(outputStream))) goto cleanup; // error
+
+	// Modification times order entries for trimming
+	utimes(manifestPath, NULL);
+	utimes(resultPath, NULL);
+
+	// Files which would have been read
+	for (i = 0; dependencies != NULL && i < filenameCount; ++i) {
+		if (unicodeUTF8Decode(filenames[i], &filename, &filenameLength, &bufferLength, &errorCount) != UNICODE_OKAY) goto cleanup; // error
+		if (!pypDependenciesAdd(dependencies, filename)) {
+			// Error
+			memFree(filename);
+			goto cleanup;
+		}
+		memFree(filename);
+	}
+	status = PYP_CACHE_FETCH_HIT;
+
+	// Done
+	cleanup:
+	if (resultFd >= 0) close(resultFd);
+	if (manifestPath != NULL) memFree(manifestPath);
+	if (resultPath != NULL) memFree(resultPath);
+	if (manifest != NULL) memFree(manifest);
+	if (filenames != NULL) memFree(filenames);
+	return status;
+}
+
+PypBool
+pypCacheStore(PypCache* cache, const unicode_char* inputFilename, PypDependencies* dependencies, const unicode_char* outputFilename, time_t renderStart) {
+	// Vars
+	unsigned char manifestDigest[HASH_DIGEST_LENGTH];
+	unsigned char resultDigest[HASH_DIGEST_LENGTH];
+	char* manifestPath = NULL;
+	char* resultPath = NULL;
+	char** filenames;
+	size_t* filenameLengths;
+	char* manifest = NULL;
+	size_t manifestLength = 0;
+	char* outputFilenameUTF8 = NULL;
+	size_t outputFilenameUTF8Length;
+	size_t errorCount;
+	struct stat info;
+	int outputFd = -1;
+	PypBool okay = PYP_FALSE;
+	size_t i;
+
+	// Assertions
+	assert(cache != NULL);
+	assert(inputFilename != NULL);
+	assert(dependencies != NULL);
+	assert(outputFilename != NULL);
+
+	// Outputs of code which raised errors aren't stored, since the error may not happen again; nor are renders which wrote pyp.output files, since only the main output is restored
+	if (dependencies->count == 0 || threadAtomicGet(&dependencies->codeErrorCount) > 0 || threadAtomicGet(&dependencies->sideOutputCount) > 0) return PYP_FALSE;
+
+	filenames = memAllocArray(char*, dependencies->count);
+	if (filenames == NULL) return PYP_FALSE; // error
+	filenameLengths = memAllocArray(size_t, dependencies->count);
+	if (filenameLengths == NULL) {
+		// Error
+		memFree(filenames);
+		return PYP_FALSE;
+	}
+	for (i = 0; i < dependencies->count; ++i) filenames[i] = NULL;
+
+	// The manifest is the file names, one per line
+	for (i = 0; i < dependencies->count; ++i) {
+		if (unicodeUTF8Encode(dependencies->filenames[i], &filenames[i], &filenameLengths[i], &errorCount) != UNICODE_OKAY) goto cleanup; // error
+		if (memchr(filenames[i], '\n', filenameLengths[i]) != NULL) goto cleanup; // can't be listed
+
+		// A file changed since the render started may not match what was read
+		if (stat(filenames[i], &info) == 0 && info.st_mtime >= renderStart) goto cleanup;
+		manifestLength += filenameLengths[i] + 1;
+	}
+	if ((manifest = memAllocArray(char, manifestLength)) == NULL) goto cleanup; // error
+	manifestLength = 0;
+	for (i = 0; i < dependencies->count; ++i) {
+		memcpy(&manifest[manifestLength], filenames[i], filenameLengths[i]);
+		manifestLength += filenameLengths[i];
+		manifest[manifestLength++] = '\n';
+	}
+
+	// Publish the output, then the manifest which leads to it
+	if (
+		!pypCacheManifestDigest(cache, inputFilename, manifestDigest) ||
+		!pypCacheResultDigest(manifestDigest, filenames, dependencies->count, resultDigest) ||
+		(manifestPath = pypCachePath(cache, manifestDigest, "manifest")) == NULL ||
+		(resultPath = pypCachePath(cache, resultDigest, "output")) == NULL ||
+		unicodeUTF8Encode(outputFilename, &outputFilenameUTF8, &outputFilenameUTF8Length, &errorCount) != UNICODE_OKAY ||
+		(outputFd = open(outputFilenameUTF8, O_RDONLY)) < 0
+	) {
+		goto cleanup;
+	}
+	okay = (
+		pypCachePublish(resultPath, outputFd, NULL, 0) &&
+		pypCachePublish(manifestPath, -1, manifest, manifestLength)
+	);
+
+	// Done
+	cleanup:
+	if (outputFd >= 0) close(outputFd);
+	if (outputFilenameUTF8 != NULL) memFree(outputFilenameUTF8);
+	if (manifestPath != NULL) memFree(manifestPath);
+	if (resultPath != NULL) memFree(resultPath);
+	if (manifest != NULL) memFree(manifest);
+	for (i = 0; i < dependencies->count; ++i) {
+		if (filenames[i] != NULL) memFree(filenames[i]);
+	}
+	memFree(filenames);
+	memFree(filenameLengths);
+	return okay;
+}
+
+void
+pypCacheTrim(PypCache* cache) {
+	// Vars
+	PypCacheEntry* entries = NULL;
+	size_t entryCount = 0;
+	size_t entryCapacity = 0;
+	PypSize totalSize = 0;
+	char* path;
+	size_t directoryLength;
+	size_t pathLength;
+	size_t nameLength;
+	DIR* dir;
+	struct dirent* dirEntry;
+	struct stat info;
+	unsigned int sub;
+	size_t i;
+
+	// Assertions
+	assert(cache != NULL);
+
+	if (cache->maxSize == 0) return;
+
+	// "directory/xx/name"
+	directoryLength = strlen(cache->directory);
+	if ((path = memAllocArray(char, directoryLength + 5)) == NULL) return; // error
+
+	// Every entry, with its size and when it was last used
+	for (sub = 0; sub < 256; ++sub) {
+		sprintf(path, "%s/%02x", cache->directory, sub);
+		if ((dir = opendir(path)) == NULL) continue;
+
+		while ((dirEntry = readdir(dir)) != NULL) {
+			nameLength = strlen(dirEntry->d_name);
+			if (
+				!(nameLength > 7 && strcmp(&dirEntry->d_name[nameLength - 7], ".output") == 0) &&
+				!(nameLength > 9 && strcmp(&dirEntry->d_name[nameLength - 9], ".manifest") == 0) &&
+				!(nameLength > 9 && strcmp(&dirEntry->d_name[nameLength - 9], ".fragment") == 0)
+			) {
+				continue;
+			}
+
+			if (entryCount == entryCapacity) {
+				PypCacheEntry* entriesNew;
+				size_t capacityNew = (entryCapacity == 0) ? 256 : entryCapacity * 2;
+
+				entriesNew = (entries == NULL) ? memAllocArray(PypCacheEntry, capacityNew) : memReallocArray(entries, PypCacheEntry, capacityNew);
+				if (entriesNew == NULL) break; // error
+				entries = entriesNew;
+				entryCapacity = capacityNew;
+			}
+
+			pathLength = directoryLength + 4 + nameLength;
+			if ((entries[entryCount].path = memAllocArray(char, pathLength + 1)) == NULL) break; // error
+			sprintf(entries[entryCount].path, "%s/%s", path, dirEntry->d_name);
+			if (stat(entries[entryCount].path, &info) != 0) {
+				memFree(entries[entryCount].path);
+				continue;
+			}
+
+			entries[entryCount].size = (PypSize) info.st_size;
+			entries[entryCount].time = info.st_mtime;
+			totalSize += entries[entryCount].size;
+			++entryCount;
+		}
+		closedir(dir);
+	}
+	memFree(path);
+
+	// Remove the least recently used until there's some room to grow
+	if (totalSize > cache->maxSize) {
+		qsort(entries, entryCount, sizeof(PypCacheEntry), pypCacheEntryCompare);
+		for (i = 0; i < entryCount && totalSize > cache->maxSize / 10 * 9; ++i) {
+			if (unlink(entries[i].path) == 0) totalSize -= entries[i].size;
+		}
+	}
+
+	// Clean
+	for (i = 0; i < entryCount; ++i) memFree(entries[i].path);
+	if (entries != NULL) memFree(entries);
+}
+
+
+PypBool
+pypCacheFragmentFetch(PypCache* cache, const unsigned char* digest, PypChar** data, PypSize* dataLength) {
+	// Vars
+	unsigned char fileDigest[HASH_DIGEST_LENGTH];
+	char* path;
+	struct stat info;
+	int fd;
+
+	// Assertions
+	assert(cache != NULL);
+	assert(digest != NULL);
+	assert(data != NULL);
+	assert(dataLength != NULL);
+
+	// Open
+	pypCacheFragmentDigest(cache, digest, fileDigest);
+	if ((path = pypCachePath(cache, fileDigest, "fragment")) == NULL) return PYP_FALSE; // error
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		// Missing
+		memFree(path);
+		return PYP_FALSE;
+	}
+
+	// Read the whole file; entries are only ever replaced by renaming, so it's complete
+	*data = NULL;
+	if (
+		fstat(fd, &info) != 0 ||
+		(*data = memAllocArray(PypChar, (size_t) info.st_size + 1)) == NULL ||
+		!fileDescriptorRead(fd, *data, (size_t) info.st_size)
+	) {
+		// Error
+		if (*data != NULL) memFree(*data);
+		close(fd);
+		memFree(path);
+		return PYP_FALSE;
+	}
+	close(fd);
+	*dataLength = (PypSize) info.st_size;
+
+	// Modification times order entries for trimming
+	utimes(path, NULL);
+	memFree(path);
+
+	// Done
+	return PYP_TRUE;
+}
+
+PypBool
+pypCacheFragmentStore(PypCache* cache, const unsigned char* digest, const PypChar* data, PypSize dataLength) {
+	// Vars
+	unsigned char fileDigest[HASH_DIGEST_LENGTH];
+	char* path;
+	PypBool okay;
+
+	// Assertions
+	assert(cache != NULL);
+	assert(digest != NULL);
+	assert(data != NULL || dataLength == 0);
+
+	// Publish
+	pypCacheFragmentDigest(cache, digest, fileDigest);
+	if ((path = pypCachePath(cache, fileDigest, "fragment")) == NULL) return PYP_FALSE; // error
+	okay = pypCachePublish(path, -1, data, dataLength);
+	memFree(path);
+
+	// Done
+	return okay;
+}
+
+
+
+// Keys
+PypBool
+pypCacheManifestDigest(PypCache* cache, const unicode_char* inputFilename, unsigned char* digest) {
+	// Vars
+	HashState hash;
+	unicode_char* absoluteFilename;
+	size_t absoluteFilenameLength;
+	char* filename;
+	size_t filenameLength;
+	size_t errorCount;
+	unsigned char inputDigest[HASH_DIGEST_LENGTH];
+	int found;
+
+	// Same paths as the dependencies, which are absolute
+	if (pathAbsoluteUnicode(inputFilename, &absoluteFilename, &absoluteFilenameLength) != PATH_OKAY) return PYP_FALSE; // error
+	if (unicodeUTF8Encode(absoluteFilename, &filename, &filenameLength, &errorCount) != UNICODE_OKAY) {
+		// Error
+		memFree(absoluteFilename);
+		return PYP_FALSE;
+	}
+	memFree(absoluteFilename);
+
+	// Options, input path, input contents
+	found = pypCacheFileDigest(filename, inputDigest);
+	if (found > 0) {
+		hashInit(&hash);
+		hashUpdate(&hash, cache->optionsDigest, HASH_DIGEST_LENGTH);
+		hashUpdate(&hash, filename, filenameLength + 1);
+		hashUpdate(&hash, inputDigest, HASH_DIGEST_LENGTH);
+		hashFinish(&hash, digest);
+	}
+
+	// Done
+	memFree(filename);
+	return (found > 0);
+}
+
+PypBool
+pypCacheResultDigest(const unsigned char* manifestDigest, char* const* filenames, size_t count, unsigned char* digest) {
+	// Vars
+	HashState hash;
+	unsigned char fileDigest[HASH_DIGEST_LENGTH];
+	int found;
+	size_t i;
+
+	// Every file read and its contents; missing files are included too, since creating one changes the output
+	hashInit(&hash);
+	hashUpdate(&hash, manifestDigest, HASH_DIGEST_LENGTH);
+	for (i = 0; i < count; ++i) {
+		if ((found = pypCacheFileDigest(filenames[i], fileDigest)) < 0) return PYP_FALSE; // error
+
+		hashUpdate(&hash, filenames[i], strlen(filenames[i]) + 1);
+		hashUpdate(&hash, (found > 0) ? "f" : "m", 1);
+		if (found > 0) hashUpdate(&hash, fileDigest, HASH_DIGEST_LENGTH);
+	}
+	hashFinish(&hash, digest);
+
+	return PYP_TRUE;
+}
+
+void
+pypCacheFragmentDigest(PypCache* cache, const unsigned char* fragmentDigest, unsigned char* digest) {
+	// Vars
+	HashState hash;
+
+	// Options, so fragments rendered with other settings aren't mixed up; the prefix keeps them apart from manifests
+	hashInit(&hash);
+	hashUpdate(&hash, cache->optionsDigest, HASH_DIGEST_LENGTH);
+	hashUpdate(&hash, "fragment", sizeof("fragment"));
+	hashUpdate(&hash, fragmentDigest, HASH_DIGEST_LENGTH);
+	hashFinish(&hash, digest);
+}
+
+int
+pypCacheFileDigest(const char* filename, unsigned char* digest) {
+	// Vars
+	HashState hash;
+	char buffer[16384];
+	ssize_t length;
+	int fd;
+
+	// Open; 0 if it doesn't exist
+	if ((fd = open(filename, O_RDONLY)) < 0) return (errno == ENOENT || errno == ENOTDIR) ? 0 : -1;
+
+	// Read
+	hashInit(&hash);
+	while ((length = read(fd, buffer, sizeof(buffer))) != 0) {
+		if (length < 0) {
+			if (errno == EINTR) continue;
+
+			// Error
+			close(fd);
+			return -1;
+		}
+		hashUpdate(&hash, buffer, (size_t) length);
+	}
+	close(fd);
+	hashFinish(&hash, digest);
+
+	// Done
+	return 1;
+}
+
+char*
+pypCachePath(PypCache* cache, const unsigned char* digest, const char* extension) {
+	// Vars
+	char hex[HASH_HEX_LENGTH + 1];
+	char* path;
+
+	// "directory/xx/rest.extension", so no single directory gets too large
+	hashToHex(digest, hex);
+	path = memAllocArray(char, strlen(cache->directory) + HASH_HEX_LENGTH + strlen(extension) + 4);
+	if (path == NULL) return NULL; // error
+	sprintf(path, "%s/%.2s/%s.%s", cache->directory, hex, &hex[2], extension);
+
+	return path;
+}
+
+
+
+// Files
+char*
+pypCacheManifestRead(const char* path, size_t* count, char*** filenames) {
+	// Vars
+	char* text;
+	struct stat info;
+	size_t length = 0;
+	ssize_t readLength;
+	size_t i;
+	size_t start;
+	int fd;
+
+	// Read the whole file, null terminated
+	if ((fd = open(path, O_RDONLY)) < 0) return NULL; // missing
+	if (fstat(fd, &info) != 0 || info.st_size <= 0 || (text = memAllocArray(char, (size_t) info.st_size + 1)) == NULL) {
+		// Error
+		close(fd);
+		return NULL;
+	}
+	while (length < (size_t) info.st_size) {
+		readLength = read(fd, &text[length], (size_t) info.st_size - length);
+		if (readLength < 0 && errno == EINTR) continue;
+		if (readLength <= 0) break;
+		length += (size_t) readLength;
+	}
+	close(fd);
+	text[length] = '\x00';
+	if (length == 0 || text[length - 1] != '\n') {
+		// Incomplete
+		memFree(text);
+		return NULL;
+	}
+
+	// Split lines in place
+	*count = 0;
+	for (i = 0; i < length; ++i) {
+		if (text[i] == '\n') ++(*count);
+	}
+	if ((*filenames = memAllocArray(char*, *count)) == NULL) {
+		// Error
+		memFree(text);
+		return NULL;
+	}
+	*count = 0;
+	for (start = 0, i = 0; i < length; ++i) {
+		if (text[i] != '\n') continue;
+
+		text[i] = '\x00';
+		(*filenames)[(*count)++] = &text[start];
+		start = i + 1;
+	}
+
+	// Done
+	return text;
+}
+
+PypBool
+pypCachePublish(const char* path, int sourceFd, const char* data, size_t dataLength) {
+	// Vars
+	char* temporaryPath;
+	const char* separator;
+	size_t pathLength;
+	size_t attempt;
+	PypBool okay = PYP_FALSE;
+	ssize_t writeLength;
+	int fd = -1;
+
+	// Next to the final path, so it can be renamed into place; other hosts may share the directory
+	pathLength = strlen(path);
+	if ((temporaryPath = memAllocArray(char, pathLength + 64)) == NULL) return PYP_FALSE; // error
+	if ((separator = strrchr(path, '/')) != NULL && !pypCacheDirectoryCreate(path, (size_t) (separator - path))) goto cleanup; // error
+	for (attempt = 0; attempt < 100 && fd < 0; ++attempt) {
+		sprintf(temporaryPath, "%s.%lu-%lu-%lu.tmp", path, (unsigned long) getpid(), (unsigned long) threadAtomicAdd(&pypCacheTemporaryCounter, 1), (unsigned long) time(NULL));
+		fd = open(temporaryPath, O_WRONLY | O_CREAT | O_EXCL, 0666);
+		if (fd < 0 && errno != EEXIST) goto cleanup; // error
+	}
+	if (fd < 0) goto cleanup; // error
+
+	// Write
+	if (sourceFd >= 0) {
+		okay = fileDescriptorCopy(sourceFd, fd);
+	}
+	else {
+		okay = PYP_TRUE;
+		while (dataLength > 0) {
+			writeLength = write(fd, data, dataLength);
+			if (writeLength < 0 && errno == EINTR) continue;
+			if (writeLength <= 0) {
+				okay = PYP_FALSE;
+				break;
+			}
+			data += writeLength;
+			dataLength -= (size_t) writeLength;
+		}
+	}
+	if (close(fd) != 0) okay = PYP_FALSE;
+
+	// Publish
+	if (okay) okay = (rename(temporaryPath, path) == 0);
+	if (!okay) unlink(temporaryPath);
+
+	// Done
+	cleanup:
+	memFree(temporaryPath);
+	return okay;
+}
+
+PypBool
+pypCacheDirectoryCreate(const char* path, size_t length) {
+	// Vars
+	char* directory;
+	PypBool okay;
+
+	if ((directory = memAllocArray(char, length + 1)) == NULL) return PYP_FALSE; // error
+	memcpy(directory, path, length);
+	directory[length] = '\x00';
+
+	okay = (mkdir(directory, 0777) == 0 || errno == EEXIST);
+
+	memFree(directory);
+	return okay;
+}
+
+int
+pypCacheEntryCompare(const void* a, const void* b) {
+	const PypCacheEntry* e1 = (const PypCacheEntry*) a;
+	const PypCacheEntry* e2 = (const PypCacheEntry*) b;
+
+	// Oldest first
+	return (e1->time < e2->time) ? -1 : (e1->time > e2->time);
+}
+#endif
+
+
+
+// Status info
+const char*
+pypCacheStatusDescription(PypCacheStatus status) {
+	switch (status) {
+		case PYP_CACHE_OKAY:
+			return "Okay";
+		case PYP_CACHE_ERROR_MEMORY:
+			return "Memory error";
+		case PYP_CACHE_ERROR_DIRECTORY:
+			return "The cache directory could not be created";
+		case PYP_CACHE_ERROR_UNSUPPORTED:
+			return "Caching is not supported on this platform";
+	}
+	return "Unknown error";
+}
+
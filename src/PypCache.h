@@ -0,0 +1,52 @@
+#ifndef __PYP_CACHE_H
+#define __PYP_CACHE_H
+
+
+
+#include <stdio.h>
+#include <time.h>
+#include "PypTypes.h"
+#include "PypDependencies.h"
+#include "Hash.h"
+#include "Unicode.h"
+
+
+
+typedef enum PypCacheStatus_ {
+	PYP_CACHE_OKAY = 0x0,
+	PYP_CACHE_ERROR_MEMORY = 0x1,
+	PYP_CACHE_ERROR_DIRECTORY = 0x2,
+	PYP_CACHE_ERROR_UNSUPPORTED = 0x3,
+} PypCacheStatus;
+
+typedef enum PypCacheFetchStatus_ {
+	PYP_CACHE_FETCH_HIT = 0x0,
+	PYP_CACHE_FETCH_MISS = 0x1,
+	PYP_CACHE_FETCH_ERROR = 0x2, // the output stream may have been partially written
+} PypCacheFetchStatus;
+
+typedef struct PypCache_ {
+	char* directory; // UTF-8
+	unsigned char optionsDigest[HASH_DIGEST_LENGTH]; // everything besides the files read which changes the output
+	PypSize maxSize; // in bytes; 0 for no limit
+} PypCache;
+
+
+
+PypCacheStatus pypCacheCreate(const unicode_char* directory, const char* const* options, size_t optionCount, PypSize maxSize, PypCache** cache);
+void pypCacheDelete(PypCache* cache);
+
+PypCacheFetchStatus pypCacheFetch(PypCache* cache, const unicode_char* inputFilename, FILE* outputStream, PypDependencies* dependencies);
+PypBool pypCacheStore(PypCache* cache, const unicode_char* inputFilename, PypDependencies* dependencies, const unicode_char* outputFilename, time_t renderStart); // files changed after renderStart make it skip storing
+void pypCacheTrim(PypCache* cache);
+
+// Fragments of output stored by pyp.cache; the digest already covers the key and the files the fragment depends on
+PypBool pypCacheFragmentFetch(PypCache* cache, const unsigned char* digest, PypChar** data, PypSize* dataLength);
+PypBool pypCacheFragmentStore(PypCache* cache, const unsigned char* digest, const PypChar* data, PypSize dataLength);
+
+const char* pypCacheStatusDescription(PypCacheStatus status);
+
+
+
+#endif
+
@@ -0,0 +1,712 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <Python.h>
+#include "PypData.h"
+#include "PypBatch.h"
+#include "PypSlots.h"
+#include "PypStats.h"
+#include "Memory.h"
+#include "File.h"
+
+
+
+// Headers
+typedef struct PypDataRender_ {
+	PypEngine* engine;
+	PypModuleExecutionInfo* executionInfo;
+	PyObject* template;
+	PyObject* loads; // json.loads
+	PyObject* format; // the output pattern's format method
+	PyObject* noArgs;
+	PypDataBuffer* dataBuffer; // reused for each record
+	FILE* reportStream;
+} PypDataRender;
+
+static PypDataStatus pypDataLineRead(FILE* stream, char** line, size_t* lineLength, size_t* lineCapacity, PypBool* found);
+static PypBool pypDataLineTrim(const char* line, size_t* lineStart, size_t* lineLength);
+static PypDataStatus pypDataRecordsRender(PypDataRender* render, FILE* dataStream, size_t* failureCount);
+static PypBool pypDataRecordRender(PypDataRender* render, const char* line, size_t lineLength, size_t lineNumber);
+static void pypDataReport(FILE* reportStream, size_t lineNumber, const char* message);
+static void pypDataReportException(FILE* reportStream, size_t lineNumber);
+
+#ifndef _WIN32
+typedef struct PypDataRecord_ {
+	long int offset; // of its line in the data file
+	size_t lineNumber;
+	PypDataStatus status;
+	char* reportText; // what the worker reported for it
+	size_t reportTextLength;
+	PypBool complete;
+	PypBool workerLost;
+} PypDataRecord;
+
+typedef struct PypDataWorkers_ {
+	PypDataRender* render;
+	const unicode_char* dataFilename;
+	PypDataRecord* records;
+	size_t recordCount;
+	size_t reportNext;
+	size_t* failureCount;
+	PypDataStatus status;
+
+	// Each worker's own
+	FILE* dataStream;
+	FILE* reportStream; // collects the reports of one record at a time
+	char* line;
+	size_t lineCapacity;
+} PypDataWorkers;
+
+static PypDataStatus pypDataRunWorkers(PypDataRender* render, FILE* dataStream, const unicode_char* dataFilename, const PypDataSettings* settings, size_t* failureCount);
+static PypDataStatus pypDataRecordsIndex(FILE* dataStream, PypDataRecord** records, size_t* recordCount);
+static uint32_t pypDataWorkerExecute(void* data, size_t jobIndex, char** text, size_t* textLength);
+static void pypDataWorkerComplete(void* data, size_t jobIndex, uint32_t status, char* text, size_t textLength, PypBool workerLost);
+static void pypDataWorkerReport(void* data);
+#endif
+
+
+
+// Settings
+void
+pypDataSettingsInit(PypDataSettings* settings) {
+	assert(settings != NULL);
+
+	settings->workerCount = 1;
+	settings->workerMaxJobs = 0;
+	settings->workerMaxMemory = 0;
+}
+
+
+
+// Execution
+PypDataStatus
+pypDataRun(PypEngine* engine, const unicode_char* inputFilename, const unicode_char* dataFilename, const unicode_char* outputPattern, PyObject* globals, const PypDataSettings* settings, FILE* errorStream, FILE* reportStream, size_t* failureCount) {
+	// Vars
+	PypModuleExecutionInfo exeInfo;
+	PypDataRender render;
+	FILE* inputStream = NULL;
+	FILE* dataStream = NULL;
+	PyObject* jsonModule = NULL;
+	PyObject* pattern = NULL;
+	PypBool exeInfoCreated = PYP_FALSE;
+	PypBool pythonInit = PYP_FALSE;
+	PypDataStatus status = PYP_DATA_OKAY;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(inputFilename != NULL);
+	assert(dataFilename != NULL);
+	assert(outputPattern != NULL);
+	assert(settings != NULL);
+	assert(reportStream != NULL);
+	assert(failureCount != NULL);
+
+	*failureCount = 0;
+	render.engine = engine;
+	render.executionInfo = &exeInfo;
+	render.template = NULL;
+	render.loads = NULL;
+	render.format = NULL;
+	render.noArgs = NULL;
+	render.dataBuffer = NULL;
+	render.reportStream = reportStream;
+
+	// Open both before python is started
+	if (fileOpenUnicode(inputFilename, "rb", &inputStream) != FILE_OPEN_OKAY) return PYP_DATA_ERROR_OPEN_INPUT; // error
+	if (fileOpenUnicode(dataFilename, "rb", &dataStream) != FILE_OPEN_OKAY) {
+		// Error
+		status = PYP_DATA_ERROR_OPEN_DATA;
+		goto cleanup;
+	}
+
+	// Start python
+	if (pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) {
+		// Error
+		status = PYP_DATA_ERROR_PYTHON;
+		goto cleanup;
+	}
+
+	// Execution setup; one for the whole run, as the records share the globals
+	if (
+		(render.dataBuffer = pypDataBufferCreate()) == NULL ||
+		pypModuleExecutionInfoCreate(
+			&exeInfo,
+			engine->readSettings,
+			engine->piMain,
+			engine->piCodeBlock,
+			engine->piCodeExpression,
+			engine->optimizedTags,
+			inputStream,
+			NULL,
+			errorStream,
+			render.dataBuffer,
+			inputFilename,
+			engine->encoding,
+			engine->encodingErrorMode,
+			engine->pythonState
+		) == NULL
+	) {
+		// Error
+		status = PYP_DATA_ERROR_MEMORY;
+		goto cleanup;
+	}
+	exeInfoCreated = PYP_TRUE;
+	exeInfo.outputSync = (engine->outputSync == FILE_OUTPUT_SYNC_GROUP) ? FILE_OUTPUT_SYNC_FILE : engine->outputSync; // as for any other render
+
+	if (engine->includePaths != NULL && (exeInfo.includeLookups = pypIncludeLookupsCreate(engine->includePaths)) == NULL) {
+		// Error
+		status = PYP_DATA_ERROR_MEMORY;
+		goto cleanup;
+	}
+
+	// Setup pyp
+	if (pypModulePythonInit(&exeInfo) != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error
+		status = PYP_DATA_ERROR_PYTHON;
+		goto cleanup;
+	}
+	pythonInit = PYP_TRUE;
+	if (globals != NULL && PyDict_Update(engine->pythonState->globalsDict, globals) != 0) {
+		// Error
+		PyErr_Clear();
+		status = PYP_DATA_ERROR_PYTHON;
+		goto cleanup;
+	}
+
+	// Compiled once; each record only runs the compiled tags, in a copy of the globals with the record's keys added
+	if ((render.template = pypModuleTemplateCompile(&exeInfo)) == NULL) {
+		// Error
+		PyErr_Print();
+		status = PYP_DATA_ERROR_TEMPLATE;
+		goto cleanup;
+	}
+
+	// Records are parsed by the json module, and named with the pattern's str.format
+	if (
+		(jsonModule = PyImport_ImportModule("json")) == NULL ||
+		(render.loads = PyObject_GetAttrString(jsonModule, "loads")) == NULL ||
+		(pattern = PyUnicode_FromWideChar(outputPattern, (Py_ssize_t) getUnicodeCharStringLength(outputPattern))) == NULL ||
+		(render.format = PyObject_GetAttrString(pattern, "format")) == NULL ||
+		(render.noArgs = PyTuple_New(0)) == NULL
+	) {
+		// Error
+		PyErr_Clear();
+		status = PYP_DATA_ERROR_PYTHON;
+		goto cleanup;
+	}
+
+	// Run
+	#ifndef _WIN32
+	if (settings->workerCount > 1) {
+		status = pypDataRunWorkers(&render, dataStream, dataFilename, settings, failureCount);
+	}
+	else
+	#endif
+	{
+		status = pypDataRecordsRender(&render, dataStream, failureCount);
+	}
+
+
+	// Cleanup
+	cleanup:
+	if (render.template != NULL) Py_DECREF(render.template);
+	if (render.loads != NULL) Py_DECREF(render.loads);
+	if (render.format != NULL) Py_DECREF(render.format);
+	if (render.noArgs != NULL) Py_DECREF(render.noArgs);
+	if (jsonModule != NULL) Py_DECREF(jsonModule);
+	if (pattern != NULL) Py_DECREF(pattern);
+	if (pythonInit) pypModulePythonDeinit(&exeInfo);
+	if (exeInfoCreated) {
+		if (exeInfo.includeLookups != NULL) pypIncludeLookupsDelete(exeInfo.includeLookups);
+		pypModuleExecutionInfoClean(&exeInfo);
+	}
+	if (render.dataBuffer != NULL) pypDataBufferDelete(render.dataBuffer);
+	if (dataStream != NULL) fclose(dataStream);
+	fclose(inputStream);
+	return status;
+}
+
+PypDataStatus
+pypDataLineRead(FILE* stream, char** line, size_t* lineLength, size_t* lineCapacity, PypBool* found) {
+	// Vars
+	char* lineNew;
+	size_t length = 0;
+
+	// Assertions
+	assert(stream != NULL);
+	assert(line != NULL);
+	assert(lineLength != NULL);
+	assert(lineCapacity != NULL);
+	assert(found != NULL);
+
+	// Only one line is held at a time, however long the file is
+	*found = PYP_FALSE;
+	while (1) {
+		if (*line == NULL || *lineCapacity - length < 2) {
+			if (*line == NULL) {
+				*lineCapacity = 4096;
+				lineNew = memAllocArray(char, *lineCapacity);
+			}
+			else {
+				*lineCapacity *= 2;
+				lineNew = memReallocArray(*line, char, *lineCapacity);
+			}
+			if (lineNew == NULL) return PYP_DATA_ERROR_MEMORY; // error
+			*line = lineNew;
+		}
+
+		if (fgets(&(*line)[length], (int) (*lineCapacity - length), stream) == NULL) break;
+		*found = PYP_TRUE;
+		length += strlen(&(*line)[length]);
+		if (length > 0 && (*line)[length - 1] == '\n') break;
+	}
+
+	// Done
+	if (ferror(stream)) return PYP_DATA_ERROR_READ; // error
+	*lineLength = length;
+	return PYP_DATA_OKAY;
+}
+
+PypBool
+pypDataLineTrim(const char* line, size_t* lineStart, size_t* lineLength) {
+	// Assertions
+	assert(line != NULL);
+	assert(lineStart != NULL);
+	assert(lineLength != NULL);
+
+	// Surrounding whitespace is cut off; blank lines are not records
+	while (*lineLength > 0 && (line[*lineLength - 1] == '\n' || line[*lineLength - 1] == '\r' || line[*lineLength - 1] == ' ' || line[*lineLength - 1] == '\t')) --(*lineLength);
+	for (*lineStart = 0; *lineStart < *lineLength && (line[*lineStart] == ' ' || line[*lineStart] == '\t'); ++(*lineStart));
+	*lineLength -= *lineStart;
+	return (*lineLength > 0);
+}
+
+PypDataStatus
+pypDataRecordsRender(PypDataRender* render, FILE* dataStream, size_t* failureCount) {
+	// Vars
+	char* line = NULL;
+	size_t lineLength;
+	size_t lineCapacity = 0;
+	size_t lineStart;
+	size_t lineNumber = 0;
+	PypBool found;
+	PypDataStatus status;
+
+	// Assertions
+	assert(render != NULL);
+	assert(dataStream != NULL);
+	assert(failureCount != NULL);
+
+	// One JSON object per line; blank lines are skipped
+	while ((status = pypDataLineRead(dataStream, &line, &lineLength, &lineCapacity, &found)) == PYP_DATA_OKAY && found) {
+		++lineNumber;
+		if (!pypDataLineTrim(line, &lineStart, &lineLength)) continue;
+
+		if (!pypDataRecordRender(render, &line[lineStart], lineLength, lineNumber)) ++(*failureCount);
+	}
+
+	// Done
+	if (line != NULL) memFree(line);
+	return status;
+}
+
+PypBool
+pypDataRecordRender(PypDataRender* render, const char* line, size_t lineLength, size_t lineNumber) {
+	// Vars
+	PyObject* text = NULL;
+	PyObject* record = NULL;
+	PyObject* filenameObject = NULL;
+	unicode_char* outputFilename = NULL;
+	PypSlots slots;
+	FileOutput output;
+	PypDataBufferEntry* entry;
+	PypReadStatus rs = PYP_READ_OKAY;
+	PypBool rendered;
+	PypBool okay = PYP_FALSE;
+
+	// Assertions
+	assert(render != NULL);
+	assert(line != NULL);
+
+	// Parse
+	if (
+		(text = PyUnicode_DecodeUTF8(line, (Py_ssize_t) lineLength, "strict")) == NULL ||
+		(record = PyObject_CallFunctionObjArgs(render->loads, text, NULL)) == NULL
+	) {
+		// Error
+		pypDataReportException(render->reportStream, lineNumber);
+		goto cleanup;
+	}
+	if (!PyDict_Check(record)) {
+		// Error
+		pypDataReport(render->reportStream, lineNumber, "Record is not a JSON object");
+		goto cleanup;
+	}
+
+	// Output file name
+	if ((filenameObject = PyObject_Call(render->format, render->noArgs, record)) == NULL) {
+		// Error
+		pypDataReportException(render->reportStream, lineNumber);
+		goto cleanup;
+	}
+	if (!pypPathFromObject(filenameObject, &outputFilename)) {
+		// Error
+		pypDataReport(render->reportStream, lineNumber, "Invalid output path");
+		goto cleanup;
+	}
+
+	// Render; slots are filled once the record's output is complete
+	pypSlotsInit(&slots, NULL);
+	render->executionInfo->slots = &slots;
+	rendered = pypModuleTemplateRender(render->executionInfo, render->template, record, render->dataBuffer);
+	if (pypSlotsFinish(&slots, render->dataBuffer) != PYP_SLOTS_OKAY) rs = PYP_READ_ERROR_WRITE;
+	render->executionInfo->slots = NULL;
+	pypStatsAdd(PYP_STATS_RENDERS, 1);
+	if (!rendered) {
+		// Error
+		pypStatsAdd(PYP_STATS_RENDER_ERRORS, 1);
+		pypDataReportException(render->reportStream, lineNumber);
+		goto cleanup;
+	}
+
+	// Write
+	if (rs == PYP_READ_OKAY) {
+		if (pypEngineOutputOpen(render->engine, outputFilename, &output) != FILE_OPEN_OKAY) {
+			rs = PYP_READ_ERROR_OPEN;
+		}
+		else {
+			for (entry = render->dataBuffer->firstChild; rs == PYP_READ_OKAY && entry != NULL; entry = entry->nextSibling) {
+				if (fwrite(entry->buffer, sizeof(PypChar), entry->bufferLength, output.stream) != entry->bufferLength) rs = PYP_READ_ERROR_WRITE;
+			}
+			rs = pypEngineOutputClose(&output, rs);
+		}
+	}
+	if (rs != PYP_READ_OKAY) {
+		// Error
+		pypStatsAdd(PYP_STATS_RENDER_ERRORS, 1);
+		pypDataReport(render->reportStream, lineNumber, pypReadStatusDescription(rs));
+		goto cleanup;
+	}
+
+	// Done
+	okay = PYP_TRUE;
+
+
+	// Cleanup
+	cleanup:
+	pypDataBufferEmpty(render->dataBuffer);
+	if (text != NULL) Py_DECREF(text);
+	if (record != NULL) Py_DECREF(record);
+	if (filenameObject != NULL) Py_DECREF(filenameObject);
+	if (outputFilename != NULL) memFree(outputFilename);
+	return okay;
+}
+
+
+
+// Reporting
+void
+pypDataReport(FILE* reportStream, size_t lineNumber, const char* message) {
+	assert(reportStream != NULL);
+	assert(message != NULL);
+
+	fprintf(reportStream, "Error rendering record on line %lu: %s\n", (unsigned long int) lineNumber, message);
+}
+
+void
+pypDataReportException(FILE* reportStream, size_t lineNumber) {
+	// Vars
+	PyObject* exception;
+	PyObject* value;
+	PyObject* traceback;
+	PyObject* messageObject;
+	const char* typeName = NULL;
+	const char* typeNameEnd;
+	char* message = NULL;
+
+	// Assertions
+	assert(reportStream != NULL);
+
+	// The exception's type without its module, and its message
+	PyErr_Fetch(&exception, &value, &traceback);
+	PyErr_NormalizeException(&exception, &value, &traceback);
+	if (exception != NULL && (typeName = PyExceptionClass_Name(exception)) != NULL && (typeNameEnd = strrchr(typeName, '.')) != NULL) typeName = typeNameEnd + 1;
+	if (value != NULL && (messageObject = PyObject_Str(value)) != NULL) {
+		message = pypStringObjectCopyUTF8(messageObject);
+		Py_DECREF(messageObject);
+	}
+
+	// Report
+	fprintf(
+		reportStream,
+		"Error rendering record on line %lu: %s%s%s\n",
+		(unsigned long int) lineNumber,
+		(typeName != NULL) ? typeName : "Error",
+		(message != NULL && message[0] != '\x00') ? ": " : "",
+		(message != NULL) ? message : ""
+	);
+
+	// Clean
+	if (message != NULL) memFree(message);
+	if (exception != NULL) Py_DECREF(exception);
+	if (value != NULL) Py_DECREF(value);
+	if (traceback != NULL) Py_DECREF(traceback);
+	PyErr_Clear();
+}
+
+
+
+// Worker processes
+#ifndef _WIN32
+PypDataStatus
+pypDataRunWorkers(PypDataRender* render, FILE* dataStream, const unicode_char* dataFilename, const PypDataSettings* settings, size_t* failureCount) {
+	// Vars
+	PypDataWorkers workers;
+	PypBatchPool pool;
+	PypBatchStatus batchStatus;
+	PypDataStatus status;
+	size_t i;
+
+	// Assertions
+	assert(render != NULL);
+	assert(dataStream != NULL);
+	assert(dataFilename != NULL);
+	assert(settings != NULL);
+	assert(settings->workerCount > 1);
+	assert(failureCount != NULL);
+
+	// Setup
+	workers.render = render;
+	workers.dataFilename = dataFilename;
+	workers.records = NULL;
+	workers.recordCount = 0;
+	workers.reportNext = 0;
+	workers.failureCount = failureCount;
+	workers.status = PYP_DATA_OKAY;
+	workers.dataStream = NULL;
+	workers.reportStream = NULL;
+	workers.line = NULL;
+	workers.lineCapacity = 0;
+
+	// Every record is found first, so each worker can be handed the next one as it becomes free
+	if ((status = pypDataRecordsIndex(dataStream, &workers.records, &workers.recordCount)) != PYP_DATA_OKAY) return status; // error
+
+	// Started after the template is compiled, so every worker shares it copy-on-write
+	pool.jobCount = workers.recordCount;
+	pool.order = NULL;
+	pool.workerCount = settings->workerCount;
+	pool.workerMaxJobs = settings->workerMaxJobs;
+	pool.workerMaxMemory = settings->workerMaxMemory;
+	pool.executeFunction = pypDataWorkerExecute;
+	pool.completeFunction = pypDataWorkerComplete;
+	pool.reportFunction = pypDataWorkerReport;
+	pool.data = &workers;
+
+	batchStatus = pypBatchPoolRun(&pool);
+	if (batchStatus == PYP_BATCH_ERROR_MEMORY) {
+		status = PYP_DATA_ERROR_MEMORY;
+	}
+	else if (batchStatus != PYP_BATCH_OKAY) {
+		status = PYP_DATA_ERROR_WORKER;
+	}
+	else {
+		status = workers.status;
+	}
+
+	// Clean
+	for (i = 0; i < workers.recordCount; ++i) {
+		if (workers.records[i].reportText != NULL) memFree(workers.records[i].reportText);
+	}
+	if (workers.records != NULL) memFree(workers.records);
+	return status;
+}
+
+PypDataStatus
+pypDataRecordsIndex(FILE* dataStream, PypDataRecord** records, size_t* recordCount) {
+	// Vars
+	PypDataRecord* recordsNew;
+	PypDataRecord* record;
+	size_t recordCapacity = 0;
+	char* line = NULL;
+	size_t lineLength;
+	size_t lineCapacity = 0;
+	size_t lineStart;
+	size_t lineNumber = 0;
+	long int offset;
+	PypBool found;
+	PypDataStatus status;
+
+	// Assertions
+	assert(dataStream != NULL);
+	assert(records != NULL);
+	assert(recordCount != NULL);
+
+	// Only where each record starts is kept
+	*records = NULL;
+	*recordCount = 0;
+	while ((offset = ftell(dataStream)) >= 0 && (status = pypDataLineRead(dataStream, &line, &lineLength, &lineCapacity, &found)) == PYP_DATA_OKAY && found) {
+		++lineNumber;
+		if (!pypDataLineTrim(line, &lineStart, &lineLength)) continue;
+
+		// Extend
+		if (*recordCount >= recordCapacity) {
+			recordCapacity = (recordCapacity == 0) ? 1024 : recordCapacity * 2;
+			recordsNew = (*records == NULL) ? memAllocArray(PypDataRecord, recordCapacity) : memReallocArray(*records, PypDataRecord, recordCapacity);
+			if (recordsNew == NULL) {
+				// Error
+				status = PYP_DATA_ERROR_MEMORY;
+				break;
+			}
+			*records = recordsNew;
+		}
+
+		record = &(*records)[*recordCount];
+		record->offset = offset;
+		record->lineNumber = lineNumber;
+		record->status = PYP_DATA_OKAY;
+		record->reportText = NULL;
+		record->reportTextLength = 0;
+		record->complete = PYP_FALSE;
+		record->workerLost = PYP_FALSE;
+		++(*recordCount);
+	}
+	if (offset < 0) status = PYP_DATA_ERROR_READ;
+
+	// Done
+	if (line != NULL) memFree(line);
+	if (status != PYP_DATA_OKAY && *records != NULL) {
+		// Error
+		memFree(*records);
+		*records = NULL;
+		*recordCount = 0;
+	}
+	return status;
+}
+
+uint32_t
+pypDataWorkerExecute(void* data, size_t jobIndex, char** text, size_t* textLength) {
+	// Vars
+	PypDataWorkers* workers = (PypDataWorkers*) data;
+	PypDataRecord* record = &workers->records[jobIndex];
+	size_t lineLength;
+	size_t lineStart;
+	long int reportLength;
+	PypBool found;
+	PypDataStatus status = PYP_DATA_OKAY;
+
+	// Opened again by each worker, so they don't share a file position
+	if (workers->dataStream == NULL && fileOpenUnicode(workers->dataFilename, "rb", &workers->dataStream) != FILE_OPEN_OKAY) {
+		// Error
+		workers->dataStream = NULL;
+		return PYP_DATA_ERROR_OPEN_DATA;
+	}
+	if (workers->reportStream == NULL && (workers->reportStream = tmpfile()) == NULL) return PYP_DATA_ERROR_WORKER; // error
+
+	// Reports are collected, so the parent can show them in record order
+	rewind(workers->reportStream);
+	workers->render->reportStream = workers->reportStream;
+
+	// Render
+	if (fseek(workers->dataStream, record->offset, SEEK_SET) != 0) {
+		status = PYP_DATA_ERROR_READ;
+	}
+	else if ((status = pypDataLineRead(workers->dataStream, &workers->line, &lineLength, &workers->lineCapacity, &found)) == PYP_DATA_OKAY) {
+		if (!found || !pypDataLineTrim(workers->line, &lineStart, &lineLength)) {
+			status = PYP_DATA_ERROR_READ; // changed since it was indexed
+		}
+		else {
+			pypDataRecordRender(workers->render, &workers->line[lineStart], lineLength, record->lineNumber);
+		}
+	}
+
+	// Read what was reported
+	fflush(workers->reportStream);
+	reportLength = ftell(workers->reportStream);
+	if (reportLength > 0) {
+		if ((*text = memAllocArray(char, reportLength)) == NULL) return PYP_DATA_ERROR_MEMORY; // error
+		rewind(workers->reportStream);
+		*textLength = fread(*text, sizeof(char), reportLength, workers->reportStream);
+	}
+
+	// Done
+	return status;
+}
+
+void
+pypDataWorkerComplete(void* data, size_t jobIndex, uint32_t status, char* text, size_t textLength, PypBool workerLost) {
+	// Vars
+	PypDataWorkers* workers = (PypDataWorkers*) data;
+	PypDataRecord* record = &workers->records[jobIndex];
+
+	// Complete
+	record->status = workerLost ? PYP_DATA_OKAY : (PypDataStatus) status;
+	record->workerLost = workerLost;
+	record->reportText = text;
+	record->reportTextLength = textLength;
+	record->complete = PYP_TRUE;
+	if (record->status != PYP_DATA_OKAY && workers->status == PYP_DATA_OKAY) workers->status = record->status;
+}
+
+void
+pypDataWorkerReport(void* data) {
+	// Vars
+	PypDataWorkers* workers = (PypDataWorkers*) data;
+	FILE* reportStream = workers->render->reportStream;
+	PypDataRecord* record;
+
+	// Report every completed record which has no incomplete record before it
+	for (; workers->reportNext < workers->recordCount; ++workers->reportNext) {
+		record = &workers->records[workers->reportNext];
+		if (!record->complete) break;
+
+		if (record->reportTextLength > 0) fwrite(record->reportText, sizeof(char), record->reportTextLength, reportStream);
+		if (record->workerLost) {
+			pypDataReport(reportStream, record->lineNumber, "Worker terminated unexpectedly");
+		}
+		else if (record->status != PYP_DATA_OKAY) {
+			pypDataReport(reportStream, record->lineNumber, pypDataStatusDescription(record->status));
+		}
+
+		// A record failed if anything was reported for it
+		if (record->workerLost || record->status != PYP_DATA_OKAY || record->reportTextLength > 0) ++(*workers->failureCount);
+
+		// Release
+		if (record->reportText != NULL) {
+			memFree(record->reportText);
+			record->reportText = NULL;
+			record->reportTextLength = 0;
+		}
+	}
+	fflush(reportStream);
+}
+#endif
+
+
+
+// Status info
+const char*
+pypDataStatusDescription(PypDataStatus status) {
+	switch (status) {
+		case PYP_DATA_OKAY:
+			return "Okay";
+		case PYP_DATA_ERROR_MEMORY:
+			return "Memory error";
+		case PYP_DATA_ERROR_OPEN_INPUT:
+			return "Error opening input file";
+		case PYP_DATA_ERROR_OPEN_DATA:
+			return "Error opening data file";
+		case PYP_DATA_ERROR_READ:
+			return "Error reading data file";
+		case PYP_DATA_ERROR_TEMPLATE:
+			return "The template couldn't be compiled";
+		case PYP_DATA_ERROR_WORKER:
+			return "Worker process error";
+		case PYP_DATA_ERROR_PYTHON:
+			return "Python setup error";
+		default:
+			return "Error";
+	}
+}
+
@@ -0,0 +1,43 @@
+#ifndef __PYP_DATA_H
+#define __PYP_DATA_H
+
+
+
+#include <stdio.h>
+#include "PypTypes.h"
+#include "PypReader.h"
+#include "PypEngine.h"
+#include "Unicode.h"
+
+
+
+typedef enum PypDataStatus_ {
+	PYP_DATA_OKAY = 0x0,
+	PYP_DATA_ERROR_MEMORY = 0x1,
+	PYP_DATA_ERROR_OPEN_INPUT = 0x2,
+	PYP_DATA_ERROR_OPEN_DATA = 0x3,
+	PYP_DATA_ERROR_READ = 0x4,
+	PYP_DATA_ERROR_TEMPLATE = 0x5, // the template couldn't be compiled
+	PYP_DATA_ERROR_WORKER = 0x6,
+	PYP_DATA_ERROR_PYTHON = 0x7,
+} PypDataStatus;
+
+typedef struct PypDataSettings_ {
+	size_t workerCount; // each worker process is handed the next record once it's free
+	size_t workerMaxJobs; // records a worker renders before it's replaced; 0 for no limit
+	size_t workerMaxMemory; // in kilobytes; 0 for no limit
+} PypDataSettings;
+
+
+
+void pypDataSettingsInit(PypDataSettings* settings);
+
+// Renders inputFilename once for each JSON object line of dataFilename, written to outputPattern formatted with the object's keys
+PypDataStatus pypDataRun(PypEngine* engine, const unicode_char* inputFilename, const unicode_char* dataFilename, const unicode_char* outputPattern, PyObject* globals, const PypDataSettings* settings, FILE* errorStream, FILE* reportStream, size_t* failureCount);
+
+const char* pypDataStatusDescription(PypDataStatus status);
+
+
+
+#endif
+
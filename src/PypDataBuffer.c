@@ -34,8 +34,7 @@ pypDataBufferDelete(PypDataBuffer* dataBuffer) {
 	for (entry = dataBuffer->firstChild; entry != NULL; entry = next) {
 		// Delete
 		next = entry->nextSibling;
-		memFree(entry->buffer);
-		memFree(entry);
+		pypDataBufferEntryDelete(entry);
 	}
 
 	memFree(dataBuffer);
@@ -55,8 +54,7 @@ pypDataBufferEmpty(PypDataBuffer* dataBuffer) {
 	for (entry = dataBuffer->firstChild; entry != NULL; entry = next) {
 		// Delete
 		next = entry->nextSibling;
-		memFree(entry->buffer);
-		memFree(entry);
+		pypDataBufferEntryDelete(entry);
 	}
 
 	// Zero data
@@ -90,6 +88,7 @@ pypDataBufferExtend(PypDataBuffer* dataBuffer, PypSize dataLength) {
 
 	entry->bufferLength = dataLength;
 	dataBuffer->totalSize += dataLength;
+	entry->reference = NULL;
 	entry->nextSibling = NULL;
 
 	// Link
@@ -136,9 +135,18 @@ pypDataBufferExtendWithString(PypDataBuffer* dataBuffer, const PypChar* data) {
 // Extend it with another instance
 void
 pypDataBufferExtendWithDataBufferAndDelete(PypDataBuffer* dataBuffer, PypDataBuffer* other) {
+	// Move, then delete other
+	pypDataBufferExtendWithDataBufferAndEmpty(dataBuffer, other);
+	memFree(other);
+}
+
+// Extend it with the contents of another instance, which is left empty
+void
+pypDataBufferExtendWithDataBufferAndEmpty(PypDataBuffer* dataBuffer, PypDataBuffer* other) {
 	// Assertions
 	assert(dataBuffer != NULL);
 	assert(other != NULL);
+	assert(dataBuffer != other);
 
 	if (other->firstChild != NULL) {
 		// Must be something to copy
@@ -148,6 +156,75 @@ pypDataBufferExtendWithDataBufferAndDelete(PypDataBuffer* dataBuffer, PypDataBuf
 		dataBuffer->totalSize += other->totalSize;
 		*(dataBuffer->lastChild) = other->firstChild;
 		dataBuffer->lastChild = other->lastChild;
+
+		// Zero other
+		other->totalSize = 0;
+		other->firstChild = NULL;
+		other->lastChild = &other->firstChild;
+	}
+}
+
+// Reserve a position, which is filled later with another instance
+PypDataBufferEntry*
+pypDataBufferExtendPlaceholder(PypDataBuffer* dataBuffer) {
+	// Vars
+	PypDataBufferEntry* entry;
+
+	// Assertions
+	assert(dataBuffer != NULL);
+
+	// Create; an empty entry, so unification and output can treat it like any other
+	entry = memAlloc(PypDataBufferEntry);
+	if (entry == NULL) return NULL; // error
+
+	entry->buffer = memAllocArray(PypChar, 1);
+	if (entry->buffer == NULL) {
+		// Cleanup
+		memFree(entry);
+		return NULL;
+	}
+	entry->buffer[0] = '\x00';
+	entry->bufferLength = 0;
+	entry->reference = NULL;
+	entry->nextSibling = NULL;
+
+	// Link
+	*dataBuffer->lastChild = entry;
+	dataBuffer->lastChild = &entry->nextSibling;
+
+	// Done
+	return entry;
+}
+
+// Delete a single entry, which isn't linked into a buffer anymore
+void
+pypDataBufferEntryDelete(PypDataBufferEntry* entry) {
+	// Assertions
+	assert(entry != NULL);
+
+	// Whatever kept track of it is told it's gone
+	if (entry->reference != NULL) *entry->reference = NULL;
+
+	// Delete
+	memFree(entry->buffer);
+	memFree(entry);
+}
+
+// Insert another instance after a placeholder
+void
+pypDataBufferPlaceholderFillAndDelete(PypDataBuffer* dataBuffer, PypDataBufferEntry* placeholder, PypDataBuffer* other) {
+	// Assertions
+	assert(dataBuffer != NULL);
+	assert(placeholder != NULL);
+	assert(placeholder->bufferLength == 0);
+	assert(other != NULL);
+
+	if (other->firstChild != NULL) {
+		// Link in
+		*(other->lastChild) = placeholder->nextSibling;
+		if (dataBuffer->lastChild == &placeholder->nextSibling) dataBuffer->lastChild = other->lastChild;
+		placeholder->nextSibling = other->firstChild;
+		dataBuffer->totalSize += other->totalSize;
 	}
 
 	// Delete other
@@ -180,6 +257,7 @@ pypDataBufferUnify(PypDataBuffer* dataBuffer, PypBool nullTerminate, PypDataBuff
 	if (entryNew == NULL) return PYP_FALSE; // error
 
 	entryNew->bufferLength = dataBuffer->totalSize;
+	entryNew->reference = NULL;
 	entryNew->nextSibling = NULL;
 
 	// Create
@@ -203,8 +281,7 @@ pypDataBufferUnify(PypDataBuffer* dataBuffer, PypBool nullTerminate, PypDataBuff
 	for (entry = dataBuffer->firstChild; entry != NULL; entry = next) {
 		// Delete
 		next = entry->nextSibling;
-		memFree(entry->buffer);
-		memFree(entry);
+		pypDataBufferEntryDelete(entry);
 	}
 
 	// Update lists
@@ -21,6 +21,7 @@ typedef struct PypDataBuffer_ {
 typedef struct PypDataBufferEntry_ {
 	PypSize bufferLength;
 	PypChar* buffer;
+	struct PypDataBufferEntry_** reference; // if not NULL, set to NULL when the entry is deleted; placeholders something outside the buffer keeps track of
 	struct PypDataBufferEntry_* nextSibling;
 } PypDataBufferEntry;
 
@@ -33,6 +34,10 @@ PypDataBufferEntry* pypDataBufferExtend(PypDataBuffer* dataBuffer, PypSize dataL
 PypDataBufferEntry* pypDataBufferExtendWithData(PypDataBuffer* dataBuffer, const PypChar* data, PypSize dataLength);
 PypDataBufferEntry* pypDataBufferExtendWithString(PypDataBuffer* dataBuffer, const PypChar* data);
 void pypDataBufferExtendWithDataBufferAndDelete(PypDataBuffer* dataBuffer, PypDataBuffer* other);
+void pypDataBufferExtendWithDataBufferAndEmpty(PypDataBuffer* dataBuffer, PypDataBuffer* other);
+PypDataBufferEntry* pypDataBufferExtendPlaceholder(PypDataBuffer* dataBuffer);
+void pypDataBufferEntryDelete(PypDataBufferEntry* entry);
+void pypDataBufferPlaceholderFillAndDelete(PypDataBuffer* dataBuffer, PypDataBufferEntry* placeholder, PypDataBuffer* other);
 PypBool pypDataBufferUnify(PypDataBuffer* dataBuffer, PypBool nullTerminate, PypDataBufferEntry** ptrNewEntry);
 
 
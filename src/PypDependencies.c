@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <string.h>
+#include "PypDependencies.h"
+#include "Memory.h"
+#include "File.h"
+
+
+
+// Headers
+static PypBool pypDependenciesWriteEscaped(FILE* stream, const unicode_char* filename);
+
+MAP_BODY_HELPER_HEADERS_STATIC(unicode_char*, size_t, pypDependencyMap, PypDependencyMap);
+MAP_FUNCTION_HEADERS_STATIC(unicode_char*, size_t, pypDependencyMap, PypDependencyMap);
+MAP_BODY(unicode_char*, size_t, pypDependencyMap, PypDependencyMap)
+
+
+
+// Creation
+PypDependencies*
+pypDependenciesCreate() {
+	// Vars
+	PypDependencies* dependencies;
+
+	// Create
+	dependencies = memAlloc(PypDependencies);
+	if (dependencies == NULL) return NULL; // error
+
+	dependencies->filenames = NULL;
+	dependencies->count = 0;
+	dependencies->capacity = 0;
+	dependencies->codeErrorCount = 0;
+	dependencies->sideOutputCount = 0;
+
+	if ((dependencies->map = pypDependencyMapCreate(NULL)) == NULL) {
+		// Error
+		memFree(dependencies);
+		return NULL;
+	}
+	threadMutexInit(&dependencies->mutex);
+
+	// Done
+	return dependencies;
+}
+
+void
+pypDependenciesDelete(PypDependencies* dependencies) {
+	// Vars
+	size_t i;
+
+	// Assertions
+	assert(dependencies != NULL);
+
+	// Delete
+	for (i = 0; i < dependencies->count; ++i) memFree(dependencies->filenames[i]);
+	if (dependencies->filenames != NULL) memFree(dependencies->filenames);
+	pypDependencyMapDelete(dependencies->map);
+	threadMutexDestroy(&dependencies->mutex);
+	memFree(dependencies);
+}
+
+
+
+// Access
+PypBool
+pypDependenciesAdd(PypDependencies* dependencies, const unicode_char* filename) {
+	// Vars
+	unicode_char* filenameCopy = NULL;
+	size_t length;
+	PypBool okay = PYP_TRUE;
+
+	// Assertions
+	assert(dependencies != NULL);
+	assert(filename != NULL);
+
+	threadMutexLock(&dependencies->mutex);
+
+	// Already known
+	if (pypDependencyMapFind(dependencies->map, filename, NULL) == MAP_FOUND) goto cleanup;
+
+	// Extend
+	if (dependencies->count == dependencies->capacity) {
+		unicode_char** filenamesNew;
+		size_t capacityNew = (dependencies->capacity == 0) ? 16 : dependencies->capacity * 2;
+
+		filenamesNew = (dependencies->filenames == NULL) ? memAllocArray(unicode_char*, capacityNew) : memReallocArray(dependencies->filenames, unicode_char*, capacityNew);
+		if (filenamesNew == NULL) {
+			// Error
+			okay = PYP_FALSE;
+			goto cleanup;
+		}
+		dependencies->filenames = filenamesNew;
+		dependencies->capacity = capacityNew;
+	}
+
+	// Add
+	length = wcslen(filename) + 1;
+	if (
+		(filenameCopy = memAllocArray(unicode_char, length)) == NULL ||
+		pypDependencyMapAdd(dependencies->map, filename, dependencies->count) != MAP_ADDED
+	) {
+		// Error
+		if (filenameCopy != NULL) memFree(filenameCopy);
+		okay = PYP_FALSE;
+		goto cleanup;
+	}
+	memcpy(filenameCopy, filename, sizeof(unicode_char) * length);
+	dependencies->filenames[dependencies->count++] = filenameCopy;
+
+	// Done
+	cleanup:
+	threadMutexUnlock(&dependencies->mutex);
+	return okay;
+}
+
+PypBool
+pypDependenciesContains(PypDependencies* dependencies, const unicode_char* filename) {
+	// Vars
+	PypBool found;
+
+	// Assertions
+	assert(dependencies != NULL);
+	assert(filename != NULL);
+
+	threadMutexLock(&dependencies->mutex);
+	found = (pypDependencyMapFind(dependencies->map, filename, NULL) == MAP_FOUND);
+	threadMutexUnlock(&dependencies->mutex);
+
+	return found;
+}
+
+
+
+// Output
+PypBool
+pypDependenciesWriteMakefile(PypDependencies* dependencies, const unicode_char* target, const unicode_char* filename) {
+	// Vars
+	FILE* stream;
+	PypBool okay;
+	size_t i;
+
+	// Assertions
+	assert(dependencies != NULL);
+	assert(target != NULL);
+	assert(filename != NULL);
+
+	// Open
+	if (fileOpenUnicode(filename, "wb", &stream) != FILE_OPEN_OKAY) return PYP_FALSE; // error
+
+	// The target, followed by everything read to render it
+	okay = pypDependenciesWriteEscaped(stream, target);
+	if (okay) okay = (fputc(':', stream) != EOF);
+	for (i = 0; okay && i < dependencies->count; ++i) {
+		okay = (
+			fputs((i == 0) ? " " : " \\\n  ", stream) != EOF &&
+			pypDependenciesWriteEscaped(stream, dependencies->filenames[i])
+		);
+	}
+	if (okay) okay = (fputc('\n', stream) != EOF);
+
+	// Each file also gets an empty rule, so deleting one doesn't break the build
+	for (i = 0; okay && i < dependencies->count; ++i) {
+		okay = (
+			fputc('\n', stream) != EOF &&
+			pypDependenciesWriteEscaped(stream, dependencies->filenames[i]) &&
+			fputs(":\n", stream) != EOF
+		);
+	}
+
+	// Close
+	if (fclose(stream) != 0) okay = PYP_FALSE;
+
+	// Done
+	return okay;
+}
+
+PypBool
+pypDependenciesWriteEscaped(FILE* stream, const unicode_char* filename) {
+	// Vars
+	char* filenameUTF8;
+	size_t filenameUTF8Length;
+	size_t errorCount;
+	size_t i;
+	PypBool okay = PYP_TRUE;
+
+	if (unicodeUTF8Encode(filename, &filenameUTF8, &filenameUTF8Length, &errorCount) != UNICODE_OKAY) return PYP_FALSE; // error
+
+	// Make treats spaces, "#" and "$" specially
+	for (i = 0; okay && i < filenameUTF8Length; ++i) {
+		switch (filenameUTF8[i]) {
+			case ' ':
+			case '#':
+				okay = (fputc('\\', stream) != EOF);
+				break;
+			case '$':
+				okay = (fputc('$', stream) != EOF);
+				break;
+		}
+		if (okay) okay = (fputc(filenameUTF8[i], stream) != EOF);
+	}
+
+	// Done
+	memFree(filenameUTF8);
+	return okay;
+}
+
+
+
+// Map functions
+MapHashValue pypDependencyMapKeyHashFunction(const unicode_char* key) {
+	return mapHelperHashUnicode(key);
+}
+int pypDependencyMapKeyCompareFunction(const unicode_char* key1, const unicode_char* key2) {
+	return mapHelperCompareUnicode(key1, key2);
+}
+int pypDependencyMapKeyCopyFunction(const unicode_char* key, unicode_char** output) {
+	return mapHelperCopyUnicode(key, output);
+}
+void pypDependencyMapKeyDeleteFunction(unicode_char* key) {
+	mapHelperDeleteUnicode(key);
+}
+void pypDependencyMapValueDeleteFunction(size_t value) {
+	// Nothing
+}
+
@@ -0,0 +1,39 @@
+#ifndef __PYP_DEPENDENCIES_H
+#define __PYP_DEPENDENCIES_H
+
+
+
+#include <stddef.h>
+#include "PypTypes.h"
+#include "Unicode.h"
+#include "Thread.h"
+#include "Map.h"
+
+
+
+MAP_DATA_HEADER(PypDependencyMap);
+
+typedef struct PypDependencies_ {
+	unicode_char** filenames; // absolute paths, in the order they were first read
+	size_t count;
+	size_t capacity;
+	PypDependencyMap* map;
+	ThreadMutex mutex; // includes may be rendered on several threads at once
+	volatile ThreadAtomic codeErrorCount; // code errors raised while rendering; the output may differ on another try
+	volatile ThreadAtomic sideOutputCount; // files written by pyp.output, which the cache can't restore
+} PypDependencies;
+
+
+
+PypDependencies* pypDependenciesCreate();
+void pypDependenciesDelete(PypDependencies* dependencies);
+
+PypBool pypDependenciesAdd(PypDependencies* dependencies, const unicode_char* filename);
+PypBool pypDependenciesContains(PypDependencies* dependencies, const unicode_char* filename);
+
+PypBool pypDependenciesWriteMakefile(PypDependencies* dependencies, const unicode_char* target, const unicode_char* filename);
+
+
+
+#endif
+
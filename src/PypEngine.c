@@ -0,0 +1,881 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <Python.h>
+#include "PypEngine.h"
+#include "PypDataBufferModifiers.h"
+#include "PypStats.h"
+#include "PypSlots.h"
+#include "Memory.h"
+#include "File.h"
+
+
+
+// Headers
+static PypTagGroup* pypEngineTagsInit(const PypProcessingInfo* piCodeBlock, const PypProcessingInfo* piCodeExpression, PypBool allowContinuation);
+static PypBool pypEngineImportPreludeModule(PyObject* mainDict, const char* moduleName, size_t moduleNameLength);
+static PypBool pypEngineInputTagFree(FILE* inputStream);
+static PypReadStatus pypEngineRenderExecute(PypEngine* engine, PypModuleExecutionInfo* exeInfo, PyObject* globals, PypDependencies* inputDependencies, PypDependencies* dependencies);
+
+static volatile ThreadAtomic pypEngineRenderCount = 0;
+
+
+
+// Settings
+void
+pypEngineSettingsInit(PypEngineSettings* settings) {
+	assert(settings != NULL);
+
+	settings->readerFlags = PYP_READER_FLAG_ON_UNCLOSED_TAG_ERROR | PYP_READER_FLAG_ON_CONTINUATION_UNMATCHED_TAG_ERROR | PYP_READER_FLAG_ON_CONTINUATION_MISMATCHED_TAG_ERROR;
+	settings->readBlockCount = 2;
+	settings->readBlockSize = 10240;
+	settings->allowContinuation = PYP_TRUE;
+	settings->allowTopLevelAwait = PYP_FALSE;
+	settings->inlineErrorEscapeFunction = NULL;
+	settings->outputOnlyIfChanged = PYP_FALSE;
+	settings->outputSync = FILE_OUTPUT_SYNC_NONE;
+	settings->cache = NULL;
+	settings->fragments = NULL;
+	settings->includePath = NULL;
+	settings->changeWorkingDirectory = PYP_FALSE;
+	settings->encoding = "utf-8";
+	settings->encodingErrorMode = "strict";
+	pypModulePythonSettingsInit(&settings->python);
+}
+
+
+
+// Creation
+PypEngine*
+pypEngineCreate(const PypEngineSettings* settings, const cmd_char* applicationPath) {
+	// Vars
+	PypEngine* engine;
+	PypStatsValue timerStart;
+	size_t applicationPathLength;
+
+	// Assertions
+	assert(settings != NULL);
+	assert(settings->encoding != NULL);
+	assert(settings->encodingErrorMode != NULL);
+	assert(applicationPath != NULL);
+
+	// Create
+	engine = memAlloc(PypEngine);
+	if (engine == NULL) return NULL; // error
+
+	engine->readSettings = NULL;
+	engine->piMain = NULL;
+	engine->piCodeBlock = NULL;
+	engine->piCodeExpression = NULL;
+	engine->optimizedTags = NULL;
+	engine->pythonState = NULL;
+	engine->applicationPath = NULL;
+	engine->python = settings->python;
+	engine->allowTopLevelAwait = settings->allowTopLevelAwait;
+	engine->encoding = settings->encoding;
+	engine->encodingErrorMode = settings->encodingErrorMode;
+	engine->preludeModules = NULL;
+	engine->outputOnlyIfChanged = settings->outputOnlyIfChanged;
+	engine->outputSync = settings->outputSync;
+	engine->cache = settings->cache;
+	engine->fragments = settings->fragments;
+	engine->includePaths = NULL;
+	engine->changeWorkingDirectory = settings->changeWorkingDirectory;
+	engine->parent = NULL;
+
+	// Setup
+	timerStart = pypStatsClock();
+	applicationPathLength = getUnicodeCharStringLength(applicationPath);
+	if (
+		(engine->applicationPath = memAllocArray(cmd_char, applicationPathLength + 1)) == NULL ||
+		(engine->piMain = pypProcessingInfoCreate(NULL, NULL, settings->inlineErrorEscapeFunction, NULL)) == NULL ||
+		(engine->piCodeBlock = pypProcessingInfoCreate(pypDataBufferModifyExecuteCode, NULL, NULL, pypDataBufferModifyToString)) == NULL ||
+		(engine->piCodeExpression = pypProcessingInfoCreate(pypDataBufferModifyExecuteExpression, NULL, NULL, pypDataBufferModifyToString)) == NULL ||
+		(engine->optimizedTags = pypEngineTagsInit(engine->piCodeBlock, engine->piCodeExpression, settings->allowContinuation)) == NULL ||
+		(engine->readSettings = pypReaderSettingsCreate(settings->readerFlags, settings->readBlockCount, settings->readBlockSize)) == NULL ||
+		(settings->includePath != NULL && (engine->includePaths = pypIncludePathsCreate(settings->includePath)) == NULL)
+	) {
+		// Error
+		pypEngineDelete(engine);
+		return NULL;
+	}
+	memcpy(engine->applicationPath, applicationPath, sizeof(cmd_char) * (applicationPathLength + 1));
+
+	// Set error messages
+	engine->readSettings->errorMessages[PYP_READER_ERROR_ID_UNCLOSED_TAG] = "Unclosed tag\n";
+	engine->readSettings->errorMessages[PYP_READER_ERROR_ID_CONTINUATION_UNMATCHED_OPENING_TAG] = "Invalid tag opening continuation\n";
+	engine->readSettings->errorMessages[PYP_READER_ERROR_ID_CONTINUATION_MISMATCHED_OPENING_TAG] = "Mismatched tag continuation opening\n";
+	engine->readSettings->errorMessages[PYP_READER_ERROR_ID_CONTINUATION_MISMATCHED_CLOSING_TAG] = "Mismatched tag continuation closing\n";
+	engine->readSettings->errorFunction = pypModuleReaderError; // records into the render's error log, if it has one
+	engine->readSettings->holdFunction = pypModuleReaderHold; // holds output back for unfilled slots
+	engine->readSettings->redirectFunction = pypModuleReaderRedirect; // output between tags goes into captures left open
+
+	// Python is started by the first render which needs it
+	pypStatsTimerAdd(PYP_STATS_TIMER_ENGINE_SETUP, pypStatsClock() - timerStart);
+
+	// Done
+	return engine;
+}
+
+PypEngineStatus
+pypEnginePythonStart(PypEngine* engine) {
+	assert(engine != NULL);
+
+	// Already started, or failed to
+	if (engine->pythonState != NULL) return (engine->pythonState->status == PYP_MODULE_SETUP_STATUS_OKAY) ? PYP_ENGINE_OKAY : PYP_ENGINE_ERROR_PYTHON;
+
+	// Setup
+	if ((engine->pythonState = pypModulePythonSetup(engine->applicationPath, &engine->python)) == NULL) return PYP_ENGINE_ERROR_MEMORY; // error
+	if (engine->pythonState->status != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error; the reason is only shown here, since python didn't show it
+		if (engine->pythonState->statusMessage != NULL) {
+			fprintf(stderr, "Python setup error: %s%s%s\n",
+				(engine->pythonState->statusFunction != NULL) ? engine->pythonState->statusFunction : "",
+				(engine->pythonState->statusFunction != NULL) ? ": " : "",
+				engine->pythonState->statusMessage
+			);
+		}
+		return PYP_ENGINE_ERROR_PYTHON;
+	}
+	engine->pythonState->allowTopLevelAwait = engine->allowTopLevelAwait;
+	engine->pythonState->changeWorkingDirectory = engine->changeWorkingDirectory;
+	engine->pythonState->fragments = engine->fragments;
+
+	// Okay
+	return PYP_ENGINE_OKAY;
+}
+
+void
+pypEngineDelete(PypEngine* engine) {
+	assert(engine != NULL);
+
+	if (engine->preludeModules != NULL) memFree(engine->preludeModules);
+
+	#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+	if (engine->parent != NULL) {
+		// Only the interpreter is owned
+		if (engine->pythonState != NULL) pypModulePythonSubinterpreterFinalize(engine->pythonState);
+		memFree(engine);
+		return;
+	}
+	#endif
+
+	if (engine->pythonState != NULL) pypModulePythonFinalize(engine->pythonState);
+	if (engine->applicationPath != NULL) memFree(engine->applicationPath);
+	if (engine->includePaths != NULL) pypIncludePathsDelete(engine->includePaths);
+	if (engine->readSettings != NULL) pypReaderSettingsDelete(engine->readSettings);
+	if (engine->optimizedTags != NULL) pypTagGroupDeleteTree(engine->optimizedTags);
+	if (engine->piMain != NULL) pypProcessingInfoDelete(engine->piMain);
+	if (engine->piCodeBlock != NULL) pypProcessingInfoDelete(engine->piCodeBlock);
+	if (engine->piCodeExpression != NULL) pypProcessingInfoDelete(engine->piCodeExpression);
+	memFree(engine);
+}
+
+
+
+#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+PypEngine*
+pypEngineWorkerCreate(const PypEngine* engine) {
+	// Vars
+	PypEngine* worker;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(engine->parent == NULL);
+
+	// Create
+	worker = memAlloc(PypEngine);
+	if (worker == NULL) return NULL; // error
+
+	// Tag tables and settings are read-only, so they are shared
+	*worker = *engine;
+	worker->parent = engine;
+	worker->preludeModules = NULL;
+
+	// Own interpreter, which is current for the calling thread after this
+	worker->pythonState = pypModulePythonSubinterpreterSetup();
+	if (worker->pythonState == NULL || worker->pythonState->status != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error
+		pypEngineDelete(worker);
+		return NULL;
+	}
+	worker->pythonState->allowTopLevelAwait = engine->allowTopLevelAwait;
+	worker->pythonState->fragments = engine->fragments; // shared by every interpreter, since it only holds bytes
+	if (pypModuleGcSetup(worker->pythonState, &engine->python.gc) != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error
+		pypEngineDelete(worker);
+		return NULL;
+	}
+	if (engine->python.memoizeExpressions && pypModuleMemoizeSetup(worker->pythonState) != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error
+		pypEngineDelete(worker);
+		return NULL;
+	}
+
+	// Python objects can't be shared between interpreters, so the prelude is imported again
+	if (engine->preludeModules != NULL && pypEngineImportPrelude(worker, engine->preludeModules) != PYP_ENGINE_OKAY) {
+		// Error
+		pypEngineDelete(worker);
+		return NULL;
+	}
+
+	// Done
+	return worker;
+}
+#endif
+
+
+
+// Prelude modules
+PypEngineStatus
+pypEngineImportPrelude(PypEngine* engine, const char* moduleNames) {
+	// Vars
+	PyObject* mainModule;
+	PyObject* mainDict;
+	const char* nameStart;
+	const char* nameEnd;
+	PypStatsValue timerStart;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(moduleNames != NULL);
+
+	if (engine->pythonState == NULL) {
+		PypEngineStatus status;
+
+		if ((status = pypEnginePythonStart(engine)) != PYP_ENGINE_OKAY) return status; // error
+	}
+
+	// Modules are imported into __main__, which each render's globals are copied from
+	if ((mainModule = PyImport_AddModule("__main__")) == NULL) {
+		// Error
+		PyErr_Print();
+		return PYP_ENGINE_ERROR_PYTHON;
+	}
+	mainDict = PyModule_GetDict(mainModule);
+
+	// Remember for worker interpreters
+	if (engine->preludeModules == NULL) {
+		size_t length = strlen(moduleNames);
+
+		if ((engine->preludeModules = memAllocArray(char, length + 1)) == NULL) return PYP_ENGINE_ERROR_MEMORY; // error
+		memcpy(engine->preludeModules, moduleNames, sizeof(char) * (length + 1));
+	}
+
+	// Comma separated list
+	timerStart = pypStatsClock();
+	for (nameStart = moduleNames; ; nameStart = nameEnd + 1) {
+		// Find end
+		for (nameEnd = nameStart; *nameEnd != ',' && *nameEnd != '\x00'; ++nameEnd);
+
+		// Import
+		if (nameEnd > nameStart && !pypEngineImportPreludeModule(mainDict, nameStart, nameEnd - nameStart)) {
+			// Error
+			PyErr_Print();
+			return PYP_ENGINE_ERROR_PYTHON;
+		}
+
+		// Next
+		if (*nameEnd == '\x00') break;
+	}
+	pypStatsTimerAdd(PYP_STATS_TIMER_PRELUDE, pypStatsClock() - timerStart);
+
+	// Prelude objects live as long as the engine, so the collector can stop scanning them
+	pypModuleGcFreeze(engine->pythonState);
+
+	// Okay
+	return PYP_ENGINE_OKAY;
+}
+
+PypBool
+pypEngineImportPreludeModule(PyObject* mainDict, const char* moduleName, size_t moduleNameLength) {
+	// Vars
+	PyObject* module = NULL;
+	PyObject* topModule = NULL;
+	char* name;
+	size_t topNameLength;
+	PypBool okay = PYP_FALSE;
+
+	// Assertions
+	assert(mainDict != NULL);
+	assert(moduleName != NULL);
+	assert(moduleNameLength > 0);
+
+	// Copy name
+	name = memAllocArray(char, moduleNameLength + 1);
+	if (name == NULL) {
+		// Error
+		PyErr_NoMemory();
+		return PYP_FALSE;
+	}
+	memcpy(name, moduleName, sizeof(char) * moduleNameLength);
+	name[moduleNameLength] = '\x00';
+
+	// Import the full name, then bind the top level package like "import a.b" does
+	for (topNameLength = 0; topNameLength < moduleNameLength && name[topNameLength] != '.'; ++topNameLength);
+	if ((module = PyImport_ImportModule(name)) != NULL) {
+		name[topNameLength] = '\x00';
+		if (
+			(topModule = PyImport_ImportModule(name)) != NULL &&
+			PyDict_SetItemString(mainDict, name, topModule) == 0
+		) {
+			okay = PYP_TRUE;
+		}
+	}
+
+	// Clean
+	if (topModule != NULL) Py_DECREF(topModule);
+	if (module != NULL) Py_DECREF(module);
+	memFree(name);
+	return okay;
+}
+
+
+
+// Globals overrides
+PypEngineStatus
+pypEngineGlobalsParse(PypEngine* engine, const char* source, PyObject** globals) {
+	// Vars
+	PyObject* astModule;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(source != NULL);
+	assert(globals != NULL);
+
+	// A dict literal, such as {"name": "value"}
+	*globals = NULL;
+	if (pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) return PYP_ENGINE_ERROR_PYTHON; // error
+	if ((astModule = PyImport_ImportModule("ast")) != NULL) {
+		*globals = PyObject_CallMethod(astModule, "literal_eval", "s", source);
+		Py_DECREF(astModule);
+	}
+	if (*globals == NULL || !PyDict_Check(*globals)) {
+		// Error
+		Py_XDECREF(*globals);
+		*globals = NULL;
+		PyErr_Clear();
+		return PYP_ENGINE_ERROR_PYTHON;
+	}
+
+	// Done
+	return PYP_ENGINE_OKAY;
+}
+
+
+
+// Garbage collection
+void
+pypEngineGcCollect(PypEngine* engine) {
+	assert(engine != NULL);
+
+	// Nothing to collect before python starts
+	if (engine->pythonState != NULL && engine->pythonState->status == PYP_MODULE_SETUP_STATUS_OKAY) pypModuleGcCollect(engine->pythonState);
+}
+
+
+
+// Rendering
+PypReadStatus
+pypEngineRender(PypEngine* engine, FILE* inputStream, FILE* outputStream, FILE* errorStream, const cmd_char* inputFilename) {
+	return pypEngineRenderWithGlobals(engine, inputStream, outputStream, errorStream, inputFilename, NULL, NULL);
+}
+
+PypReadStatus
+pypEngineRenderWithGlobals(PypEngine* engine, FILE* inputStream, FILE* outputStream, FILE* errorStream, const cmd_char* inputFilename, PyObject* globals, PypDependencies* dependencies) {
+	// Vars
+	PypModuleExecutionInfo exeInfo;
+	PypReadStatus rs;
+	PypStatsValue timerStart;
+	PypBool first;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(inputStream != NULL);
+	assert(outputStream != NULL);
+	assert(inputFilename != NULL);
+
+	// The first render also pays for setup which is done lazily
+	first = (threadAtomicAdd(&pypEngineRenderCount, 1) == 1);
+	timerStart = first ? pypStatsClock() : 0;
+
+	// Nothing to execute, so the input is copied as is
+	if (pypEngineInputTagFree(inputStream)) {
+		if (dependencies != NULL && inputStream != stdin && !pypDependenciesAdd(dependencies, inputFilename)) return PYP_READ_ERROR_MEMORY; // error
+
+		rs = fileStreamCopy(inputStream, outputStream) ? PYP_READ_OKAY : PYP_READ_ERROR_WRITE;
+		pypStatsAdd(PYP_STATS_RENDERS, 1);
+		pypStatsAdd(PYP_STATS_TAG_FREE_COPIES, 1);
+		if (rs != PYP_READ_OKAY) pypStatsAdd(PYP_STATS_RENDER_ERRORS, 1);
+		if (first) pypStatsTimerAdd(PYP_STATS_TIMER_FIRST_RENDER, pypStatsClock() - timerStart);
+		return rs;
+	}
+
+	// Start python
+	if (pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) return PYP_READ_ERROR; // error
+	if (first) timerStart = pypStatsClock(); // python's startup has its own timer
+
+	// Execution setup
+	if (pypModuleExecutionInfoCreate(
+		&exeInfo,
+		engine->readSettings,
+		engine->piMain,
+		engine->piCodeBlock,
+		engine->piCodeExpression,
+		engine->optimizedTags,
+		inputStream,
+		outputStream,
+		errorStream,
+		NULL,
+		inputFilename,
+		engine->encoding,
+		engine->encodingErrorMode,
+		engine->pythonState
+	) == NULL) {
+		// Error
+		return PYP_READ_ERROR_MEMORY;
+	}
+
+	// Render; stdin isn't a file anything can depend on
+	rs = pypEngineRenderExecute(engine, &exeInfo, globals, (inputStream != stdin ? dependencies : NULL), dependencies);
+	if (first) pypStatsTimerAdd(PYP_STATS_TIMER_FIRST_RENDER, pypStatsClock() - timerStart);
+
+	// Done
+	return rs;
+}
+
+PypReadStatus
+pypEngineRenderSource(PypEngine* engine, PypReadFunction inputRead, void* inputSource, PypDataBuffer* outputDataBuffer, FILE* errorStream, const cmd_char* inputFilename, PyObject* globals, PypDependencies* dependencies, PypModuleErrorLog* errorLog) {
+	// Vars
+	PypModuleExecutionInfo exeInfo;
+	PypReadStatus rs;
+	PypStatsValue timerStart;
+	PypBool first;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(inputRead != NULL);
+	assert(outputDataBuffer != NULL);
+	assert(inputFilename != NULL);
+
+	// The first render also pays for setup which is done lazily
+	first = (threadAtomicAdd(&pypEngineRenderCount, 1) == 1);
+
+	// Start python; a source can only be read once, so tag-free input isn't special
+	if (pypEnginePythonStart(engine) != PYP_ENGINE_OKAY) return PYP_READ_ERROR; // error
+	timerStart = first ? pypStatsClock() : 0; // python's startup has its own timer
+
+	// Execution setup
+	if (pypModuleExecutionInfoCreate(
+		&exeInfo,
+		engine->readSettings,
+		engine->piMain,
+		engine->piCodeBlock,
+		engine->piCodeExpression,
+		engine->optimizedTags,
+		NULL,
+		NULL,
+		errorStream,
+		outputDataBuffer,
+		inputFilename,
+		engine->encoding,
+		engine->encodingErrorMode,
+		engine->pythonState
+	) == NULL) {
+		// Error
+		return PYP_READ_ERROR_MEMORY;
+	}
+	exeInfo.inputRead = inputRead;
+	exeInfo.inputSource = inputSource;
+	exeInfo.errorLog = errorLog;
+
+	// Render
+	rs = pypEngineRenderExecute(engine, &exeInfo, globals, dependencies, dependencies);
+	if (first) pypStatsTimerAdd(PYP_STATS_TIMER_FIRST_RENDER, pypStatsClock() - timerStart);
+
+	// Done
+	return rs;
+}
+
+PypReadStatus
+pypEngineRenderExecute(PypEngine* engine, PypModuleExecutionInfo* exeInfo, PyObject* globals, PypDependencies* inputDependencies, PypDependencies* dependencies) {
+	// Vars
+	PypSlots slots;
+	PypReadStatus rs;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(exeInfo != NULL);
+
+	// The input is recorded first, followed by everything it includes
+	exeInfo->dependencies = dependencies;
+
+	// Batch runs only commit each job's main output, so files from pyp.output are synced on their own
+	exeInfo->outputSync = (engine->outputSync == FILE_OUTPUT_SYNC_GROUP) ? FILE_OUTPUT_SYNC_FILE : engine->outputSync;
+	if (inputDependencies != NULL && !pypDependenciesAdd(inputDependencies, exeInfo->inputFilename)) {
+		// Error
+		pypModuleExecutionInfoClean(exeInfo);
+		return PYP_READ_ERROR_MEMORY;
+	}
+
+	// Search directory lookups are only remembered for this render, so files created between renders are found
+	if (engine->includePaths != NULL && (exeInfo->includeLookups = pypIncludeLookupsCreate(engine->includePaths)) == NULL) {
+		// Error
+		pypModuleExecutionInfoClean(exeInfo);
+		return PYP_READ_ERROR_MEMORY;
+	}
+
+	// Setup pyp
+	if (pypModulePythonInit(exeInfo) != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error
+		if (exeInfo->includeLookups != NULL) pypIncludeLookupsDelete(exeInfo->includeLookups);
+		pypModuleExecutionInfoClean(exeInfo);
+		return PYP_READ_ERROR;
+	}
+	if (globals != NULL && PyDict_Update(engine->pythonState->globalsDict, globals) != 0) {
+		// Error
+		PyErr_Clear();
+		pypModulePythonDeinit(exeInfo);
+		if (exeInfo->includeLookups != NULL) pypIncludeLookupsDelete(exeInfo->includeLookups);
+		pypModuleExecutionInfoClean(exeInfo);
+		return PYP_READ_ERROR;
+	}
+
+	// Execute; slots are only filled within the render that reserved them
+	pypSlotsInit(&slots, exeInfo->outputStream);
+	exeInfo->slots = &slots;
+	rs = pypIncludeFromExecutionInfo(exeInfo);
+	if (pypSlotsFinish(&slots, exeInfo->outputDataBuffer) != PYP_SLOTS_OKAY && rs == PYP_READ_OKAY) rs = PYP_READ_ERROR_WRITE;
+	exeInfo->slots = NULL;
+	pypStatsAdd(PYP_STATS_RENDERS, 1);
+	if (rs != PYP_READ_OKAY) pypStatsAdd(PYP_STATS_RENDER_ERRORS, 1);
+
+	// Deinit python
+	pypModulePythonDeinit(exeInfo);
+	if (exeInfo->includeLookups != NULL) pypIncludeLookupsDelete(exeInfo->includeLookups);
+	pypModuleExecutionInfoClean(exeInfo);
+
+	// Done
+	return rs;
+}
+
+PypBool
+pypEngineInputTagFree(FILE* inputStream) {
+	// Vars
+	char buffer[16384];
+	long int start;
+	size_t length;
+	PypBool previousOpen = PYP_FALSE;
+	PypBool tagFree = PYP_TRUE;
+	const char* pos;
+	const char* end;
+
+	// Assertions
+	assert(inputStream != NULL);
+
+	// The input has to be read twice, so pipes can't be checked
+	if ((start = ftell(inputStream)) < 0) return PYP_FALSE;
+
+	// Every tag opens with "<?"; stop at the first one
+	while (tagFree && (length = fread(buffer, sizeof(char), sizeof(buffer), inputStream)) > 0) {
+		if (previousOpen && buffer[0] == '?') {
+			tagFree = PYP_FALSE;
+			break;
+		}
+		for (pos = buffer, end = buffer + length; (pos = (const char*) memchr(pos, '<', end - pos)) != NULL; ++pos) {
+			if (pos + 1 < end && pos[1] == '?') {
+				tagFree = PYP_FALSE;
+				break;
+			}
+		}
+		previousOpen = (buffer[length - 1] == '<');
+	}
+
+	// Rewind for whichever path reads it next
+	if (ferror(inputStream) || fseek(inputStream, start, SEEK_SET) != 0) return PYP_FALSE;
+	return tagFree;
+}
+
+PypReadStatus
+pypEngineRenderFile(PypEngine* engine, const cmd_char* inputFilename, const cmd_char* outputFilename, FILE* errorStream, PypDependencies* dependencies) {
+	// Vars
+	FILE* inputStream = NULL;
+	FileOutput output;
+	PypDependencies* renderDependencies = dependencies;
+	PypCacheFetchStatus cs = PYP_CACHE_FETCH_MISS;
+	time_t renderStart = 0;
+	unicode_char* stagedFilename;
+	PypReadStatus rs = PYP_READ_OKAY;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(inputFilename != NULL);
+	assert(outputFilename != NULL);
+
+	// Every file read is needed to store the output in the cache
+	if (engine->cache != NULL && renderDependencies == NULL && (renderDependencies = pypDependenciesCreate()) == NULL) return PYP_READ_ERROR_MEMORY; // error
+
+	// Open
+	if (fileOpenUnicode(inputFilename, "rb", &inputStream) != FILE_OPEN_OKAY) {
+		// Error
+		rs = PYP_READ_ERROR_OPEN;
+		goto cleanup;
+	}
+	if (pypEngineOutputOpen(engine, outputFilename, &output) != FILE_OPEN_OKAY) {
+		// Error
+		rs = PYP_READ_ERROR_OPEN;
+		goto cleanup;
+	}
+
+	// Cached
+	if (engine->cache != NULL) {
+		cs = pypCacheFetch(engine->cache, inputFilename, output.stream, renderDependencies);
+		pypStatsAdd((cs == PYP_CACHE_FETCH_HIT) ? PYP_STATS_CACHE_HITS : PYP_STATS_CACHE_MISSES, 1);
+		if (cs == PYP_CACHE_FETCH_ERROR) rs = PYP_READ_ERROR_WRITE;
+		renderStart = time(NULL);
+	}
+
+	// Render
+	if (cs == PYP_CACHE_FETCH_MISS) {
+		rs = pypEngineRenderWithGlobals(engine, inputStream, output.stream, errorStream, inputFilename, NULL, renderDependencies);
+	}
+
+	// Close
+	rs = pypEngineOutputClose(&output, rs);
+
+	// Store; a staged output isn't in place until its group is committed
+	if (engine->cache != NULL && cs == PYP_CACHE_FETCH_MISS && rs == PYP_READ_OKAY) {
+		if (!output.staged) {
+			pypCacheStore(engine->cache, inputFilename, renderDependencies, outputFilename, renderStart);
+		}
+		else if ((stagedFilename = fileOutputStagedFilename(outputFilename)) != NULL) {
+			pypCacheStore(engine->cache, inputFilename, renderDependencies, stagedFilename, renderStart);
+			memFree(stagedFilename);
+		}
+	}
+
+	// Done
+	cleanup:
+	if (inputStream != NULL) fclose(inputStream);
+	if (renderDependencies != dependencies) pypDependenciesDelete(renderDependencies);
+	return rs;
+}
+
+
+
+// Output files
+FileOpenStatus
+pypEngineOutputOpen(PypEngine* engine, const cmd_char* outputFilename, FileOutput* output) {
+	assert(engine != NULL);
+
+	return fileOutputOpen(outputFilename, engine->outputOnlyIfChanged, engine->outputSync, output);
+}
+
+PypReadStatus
+pypEngineOutputClose(FileOutput* output, PypReadStatus status) {
+	// Vars
+	FileOutputStatus fs;
+
+	// Close, replacing the old output if needed
+	fs = fileOutputClose(output);
+	if (fs == FILE_OUTPUT_UNCHANGED) pypStatsAdd(PYP_STATS_OUTPUTS_UNCHANGED, 1);
+
+	// Done
+	return (fs == FILE_OUTPUT_ERROR && status == PYP_READ_OKAY) ? PYP_READ_ERROR_WRITE : status;
+}
+
+
+
+// Status info
+const char*
+pypReadStatusDescription(PypReadStatus status) {
+	switch (status) {
+		case PYP_READ_OKAY:
+			return "Okay";
+		case PYP_READ_ERROR_MEMORY:
+			return "Memory error";
+		case PYP_READ_ERROR_OPEN:
+			return "File open error";
+		case PYP_READ_ERROR_READ:
+			return "Read error";
+		case PYP_READ_ERROR_WRITE:
+			return "Write error";
+		case PYP_READ_ERROR_DIRECTORY:
+			return "Directory error";
+		default:
+			return "Error";
+	}
+}
+
+
+
+// Tag setup
+PypTagGroup*
+pypEngineTagsInit(const PypProcessingInfo* piCodeBlock, const PypProcessingInfo* piCodeExpression, PypBool allowContinuation) {
+	// Vars
+	PypTagGroup* tgLevel1 = NULL;
+	PypTagGroup* tgLevel2 = NULL;
+	PypTagGroup* tgCloser = NULL;
+	PypTagGroup* tgEscapes = NULL;
+	PypTagGroup* tgOptimized = NULL;
+	PypTag* tag = NULL;
+
+	// Assertions
+	assert(piCodeBlock != NULL || piCodeExpression != NULL);
+
+
+	// Create basic tag structure
+	if ((tgLevel1 = pypTagGroupCreate()) == NULL) goto cleanup;
+	if ((tgLevel2 = pypTagGroupCreate()) == NULL) goto cleanup;
+
+
+
+	//{ Main tag <? ?>
+	if (piCodeBlock != NULL) {
+		if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
+
+		if ((tag = pypTagCreate("<?", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgLevel2)) == NULL) goto cleanup;
+		pypTagGroupAddTag(tgLevel1, tag);
+		pypSetProcessingInfo(tag, piCodeBlock);
+
+		if ((tag = pypTagCreate("?>", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+		pypTagGroupAddTag(tgCloser, tag);
+
+		if (allowContinuation) {
+			if ((tag = pypTagCreate("<?...", 0, PYP_TAG_FLAG_CONTINUATION, tgCloser, tgLevel2)) == NULL) goto cleanup;
+			pypTagGroupAddTag(tgLevel1, tag);
+			pypSetProcessingInfo(tag, piCodeBlock);
+
+			if ((tag = pypTagCreate("...?>", 0, PYP_TAG_FLAG_CONTINUATION, NULL, NULL)) == NULL) goto cleanup;
+			pypTagGroupAddTag(tgCloser, tag);
+		}
+	}
+	//}
+
+	//{ Main eval tag <?= ?>
+	if (piCodeExpression != NULL) {
+		if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
+
+		if ((tag = pypTagCreate("<?=", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgLevel2)) == NULL) goto cleanup;
+		pypTagGroupAddTag(tgLevel1, tag);
+		pypSetProcessingInfo(tag, piCodeExpression);
+
+		if ((tag = pypTagCreate("?>", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+		pypTagGroupAddTag(tgCloser, tag);
+
+		if (allowContinuation) {
+			if ((tag = pypTagCreate("<?=...", 0, PYP_TAG_FLAG_CONTINUATION, tgCloser, tgLevel2)) == NULL) goto cleanup;
+			pypTagGroupAddTag(tgLevel1, tag);
+			pypSetProcessingInfo(tag, piCodeExpression);
+
+			if ((tag = pypTagCreate("...?>", 0, PYP_TAG_FLAG_CONTINUATION, NULL, NULL)) == NULL) goto cleanup;
+			pypTagGroupAddTag(tgCloser, tag);
+		}
+	}
+	//}
+
+	//{ Single ' quoted string
+	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
+	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
+
+	if ((tag = pypTagCreate("\'", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgLevel2, tag);
+
+	if ((tag = pypTagCreate("\'", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\r", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\\\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgEscapes, tag);
+
+	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgEscapes, tag);
+	//}
+
+	//{ Single " quoted string
+	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
+	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
+
+	if ((tag = pypTagCreate("\"", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgLevel2, tag);
+
+	if ((tag = pypTagCreate("\"", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\r", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\\\r\n", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgEscapes, tag);
+
+	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgEscapes, tag);
+	//}
+
+	//{ Triple ' quoted string
+	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
+	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
+
+	if ((tag = pypTagCreate("\'\'\'", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgLevel2, tag);
+
+	if ((tag = pypTagCreate("\'\'\'", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgEscapes, tag);
+	//}
+
+	//{ Triple " quoted string
+	if ((tgCloser = pypTagGroupCreate()) == NULL) goto cleanup;
+	if ((tgEscapes = pypTagGroupCreate()) == NULL) goto cleanup;
+
+	if ((tag = pypTagCreate("\"\"\"", 0, PYP_TAG_FLAGS_NONE, tgCloser, tgEscapes)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgLevel2, tag);
+
+	if ((tag = pypTagCreate("\"\"\"", 0, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgCloser, tag);
+
+	if ((tag = pypTagCreate("\\", 1, PYP_TAG_FLAGS_NONE, NULL, NULL)) == NULL) goto cleanup;
+	pypTagGroupAddTag(tgEscapes, tag);
+	//}
+
+
+
+
+	// Optimize
+	tgOptimized = pypTagGroupOptimize(tgLevel1);
+	if (tgOptimized == NULL) goto cleanup;
+
+
+	// Delete setup group tree
+	pypTagGroupDeleteTree(tgLevel1);
+
+
+	// Done
+	return tgOptimized;
+
+
+	// Depending on where the error occured, this might not free all the memory created
+	// Though this is not really a problem, since the application will exit on error
+	cleanup:
+	if (tgLevel1 != NULL) pypTagGroupDeleteTree(tgLevel1);
+	return NULL;
+}
+
+
+
@@ -0,0 +1,100 @@
+#ifndef __PYP_ENGINE_H
+#define __PYP_ENGINE_H
+
+
+
+#include <stdio.h>
+#include "PypTypes.h"
+#include "PypTags.h"
+#include "PypReader.h"
+#include "PypProcessing.h"
+#include "PypModule.h"
+#include "PypDependencies.h"
+#include "PypCache.h"
+#include "PypFragments.h"
+#include "PypIncludePaths.h"
+#include "File.h"
+#include "CommandLineChar.h"
+
+
+
+typedef enum PypEngineStatus_ {
+	PYP_ENGINE_OKAY = 0x0,
+	PYP_ENGINE_ERROR_MEMORY = 0x1,
+	PYP_ENGINE_ERROR_PYTHON = 0x2,
+} PypEngineStatus;
+
+typedef struct PypEngineSettings_ {
+	PypReaderFlags readerFlags;
+	PypSize readBlockCount;
+	PypSize readBlockSize;
+	PypBool allowContinuation;
+	PypBool allowTopLevelAwait; // code may use await outside of a function; needs python 3.8
+	PypDataBufferModifier inlineErrorEscapeFunction;
+	PypBool outputOnlyIfChanged; // output files are written to a temporary file, and only replace the output if different
+	FileOutputSync outputSync; // group sync leaves outputs staged; only batch runs commit them
+	PypCache* cache; // if not NULL, file renders are looked up and stored here; not owned by the engine
+	PypFragments* fragments; // if not NULL, regions of pyp.cache are looked up and stored here; not owned by the engine
+	const cmd_char* includePath; // if not NULL, directories searched for includes which aren't next to the including file, separated like PYTHONPATH
+	PypBool changeWorkingDirectory; // each template renders with its own directory as the working directory, which prevents rendering concurrently
+	const char* encoding;
+	const char* encodingErrorMode;
+	PypPythonSettings python;
+} PypEngineSettings;
+
+typedef struct PypEngine_ {
+	PypReaderSettings* readSettings;
+
+	PypProcessingInfo* piMain;
+	PypProcessingInfo* piCodeBlock;
+	PypProcessingInfo* piCodeExpression;
+
+	PypTagGroup* optimizedTags;
+
+	PypPythonState* pythonState; // NULL until python is started, which tag-free renders never need
+	cmd_char* applicationPath;
+	PypPythonSettings python;
+	PypBool allowTopLevelAwait;
+
+	const char* encoding;
+	const char* encodingErrorMode;
+	char* preludeModules;
+	PypBool outputOnlyIfChanged;
+	FileOutputSync outputSync;
+	PypCache* cache;
+	PypFragments* fragments;
+	PypIncludePaths* includePaths; // NULL if there are no search directories
+	PypBool changeWorkingDirectory;
+
+	const struct PypEngine_* parent; // set for worker engines, which share the parent's tag tables
+} PypEngine;
+
+
+
+void pypEngineSettingsInit(PypEngineSettings* settings);
+
+PypEngine* pypEngineCreate(const PypEngineSettings* settings, const cmd_char* applicationPath);
+void pypEngineDelete(PypEngine* engine);
+PypEngineStatus pypEnginePythonStart(PypEngine* engine);
+#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+PypEngine* pypEngineWorkerCreate(const PypEngine* engine);
+#endif
+
+PypEngineStatus pypEngineImportPrelude(PypEngine* engine, const char* moduleNames);
+PypEngineStatus pypEngineGlobalsParse(PypEngine* engine, const char* source, PyObject** globals);
+void pypEngineGcCollect(PypEngine* engine);
+
+PypReadStatus pypEngineRender(PypEngine* engine, FILE* inputStream, FILE* outputStream, FILE* errorStream, const cmd_char* inputFilename);
+PypReadStatus pypEngineRenderWithGlobals(PypEngine* engine, FILE* inputStream, FILE* outputStream, FILE* errorStream, const cmd_char* inputFilename, PyObject* globals, PypDependencies* dependencies);
+PypReadStatus pypEngineRenderSource(PypEngine* engine, PypReadFunction inputRead, void* inputSource, PypDataBuffer* outputDataBuffer, FILE* errorStream, const cmd_char* inputFilename, PyObject* globals, PypDependencies* dependencies, PypModuleErrorLog* errorLog);
+FileOpenStatus pypEngineOutputOpen(PypEngine* engine, const cmd_char* outputFilename, FileOutput* output);
+PypReadStatus pypEngineOutputClose(FileOutput* output, PypReadStatus status);
+
+PypReadStatus pypEngineRenderFile(PypEngine* engine, const cmd_char* inputFilename, const cmd_char* outputFilename, FILE* errorStream, PypDependencies* dependencies);
+
+const char* pypReadStatusDescription(PypReadStatus status);
+
+
+
+#endif
+
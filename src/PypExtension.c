@@ -0,0 +1,294 @@
+#include <Python.h>
+#include "PypExtension.h"
+#ifdef PYP_EXTENSION_MODULE
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "PypEngine.h"
+#include "Memory.h"
+#include "Thread.h"
+#include "File.h"
+
+
+
+// Headers
+static PypEngine* pypExtensionEngineGet(void);
+static PyObject* pypExtensionRender(PyObject* module, FILE* inputStream, const unicode_char* inputFilename, PyObject* globals, PyObject* destination);
+static PyObject* pypExtensionStreamRead(FILE* stream);
+
+// Tag tables and settings, shared by every render in the process
+static PypEngine* pypExtensionEngine = NULL;
+static ThreadMutex pypExtensionEngineMutex = THREAD_MUTEX_INITIALIZER;
+
+
+
+// Module methods
+PyObject*
+pypExtension_render_file(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "src", "dst", "globals", NULL };
+	PyObject* sourceObject;
+	PyObject* destination = Py_None;
+	PyObject* globals = Py_None;
+	PyObject* result;
+	unicode_char* inputFilename;
+	FILE* inputStream;
+
+	// Arguments
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "O|OO:render_file", keywordNames, &sourceObject, &destination, &globals)) return NULL; // error
+	if (!pypPathFromObject(sourceObject, &inputFilename)) {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "src must be a path");
+		return NULL;
+	}
+
+	// Open
+	if (fileOpenUnicode(inputFilename, "rb", &inputStream) != FILE_OPEN_OKAY) {
+		// Error
+		memFree(inputFilename);
+		#if PY_MAJOR_VERSION >= 3
+		PyErr_SetString(PyExc_FileNotFoundError, "Error opening input file");
+		#else
+		PyErr_SetString(PyExc_IOError, "Error opening input file");
+		#endif
+		return NULL;
+	}
+
+	// Render
+	result = pypExtensionRender(self, inputStream, inputFilename, globals, destination);
+
+	// Done
+	fclose(inputStream);
+	memFree(inputFilename);
+	return result;
+}
+
+PyObject*
+pypExtension_render_string(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "text", "globals", "filename", NULL };
+	PyObject* text;
+	PyObject* textBytes = NULL;
+	PyObject* globals = Py_None;
+	PyObject* filenameObject = Py_None;
+	PyObject* result = NULL;
+	unicode_char* inputFilename = NULL;
+	FILE* inputStream = NULL;
+	char* buffer;
+	Py_ssize_t bufferLength;
+
+	// Arguments
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "O|OO:render_string", keywordNames, &text, &globals, &filenameObject)) return NULL; // error
+
+	// Includes are relative to the file name, which defaults to one in the working directory
+	if (filenameObject != Py_None) {
+		if (!pypPathFromObject(filenameObject, &inputFilename)) {
+			// Error
+			PyErr_SetString(PyExc_TypeError, "filename must be a path");
+			return NULL;
+		}
+	}
+	else {
+		if ((inputFilename = memAllocArray(unicode_char, 9)) == NULL) return PyErr_NoMemory(); // error
+		memcpy(inputFilename, L"<string>", sizeof(unicode_char) * 9);
+	}
+
+	// Encoded as the output is, and read back from a temporary file
+	if (PyUnicode_Check(text)) {
+		if ((textBytes = PyUnicode_AsUTF8String(text)) == NULL) goto cleanup; // error
+	}
+	#if PY_MAJOR_VERSION >= 3
+	else if (PyBytes_Check(text)) {
+	#else
+	else if (PyString_Check(text)) {
+	#endif
+		textBytes = text;
+		Py_INCREF(textBytes);
+	}
+	else {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "text must be a string");
+		goto cleanup;
+	}
+	#if PY_MAJOR_VERSION >= 3
+	buffer = PyBytes_AS_STRING(textBytes);
+	bufferLength = PyBytes_GET_SIZE(textBytes);
+	#else
+	buffer = PyString_AS_STRING(textBytes);
+	bufferLength = PyString_GET_SIZE(textBytes);
+	#endif
+
+	if (
+		(inputStream = tmpfile()) == NULL ||
+		fwrite(buffer, sizeof(char), (size_t) bufferLength, inputStream) != (size_t) bufferLength ||
+		fseek(inputStream, 0, SEEK_SET) != 0
+	) {
+		// Error
+		PyErr_SetString(PyExc_IOError, "Error writing temporary file");
+		goto cleanup;
+	}
+
+	// Render
+	result = pypExtensionRender(self, inputStream, inputFilename, globals, Py_None);
+
+	// Done
+	cleanup:
+	if (inputStream != NULL) fclose(inputStream);
+	if (textBytes != NULL) Py_DECREF(textBytes);
+	memFree(inputFilename);
+	return result;
+}
+
+
+
+// Rendering
+PypEngine*
+pypExtensionEngineGet(void) {
+	// Vars
+	PypEngineSettings settings;
+	PypEngine* engine;
+
+	// Created by the first render, and kept until the process exits
+	threadMutexLock(&pypExtensionEngineMutex);
+	if (pypExtensionEngine == NULL) {
+		pypEngineSettingsInit(&settings);
+		pypExtensionEngine = pypEngineCreate(&settings, L"pyp");
+	}
+	engine = pypExtensionEngine;
+	threadMutexUnlock(&pypExtensionEngineMutex);
+
+	// Done
+	return engine;
+}
+
+PyObject*
+pypExtensionRender(PyObject* module, FILE* inputStream, const unicode_char* inputFilename, PyObject* globals, PyObject* destination) {
+	// Vars
+	PypEngine* sharedEngine;
+	PypEngine engine;
+	FileOutput output;
+	FILE* outputStream = NULL;
+	unicode_char* outputFilename = NULL;
+	PyObject* value = NULL;
+	PyObject* result = NULL;
+	PypReadStatus rs;
+
+	// Assertions
+	assert(module != NULL);
+	assert(inputStream != NULL);
+	assert(inputFilename != NULL);
+
+	// Arguments
+	if (globals == Py_None) globals = NULL;
+	if (destination == Py_None) destination = NULL;
+	if (globals != NULL && !PyDict_Check(globals)) {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "globals must be a dict");
+		return NULL;
+	}
+
+	// Each call renders with its own state on the calling interpreter, so a template can render another
+	if ((sharedEngine = pypExtensionEngineGet()) == NULL) return PyErr_NoMemory(); // error
+	engine = *sharedEngine;
+	engine.parent = sharedEngine;
+	engine.preludeModules = NULL;
+	if ((engine.pythonState = pypModulePythonAttach()) == NULL) return PyErr_NoMemory(); // error
+	if (engine.pythonState->status != PYP_MODULE_SETUP_STATUS_OKAY) {
+		// Error
+		pypModulePythonDetach(engine.pythonState);
+		return PyErr_NoMemory();
+	}
+	engine.pythonState->changeWorkingDirectory = engine.changeWorkingDirectory;
+
+	if (destination != NULL && !PyObject_HasAttrString(destination, "write")) {
+		// Written to the named file
+		if (!pypPathFromObject(destination, &outputFilename)) {
+			// Error
+			PyErr_SetString(PyExc_TypeError, "dst must be a path, a file object, or None");
+			goto cleanup;
+		}
+		if (pypEngineOutputOpen(&engine, outputFilename, &output) != FILE_OPEN_OKAY) {
+			// Error
+			PyErr_SetString(PyExc_IOError, "Error opening output file");
+			goto cleanup;
+		}
+
+		rs = pypEngineRenderWithGlobals(&engine, inputStream, output.stream, stderr, inputFilename, globals, NULL);
+		rs = pypEngineOutputClose(&output, rs);
+	}
+	else {
+		// Rendered to a temporary file, and read back
+		if ((outputStream = tmpfile()) == NULL) {
+			// Error
+			PyErr_SetString(PyExc_IOError, "Error opening temporary file");
+			goto cleanup;
+		}
+
+		rs = pypEngineRenderWithGlobals(&engine, inputStream, outputStream, stderr, inputFilename, globals, NULL);
+		if (rs == PYP_READ_OKAY && (value = pypExtensionStreamRead(outputStream)) == NULL) goto cleanup; // error
+	}
+
+	// Code errors are shown inline like the command line shows them; anything else stops the render
+	if (rs != PYP_READ_OKAY) {
+		if (PyErr_Occurred() == NULL) PyErr_SetString(pypModuleErrorType(module), pypReadStatusDescription(rs));
+		goto cleanup;
+	}
+
+	// Output
+	if (destination == NULL) {
+		result = value;
+		value = NULL;
+	}
+	else if (value == NULL || (result = PyObject_CallMethod(destination, (char*) "write", (char*) "O", value)) != NULL) {
+		Py_XDECREF(result);
+		result = Py_None;
+		Py_INCREF(result);
+	}
+
+	// Done
+	cleanup:
+	if (value != NULL) Py_DECREF(value);
+	if (outputStream != NULL) fclose(outputStream);
+	if (outputFilename != NULL) memFree(outputFilename);
+	pypModulePythonDetach(engine.pythonState);
+	return result;
+}
+
+PyObject*
+pypExtensionStreamRead(FILE* stream) {
+	// Vars
+	PyObject* value;
+	long length;
+
+	// Assertions
+	assert(stream != NULL);
+
+	// Size
+	if (fseek(stream, 0, SEEK_END) != 0 || (length = ftell(stream)) < 0 || fseek(stream, 0, SEEK_SET) != 0) {
+		// Error
+		PyErr_SetString(PyExc_IOError, "Error reading temporary file");
+		return NULL;
+	}
+
+	// Read
+	#if PY_MAJOR_VERSION >= 3
+	if ((value = PyBytes_FromStringAndSize(NULL, length)) == NULL) return NULL; // error
+	if (fread(PyBytes_AS_STRING(value), sizeof(char), (size_t) length, stream) != (size_t) length) {
+	#else
+	if ((value = PyString_FromStringAndSize(NULL, length)) == NULL) return NULL; // error
+	if (fread(PyString_AS_STRING(value), sizeof(char), (size_t) length, stream) != (size_t) length) {
+	#endif
+		// Error
+		Py_DECREF(value);
+		PyErr_SetString(PyExc_IOError, "Error reading temporary file");
+		return NULL;
+	}
+
+	// Done
+	return value;
+}
+
+
+
+#endif
+
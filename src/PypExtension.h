@@ -0,0 +1,19 @@
+#ifndef __PYP_EXTENSION_H
+#define __PYP_EXTENSION_H
+
+
+
+#include <Python.h>
+
+
+
+// Only in the importable module build, where templates render on the interpreter which imported it
+#ifdef PYP_EXTENSION_MODULE
+PyObject* pypExtension_render_file(PyObject* self, PyObject* args, PyObject* keywords);
+PyObject* pypExtension_render_string(PyObject* self, PyObject* args, PyObject* keywords);
+#endif
+
+
+
+#endif
+
@@ -0,0 +1,278 @@
+#include <assert.h>
+#include <string.h>
+#include "PypFragments.h"
+#include "PypStats.h"
+#include "Memory.h"
+#include "File.h"
+#include "Path.h"
+
+
+
+// Changing anything about how fragments are keyed should change this
+#define PYP_FRAGMENTS_FORMAT "pyp-fragment-1"
+
+
+
+// Headers
+static PypBool pypFragmentsMemoryAdd(PypFragments* fragments, const char* name, PypChar* data, PypSize dataLength);
+
+MAP_BODY_HELPER_HEADERS_STATIC(char*, PypFragment*, pypFragmentMap, PypFragmentMap);
+MAP_FUNCTION_HEADERS_STATIC(char*, PypFragment*, pypFragmentMap, PypFragmentMap);
+MAP_BODY(char*, PypFragment*, pypFragmentMap, PypFragmentMap)
+
+
+
+// Creation
+PypFragments*
+pypFragmentsCreate(PypSize maxSize, PypCache* disk) {
+	// Vars
+	PypFragments* fragments;
+
+	// Create
+	fragments = memAlloc(PypFragments);
+	if (fragments == NULL) return NULL; // error
+
+	fragments->firstChild = NULL;
+	fragments->lastChild = &fragments->firstChild;
+	fragments->size = 0;
+	fragments->maxSize = maxSize;
+	fragments->disk = disk;
+
+	if ((fragments->map = pypFragmentMapCreate(NULL)) == NULL) {
+		// Error
+		memFree(fragments);
+		return NULL;
+	}
+	threadMutexInit(&fragments->mutex);
+
+	// Done
+	return fragments;
+}
+
+void
+pypFragmentsDelete(PypFragments* fragments) {
+	// Vars
+	PypFragment* fragment;
+	PypFragment* next;
+
+	// Assertions
+	assert(fragments != NULL);
+
+	// Delete
+	for (fragment = fragments->firstChild; fragment != NULL; fragment = next) {
+		next = fragment->nextSibling;
+		memFree(fragment->data);
+		memFree(fragment);
+	}
+	pypFragmentMapDelete(fragments->map);
+	threadMutexDestroy(&fragments->mutex);
+	memFree(fragments);
+}
+
+
+
+// Keys
+PypBool
+pypFragmentsDigest(const char* key, PypSize keyLength, const unicode_char* const* filenames, size_t filenameCount, unsigned char* digest) {
+	// Vars
+	HashState hash;
+	FileStamp stamp;
+	unicode_char* absoluteFilename;
+	size_t absoluteFilenameLength;
+	char* filename;
+	size_t filenameLength;
+	size_t errorCount;
+	uint64_t length;
+	size_t i;
+
+	// Assertions
+	assert(key != NULL || keyLength == 0);
+	assert(filenames != NULL || filenameCount == 0);
+	assert(digest != NULL);
+
+	// The key may contain anything, so its length comes first
+	hashInit(&hash);
+	hashUpdate(&hash, PYP_FRAGMENTS_FORMAT, sizeof(PYP_FRAGMENTS_FORMAT));
+	length = (uint64_t) keyLength;
+	hashUpdate(&hash, &length, sizeof(length));
+	hashUpdate(&hash, key, keyLength);
+
+	// Files are stamped instead of read, since this happens on every use; missing files are included too, since creating one changes the output
+	for (i = 0; i < filenameCount; ++i) {
+		if (pathAbsoluteUnicode(filenames[i], &absoluteFilename, &absoluteFilenameLength) != PATH_OKAY) return PYP_FALSE; // error
+		if (!fileStampUnicode(absoluteFilename, &stamp) || unicodeUTF8Encode(absoluteFilename, &filename, &filenameLength, &errorCount) != UNICODE_OKAY) {
+			// Error
+			memFree(absoluteFilename);
+			return PYP_FALSE;
+		}
+		memFree(absoluteFilename);
+
+		hashUpdate(&hash, filename, filenameLength + 1);
+		hashUpdate(&hash, stamp.exists ? "f" : "m", 1);
+		hashUpdate(&hash, &stamp.modified, sizeof(stamp.modified));
+		hashUpdate(&hash, &stamp.size, sizeof(stamp.size));
+		memFree(filename);
+	}
+	hashFinish(&hash, digest);
+
+	// Done
+	return PYP_TRUE;
+}
+
+
+
+// Access
+PypBool
+pypFragmentsFetch(PypFragments* fragments, const unsigned char* digest, PypDataBuffer* dataBuffer) {
+	// Vars
+	char name[HASH_HEX_LENGTH + 1];
+	PypFragment* fragment;
+	PypChar* data = NULL;
+	PypSize dataLength = 0;
+	PypBool found;
+
+	// Assertions
+	assert(fragments != NULL);
+	assert(digest != NULL);
+	assert(dataBuffer != NULL);
+
+	hashToHex(digest, name);
+
+	// Memory; copied while locked, since another thread may evict it
+	threadMutexLock(&fragments->mutex);
+	found = (pypFragmentMapFind(fragments->map, name, &fragment) == MAP_FOUND);
+	if (found) {
+		dataLength = fragment->dataLength;
+		found = (dataLength == 0 || pypDataBufferExtendWithData(dataBuffer, fragment->data, dataLength) != NULL);
+	}
+	threadMutexUnlock(&fragments->mutex);
+
+	// Disk; kept in memory after, so later uses don't read it again
+	if (!found && fragments->disk != NULL && pypCacheFragmentFetch(fragments->disk, digest, &data, &dataLength)) {
+		found = (dataLength == 0 || pypDataBufferExtendWithData(dataBuffer, data, dataLength) != NULL);
+		if (found) {
+			threadMutexLock(&fragments->mutex);
+			if (!pypFragmentsMemoryAdd(fragments, name, data, dataLength)) memFree(data);
+			threadMutexUnlock(&fragments->mutex);
+		}
+		else {
+			memFree(data);
+		}
+	}
+
+	// Stats
+	if (found) {
+		pypStatsAdd(PYP_STATS_FRAGMENT_HITS, 1);
+		pypStatsAdd(PYP_STATS_FRAGMENT_BYTES_SAVED, (PypStatsValue) dataLength);
+	}
+	else {
+		pypStatsAdd(PYP_STATS_FRAGMENT_MISSES, 1);
+	}
+
+	// Done
+	return found;
+}
+
+PypBool
+pypFragmentsStore(PypFragments* fragments, const unsigned char* digest, const PypDataBuffer* dataBuffer) {
+	// Vars
+	char name[HASH_HEX_LENGTH + 1];
+	PypDataBufferEntry* entry;
+	PypChar* data;
+	PypSize dataLength = 0;
+	PypBool okay = PYP_TRUE;
+
+	// Assertions
+	assert(fragments != NULL);
+	assert(digest != NULL);
+	assert(dataBuffer != NULL);
+
+	// A slot placeholder is filled later, so the output isn't complete yet
+	for (entry = dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+		if (entry->reference != NULL) return PYP_FALSE;
+	}
+
+	// Copied, so the buffer can still be moved into the output without unifying it
+	if ((data = memAllocArray(PypChar, dataBuffer->totalSize + 1)) == NULL) return PYP_FALSE; // error
+	for (entry = dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+		memcpy(&data[dataLength], entry->buffer, sizeof(PypChar) * entry->bufferLength);
+		dataLength += entry->bufferLength;
+	}
+
+	// Disk
+	if (fragments->disk != NULL) okay = pypCacheFragmentStore(fragments->disk, digest, data, dataLength);
+
+	// Memory
+	hashToHex(digest, name);
+	threadMutexLock(&fragments->mutex);
+	if (!pypFragmentsMemoryAdd(fragments, name, data, dataLength)) memFree(data);
+	threadMutexUnlock(&fragments->mutex);
+
+	// Done
+	return okay;
+}
+
+
+
+// Memory tier
+PypBool
+pypFragmentsMemoryAdd(PypFragments* fragments, const char* name, PypChar* data, PypSize dataLength) {
+	// Vars
+	PypFragment* fragment;
+
+	// Too large, or stored by another thread in the meantime
+	if (fragments->maxSize == 0 || dataLength > fragments->maxSize || pypFragmentMapFind(fragments->map, name, NULL) == MAP_FOUND) return PYP_FALSE;
+
+	// Evict the oldest until it fits
+	while (fragments->firstChild != NULL && fragments->size + dataLength > fragments->maxSize) {
+		fragment = fragments->firstChild;
+		fragments->firstChild = fragment->nextSibling;
+		if (fragments->firstChild == NULL) fragments->lastChild = &fragments->firstChild;
+
+		pypFragmentMapRemove(fragments->map, fragment->name, NULL);
+		fragments->size -= fragment->dataLength;
+		memFree(fragment->data);
+		memFree(fragment);
+	}
+
+	// Create
+	if ((fragment = memAlloc(PypFragment)) == NULL) return PYP_FALSE; // error
+	memcpy(fragment->name, name, sizeof(fragment->name));
+	fragment->data = data;
+	fragment->dataLength = dataLength;
+	fragment->nextSibling = NULL;
+
+	if (pypFragmentMapAdd(fragments->map, fragment->name, fragment) != MAP_ADDED) {
+		// Error
+		memFree(fragment);
+		return PYP_FALSE;
+	}
+
+	// Link
+	*fragments->lastChild = fragment;
+	fragments->lastChild = &fragment->nextSibling;
+	fragments->size += dataLength;
+
+	// Done; the data is owned by the fragment now
+	return PYP_TRUE;
+}
+
+
+
+// Map functions
+MapHashValue pypFragmentMapKeyHashFunction(const char* key) {
+	return mapHelperHashString(key);
+}
+int pypFragmentMapKeyCompareFunction(const char* key1, const char* key2) {
+	return mapHelperCompareString(key1, key2);
+}
+int pypFragmentMapKeyCopyFunction(const char* key, char** output) {
+	return mapHelperCopyString(key, output);
+}
+void pypFragmentMapKeyDeleteFunction(char* key) {
+	mapHelperDeleteString(key);
+}
+void pypFragmentMapValueDeleteFunction(PypFragment* value) {
+	// Nothing; fragments are deleted from their list
+}
+
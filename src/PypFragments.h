@@ -0,0 +1,51 @@
+#ifndef __PYP_FRAGMENTS_H
+#define __PYP_FRAGMENTS_H
+
+
+
+#include "PypTypes.h"
+#include "PypDataBuffer.h"
+#include "PypCache.h"
+#include "Hash.h"
+#include "Map.h"
+#include "Thread.h"
+#include "Unicode.h"
+
+
+
+struct PypFragment_;
+
+MAP_DATA_HEADER(PypFragmentMap);
+
+typedef struct PypFragment_ {
+	char name[HASH_HEX_LENGTH + 1]; // the digest, as the map's key
+	PypChar* data;
+	PypSize dataLength;
+	struct PypFragment_* nextSibling; // stored after this one
+} PypFragment;
+
+typedef struct PypFragments_ {
+	PypFragment* firstChild; // stored first, and evicted first
+	PypFragment** lastChild;
+	PypFragmentMap* map;
+	PypSize size;
+	PypSize maxSize; // of the memory tier; 0 keeps nothing in memory
+	PypCache* disk; // if not NULL, fragments are also looked up and stored here; not owned
+	ThreadMutex mutex; // templates may render on several threads at once
+} PypFragments;
+
+
+
+PypFragments* pypFragmentsCreate(PypSize maxSize, PypCache* disk);
+void pypFragmentsDelete(PypFragments* fragments);
+
+// Key bytes, and the modification time and size of each file the fragment depends on
+PypBool pypFragmentsDigest(const char* key, PypSize keyLength, const unicode_char* const* filenames, size_t filenameCount, unsigned char* digest);
+
+PypBool pypFragmentsFetch(PypFragments* fragments, const unsigned char* digest, PypDataBuffer* dataBuffer); // on a hit, the fragment is added to dataBuffer
+PypBool pypFragmentsStore(PypFragments* fragments, const unsigned char* digest, const PypDataBuffer* dataBuffer); // output with slot placeholders isn't stored
+
+
+
+#endif
+
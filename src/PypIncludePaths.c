@@ -0,0 +1,215 @@
+#include <assert.h>
+#include <string.h>
+#include "PypIncludePaths.h"
+#include "Memory.h"
+#include "Path.h"
+#include "File.h"
+
+
+
+// Headers
+static PypBool pypIncludeLookupExists(PypIncludeLookups* lookups, const unicode_char* filename);
+
+MAP_BODY_HELPER_HEADERS_STATIC(unicode_char*, PypBool, pypIncludeLookupMap, PypIncludeLookupMap);
+MAP_FUNCTION_HEADERS_STATIC(unicode_char*, PypBool, pypIncludeLookupMap, PypIncludeLookupMap);
+MAP_BODY(unicode_char*, PypBool, pypIncludeLookupMap, PypIncludeLookupMap)
+
+
+
+// Search directories
+PypIncludePaths*
+pypIncludePathsCreate(const unicode_char* pathList) {
+	// Vars
+	PypIncludePaths* paths;
+	const unicode_char* pathStart;
+	const unicode_char* pathEnd;
+	unicode_char* directory;
+	size_t directoryLength;
+	size_t capacity = 1;
+
+	// Assertions
+	assert(pathList != NULL);
+
+	// Create
+	for (pathStart = pathList; *pathStart != '\x00'; ++pathStart) {
+		if (*pathStart == PYP_INCLUDE_PATHS_SEPARATOR) ++capacity;
+	}
+	paths = memAlloc(PypIncludePaths);
+	if (paths == NULL) return NULL; // error
+	paths->count = 0;
+	paths->directories = memAllocArray(unicode_char*, capacity);
+	if (paths->directories == NULL) {
+		// Error
+		memFree(paths);
+		return NULL;
+	}
+
+	// Each directory is made absolute once, so renders don't depend on the working directory
+	for (pathStart = pathList; ; pathStart = pathEnd + 1) {
+		for (pathEnd = pathStart; *pathEnd != PYP_INCLUDE_PATHS_SEPARATOR && *pathEnd != '\x00'; ++pathEnd);
+
+		if (pathEnd > pathStart) {
+			directoryLength = pathEnd - pathStart;
+			if ((directory = memAllocArray(unicode_char, directoryLength + 1)) == NULL) goto cleanup; // error
+			memcpy(directory, pathStart, sizeof(unicode_char) * directoryLength);
+			directory[directoryLength] = '\x00';
+
+			if (pathAbsoluteUnicode(directory, &paths->directories[paths->count], &directoryLength) != PATH_OKAY) {
+				// Error
+				memFree(directory);
+				goto cleanup;
+			}
+			memFree(directory);
+			++paths->count;
+		}
+
+		if (*pathEnd == '\x00') break;
+	}
+
+	// Done
+	return paths;
+
+	// Cleanup
+	cleanup:
+	pypIncludePathsDelete(paths);
+	return NULL;
+}
+
+void
+pypIncludePathsDelete(PypIncludePaths* paths) {
+	// Vars
+	size_t i;
+
+	// Assertions
+	assert(paths != NULL);
+
+	// Delete
+	for (i = 0; i < paths->count; ++i) memFree(paths->directories[i]);
+	memFree(paths->directories);
+	memFree(paths);
+}
+
+
+
+// Lookups for a single render
+PypIncludeLookups*
+pypIncludeLookupsCreate(const PypIncludePaths* paths) {
+	// Vars
+	PypIncludeLookups* lookups;
+
+	// Assertions
+	assert(paths != NULL);
+
+	// Create
+	lookups = memAlloc(PypIncludeLookups);
+	if (lookups == NULL) return NULL; // error
+
+	lookups->paths = paths;
+	if ((lookups->map = pypIncludeLookupMapCreate(NULL)) == NULL) {
+		// Error
+		memFree(lookups);
+		return NULL;
+	}
+	threadMutexInit(&lookups->mutex);
+
+	// Done
+	return lookups;
+}
+
+void
+pypIncludeLookupsDelete(PypIncludeLookups* lookups) {
+	assert(lookups != NULL);
+
+	pypIncludeLookupMapDelete(lookups->map);
+	threadMutexDestroy(&lookups->mutex);
+	memFree(lookups);
+}
+
+PypBool
+pypIncludeLookupExists(PypIncludeLookups* lookups, const unicode_char* filename) {
+	// Vars
+	PypBool exists;
+
+	// Assertions
+	assert(lookups != NULL);
+	assert(filename != NULL);
+
+	threadMutexLock(&lookups->mutex);
+
+	// Each candidate is only checked once per render, whether it was found or not
+	if (pypIncludeLookupMapFind(lookups->map, filename, &exists) != MAP_FOUND) {
+		exists = fileExistsUnicode(filename);
+		pypIncludeLookupMapAdd(lookups->map, filename, exists); // if it can't be remembered, it's checked again next time
+	}
+
+	threadMutexUnlock(&lookups->mutex);
+	return exists;
+}
+
+
+
+// Resolving
+PypBool
+pypIncludePathResolve(PypIncludeLookups* lookups, const unicode_char* directory, size_t directoryLength, const unicode_char* path, unicode_char** filename) {
+	// Vars
+	unicode_char* candidate;
+	size_t candidateLength;
+	size_t i;
+
+	// Assertions
+	assert(directory != NULL);
+	assert(path != NULL);
+	assert(filename != NULL);
+
+	// Relative to the including file's directory
+	if (pathJoinUnicode(directory, directoryLength, path, filename, &candidateLength) != PATH_OKAY) return PYP_FALSE; // error
+	if (
+		lookups == NULL ||
+		lookups->paths->count == 0 ||
+		pathIsAbsoluteUnicode(path) ||
+		pypIncludeLookupExists(lookups, *filename)
+	) {
+		// Done
+		return PYP_TRUE;
+	}
+
+	// Search directories, in order
+	for (i = 0; i < lookups->paths->count; ++i) {
+		if (pathJoinUnicode(lookups->paths->directories[i], getUnicodeCharStringLength(lookups->paths->directories[i]), path, &candidate, &candidateLength) != PATH_OKAY) {
+			// Error
+			memFree(*filename);
+			return PYP_FALSE;
+		}
+
+		if (pypIncludeLookupExists(lookups, candidate)) {
+			// Found
+			memFree(*filename);
+			*filename = candidate;
+			return PYP_TRUE;
+		}
+		memFree(candidate);
+	}
+
+	// Not found anywhere; the including file's directory is reported when it fails to open
+	return PYP_TRUE;
+}
+
+
+
+// Map functions
+MapHashValue pypIncludeLookupMapKeyHashFunction(const unicode_char* key) {
+	return mapHelperHashUnicode(key);
+}
+int pypIncludeLookupMapKeyCompareFunction(const unicode_char* key1, const unicode_char* key2) {
+	return mapHelperCompareUnicode(key1, key2);
+}
+int pypIncludeLookupMapKeyCopyFunction(const unicode_char* key, unicode_char** output) {
+	return mapHelperCopyUnicode(key, output);
+}
+void pypIncludeLookupMapKeyDeleteFunction(unicode_char* key) {
+	mapHelperDeleteUnicode(key);
+}
+void pypIncludeLookupMapValueDeleteFunction(PypBool value) {
+	// Nothing
+}
+
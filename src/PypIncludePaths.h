@@ -0,0 +1,47 @@
+#ifndef __PYP_INCLUDE_PATHS_H
+#define __PYP_INCLUDE_PATHS_H
+
+
+
+#include <stddef.h>
+#include "PypTypes.h"
+#include "Unicode.h"
+#include "Thread.h"
+#include "Map.h"
+
+
+
+// Separates search directories, as in PYTHONPATH
+#ifdef _WIN32
+#define PYP_INCLUDE_PATHS_SEPARATOR ';'
+#else
+#define PYP_INCLUDE_PATHS_SEPARATOR ':'
+#endif
+
+MAP_DATA_HEADER(PypIncludeLookupMap);
+
+typedef struct PypIncludePaths_ {
+	unicode_char** directories; // absolute and normalized, searched in order after the including file's directory
+	size_t count;
+} PypIncludePaths;
+
+typedef struct PypIncludeLookups_ {
+	const PypIncludePaths* paths;
+	PypIncludeLookupMap* map; // candidate file name -> whether it exists; files aren't expected to appear or vanish mid-render
+	ThreadMutex mutex; // includes may be rendered on several threads at once
+} PypIncludeLookups;
+
+
+
+PypIncludePaths* pypIncludePathsCreate(const unicode_char* pathList);
+void pypIncludePathsDelete(PypIncludePaths* paths);
+
+PypIncludeLookups* pypIncludeLookupsCreate(const PypIncludePaths* paths);
+void pypIncludeLookupsDelete(PypIncludeLookups* lookups);
+
+PypBool pypIncludePathResolve(PypIncludeLookups* lookups, const unicode_char* directory, size_t directoryLength, const unicode_char* path, unicode_char** filename);
+
+
+
+#endif
+
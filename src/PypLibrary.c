@@ -0,0 +1,427 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <Python.h>
+#include "PypLibrary.h"
+#include "PypEngine.h"
+#include "PypDataBuffer.h"
+#include "Memory.h"
+#include "Thread.h"
+#include "File.h"
+#include "Unicode.h"
+
+
+
+// Discards errors which are only recorded
+#ifdef _WIN32
+#define PYP_LIBRARY_NULL_DEVICE "NUL"
+#else
+#define PYP_LIBRARY_NULL_DEVICE "/dev/null"
+#endif
+
+
+
+// Structs
+struct PypLibraryEngine_ {
+	PypEngine* engine;
+	FILE* errorStream; // NULL for inline errors
+	FILE* nullStream;
+	PyThreadState* threadState; // of the thread which started python; the GIL is released between renders
+	ThreadMutex mutex;
+};
+
+
+
+// Headers
+static PypSize pypLibrarySourceRead(void* data, PypChar* buffer, PypSize bufferSize);
+static PypLibraryStatus pypLibrarySinkWrite(PypLibrarySink* sink, const PypDataBuffer* dataBuffer);
+static PypLibraryError* pypLibraryErrorsFromLog(PypModuleErrorLog* errorLog);
+static PypBool pypLibraryStringDecode(const char* string, unicode_char** output);
+
+
+
+// Settings
+void
+pypLibrarySettingsInit(PypLibrarySettings* settings) {
+	assert(settings != NULL);
+
+	settings->includePath = NULL;
+	settings->pythonHome = NULL;
+	settings->isolated = 0;
+	settings->errorOutput = PYP_LIBRARY_ERROR_OUTPUT_NONE;
+}
+
+
+
+// Engines
+PypLibraryStatus
+pypLibraryEngineCreate(const PypLibrarySettings* settings, PypLibraryEngine** engine) {
+	// Vars
+	PypEngineSettings engineSettings;
+	PypLibraryEngine* libraryEngine;
+	unicode_char* includePath = NULL;
+	unicode_char* pythonHome = NULL;
+	PypLibraryStatus status = PYP_LIBRARY_ERROR_MEMORY;
+	PypEngineStatus es;
+
+	// Assertions
+	assert(settings != NULL);
+	assert(engine != NULL);
+
+	// Create
+	*engine = NULL;
+	if ((libraryEngine = memAlloc(PypLibraryEngine)) == NULL) return PYP_LIBRARY_ERROR_MEMORY; // error
+	libraryEngine->engine = NULL;
+	libraryEngine->errorStream = stderr;
+	libraryEngine->nullStream = NULL;
+	libraryEngine->threadState = NULL;
+	threadMutexInit(&libraryEngine->mutex);
+
+	// Error output
+	if (settings->errorOutput == PYP_LIBRARY_ERROR_OUTPUT_INLINE) {
+		libraryEngine->errorStream = NULL;
+	}
+	else if (settings->errorOutput == PYP_LIBRARY_ERROR_OUTPUT_NONE) {
+		if ((libraryEngine->nullStream = fopen(PYP_LIBRARY_NULL_DEVICE, "wb")) == NULL) {
+			// Error
+			status = PYP_LIBRARY_ERROR_OPEN;
+			goto cleanup;
+		}
+		libraryEngine->errorStream = libraryEngine->nullStream;
+	}
+
+	// Engine
+	pypEngineSettingsInit(&engineSettings);
+	if (
+		!pypLibraryStringDecode(settings->includePath, &includePath) ||
+		!pypLibraryStringDecode(settings->pythonHome, &pythonHome)
+	) {
+		// Error
+		goto cleanup;
+	}
+	engineSettings.includePath = includePath;
+	engineSettings.python.home = pythonHome;
+	engineSettings.python.isolated = (settings->isolated != 0);
+
+	if ((libraryEngine->engine = pypEngineCreate(&engineSettings, L"pyp")) == NULL) goto cleanup; // error
+
+	// Python is started now, so that the settings don't need to be kept, and renders can happen on any thread
+	if ((es = pypEnginePythonStart(libraryEngine->engine)) != PYP_ENGINE_OKAY) {
+		// Error
+		status = (es == PYP_ENGINE_ERROR_MEMORY) ? PYP_LIBRARY_ERROR_MEMORY : PYP_LIBRARY_ERROR_PYTHON;
+		goto cleanup;
+	}
+	#if PY_VERSION_HEX < 0x03070000
+	PyEval_InitThreads();
+	#endif
+	libraryEngine->threadState = PyEval_SaveThread();
+
+	// Done
+	if (includePath != NULL) memFree(includePath);
+	if (pythonHome != NULL) memFree(pythonHome);
+	*engine = libraryEngine;
+	return PYP_LIBRARY_OKAY;
+
+	// Cleanup
+	cleanup:
+	if (includePath != NULL) memFree(includePath);
+	if (pythonHome != NULL) memFree(pythonHome);
+	pypLibraryEngineDelete(libraryEngine);
+	return status;
+}
+
+void
+pypLibraryEngineDelete(PypLibraryEngine* engine) {
+	assert(engine != NULL);
+
+	if (engine->threadState != NULL) PyEval_RestoreThread(engine->threadState);
+	if (engine->engine != NULL) pypEngineDelete(engine->engine);
+	if (engine->nullStream != NULL) fclose(engine->nullStream);
+	threadMutexDestroy(&engine->mutex);
+	memFree(engine);
+}
+
+
+
+// Sources
+void
+pypLibrarySourceMemory(PypLibrarySource* source, const char* buffer, size_t length) {
+	assert(source != NULL);
+	assert(buffer != NULL || length == 0);
+
+	source->read = NULL;
+	source->data = NULL;
+	source->buffer = buffer;
+	source->length = length;
+	source->position = 0;
+	source->fd = -1;
+	source->failed = 0;
+}
+
+void
+pypLibrarySourceFd(PypLibrarySource* source, int fd) {
+	assert(source != NULL);
+	assert(fd >= 0);
+
+	pypLibrarySourceMemory(source, NULL, 0);
+	source->fd = fd;
+}
+
+void
+pypLibrarySourceCallback(PypLibrarySource* source, PypLibraryReadFunction read, void* data) {
+	assert(source != NULL);
+	assert(read != NULL);
+
+	pypLibrarySourceMemory(source, NULL, 0);
+	source->read = read;
+	source->data = data;
+}
+
+PypSize
+pypLibrarySourceRead(void* data, PypChar* buffer, PypSize bufferSize) {
+	// Vars
+	PypLibrarySource* source = (PypLibrarySource*) data;
+	size_t readLength = 0;
+	size_t length;
+
+	// Assertions
+	assert(source != NULL);
+	assert(buffer != NULL);
+
+	// The reader stops at the first short read, so the buffer is filled unless the input has ended
+	if (source->failed) return 0;
+	if (source->read != NULL) {
+		while (readLength < bufferSize) {
+			length = (source->read)(source->data, &buffer[readLength], bufferSize - readLength);
+			if (length == 0) break;
+			if (length == PYP_LIBRARY_READ_ERROR || length > bufferSize - readLength) {
+				// Error
+				source->failed = 1;
+				break;
+			}
+			readLength += length;
+		}
+	}
+	else if (source->fd >= 0) {
+		if (!fileDescriptorReadUpTo(source->fd, buffer, bufferSize, &readLength)) source->failed = 1;
+	}
+	else {
+		readLength = source->length - source->position;
+		if (readLength > bufferSize) readLength = bufferSize;
+		memcpy(buffer, &source->buffer[source->position], sizeof(char) * readLength);
+		source->position += readLength;
+	}
+
+	// Done
+	return readLength;
+}
+
+
+
+// Sinks
+void
+pypLibrarySinkMemory(PypLibrarySink* sink) {
+	assert(sink != NULL);
+
+	sink->write = NULL;
+	sink->data = NULL;
+	sink->buffer = NULL;
+	sink->length = 0;
+	sink->fd = -1;
+}
+
+void
+pypLibrarySinkFd(PypLibrarySink* sink, int fd) {
+	assert(sink != NULL);
+	assert(fd >= 0);
+
+	pypLibrarySinkMemory(sink);
+	sink->fd = fd;
+}
+
+void
+pypLibrarySinkCallback(PypLibrarySink* sink, PypLibraryWriteFunction write, void* data) {
+	assert(sink != NULL);
+	assert(write != NULL);
+
+	pypLibrarySinkMemory(sink);
+	sink->write = write;
+	sink->data = data;
+}
+
+PypLibraryStatus
+pypLibrarySinkWrite(PypLibrarySink* sink, const PypDataBuffer* dataBuffer) {
+	// Vars
+	PypDataBufferEntry* entry;
+	char* pos;
+
+	// Assertions
+	assert(sink != NULL);
+	assert(dataBuffer != NULL);
+
+	// Memory; null terminated for convenience, which isn't counted in the length
+	if (sink->write == NULL && sink->fd < 0) {
+		if ((sink->buffer = memAllocArray(char, dataBuffer->totalSize + 1)) == NULL) return PYP_LIBRARY_ERROR_MEMORY; // error
+		pos = sink->buffer;
+		for (entry = dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+			memcpy(pos, entry->buffer, sizeof(char) * entry->bufferLength);
+			pos += entry->bufferLength;
+		}
+		*pos = '\x00';
+		sink->length = dataBuffer->totalSize;
+		return PYP_LIBRARY_OKAY;
+	}
+
+	// Each entry
+	for (entry = dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+		if (entry->bufferLength == 0) continue;
+		if (sink->write != NULL) {
+			if (!(sink->write)(sink->data, entry->buffer, entry->bufferLength)) return PYP_LIBRARY_ERROR_WRITE; // error
+		}
+		else {
+			if (!fileDescriptorWrite(sink->fd, entry->buffer, entry->bufferLength)) return PYP_LIBRARY_ERROR_WRITE; // error
+		}
+	}
+	sink->length += dataBuffer->totalSize;
+
+	// Done
+	return PYP_LIBRARY_OKAY;
+}
+
+
+
+// Rendering
+PypLibraryStatus
+pypLibraryRender(PypLibraryEngine* engine, PypLibrarySource* source, PypLibrarySink* sink, const char* filename, PypLibraryError** errors) {
+	// Vars
+	PypModuleErrorLog errorLog;
+	PypDataBuffer* output;
+	unicode_char* inputFilename = NULL;
+	PyGILState_STATE gilState;
+	PypReadStatus rs;
+	PypLibraryStatus status;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(source != NULL);
+	assert(sink != NULL);
+
+	// Setup
+	if (errors != NULL) *errors = NULL;
+	if (!pypLibraryStringDecode((filename != NULL) ? filename : "<string>", &inputFilename)) return PYP_LIBRARY_ERROR_MEMORY; // error
+	if ((output = pypDataBufferCreate()) == NULL) {
+		// Error
+		memFree(inputFilename);
+		return PYP_LIBRARY_ERROR_MEMORY;
+	}
+	pypModuleErrorLogInit(&errorLog);
+
+	// Render; the engine's render state is shared, so renders take turns, taking the GIL second so that waiting doesn't hold it
+	threadMutexLock(&engine->mutex);
+	gilState = PyGILState_Ensure();
+	rs = pypEngineRenderSource(engine->engine, pypLibrarySourceRead, source, output, engine->errorStream, inputFilename, NULL, NULL, &errorLog);
+	PyGILState_Release(gilState);
+	threadMutexUnlock(&engine->mutex);
+
+	// Output is written even if the render failed, like the command line leaves what was rendered
+	status = (PypLibraryStatus) rs;
+	if (source->failed && status == PYP_LIBRARY_OKAY) status = PYP_LIBRARY_ERROR_READ;
+	if (status != PYP_LIBRARY_ERROR_MEMORY) {
+		PypLibraryStatus ws = pypLibrarySinkWrite(sink, output);
+		if (status == PYP_LIBRARY_OKAY) status = ws;
+	}
+
+	// Errors
+	if (errors != NULL) *errors = pypLibraryErrorsFromLog(&errorLog);
+
+	// Done
+	pypModuleErrorLogClean(&errorLog);
+	pypDataBufferDelete(output);
+	memFree(inputFilename);
+	return status;
+}
+
+
+
+// Errors
+PypLibraryError*
+pypLibraryErrorsFromLog(PypModuleErrorLog* errorLog) {
+	// Vars
+	PypLibraryError* first = NULL;
+	PypLibraryError** last = &first;
+	PypLibraryError* error;
+	PypModuleError* source;
+
+	// Assertions
+	assert(errorLog != NULL);
+
+	// The strings are moved, so the log can be cleaned as usual
+	for (source = errorLog->firstChild; source != NULL; source = source->nextSibling) {
+		if ((error = memAlloc(PypLibraryError)) == NULL) break; // error
+		error->type = (source->type == PYP_MODULE_ERROR_SYNTAX) ? PYP_LIBRARY_ERROR_TYPE_SYNTAX : PYP_LIBRARY_ERROR_TYPE_CODE;
+		error->name = source->name;
+		error->message = source->message;
+		error->traceback = source->traceback;
+		error->filename = source->filename;
+		error->line = source->line;
+		error->next = NULL;
+		source->name = NULL;
+		source->message = NULL;
+		source->traceback = NULL;
+		source->filename = NULL;
+
+		*last = error;
+		last = &error->next;
+	}
+
+	// Done
+	return first;
+}
+
+void
+pypLibraryErrorsDelete(PypLibraryError* errors) {
+	// Vars
+	PypLibraryError* next;
+
+	// Delete
+	for (; errors != NULL; errors = next) {
+		next = errors->next;
+		if (errors->name != NULL) memFree((char*) errors->name);
+		if (errors->message != NULL) memFree((char*) errors->message);
+		if (errors->traceback != NULL) memFree((char*) errors->traceback);
+		if (errors->filename != NULL) memFree((char*) errors->filename);
+		memFree(errors);
+	}
+}
+
+
+
+// Misc
+void
+pypLibraryFree(void* buffer) {
+	if (buffer != NULL) memFree(buffer);
+}
+
+const char*
+pypLibraryStatusDescription(PypLibraryStatus status) {
+	if (status == PYP_LIBRARY_ERROR_PYTHON) return "Python error";
+	if (status == PYP_LIBRARY_ERROR_CODE_EXECUTION) return "Code execution error";
+	return pypReadStatusDescription((PypReadStatus) status);
+}
+
+PypBool
+pypLibraryStringDecode(const char* string, unicode_char** output) {
+	// Vars
+	size_t characterCount;
+	size_t bufferLength;
+	size_t errorCount;
+
+	// Assertions
+	assert(output != NULL);
+
+	// Optional strings stay NULL
+	*output = NULL;
+	if (string == NULL) return PYP_TRUE;
+	return (unicodeUTF8Decode(string, output, &characterCount, &bufferLength, &errorCount) == UNICODE_OKAY);
+}
+
@@ -0,0 +1,120 @@
+#ifndef __PYP_LIBRARY_H
+#define __PYP_LIBRARY_H
+
+
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+// Embedding API; the only header a host needs, so it doesn't depend on python's or pyp's internal headers
+#if defined(_WIN32) && defined(PYP_LIBRARY_BUILD)
+#define PYP_LIBRARY_API __declspec(dllexport)
+#else
+#define PYP_LIBRARY_API
+#endif
+
+typedef struct PypLibraryEngine_ PypLibraryEngine;
+
+typedef enum PypLibraryStatus_ {
+	PYP_LIBRARY_OKAY = 0x0,
+	PYP_LIBRARY_ERROR = 0x1,
+	PYP_LIBRARY_ERROR_MEMORY = 0x2,
+	PYP_LIBRARY_ERROR_OPEN = 0x3, // an include couldn't be opened
+	PYP_LIBRARY_ERROR_READ = 0x4,
+	PYP_LIBRARY_ERROR_WRITE = 0x5,
+	PYP_LIBRARY_ERROR_CODE_EXECUTION = 0x6,
+	PYP_LIBRARY_ERROR_DIRECTORY = 0x7,
+	PYP_LIBRARY_ERROR_PYTHON = 0x100, // python couldn't be started
+} PypLibraryStatus;
+
+typedef enum PypLibraryErrorOutput_ {
+	PYP_LIBRARY_ERROR_OUTPUT_NONE = 0x0, // errors are only recorded
+	PYP_LIBRARY_ERROR_OUTPUT_INLINE = 0x1, // errors are shown in the output, as with --inline-errors
+	PYP_LIBRARY_ERROR_OUTPUT_STDERR = 0x2,
+} PypLibraryErrorOutput;
+
+typedef enum PypLibraryErrorType_ {
+	PYP_LIBRARY_ERROR_TYPE_CODE = 0x0, // raised by a tag's code
+	PYP_LIBRARY_ERROR_TYPE_SYNTAX = 0x1, // a tag which isn't closed, or continued properly
+} PypLibraryErrorType;
+
+typedef struct PypLibrarySettings_ {
+	const char* includePath; // if not NULL, directories searched for includes, separated like PYTHONPATH
+	const char* pythonHome; // if not NULL, the standard library prefix, so it isn't searched for
+	int isolated; // ignore PYTHON* environment variables and the user site directory
+	PypLibraryErrorOutput errorOutput;
+} PypLibrarySettings; // strings are UTF-8
+
+typedef struct PypLibraryError_ {
+	PypLibraryErrorType type;
+	const char* name; // the exception's type; NULL for syntax errors
+	const char* message;
+	const char* traceback; // as python prints it; NULL for syntax errors
+	const char* filename; // of the template the error is in, which may be an include
+	size_t line; // in the template's file, counted from 1; for code errors, where the tag's own code was when it raised, even if the error came from a function it called; 0 if not known
+	struct PypLibraryError_* next;
+} PypLibraryError; // strings are UTF-8
+
+// Returns how many bytes were read, 0 at the end of the input, or PYP_LIBRARY_READ_ERROR
+typedef size_t (*PypLibraryReadFunction)(void* data, char* buffer, size_t bufferSize);
+#define PYP_LIBRARY_READ_ERROR ((size_t) -1)
+// Returns zero on failure
+typedef int (*PypLibraryWriteFunction)(void* data, const char* buffer, size_t bufferSize);
+
+typedef struct PypLibrarySource_ {
+	PypLibraryReadFunction read;
+	void* data;
+	const char* buffer;
+	size_t length;
+	size_t position;
+	int fd;
+	int failed;
+} PypLibrarySource; // set up with one of the pypLibrarySource* functions
+
+typedef struct PypLibrarySink_ {
+	PypLibraryWriteFunction write;
+	void* data;
+	char* buffer; // memory sinks: the output, which is freed with pypLibraryFree
+	size_t length;
+	int fd;
+} PypLibrarySink; // set up with one of the pypLibrarySink* functions
+
+
+
+PYP_LIBRARY_API void pypLibrarySettingsInit(PypLibrarySettings* settings);
+
+// Python is started once per process, so there can only be one engine at a time
+PYP_LIBRARY_API PypLibraryStatus pypLibraryEngineCreate(const PypLibrarySettings* settings, PypLibraryEngine** engine);
+PYP_LIBRARY_API void pypLibraryEngineDelete(PypLibraryEngine* engine);
+
+PYP_LIBRARY_API void pypLibrarySourceMemory(PypLibrarySource* source, const char* buffer, size_t length);
+PYP_LIBRARY_API void pypLibrarySourceFd(PypLibrarySource* source, int fd);
+PYP_LIBRARY_API void pypLibrarySourceCallback(PypLibrarySource* source, PypLibraryReadFunction read, void* data);
+
+PYP_LIBRARY_API void pypLibrarySinkMemory(PypLibrarySink* sink);
+PYP_LIBRARY_API void pypLibrarySinkFd(PypLibrarySink* sink, int fd);
+PYP_LIBRARY_API void pypLibrarySinkCallback(PypLibrarySink* sink, PypLibraryWriteFunction write, void* data);
+
+// May be called from any thread; renders on the same engine take turns
+// filename is used for error messages and to resolve includes; errors may be NULL, otherwise it's set to the errors' list, or NULL if there were none
+PYP_LIBRARY_API PypLibraryStatus pypLibraryRender(PypLibraryEngine* engine, PypLibrarySource* source, PypLibrarySink* sink, const char* filename, PypLibraryError** errors);
+
+PYP_LIBRARY_API void pypLibraryErrorsDelete(PypLibraryError* errors);
+PYP_LIBRARY_API void pypLibraryFree(void* buffer);
+PYP_LIBRARY_API const char* pypLibraryStatusDescription(PypLibraryStatus status);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#endif
+
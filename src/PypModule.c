@@ -1,6 +1,14 @@
 #include <assert.h>
+#include <stdint.h>
 #include <Python.h>
 #include <frameobject.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 #if PY_MAJOR_VERSION < 3
 #include <cStringIO.h>
 #endif
@@ -10,14 +18,133 @@
 #include "Memory.h"
 #include "Path.h"
 #include "File.h"
+#include "Thread.h"
+#include "PypStats.h"
+#include "PypDependencies.h"
+#include "PypIncludePaths.h"
+#include "PypSlots.h"
+#include "PypFragments.h"
+#include "PypExtension.h"
 
 
 
 // Structs
 typedef struct PypModuleState_ {
 	PyObject* error;
+	PyObject* contextType;
+	PyObject* templateType;
+	PyObject* captureType;
+	PyObject* outputType;
+	PyObject* fragmentType;
 } PypModuleState;
 
+typedef struct PypModuleContext_ {
+	PypDataBuffer* dataBuffer;
+	PypModuleExecutionInfo* executionInfo;
+	struct PypAsyncInclude_* asyncIncludes; // started by pyp.include_async, spliced in when the tag or context ends
+} PypModuleContext;
+
+typedef struct PypContextObject_ {
+	PyObject_HEAD
+	PypModuleExecutionInfo executionInfo;
+	PypDataBuffer* dataBuffer;
+	PypModuleContext previousContext;
+	PypBool active;
+	ThreadMutex mutex;
+} PypContextObject;
+
+typedef struct PypCaptureObject_ {
+	PyObject_HEAD
+	PypDataBuffer* dataBuffer;
+	PypDataBuffer* previousDataBuffer; // restored when the capture ends
+	PypModuleExecutionInfo* executionInfo; // the render it was entered in, while it's active
+	struct PypCaptureObject_* outer; // entered before it in the same render
+	PypBool spanning; // left open by the tag which entered it, so it collects the output after the tag too
+	PypBool active;
+} PypCaptureObject;
+
+typedef struct PypOutputObject_ {
+	PyObject_HEAD
+	unicode_char* filename;
+	PypBool onlyIfChanged;
+	FileOutput output; // open while it's the current output
+	PypDataBuffer* dataBuffer; // written to the file when the output ends
+	PypDataBuffer* previousDataBuffer; // restored when the output ends
+	PypBool active;
+} PypOutputObject;
+
+typedef struct PypFragmentObject_ {
+	PyObject_HEAD
+	PypFragments* fragments; // NULL if nothing caches it, and the region always renders
+	unsigned char digest[HASH_DIGEST_LENGTH];
+	PypBool hit; // the cached output was already added, so the region's own output is thrown away
+	PypStatsValue codeErrorCount; // when the region started; output of code which raised errors isn't stored
+	PypDataBuffer* dataBuffer; // the region's output
+	PypDataBuffer* previousDataBuffer; // restored when the region ends
+	PypBool active;
+} PypFragmentObject;
+
+typedef struct PypTemplateSegment_ {
+	PyObject* code; // NULL for text
+	PypBool expression;
+	PypChar* text;
+	PypSize textLength;
+	PypStreamLocation location; // of the tag, for escaping its error output
+	PypDataBufferEntry* placeholder; // where the tag's output would have gone; only used while compiling
+} PypTemplateSegment;
+
+typedef struct PypTemplateObject_ {
+	PyObject_HEAD
+	PypModuleExecutionInfo executionInfo; // the template's file name, and the settings it was compiled with
+	PypTemplateSegment* segments; // text and tags, in order
+	size_t segmentCount;
+	size_t segmentCapacity;
+	PypBool fromFile; // each render depends on the template's file
+} PypTemplateObject;
+
+typedef enum PypIncludeState_ {
+	PYP_INCLUDE_PENDING = 0x0,
+	PYP_INCLUDE_DONE = 0x1,
+	PYP_INCLUDE_LOST = 0x2, // the worker rendering it exited early
+} PypIncludeState;
+
+#ifdef PYP_ASYNC_SUPPORTED
+typedef struct PypAsyncInclude_ {
+	Thread thread;
+	PyThreadState* threadState; // created by the caller, so a failure is raised there
+	PypModuleExecutionInfo executionInfo; // copy of the caller's, which never changes the working directory
+	unicode_char* filename;
+	PypDataBuffer* dataBuffer;
+	PypDataBuffer* targetDataBuffer;
+	PypDataBufferEntry* placeholder;
+	PypReadStatus status;
+	PyObject* loop;
+	PyObject* future;
+	struct PypAsyncInclude_* nextSibling;
+} PypAsyncInclude;
+
+typedef struct PypAsyncRun_ {
+	Thread thread;
+	PyThreadState* threadState; // created by the caller, so a failure is raised there
+	PypModuleContext context;
+	PyObject* coroutine;
+	PyObject* result;
+	PyObject* errorType;
+	PyObject* errorValue;
+	PyObject* errorTraceback;
+} PypAsyncRun;
+#endif
+
+#ifndef _WIN32
+typedef struct PypIncludeResultHeader_ {
+	uint32_t index;
+	uint32_t status;
+	uint64_t length;
+	uint64_t dependenciesLength; // characters of the null terminated file names that follow the output
+	PypStatsValue stats[PYP_STATS_COUNTER_COUNT]; // counted since the previous result
+} PypIncludeResultHeader;
+#endif
+
 
 // Module indo
 PyDoc_STRVAR(pypModuleName, "pyp");
@@ -29,37 +156,253 @@ PyDoc_STRVAR(pypCompiledCodeFilenamePrefix, "pyp:");
 PyDoc_STRVAR(pypDoc_include, "Include a file using the Python preprocessor");
 static PyObject* pyp_include(PyObject* self, PyObject* args);
 
-PyDoc_STRVAR(pypDoc_write, "Write to the output file stream");
+PyDoc_STRVAR(pypDoc_include_parallel, "Include several independent files at once, outputting them in order; returns None or an exception for each file");
+static PyObject* pyp_include_parallel(PyObject* self, PyObject* args, PyObject* keywords);
+
+#ifdef PYP_ASYNC_SUPPORTED
+PyDoc_STRVAR(pypDoc_include_async, "Start including a file on another thread; returns an awaitable, and the output is placed where this was called");
+static PyObject* pyp_include_async(PyObject* self, PyObject* args);
+#endif
+
+PyDoc_STRVAR(pypDoc_write, "Write to the output file stream; an iterator or generator of strings is written one chunk at a time");
 static PyObject* pyp_write(PyObject* self, PyObject* args);
 
+PyDoc_STRVAR(pypDoc_depend, "Record that the output depends on a file which was read without being included");
+static PyObject* pyp_depend(PyObject* self, PyObject* args);
+
+PyDoc_STRVAR(pypDoc_slot, "Reserve a named position in the output, filled later with pyp.fill; output after it is held back until then");
+static PyObject* pyp_slot(PyObject* self, PyObject* args);
+
+PyDoc_STRVAR(pypDoc_fill, "Fill a slot reserved with pyp.slot with a string, or an iterator of strings; it can only be filled once");
+static PyObject* pyp_fill(PyObject* self, PyObject* args);
+
+PyDoc_STRVAR(pypDoc_context, "Create an output context which another thread can write and include into");
+static PyObject* pyp_context(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDoc_gc_disable, "Turn off automatic garbage collection until the current render ends");
+static PyObject* pyp_gc_disable(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDoc_capture, "Create a capture which, as a context manager, collects the output written and included inside it; entered in one tag and exited in a later one, it collects everything in between");
+static PyObject* pyp_capture(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDoc_output, "Create an output which, as a context manager, sends the output written and included inside it to a file instead; with only_if_changed, a file with the same contents is left untouched");
+static PyObject* pyp_output(PyObject* self, PyObject* args, PyObject* keywords);
+
+PyDoc_STRVAR(pypDoc_cache, "Create a fragment which, as a context manager, reuses the output of its region while the key and the modification times of the files in deps are unchanged; entering it returns True if the output was reused, so the region can skip its work, and with render= the region is that function, which is only called on a miss");
+static PyObject* pyp_cache(PyObject* self, PyObject* args, PyObject* keywords);
+
+PyDoc_STRVAR(pypDoc_compile, "Compile a template file, or the source given as text=, into a Template which can be rendered many times");
+static PyObject* pyp_compile(PyObject* self, PyObject* args, PyObject* keywords);
+
+#ifdef PYP_EXTENSION_MODULE
+PyDoc_STRVAR(pypDoc_render_file, "Render a template file; the output goes to dst, which is a path or a file object, or is returned as bytes if dst is None");
+PyDoc_STRVAR(pypDoc_render_string, "Render template source given as text; returns the output as bytes");
+#endif
+
 static PyMethodDef moduleMethods[] = {
     { "include", (PyCFunction) pyp_include , METH_VARARGS , pypDoc_include },
+    { "include_parallel", (PyCFunction) pyp_include_parallel , METH_VARARGS | METH_KEYWORDS , pypDoc_include_parallel },
+    #ifdef PYP_ASYNC_SUPPORTED
+    { "include_async", (PyCFunction) pyp_include_async , METH_VARARGS , pypDoc_include_async },
+    #endif
     { "write", (PyCFunction) pyp_write , METH_VARARGS , pypDoc_write },
+    { "depend", (PyCFunction) pyp_depend , METH_VARARGS , pypDoc_depend },
+    { "slot", (PyCFunction) pyp_slot , METH_VARARGS , pypDoc_slot },
+    { "fill", (PyCFunction) pyp_fill , METH_VARARGS , pypDoc_fill },
+    { "context", (PyCFunction) pyp_context , METH_NOARGS , pypDoc_context },
+    { "gc_disable", (PyCFunction) pyp_gc_disable , METH_NOARGS , pypDoc_gc_disable },
+    { "capture", (PyCFunction) pyp_capture , METH_NOARGS , pypDoc_capture },
+    { "output", (PyCFunction) pyp_output , METH_VARARGS | METH_KEYWORDS , pypDoc_output },
+    { "cache", (PyCFunction) pyp_cache , METH_VARARGS | METH_KEYWORDS , pypDoc_cache },
+    { "compile", (PyCFunction) pyp_compile , METH_VARARGS | METH_KEYWORDS , pypDoc_compile },
+    #ifdef PYP_EXTENSION_MODULE
+    { "render_file", (PyCFunction) pypExtension_render_file , METH_VARARGS | METH_KEYWORDS , pypDoc_render_file },
+    { "render_string", (PyCFunction) pypExtension_render_string , METH_VARARGS | METH_KEYWORDS , pypDoc_render_string },
+    #endif
+	{ NULL } // sentinel
+};
+
+// Context methods
+PyDoc_STRVAR(pypContextTypeName, "pyp.Context");
+PyDoc_STRVAR(pypDocContext, "Output context created by pyp.context()");
+
+PyDoc_STRVAR(pypDocContext_enter, "Make this the current context of the calling thread");
+static PyObject* pypContext_enter(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDocContext_exit, "Restore the previous context of the calling thread");
+static PyObject* pypContext_exit(PyObject* self, PyObject* args);
+
+PyDoc_STRVAR(pypDocContext_getvalue, "Get the output written to the context, as bytes");
+static PyObject* pypContext_getvalue(PyObject* self, PyObject* unused);
+
+static void pypContext_dealloc(PyObject* self);
+
+static PyMethodDef contextMethods[] = {
+    { "__enter__", (PyCFunction) pypContext_enter , METH_NOARGS , pypDocContext_enter },
+    { "__exit__", (PyCFunction) pypContext_exit , METH_VARARGS , pypDocContext_exit },
+    { "getvalue", (PyCFunction) pypContext_getvalue , METH_NOARGS , pypDocContext_getvalue },
+	{ NULL } // sentinel
+};
+
+// Capture methods
+PyDoc_STRVAR(pypCaptureTypeName, "pyp.Capture");
+PyDoc_STRVAR(pypDocCapture, "Output capture created by pyp.capture()");
+
+PyDoc_STRVAR(pypDocCapture_enter, "Start collecting the output");
+static PyObject* pypCapture_enter(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDocCapture_exit, "Stop collecting the output, which goes where it went before");
+static PyObject* pypCapture_exit(PyObject* self, PyObject* args);
+
+PyDoc_STRVAR(pypDocCapture_getvalue, "Get the captured output, as bytes");
+static PyObject* pypCapture_getvalue(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDocCapture_emit, "Add the captured output to the current output; with clear=True it's moved without copying instead, leaving the capture empty");
+static PyObject* pypCapture_emit(PyObject* self, PyObject* args, PyObject* keywords);
+
+static void pypCapture_dealloc(PyObject* self);
+
+static PyMethodDef captureMethods[] = {
+    { "__enter__", (PyCFunction) pypCapture_enter , METH_NOARGS , pypDocCapture_enter },
+    { "__exit__", (PyCFunction) pypCapture_exit , METH_VARARGS , pypDocCapture_exit },
+    { "getvalue", (PyCFunction) pypCapture_getvalue , METH_NOARGS , pypDocCapture_getvalue },
+    { "emit", (PyCFunction) pypCapture_emit , METH_VARARGS | METH_KEYWORDS , pypDocCapture_emit },
+	{ NULL } // sentinel
+};
+
+// Output methods
+PyDoc_STRVAR(pypOutputTypeName, "pyp.Output");
+PyDoc_STRVAR(pypDocOutput, "File output created by pyp.output()");
+
+PyDoc_STRVAR(pypDocOutput_enter, "Open the file, and start collecting the output for it");
+static PyObject* pypOutput_enter(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDocOutput_exit, "Write the collected output to the file and close it; the output goes where it went before");
+static PyObject* pypOutput_exit(PyObject* self, PyObject* args);
+
+static void pypOutput_dealloc(PyObject* self);
+
+static PyMethodDef outputMethods[] = {
+    { "__enter__", (PyCFunction) pypOutput_enter , METH_NOARGS , pypDocOutput_enter },
+    { "__exit__", (PyCFunction) pypOutput_exit , METH_VARARGS , pypDocOutput_exit },
+	{ NULL } // sentinel
+};
+
+// Fragment methods
+PyDoc_STRVAR(pypFragmentTypeName, "pyp.Fragment");
+PyDoc_STRVAR(pypDocFragment, "Cached output region created by pyp.cache()");
+
+PyDoc_STRVAR(pypDocFragment_enter, "Add the cached output if there is any, and start collecting the region's output; returns True if the cached output was used");
+static PyObject* pypFragment_enter(PyObject* self, PyObject* unused);
+
+PyDoc_STRVAR(pypDocFragment_exit, "Store the collected output and add it to where the output went before, unless the cached output was used");
+static PyObject* pypFragment_exit(PyObject* self, PyObject* args);
+
+static void pypFragment_dealloc(PyObject* self);
+
+static PyMethodDef fragmentMethods[] = {
+    { "__enter__", (PyCFunction) pypFragment_enter , METH_NOARGS , pypDocFragment_enter },
+    { "__exit__", (PyCFunction) pypFragment_exit , METH_VARARGS , pypDocFragment_exit },
 	{ NULL } // sentinel
 };
 
-// Other
-static PypDataBuffer* pypCurrentDataBuffer = NULL;
-static PypModuleExecutionInfo* pypCurrentExecutionInfo = NULL;
+// Template methods
+PyDoc_STRVAR(pypTemplateTypeName, "pyp.Template");
+PyDoc_STRVAR(pypDocTemplate, "Compiled template created by pyp.compile(); each render runs in its own copy of the shared globals, with the keyword arguments added");
+
+PyDoc_STRVAR(pypDocTemplate_render, "Render the template with the keyword arguments as names; returns the output as bytes");
+static PyObject* pypTemplate_render(PyObject* self, PyObject* args, PyObject* keywords);
+
+PyDoc_STRVAR(pypDocTemplate_render_into, "Render the template with the keyword arguments as names, adding the output to the current output");
+static PyObject* pypTemplate_render_into(PyObject* self, PyObject* args, PyObject* keywords);
+
+static void pypTemplate_dealloc(PyObject* self);
+
+static PyMethodDef templateMethods[] = {
+    { "render", (PyCFunction) pypTemplate_render , METH_VARARGS | METH_KEYWORDS , pypDocTemplate_render },
+    { "render_into", (PyCFunction) pypTemplate_render_into , METH_VARARGS | METH_KEYWORDS , pypDocTemplate_render_into },
+	{ NULL } // sentinel
+};
 
 // More methods
+static PypBool pypModuleStateInit(PyObject* module);
+static PypModuleContext* pypModuleContextGetActive(PyObject* module);
+static PypBool pypContextAcquire(PypContextObject* context);
+static void pypContextRelease(PypContextObject* context);
+
+static void pypCapturePop(PypCaptureObject* capture);
+static void pypCapturesTagEnd(PypModuleExecutionInfo* executionInfo);
+static void pypCapturesClose(PypModuleExecutionInfo* executionInfo);
+
+static PypBool pypFragmentBegin(PypFragmentObject* fragment);
+static PypBool pypFragmentEnd(PypFragmentObject* fragment, PypBool raised);
+
+static PypBool pypTemplateSegmentAdd(PypTemplateObject* template, PypTemplateSegment** segment);
+static PyObject* pypTemplateCompile(PyObject* module, PypModuleExecutionInfo* currentExecutionInfo, FILE* inputStream, const unicode_char* filename, PypBool fromFile);
+static PypReadStatus pypTemplateCompileTag(PypModuleExecutionInfo* executionInfo, const PypStreamLocation* streamLocation, const char* sourceCode, PypBool expression, PypDataBuffer** outputDataBuffer);
+static PypBool pypTemplateSegmentsBuild(PypTemplateObject* template, PypDataBuffer* dataBuffer);
+static PypBool pypTemplateRender(PypTemplateObject* template, PyObject* args, PyObject* keywords, PypDataBuffer* target);
+
+static PypBool pypIncludeResolve(PypModuleExecutionInfo* executionInfo, PyObject* object, unicode_char** filename);
+static PypReadStatus pypIncludeRender(PypModuleExecutionInfo* executionInfo, const unicode_char* filename, PypDataBuffer* outputDataBuffer);
+static PyObject* pypIncludeErrorType(PypReadStatus status, const char** message);
+static PypBool pypGlobalsOverride(PyObject* globalsDict, PyObject* overrides, PyObject** previous);
+static void pypGlobalsRestore(PyObject* globalsDict, PyObject* previous);
+static size_t pypIncludeParallelWorkerCount(Py_ssize_t jobs, size_t count);
+#ifdef PYP_ASYNC_SUPPORTED
+static PyObject* pypAsyncEventLoopGet();
+static void pypAsyncEventLoopClose();
+static PyObject* pypAsyncRunCoroutine(PyObject* coroutine);
+static void pypAsyncRunThreadMain(void* data);
+static void pypAsyncIncludeThreadMain(void* data);
+static void pypAsyncIncludesFinish(PypModuleContext* context);
+static PyObject* pypAsyncFutureComplete(PyObject* self, PyObject* args);
+static PyThreadState* pypAsyncThreadStateCreate();
+static void pypAsyncThreadStateDelete(PyThreadState* threadState);
+static void pypAsyncThreadExit(PyThreadState* threadState);
+
+static PyMethodDef pypAsyncFutureCompleteMethod = { "_complete", (PyCFunction) pypAsyncFutureComplete , METH_VARARGS , NULL };
+#endif
+#ifndef _WIN32
+static void pypIncludeParallelFork(PypModuleExecutionInfo* executionInfo, const unicode_char** filenames, PyObject* globalsList, size_t count, size_t workerCount, PypDataBuffer** buffers, PypReadStatus* statuses, PypIncludeState* states);
+static void pypIncludeParallelWorkerMain(PypModuleExecutionInfo* executionInfo, const unicode_char** filenames, PyObject* globalsList, size_t count, size_t workerCount, size_t workerId, int resultFd);
+static PypBool pypIncludeParallelDependenciesRead(int fd, size_t length, PypDependencies* dependencies);
+static void pypPythonStreamsFlush();
+#endif
+
 static void pypModuleExceptionHandlingDeinit(PypPythonState* pyState);
 static PypModuleSetupStatus pypModuleExceptionHandlingInit(PypPythonState* pyState);
 static PypBool pypPythonExceptionDisplay(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo);
 
+static void pypModuleErrorLogAdd(PypModuleExecutionInfo* executionInfo, PypModuleErrorType type, char* name, char* message, char* traceback, PypSize line);
+static void pypModuleErrorLogAddException(PypModuleExecutionInfo* executionInfo, PyObject* exception, PyObject* value, PyObject* traceback, PyObject* tracebackText);
+
 static PypBool pypCharIsWhitespaceNotNewline(PypChar c);
 static PyObject* pypCompileCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, const PypStreamLocation* streamLocation, const char* sourceCode, PypBool isEval);
-static PypReadStatus pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyObject* code, PypBool outputResult);
+static PypReadStatus pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyObject* code, PyObject* globalsDict, PypBool outputResult);
 
 static PypBool pypStringObjectSetup(PyObject* object, const char* encoding, const char* encodingErrorMode, PyObject** newObject, char** buffer, Py_ssize_t* bufferLength);
 static PypBool pypStringObjectExtendStream(FILE* stream, PyObject* object, const char* encoding, const char* encodingErrorMode);
 static PypBool pypStringObjectExtendDataBuffer(PypDataBuffer* dataBuffer, PyObject* object, const char* encoding, const char* encodingErrorMode);
+static PypBool pypIteratorExtendDataBuffer(PypDataBuffer* dataBuffer, PyObject* iterator, const char* encoding, const char* encodingErrorMode);
+static PypBool pypIteratorWriteThrough(PypDataBuffer* dataBuffer);
+
+static PypBool pypGcCall(const char* methodName);
+static PypBool pypGcRenderDisable(PypPythonState* pyState);
+#ifdef PYP_GC_CALLBACKS_SUPPORTED
+static PyObject* pypGcCallback(PyObject* self, PyObject* args);
 
-static void pypModuleIncludeFunctionsDeinit(PypPythonState* pyState);
-static PypModuleSetupStatus pypModuleIncludeFunctionsInit(PypPythonState* pyState);
-static PypBool pypPathAbsolute(PypPythonState* pyState, PyObject* object, unicode_char** buffer, size_t* bufferLength);
-static PypBool pypPathCurrentDirectoryGet(PypPythonState* pyState, unicode_char** path, size_t* pathLength);
-static PypBool pypPathCurrentDirectorySet(PypPythonState* pyState, const unicode_char* path);
+static PyMethodDef pypGcCallbackMethod = { "_gc_callback", (PyCFunction) pypGcCallback , METH_VARARGS , NULL };
+#endif
+
+#ifdef PYP_MEMOIZE_SUPPORTED
+static void pypModuleMemoizeDeinit(PypPythonState* pyState);
+static PypBool pypMemoizeFetch(PypPythonState* pyState, PyObject* key, PyObject** entry, PypDataBuffer* output);
+static void pypMemoizeStore(PypPythonState* pyState, PyObject* key, PyObject* code, PyObject* entry, const PypDataBuffer* output);
+static PyObject* pypMemoizeResolve(PypPythonState* pyState, PyObject* chains);
+static PypBool pypMemoizeValueImmutable(PyObject* value);
+static PypBool pypMemoizeValueSame(PyObject* value1, PyObject* value2);
+#endif
 
 static PypReadStatus pypDataBufferModifyExecute(PypDataBuffer* input, PypDataBuffer** outputDataBuffer, const PypStreamLocation* streamLocation, void* data, PypBool expression);
 
@@ -73,6 +416,129 @@ static PypModuleState pypModuleState;
 #define GETSTATE(module) (&pypModuleState)
 #endif
 
+// Separates sys.path entries, as in PYTHONPATH
+#ifdef _WIN32
+#define PYP_MODULE_PATH_SEPARATOR ';'
+#else
+#define PYP_MODULE_PATH_SEPARATOR ':'
+#endif
+
+// A tag's iterator output is written straight to the output stream once this much of it is buffered
+#define PYP_MODULE_WRITE_THROUGH_SIZE (64 * 1024)
+
+// Current template context; thread-local, so that several threads can render at once
+static THREAD_LOCAL PypModuleContext pypModuleContext = { NULL, NULL, NULL };
+
+#ifdef PYP_GC_CALLBACKS_SUPPORTED
+// When the collection running on the current thread started
+static THREAD_LOCAL PypStatsValue pypGcCollectionStart = 0;
+#endif
+
+#ifdef PYP_ASYNC_SUPPORTED
+// Event loop owned by pyp for the current thread, created when first needed
+static THREAD_LOCAL PyObject* pypAsyncEventLoop = NULL;
+#endif
+
+
+
+// Context type
+#if PY_MAJOR_VERSION >= 3
+static PyType_Slot contextTypeSlots[] = {
+	{ Py_tp_dealloc, (void*) pypContext_dealloc },
+	{ Py_tp_methods, (void*) contextMethods },
+	{ Py_tp_doc, (void*) pypDocContext },
+	{ 0, NULL } // sentinel
+};
+
+static PyType_Spec contextTypeSpec = {
+	pypContextTypeName, // name
+	sizeof(PypContextObject), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT, // flags
+	contextTypeSlots // slots
+};
+
+static PyType_Slot captureTypeSlots[] = {
+	{ Py_tp_dealloc, (void*) pypCapture_dealloc },
+	{ Py_tp_methods, (void*) captureMethods },
+	{ Py_tp_doc, (void*) pypDocCapture },
+	{ 0, NULL } // sentinel
+};
+
+static PyType_Spec captureTypeSpec = {
+	pypCaptureTypeName, // name
+	sizeof(PypCaptureObject), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT, // flags
+	captureTypeSlots // slots
+};
+
+static PyType_Slot outputTypeSlots[] = {
+	{ Py_tp_dealloc, (void*) pypOutput_dealloc },
+	{ Py_tp_methods, (void*) outputMethods },
+	{ Py_tp_doc, (void*) pypDocOutput },
+	{ 0, NULL } // sentinel
+};
+
+static PyType_Spec outputTypeSpec = {
+	pypOutputTypeName, // name
+	sizeof(PypOutputObject), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT, // flags
+	outputTypeSlots // slots
+};
+
+static PyType_Slot fragmentTypeSlots[] = {
+	{ Py_tp_dealloc, (void*) pypFragment_dealloc },
+	{ Py_tp_methods, (void*) fragmentMethods },
+	{ Py_tp_doc, (void*) pypDocFragment },
+	{ 0, NULL } // sentinel
+};
+
+static PyType_Spec fragmentTypeSpec = {
+	pypFragmentTypeName, // name
+	sizeof(PypFragmentObject), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT, // flags
+	fragmentTypeSlots // slots
+};
+
+static PyType_Slot templateTypeSlots[] = {
+	{ Py_tp_dealloc, (void*) pypTemplate_dealloc },
+	{ Py_tp_methods, (void*) templateMethods },
+	{ Py_tp_doc, (void*) pypDocTemplate },
+	{ 0, NULL } // sentinel
+};
+
+static PyType_Spec templateTypeSpec = {
+	pypTemplateTypeName, // name
+	sizeof(PypTemplateObject), // basicsize
+	0, // itemsize
+	Py_TPFLAGS_DEFAULT, // flags
+	templateTypeSlots // slots
+};
+#else
+static PyTypeObject pypContextType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+static PyTypeObject pypCaptureType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+static PyTypeObject pypOutputType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+static PyTypeObject pypFragmentType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+static PyTypeObject pypTemplateType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+};
+#endif
+
 
 
 // Python 3 specific things
@@ -83,22 +549,57 @@ static int pyp_clear(PyObject* module);
 int
 pyp_traverse(PyObject* module, visitproc visit, void* arg) {
 	Py_VISIT(GETSTATE(module)->error);
+	Py_VISIT(GETSTATE(module)->contextType);
+	Py_VISIT(GETSTATE(module)->templateType);
+	Py_VISIT(GETSTATE(module)->captureType);
+	Py_VISIT(GETSTATE(module)->outputType);
+	Py_VISIT(GETSTATE(module)->fragmentType);
 	return 0;
 }
 
 int
 pyp_clear(PyObject* module) {
 	Py_CLEAR(GETSTATE(module)->error);
+	Py_CLEAR(GETSTATE(module)->contextType);
+	Py_CLEAR(GETSTATE(module)->templateType);
+	Py_CLEAR(GETSTATE(module)->captureType);
+	Py_CLEAR(GETSTATE(module)->outputType);
+	Py_CLEAR(GETSTATE(module)->fragmentType);
 	return 0;
 }
 
+#if PY_VERSION_HEX >= 0x03050000
+// Multi-phase init, so each (sub-)interpreter gets its own module instance and state
+static int pyp_exec(PyObject* module);
+
+static PyModuleDef_Slot moduleSlots[] = {
+	{ Py_mod_exec, (void*) pyp_exec },
+	#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+	{ Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED },
+	#endif
+	#ifdef Py_GIL_DISABLED
+	{ Py_mod_gil, Py_MOD_GIL_NOT_USED },
+	#endif
+	{ 0, NULL } // sentinel
+};
+
+int
+pyp_exec(PyObject* module) {
+	return pypModuleStateInit(module) ? 0 : -1;
+}
+#endif
+
 static struct PyModuleDef moduleDefinition = {
 	PyModuleDef_HEAD_INIT,
 	pypModuleName, // m_name
 	pypDocModule, // m_doc
 	sizeof(PypModuleState), // m_size
 	moduleMethods, // m_methods
+	#if PY_VERSION_HEX >= 0x03050000
+	moduleSlots, // m_slots
+	#else
 	NULL, // m_reload
+	#endif
 	pyp_traverse, // m_traverse
 	pyp_clear, // m_clear
 	NULL // m_free
@@ -108,21 +609,21 @@ static struct PyModuleDef moduleDefinition = {
 
 
 // Init function
+#if PY_VERSION_HEX >= 0x03050000
+PyMODINIT_FUNC
+pypModuleInit(void) {
+	return PyModuleDef_Init(&moduleDefinition);
+}
+#else
 #if PY_MAJOR_VERSION >= 3
 #define INIT_ERROR return NULL
-PyObject*
-pypModuleInit(void)
 #else
 #define INIT_ERROR return
-void
-pypModuleInit(void)
 #endif
+PyMODINIT_FUNC
+pypModuleInit(void)
 {
 	PyObject* module;
-	PypModuleState* state;
-	size_t moduleNameLength;
-	size_t exceptionNameLength;
-	char* exceptionName;
 
 	// Create
 	#if PY_MAJOR_VERSION >= 3
@@ -132,6 +633,34 @@ pypModuleInit(void)
 	#endif
 	if (module == NULL) INIT_ERROR; // error
 
+	// State
+	if (!pypModuleStateInit(module)) {
+		// Cleanup
+		#if PY_MAJOR_VERSION >= 3
+		Py_DECREF(module);
+		#endif
+		INIT_ERROR;
+	}
+
+	#if PY_MAJOR_VERSION < 3
+	// Import cStringIO
+	PycString_IMPORT;
+	#endif
+
+	// Done
+	#if PY_MAJOR_VERSION >= 3
+	return module;
+	#endif
+}
+#endif
+
+PypBool
+pypModuleStateInit(PyObject* module) {
+	PypModuleState* state;
+	size_t moduleNameLength;
+	size_t exceptionNameLength;
+	char* exceptionName;
+
 	// Setup the exception name
 	moduleNameLength = strlen(pypModuleName);
 	exceptionNameLength = strlen(pypModuleExceptionName);
@@ -143,24 +672,161 @@ pypModuleInit(void)
 
 	// Get the state and give it an error
 	state = GETSTATE(module);
+	state->contextType = NULL;
+	state->templateType = NULL;
+	state->captureType = NULL;
+	state->outputType = NULL;
+	state->fragmentType = NULL;
 	state->error = PyErr_NewExceptionWithDoc(exceptionName, NULL, NULL, NULL);
 	memFree(exceptionName);
 
-	if (state->error == NULL) {
-		// Cleanup
-		Py_DECREF(module);
-		INIT_ERROR;
+	if (state->error == NULL) return PYP_FALSE; // error
+
+	// Context type; instances are only created by pyp.context()
+	#if PY_MAJOR_VERSION >= 3
+	state->contextType = PyType_FromSpec(&contextTypeSpec);
+	#else
+	pypContextType.tp_name = pypContextTypeName;
+	pypContextType.tp_basicsize = sizeof(PypContextObject);
+	pypContextType.tp_dealloc = pypContext_dealloc;
+	pypContextType.tp_flags = Py_TPFLAGS_DEFAULT;
+	pypContextType.tp_doc = pypDocContext;
+	pypContextType.tp_methods = contextMethods;
+	if (PyType_Ready(&pypContextType) == 0) {
+		state->contextType = (PyObject*) &pypContextType;
+		Py_INCREF(state->contextType);
 	}
+	#endif
+	if (state->contextType == NULL) return PYP_FALSE; // error
+	((PyTypeObject*) state->contextType)->tp_new = NULL;
 
-	#if PY_MAJOR_VERSION < 3
-	// Import cStringIO
-	PycString_IMPORT;
+	Py_INCREF(state->contextType);
+	if (PyModule_AddObject(module, "Context", state->contextType) != 0) {
+		// Error
+		Py_DECREF(state->contextType);
+		return PYP_FALSE;
+	}
+
+	// Template type; instances are only created by pyp.compile()
+	#if PY_MAJOR_VERSION >= 3
+	state->templateType = PyType_FromSpec(&templateTypeSpec);
+	#else
+	pypTemplateType.tp_name = pypTemplateTypeName;
+	pypTemplateType.tp_basicsize = sizeof(PypTemplateObject);
+	pypTemplateType.tp_dealloc = pypTemplate_dealloc;
+	pypTemplateType.tp_flags = Py_TPFLAGS_DEFAULT;
+	pypTemplateType.tp_doc = pypDocTemplate;
+	pypTemplateType.tp_methods = templateMethods;
+	if (PyType_Ready(&pypTemplateType) == 0) {
+		state->templateType = (PyObject*) &pypTemplateType;
+		Py_INCREF(state->templateType);
+	}
 	#endif
+	if (state->templateType == NULL) return PYP_FALSE; // error
+	((PyTypeObject*) state->templateType)->tp_new = NULL;
 
-	// Done
+	Py_INCREF(state->templateType);
+	if (PyModule_AddObject(module, "Template", state->templateType) != 0) {
+		// Error
+		Py_DECREF(state->templateType);
+		return PYP_FALSE;
+	}
+
+	// Capture type; instances are only created by pyp.capture()
 	#if PY_MAJOR_VERSION >= 3
-	return module;
+	state->captureType = PyType_FromSpec(&captureTypeSpec);
+	#else
+	pypCaptureType.tp_name = pypCaptureTypeName;
+	pypCaptureType.tp_basicsize = sizeof(PypCaptureObject);
+	pypCaptureType.tp_dealloc = pypCapture_dealloc;
+	pypCaptureType.tp_flags = Py_TPFLAGS_DEFAULT;
+	pypCaptureType.tp_doc = pypDocCapture;
+	pypCaptureType.tp_methods = captureMethods;
+	if (PyType_Ready(&pypCaptureType) == 0) {
+		state->captureType = (PyObject*) &pypCaptureType;
+		Py_INCREF(state->captureType);
+	}
+	#endif
+	if (state->captureType == NULL) return PYP_FALSE; // error
+	((PyTypeObject*) state->captureType)->tp_new = NULL;
+
+	Py_INCREF(state->captureType);
+	if (PyModule_AddObject(module, "Capture", state->captureType) != 0) {
+		// Error
+		Py_DECREF(state->captureType);
+		return PYP_FALSE;
+	}
+
+	// Output type; instances are only created by pyp.output()
+	#if PY_MAJOR_VERSION >= 3
+	state->outputType = PyType_FromSpec(&outputTypeSpec);
+	#else
+	pypOutputType.tp_name = pypOutputTypeName;
+	pypOutputType.tp_basicsize = sizeof(PypOutputObject);
+	pypOutputType.tp_dealloc = pypOutput_dealloc;
+	pypOutputType.tp_flags = Py_TPFLAGS_DEFAULT;
+	pypOutputType.tp_doc = pypDocOutput;
+	pypOutputType.tp_methods = outputMethods;
+	if (PyType_Ready(&pypOutputType) == 0) {
+		state->outputType = (PyObject*) &pypOutputType;
+		Py_INCREF(state->outputType);
+	}
+	#endif
+	if (state->outputType == NULL) return PYP_FALSE; // error
+	((PyTypeObject*) state->outputType)->tp_new = NULL;
+
+	Py_INCREF(state->outputType);
+	if (PyModule_AddObject(module, "Output", state->outputType) != 0) {
+		// Error
+		Py_DECREF(state->outputType);
+		return PYP_FALSE;
+	}
+
+	// Fragment type; instances are only created by pyp.cache()
+	#if PY_MAJOR_VERSION >= 3
+	state->fragmentType = PyType_FromSpec(&fragmentTypeSpec);
+	#else
+	pypFragmentType.tp_name = pypFragmentTypeName;
+	pypFragmentType.tp_basicsize = sizeof(PypFragmentObject);
+	pypFragmentType.tp_dealloc = pypFragment_dealloc;
+	pypFragmentType.tp_flags = Py_TPFLAGS_DEFAULT;
+	pypFragmentType.tp_doc = pypDocFragment;
+	pypFragmentType.tp_methods = fragmentMethods;
+	if (PyType_Ready(&pypFragmentType) == 0) {
+		state->fragmentType = (PyObject*) &pypFragmentType;
+		Py_INCREF(state->fragmentType);
+	}
 	#endif
+	if (state->fragmentType == NULL) return PYP_FALSE; // error
+	((PyTypeObject*) state->fragmentType)->tp_new = NULL;
+
+	Py_INCREF(state->fragmentType);
+	if (PyModule_AddObject(module, "Fragment", state->fragmentType) != 0) {
+		// Error
+		Py_DECREF(state->fragmentType);
+		return PYP_FALSE;
+	}
+
+	// Done
+	return PYP_TRUE;
+}
+
+
+
+// Current context
+PypModuleContext*
+pypModuleContextGetActive(PyObject* module) {
+	// Vars
+	PypModuleState* state;
+
+	// Must be called from inside a template, or from a thread that entered a context
+	if (pypModuleContext.dataBuffer == NULL || pypModuleContext.executionInfo == NULL) {
+		state = GETSTATE(module);
+		PyErr_SetString(state->error != NULL ? state->error : PyExc_RuntimeError, "No template is currently being rendered");
+		return NULL;
+	}
+
+	return &pypModuleContext;
 }
 
 
@@ -170,14 +836,15 @@ PyObject*
 pyp_include(PyObject* self, PyObject* args) {
 	// Vars
 	PyObject* object;
+	PyObject* errorType;
+	const char* errorMessage;
 	unicode_char* filename;
-	size_t filenameLength;
-	FILE* inputStream;
-	PypReadStatus rs = PYP_READ_OKAY;
+	PypDataBuffer* outputDataBuffer;
+	PypReadStatus rs;
+	PypModuleContext* context;
 
-	// Assertions
-	assert(pypCurrentDataBuffer != NULL);
-	assert(pypCurrentExecutionInfo != NULL);
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
 
 	// Recursion start
 	if (Py_EnterRecursiveCall(" in include")) {
@@ -187,73 +854,27 @@ pyp_include(PyObject* self, PyObject* args) {
 	}
 
 	// Get the file name
-	if (
-		!PyArg_UnpackTuple(args, "include", 1, 1, &object) ||
-		!pypPathAbsolute(pypCurrentExecutionInfo->pythonState, object, &filename, &filenameLength)
-	) {
+	if (!PyArg_UnpackTuple(args, "include", 1, 1, &object)) {
 		// Error
 		PyErr_BadArgument();
 		Py_LeaveRecursiveCall();
 		return NULL;
 	}
+	if (!pypIncludeResolve(context->executionInfo, object, &filename)) {
+		// Error
+		Py_LeaveRecursiveCall();
+		return NULL;
+	}
 
-	// Open file
-	if (fileOpenUnicode(filename, "rb", &inputStream) == FILE_OPEN_OKAY) {
-		// Setup execution info
-		PypModuleExecutionInfo exeInfo;
-		PypDataBuffer* outputDataBuffer = NULL;
-
-		if (
-			(outputDataBuffer = pypDataBufferCreate()) != NULL &&
-			pypModuleExecutionInfoCreate(
-				&exeInfo,
-				pypCurrentExecutionInfo->readSettings,
-				pypCurrentExecutionInfo->piMain,
-				pypCurrentExecutionInfo->piCodeBlock,
-				pypCurrentExecutionInfo->piCodeExpression,
-				pypCurrentExecutionInfo->optimizedTags,
-				inputStream,
-				pypCurrentExecutionInfo->outputStream,
-				pypCurrentExecutionInfo->errorStream,
-				outputDataBuffer,
-				filename,
-				pypCurrentExecutionInfo->encoding,
-				pypCurrentExecutionInfo->encodingErrorMode,
-				pypCurrentExecutionInfo->pythonState
-			) != NULL
-		) {
-			// If necessary: https://docs.python.org/2.7/c-api/reflection.html
-			rs = pypIncludeFromExecutionInfo(&exeInfo);
-
-			// Delete execution info
-			pypModuleExecutionInfoClean(&exeInfo);
-
-			// Output buffer to previous buffer
-			assert(pypCurrentDataBuffer != outputDataBuffer);
-			pypDataBufferExtendWithDataBufferAndDelete(pypCurrentDataBuffer, outputDataBuffer);
-		}
-		else if (outputDataBuffer != NULL) {
-			// Delete
-			pypDataBufferDelete(outputDataBuffer);
-		}
+	// Render into a new buffer, then output it to the current buffer
+	if ((outputDataBuffer = pypDataBufferCreate()) == NULL) {
+		rs = PYP_READ_ERROR_MEMORY;
 	}
 	else {
-		// Exception
-		PyErr_SetString(
-			#if PY_MAJOR_VERSION >= 3
-			PyExc_FileNotFoundError,
-			#else
-			PyExc_IOError,
-			#endif
-			"Error opening include file"
-		);
-
-		// Clean
-		memFree(filename);
+		rs = pypIncludeRender(context->executionInfo, filename, outputDataBuffer);
 
-		// Recursion complete
-		Py_LeaveRecursiveCall();
-		return NULL;
+		assert(context->dataBuffer != outputDataBuffer);
+		pypDataBufferExtendWithDataBufferAndDelete(context->dataBuffer, outputDataBuffer);
 	}
 
 	// Clean
@@ -264,383 +885,3669 @@ pyp_include(PyObject* self, PyObject* args) {
 
 	// Return
 	if (rs != PYP_READ_OKAY) {
-		// Display error
-		switch (rs) {
-			case PYP_READ_ERROR_MEMORY:
-			{
-				// Exception
-				PyErr_SetString(
-					PyExc_MemoryError,
-					"Memory error"
-				);
-			}
-			break;
-			case PYP_READ_ERROR_OPEN:
-			{
-				// Exception
-				PyErr_SetString(
-					#if PY_MAJOR_VERSION >= 3
-					PyExc_FileNotFoundError,
-					#else
-					PyExc_IOError,
-					#endif
-					"File open error"
-				);
-			}
-			break;
-			case PYP_READ_ERROR_READ:
-			{
-				// Exception
-				PyErr_SetString(
-					#if PY_MAJOR_VERSION >= 3
-					PyExc_PermissionError,
-					#else
-					PyExc_IOError,
-					#endif
-					"Read error"
-				);
-			}
-			break;
-			case PYP_READ_ERROR_WRITE:
-			{
-				// Exception
-				PyErr_SetString(
-					#if PY_MAJOR_VERSION >= 3
-					PyExc_PermissionError,
-					#else
-					PyExc_IOError,
-					#endif
-					"Write error"
-				);
-			}
-			break;
-			case PYP_READ_ERROR_DIRECTORY:
-			{
-				// Exception
-				PyErr_SetString(
-					#if PY_MAJOR_VERSION >= 3
-					PyExc_FileNotFoundError,
-					#else
-					PyExc_IOError,
-					#endif
-					"Directory error"
-				);
-			}
-			break;
-			default:
-			{
-				// Exception
-				PyErr_SetString(
-					PyExc_Exception,
-					"Error"
-				);
-			}
-			break;
-		}
+		// Error
+		errorType = pypIncludeErrorType(rs, &errorMessage);
+		PyErr_SetString(errorType, errorMessage);
+		return NULL;
+	}
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+PyObject*
+pyp_include_parallel(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "paths", "globals", "jobs", NULL };
+	PyObject* pathsObject;
+	PyObject* globalsObject = Py_None;
+	PyObject* paths = NULL;
+	PyObject* globalsList = NULL;
+	PyObject* overrides;
+	PyObject* previous;
+	PyObject* results = NULL;
+	PyObject* result;
+	PyObject* errorType;
+	const char* errorMessage;
+	Py_ssize_t jobs = 0;
+	unicode_char** filenames = NULL;
+	PypDataBuffer** buffers = NULL;
+	PypReadStatus* statuses = NULL;
+	PypIncludeState* states = NULL;
+	PypModuleContext* context;
+	size_t count;
+	size_t workerCount;
+	size_t i;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+
+	// Arguments
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "O|On:include_parallel", keywordNames, &pathsObject, &globalsObject, &jobs)) return NULL; // error
+	if ((paths = PySequence_Fast(pathsObject, "paths must be a sequence")) == NULL) return NULL; // error
+	count = (size_t) PySequence_Fast_GET_SIZE(paths);
+
+	if (globalsObject != Py_None) {
+		if ((globalsList = PySequence_Fast(globalsObject, "globals must be a sequence")) == NULL) goto cleanup; // error
+		if ((size_t) PySequence_Fast_GET_SIZE(globalsList) != count) {
+			PyErr_SetString(PyExc_ValueError, "globals must have one entry for each path");
+			goto cleanup;
+		}
+		for (i = 0; i < count; ++i) {
+			overrides = PySequence_Fast_GET_ITEM(globalsList, i);
+			if (overrides != Py_None && !PyDict_Check(overrides)) {
+				PyErr_SetString(PyExc_TypeError, "globals entries must be dicts or None");
+				goto cleanup;
+			}
+		}
+	}
+
+	// Setup
+	if (
+		(results = PyList_New(count)) == NULL ||
+		(count > 0 && (
+			(filenames = memAllocArray(unicode_char*, count)) == NULL ||
+			(buffers = memAllocArray(PypDataBuffer*, count)) == NULL ||
+			(statuses = memAllocArray(PypReadStatus, count)) == NULL ||
+			(states = memAllocArray(PypIncludeState, count)) == NULL
+		))
+	) {
+		// Error
+		if (results != NULL) PyErr_NoMemory();
+		goto cleanup;
+	}
+	for (i = 0; i < count; ++i) {
+		filenames[i] = NULL;
+		buffers[i] = NULL;
+		statuses[i] = PYP_READ_OKAY;
+		states[i] = PYP_INCLUDE_PENDING;
+	}
+
+	// File names are resolved before any rendering, so bad arguments fail the whole call
+	for (i = 0; i < count; ++i) {
+		if (!pypIncludeResolve(context->executionInfo, PySequence_Fast_GET_ITEM(paths, i), &filenames[i])) goto cleanup; // error
+		if ((buffers[i] = pypDataBufferCreate()) == NULL) {
+			// Error
+			PyErr_NoMemory();
+			goto cleanup;
+		}
+	}
+
+	// Worker processes; sub-interpreters don't allow forking
+	workerCount = pypIncludeParallelWorkerCount(jobs, count);
+	#ifndef _WIN32
+	if (workerCount > 1 && context->executionInfo->pythonState->interpreterThreadState == NULL) {
+		pypIncludeParallelFork(context->executionInfo, (const unicode_char**) filenames, globalsList, count, workerCount, buffers, statuses, states);
+	}
+	#endif
+
+	// Anything not rendered by a worker is rendered here, in order
+	if (Py_EnterRecursiveCall(" in include_parallel")) {
+		// Recursion limit
+		Py_LeaveRecursiveCall();
+		goto cleanup;
+	}
+	for (i = 0; i < count; ++i) {
+		if (states[i] != PYP_INCLUDE_PENDING) continue;
+
+		overrides = (globalsList == NULL) ? Py_None : PySequence_Fast_GET_ITEM(globalsList, i);
+		if (overrides != Py_None && !pypGlobalsOverride(context->executionInfo->pythonState->globalsDict, overrides, &previous)) {
+			// Error
+			PyErr_Clear();
+			statuses[i] = PYP_READ_ERROR;
+		}
+		else {
+			statuses[i] = pypIncludeRender(context->executionInfo, filenames[i], buffers[i]);
+			if (overrides != Py_None) pypGlobalsRestore(context->executionInfo->pythonState->globalsDict, previous);
+		}
+		states[i] = PYP_INCLUDE_DONE;
+	}
+	Py_LeaveRecursiveCall();
+
+	// Output in request order, and report errors for each include
+	for (i = 0; i < count; ++i) {
+		pypDataBufferExtendWithDataBufferAndDelete(context->dataBuffer, buffers[i]);
+		buffers[i] = NULL;
+
+		if (states[i] == PYP_INCLUDE_LOST) {
+			result = PyObject_CallFunction(PyExc_RuntimeError, "s", "Include worker terminated unexpectedly");
+			if (result == NULL) goto cleanup; // error
+		}
+		else if (statuses[i] == PYP_READ_OKAY) {
+			Py_INCREF(Py_None);
+			result = Py_None;
+		}
+		else {
+			errorType = pypIncludeErrorType(statuses[i], &errorMessage);
+			if ((result = PyObject_CallFunction(errorType, "s", errorMessage)) == NULL) goto cleanup; // error
+		}
+		PyList_SET_ITEM(results, i, result);
+	}
+
+	// Done
+	Py_DECREF(paths);
+	if (globalsList != NULL) Py_DECREF(globalsList);
+	for (i = 0; i < count; ++i) memFree(filenames[i]);
+	if (count > 0) {
+		memFree(filenames);
+		memFree(buffers);
+		memFree(statuses);
+		memFree(states);
+	}
+	return results;
+
+
+	// Cleanup
+	cleanup:
+	Py_DECREF(paths);
+	if (globalsList != NULL) Py_DECREF(globalsList);
+	if (results != NULL) Py_DECREF(results);
+	for (i = 0; i < count; ++i) {
+		if (filenames != NULL && filenames[i] != NULL) memFree(filenames[i]);
+		if (buffers != NULL && buffers[i] != NULL) pypDataBufferDelete(buffers[i]);
+	}
+	if (filenames != NULL) memFree(filenames);
+	if (buffers != NULL) memFree(buffers);
+	if (statuses != NULL) memFree(statuses);
+	if (states != NULL) memFree(states);
+	return NULL;
+}
+
+#ifdef PYP_ASYNC_SUPPORTED
+PyObject*
+pyp_include_async(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* object;
+	PyObject* loop;
+	PypModuleContext* context;
+	PypPythonState* pyState;
+	PypAsyncInclude* include;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+	pyState = context->executionInfo->pythonState;
+
+	// Get the file name
+	if (!PyArg_UnpackTuple(args, "include_async", 1, 1, &object)) {
+		// Error
+		PyErr_BadArgument();
+		return NULL;
+	}
+
+	// Lazily created state can't be set up safely once other threads use it, so it is created now
+	if (
+		pyState->exceptionHandlerCompiledCode == NULL && pypModuleExceptionHandlingInit(pyState) != PYP_MODULE_SETUP_STATUS_OKAY
+	) {
+		// Error
+		return NULL;
+	}
+
+	// The future is completed on the loop of the calling thread
+	if ((loop = pypAsyncEventLoopGet()) == NULL) return NULL; // error
+
+	// Create
+	if ((include = memAlloc(PypAsyncInclude)) == NULL) return PyErr_NoMemory(); // error
+	include->threadState = NULL;
+	include->executionInfo = *context->executionInfo;
+	include->executionInfo.changeWorkingDirectory = PYP_FALSE;
+	include->executionInfo.captures = NULL;
+	include->executionInfo.captureOutput = NULL;
+	include->executionInfo.captureOutputPending = PYP_FALSE;
+	include->executionInfo.tagDataBuffer = NULL;
+	include->executionInfo.tagLine = 0;
+	include->executionInfo.tagWriteThrough = PYP_FALSE;
+	include->targetDataBuffer = context->dataBuffer;
+	include->status = PYP_READ_OKAY;
+	include->loop = loop;
+	include->future = NULL;
+	include->dataBuffer = NULL;
+	include->placeholder = NULL;
+
+	if (!pypIncludeResolve(context->executionInfo, object, &include->filename)) {
+		// Error
+		memFree(include);
+		return NULL;
+	}
+
+	if (
+		(include->future = PyObject_CallMethod(loop, "create_future", NULL)) == NULL ||
+		(include->dataBuffer = pypDataBufferCreate()) == NULL ||
+		(include->threadState = pypAsyncThreadStateCreate()) == NULL ||
+		(include->placeholder = pypDataBufferExtendPlaceholder(include->targetDataBuffer)) == NULL
+	) {
+		// Error
+		if (include->threadState != NULL) pypAsyncThreadStateDelete(include->threadState);
+		if (include->dataBuffer != NULL) pypDataBufferDelete(include->dataBuffer);
+		if (include->future != NULL) {
+			Py_DECREF(include->future);
+			if (!PyErr_Occurred()) PyErr_NoMemory();
+		}
+		memFree(include->filename);
+		memFree(include);
+		return NULL;
+	}
+	Py_INCREF(loop);
+
+	// Start
+	if (threadCreate(&include->thread, pypAsyncIncludeThreadMain, include) != THREAD_OKAY) {
+		// Error; the placeholder is left empty
+		pypDataBufferPlaceholderFillAndDelete(include->targetDataBuffer, include->placeholder, include->dataBuffer);
+		pypAsyncThreadStateDelete(include->threadState);
+		Py_DECREF(include->future);
+		Py_DECREF(loop);
+		memFree(include->filename);
+		memFree(include);
+		PyErr_SetString(PyExc_RuntimeError, "Could not start a thread for the include");
+		return NULL;
+	}
+
+	// Completed when the current tag or context ends
+	include->nextSibling = context->asyncIncludes;
+	context->asyncIncludes = include;
+
+	// Done
+	Py_INCREF(include->future);
+	return include->future;
+}
+#endif
+
+PyObject*
+pyp_write(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* object;
+	PypModuleContext* context;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+
+	// Get and modift
+	if (!PyArg_UnpackTuple(args, "write", 1, 1, &object)) {
+		// Error
+		PyErr_BadArgument();
+		return NULL;
+	}
+	if (PyIter_Check(object)) {
+		// Consumed as it's produced
+		if (!pypIteratorExtendDataBuffer(context->dataBuffer, object, context->executionInfo->encoding, context->executionInfo->encodingErrorMode)) return NULL; // error
+	}
+	else if (!pypStringObjectExtendDataBuffer(context->dataBuffer, object, context->executionInfo->encoding, context->executionInfo->encodingErrorMode)) {
+		// Error
+		PyErr_BadArgument();
+		return NULL;
+	}
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+PyObject*
+pyp_depend(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* object;
+	unicode_char* filename;
+	PypModuleContext* context;
+	PypBool okay;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+
+	// Get the file name; it's resolved the same way as an include
+	if (!PyArg_UnpackTuple(args, "depend", 1, 1, &object)) {
+		// Error
+		PyErr_BadArgument();
+		return NULL;
+	}
+	if (!pypIncludeResolve(context->executionInfo, object, &filename)) return NULL; // error
+
+	// Record, if anything is recording
+	okay = (context->executionInfo->dependencies == NULL || pypDependenciesAdd(context->executionInfo->dependencies, filename));
+	memFree(filename);
+	if (!okay) return PyErr_NoMemory(); // error
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+PyObject*
+pyp_slot(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* nameObject;
+	PyObject* newObject = NULL;
+	PypModuleContext* context;
+	PypSlotsStatus status;
+	char* name;
+	Py_ssize_t nameLength;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+	if (context->executionInfo->slots == NULL) {
+		// Error
+		PyErr_SetString(PyExc_RuntimeError, "Slots can't be used here");
+		return NULL;
+	}
+
+	// Name
+	if (!PyArg_UnpackTuple(args, "slot", 1, 1, &nameObject)) return NULL; // error
+	if (!pypStringObjectSetup(nameObject, "utf-8", "strict", &newObject, &name, &nameLength)) {
+		// Error
+		Py_XDECREF(newObject);
+		if (PyErr_Occurred() == NULL) PyErr_SetString(PyExc_TypeError, "Slot names must be strings");
+		return NULL;
+	}
+
+	// Reserve
+	status = pypSlotsReserve(context->executionInfo->slots, context->dataBuffer, name, (PypSize) nameLength);
+	Py_XDECREF(newObject);
+	if (status == PYP_SLOTS_ERROR_EXISTS) {
+		// Error
+		PyErr_SetString(PyExc_ValueError, "A slot with that name was already reserved");
+		return NULL;
+	}
+	if (status != PYP_SLOTS_OKAY) return PyErr_NoMemory(); // error
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+PyObject*
+pyp_fill(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* nameObject;
+	PyObject* object;
+	PyObject* newObject = NULL;
+	PypModuleContext* context;
+	PypDataBuffer* content;
+	PypSlotsStatus status;
+	PypBool okay;
+	char* name;
+	Py_ssize_t nameLength;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+	if (context->executionInfo->slots == NULL) {
+		// Error
+		PyErr_SetString(PyExc_RuntimeError, "Slots can't be used here");
+		return NULL;
+	}
 
+	// Content, encoded as the output is
+	if (!PyArg_UnpackTuple(args, "fill", 2, 2, &nameObject, &object)) return NULL; // error
+	if ((content = pypDataBufferCreate()) == NULL) return PyErr_NoMemory(); // error
+	if (PyIter_Check(object)) {
+		okay = pypIteratorExtendDataBuffer(content, object, context->executionInfo->encoding, context->executionInfo->encodingErrorMode);
+	}
+	else if (!(okay = pypStringObjectExtendDataBuffer(content, object, context->executionInfo->encoding, context->executionInfo->encodingErrorMode))) {
+		PyErr_BadArgument();
+	}
+	if (!okay) {
+		// Error
+		pypDataBufferDelete(content);
+		return NULL;
+	}
+
+	// Name
+	if (!pypStringObjectSetup(nameObject, "utf-8", "strict", &newObject, &name, &nameLength)) {
 		// Error
+		Py_XDECREF(newObject);
+		pypDataBufferDelete(content);
+		if (PyErr_Occurred() == NULL) PyErr_SetString(PyExc_TypeError, "Slot names must be strings");
 		return NULL;
 	}
 
+	// Fill; output held back for it is written before this returns
+	status = pypSlotsFill(context->executionInfo->slots, name, (PypSize) nameLength, content);
+	Py_XDECREF(newObject);
+	switch (status) {
+		case PYP_SLOTS_OKAY:
+			break;
+		case PYP_SLOTS_ERROR_NOT_FOUND:
+			PyErr_SetObject(PyExc_KeyError, nameObject);
+			return NULL;
+		case PYP_SLOTS_ERROR_FILLED:
+			PyErr_SetString(PyExc_ValueError, "The slot was already filled");
+			return NULL;
+		case PYP_SLOTS_ERROR_WRITE:
+			PyErr_SetString(PyExc_IOError, "Error writing output");
+			return NULL;
+		default:
+			return PyErr_NoMemory();
+	}
+
 	// Done
 	Py_RETURN_NONE;
 }
 
-PyObject*
-pyp_write(PyObject* self, PyObject* args) {
-	// Vars
-	PyObject* object;
 
-	// Assertions
-	assert(pypCurrentDataBuffer != NULL);
-	assert(pypCurrentExecutionInfo != NULL);
+PyObject*
+pyp_context(PyObject* self, PyObject* unused) {
+	// Vars
+	PypModuleContext* context;
+	PypModuleExecutionInfo* currentExecutionInfo;
+	PypPythonState* pyState;
+	PypContextObject* object;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+	currentExecutionInfo = context->executionInfo;
+	pyState = currentExecutionInfo->pythonState;
+
+	// Lazily created state can't be set up safely once other threads use it, so it is created now
+	if (
+		pyState->exceptionHandlerCompiledCode == NULL && pypModuleExceptionHandlingInit(pyState) != PYP_MODULE_SETUP_STATUS_OKAY
+	) {
+		// Error
+		return NULL;
+	}
+
+	// Create
+	object = PyObject_New(PypContextObject, (PyTypeObject*) GETSTATE(self)->contextType);
+	if (object == NULL) return NULL; // error
+
+	object->dataBuffer = NULL;
+	object->executionInfo.inputFilename = NULL;
+	object->previousContext.dataBuffer = NULL;
+	object->previousContext.executionInfo = NULL;
+	object->previousContext.asyncIncludes = NULL;
+	object->active = PYP_FALSE;
+	threadMutexInit(&object->mutex);
+
+	// Execution info; the file name is kept so relative includes resolve as they would in the template
+	if (
+		(object->dataBuffer = pypDataBufferCreate()) == NULL ||
+		pypModuleExecutionInfoCreate(
+			&object->executionInfo,
+			currentExecutionInfo->readSettings,
+			currentExecutionInfo->piMain,
+			currentExecutionInfo->piCodeBlock,
+			currentExecutionInfo->piCodeExpression,
+			currentExecutionInfo->optimizedTags,
+			currentExecutionInfo->inputStream,
+			currentExecutionInfo->outputStream,
+			currentExecutionInfo->errorStream,
+			object->dataBuffer,
+			currentExecutionInfo->inputFilename,
+			currentExecutionInfo->encoding,
+			currentExecutionInfo->encodingErrorMode,
+			pyState
+		) == NULL
+	) {
+		// Error
+		object->executionInfo.inputFilename = NULL;
+		Py_DECREF(object);
+		return PyErr_NoMemory();
+	}
+
+	// Includes may happen on other threads, so they never change the working directory
+	object->executionInfo.changeWorkingDirectory = PYP_FALSE;
+	object->executionInfo.dependencies = currentExecutionInfo->dependencies;
+	object->executionInfo.includeLookups = currentExecutionInfo->includeLookups;
+	object->executionInfo.errorLog = currentExecutionInfo->errorLog;
+	object->executionInfo.slots = currentExecutionInfo->slots;
+	object->executionInfo.outputSync = currentExecutionInfo->outputSync;
+
+	// Done
+	return (PyObject*) object;
+}
+
+PyObject*
+pyp_capture(PyObject* self, PyObject* unused) {
+	// Vars
+	PypCaptureObject* object;
+
+	// Only inside a template
+	if (pypModuleContextGetActive(self) == NULL) return NULL; // error
+
+	// Create
+	object = PyObject_New(PypCaptureObject, (PyTypeObject*) GETSTATE(self)->captureType);
+	if (object == NULL) return NULL; // error
+
+	object->previousDataBuffer = NULL;
+	object->executionInfo = NULL;
+	object->outer = NULL;
+	object->spanning = PYP_FALSE;
+	object->active = PYP_FALSE;
+	if ((object->dataBuffer = pypDataBufferCreate()) == NULL) {
+		// Error
+		Py_DECREF(object);
+		return PyErr_NoMemory();
+	}
+
+	// Done
+	return (PyObject*) object;
+}
+
+PyObject*
+pyp_output(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "path", "only_if_changed", NULL };
+	PyObject* pathObject;
+	PypOutputObject* object;
+	unicode_char* filename;
+	int onlyIfChanged = 0;
+
+	// Only inside a template
+	if (pypModuleContextGetActive(self) == NULL) return NULL; // error
+
+	// Arguments; relative paths are relative to the working directory, as output files on the command line are
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "O|i:output", keywordNames, &pathObject, &onlyIfChanged)) return NULL; // error
+	if (!pypPathFromObject(pathObject, &filename)) {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "path must be a path");
+		return NULL;
+	}
+
+	// Create
+	object = PyObject_New(PypOutputObject, (PyTypeObject*) GETSTATE(self)->outputType);
+	if (object == NULL) {
+		// Error
+		memFree(filename);
+		return NULL;
+	}
+
+	object->filename = filename;
+	object->onlyIfChanged = (onlyIfChanged != 0);
+	object->output.stream = NULL;
+	object->dataBuffer = NULL;
+	object->previousDataBuffer = NULL;
+	object->active = PYP_FALSE;
+
+	// Done
+	return (PyObject*) object;
+}
+
+PyObject*
+pyp_cache(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "key", "deps", "render", NULL };
+	PyObject* keyObject;
+	PyObject* depsObject = Py_None;
+	PyObject* renderObject = Py_None;
+	PyObject* keyBytes = NULL;
+	PyObject* iterator = NULL;
+	PyObject* item;
+	PyObject* result = NULL;
+	PypModuleContext* context;
+	PypFragments* fragments;
+	PypFragmentObject* object = NULL;
+	unicode_char** filenames = NULL;
+	size_t filenameCount = 0;
+	size_t filenameCapacity = 0;
+	char* key;
+	Py_ssize_t keyLength;
+	PypBool okay = PYP_FALSE;
+	PypBool resolved;
+	size_t i;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+	fragments = context->executionInfo->pythonState->fragments;
+
+	// Arguments
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "O|OO:cache", keywordNames, &keyObject, &depsObject, &renderObject)) return NULL; // error
+	if (renderObject != Py_None && !PyCallable_Check(renderObject)) {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "render must be callable");
+		return NULL;
+	}
+	if (!pypStringObjectSetup(keyObject, "utf-8", "strict", &keyBytes, &key, &keyLength)) {
+		// Error
+		Py_XDECREF(keyBytes);
+		if (PyErr_Occurred() == NULL) PyErr_SetString(PyExc_TypeError, "Cache keys must be strings");
+		return NULL;
+	}
+
+	// Files the region depends on; resolved and recorded like pyp.depend, whether or not the region renders
+	if (depsObject != Py_None) {
+		if ((iterator = PyObject_GetIter(depsObject)) == NULL) goto cleanup; // error
+		while ((item = PyIter_Next(iterator)) != NULL) {
+			if (filenameCount == filenameCapacity) {
+				unicode_char** filenamesNew;
+				size_t capacityNew = (filenameCapacity == 0) ? 8 : filenameCapacity * 2;
+
+				filenamesNew = (filenames == NULL) ? memAllocArray(unicode_char*, capacityNew) : memReallocArray(filenames, unicode_char*, capacityNew);
+				if (filenamesNew == NULL) {
+					// Error
+					Py_DECREF(item);
+					PyErr_NoMemory();
+					goto cleanup;
+				}
+				filenames = filenamesNew;
+				filenameCapacity = capacityNew;
+			}
+
+			resolved = pypIncludeResolve(context->executionInfo, item, &filenames[filenameCount]);
+			Py_DECREF(item);
+			if (!resolved) goto cleanup; // error
+			++filenameCount;
+
+			if (context->executionInfo->dependencies != NULL && !pypDependenciesAdd(context->executionInfo->dependencies, filenames[filenameCount - 1])) {
+				// Error
+				PyErr_NoMemory();
+				goto cleanup;
+			}
+		}
+		if (PyErr_Occurred() != NULL) goto cleanup; // error
+	}
+
+	// Create
+	object = PyObject_New(PypFragmentObject, (PyTypeObject*) GETSTATE(self)->fragmentType);
+	if (object == NULL) goto cleanup; // error
+
+	object->hit = PYP_FALSE;
+	object->codeErrorCount = 0;
+	object->dataBuffer = NULL;
+	object->previousDataBuffer = NULL;
+	object->active = PYP_FALSE;
+
+	// Keyed now, so the files are stamped before the region reads them; a key which can't be made only means the region renders
+	object->fragments = (fragments != NULL && pypFragmentsDigest(key, (PypSize) keyLength, (const unicode_char* const*) filenames, filenameCount, object->digest)) ? fragments : NULL;
+
+	if (renderObject == Py_None) {
+		// Used as a context manager
+		result = (PyObject*) object;
+		object = NULL;
+		okay = PYP_TRUE;
+		goto cleanup;
+	}
+
+	// The region is a function call, so a hit skips its work entirely; what it returns is written like pyp.write
+	if (!pypFragmentBegin(object)) goto cleanup; // error
+	if (!object->hit) {
+		result = PyObject_CallObject(renderObject, NULL);
+		if (result != NULL && result != Py_None) {
+			if (PyIter_Check(result)) {
+				okay = pypIteratorExtendDataBuffer(pypModuleContext.dataBuffer, result, context->executionInfo->encoding, context->executionInfo->encodingErrorMode);
+			}
+			else if (!(okay = pypStringObjectExtendDataBuffer(pypModuleContext.dataBuffer, result, context->executionInfo->encoding, context->executionInfo->encodingErrorMode))) {
+				PyErr_SetString(PyExc_TypeError, "render must return None, a string, or an iterator of strings");
+			}
+			Py_DECREF(result);
+			result = okay ? Py_None : NULL;
+			if (okay) Py_INCREF(result);
+		}
+	}
+	else {
+		result = Py_None;
+		Py_INCREF(result);
+	}
+	okay = (pypFragmentEnd(object, (result == NULL)) && result != NULL);
+	if (!okay && result != NULL) {
+		Py_DECREF(result);
+		result = NULL;
+	}
+
+	// Done
+	cleanup:
+	if (object != NULL) Py_DECREF(object);
+	Py_XDECREF(iterator);
+	Py_XDECREF(keyBytes);
+	for (i = 0; i < filenameCount; ++i) memFree(filenames[i]);
+	if (filenames != NULL) memFree(filenames);
+	return okay ? result : NULL;
+}
+
+PyObject*
+pyp_gc_disable(PyObject* self, PyObject* unused) {
+	// Vars
+	PypModuleContext* context;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+
+	// Turned back on by pypModulePythonDeinit
+	if (!pypGcRenderDisable(context->executionInfo->pythonState)) return NULL; // error
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+PyObject*
+pyp_compile(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "path", "text", NULL };
+	PyObject* pathObject = NULL;
+	PyObject* textObject = NULL;
+	PyObject* textBytes = NULL;
+	PyObject* errorType;
+	const char* errorMessage;
+	char* textBuffer;
+	Py_ssize_t textBufferLength;
+	PypModuleContext* context;
+	PypModuleExecutionInfo* currentExecutionInfo;
+	PyObject* template = NULL;
+	unicode_char* filename = NULL;
+	FILE* inputStream = NULL;
+
+	// Context
+	if ((context = pypModuleContextGetActive(self)) == NULL) return NULL; // error
+	currentExecutionInfo = context->executionInfo;
+
+	// Either a file or the source itself
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "|OO:compile", keywordNames, &pathObject, &textObject)) return NULL; // error
+	if ((pathObject == NULL) == (textObject == NULL)) {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "compile() takes either a path or text");
+		return NULL;
+	}
+
+	if (pathObject != NULL) {
+		// Resolved and recorded like an include
+		if (!pypIncludeResolve(currentExecutionInfo, pathObject, &filename)) return NULL; // error
+		if (currentExecutionInfo->dependencies != NULL && !pypDependenciesAdd(currentExecutionInfo->dependencies, filename)) {
+			// Error
+			PyErr_NoMemory();
+			goto cleanup;
+		}
+		if (fileOpenUnicode(filename, "rb", &inputStream) != FILE_OPEN_OKAY) {
+			// Error
+			errorType = pypIncludeErrorType(PYP_READ_ERROR_OPEN, &errorMessage);
+			PyErr_SetString(errorType, errorMessage);
+			goto cleanup;
+		}
+	}
+	else {
+		// Encoded like the output, and read back from a temporary file; its includes are relative to the current template
+		if (!pypStringObjectSetup(textObject, currentExecutionInfo->encoding, currentExecutionInfo->encodingErrorMode, &textBytes, &textBuffer, &textBufferLength)) {
+			// Error
+			if (PyErr_Occurred() == NULL) PyErr_BadArgument();
+			goto cleanup;
+		}
+		if (
+			(inputStream = tmpfile()) == NULL ||
+			fwrite(textBuffer, sizeof(char), (size_t) textBufferLength, inputStream) != (size_t) textBufferLength ||
+			fseek(inputStream, 0, SEEK_SET) != 0
+		) {
+			// Error
+			errorType = pypIncludeErrorType(PYP_READ_ERROR_WRITE, &errorMessage);
+			PyErr_SetString(errorType, errorMessage);
+			goto cleanup;
+		}
+	}
+
+	// Compile
+	template = pypTemplateCompile(self, currentExecutionInfo, inputStream, (filename != NULL) ? filename : currentExecutionInfo->inputFilename, (pathObject != NULL));
+
+
+	// Cleanup
+	cleanup:
+	if (inputStream != NULL) fclose(inputStream);
+	if (textBytes != NULL) Py_DECREF(textBytes);
+	if (filename != NULL) memFree(filename);
+	return template;
+}
+
+
+
+// Context methods
+PypBool
+pypContextAcquire(PypContextObject* context) {
+	// Vars
+	PypBool acquired;
+
+	// Only the flag is locked, so the mutex is never held while python code runs
+	threadMutexLock(&context->mutex);
+	acquired = !context->active;
+	context->active = PYP_TRUE;
+	threadMutexUnlock(&context->mutex);
+
+	if (!acquired) PyErr_SetString(PyExc_RuntimeError, "Context is already in use");
+	return acquired;
+}
+
+void
+pypContextRelease(PypContextObject* context) {
+	threadMutexLock(&context->mutex);
+	context->active = PYP_FALSE;
+	threadMutexUnlock(&context->mutex);
+}
+
+PyObject*
+pypContext_enter(PyObject* self, PyObject* unused) {
+	// Vars
+	PypContextObject* context = (PypContextObject*) self;
+
+	// A context collects the output of one thread at a time
+	if (!pypContextAcquire(context)) return NULL; // error
+
+	// Switch
+	context->previousContext = pypModuleContext;
+	pypModuleContext.dataBuffer = context->dataBuffer;
+	pypModuleContext.executionInfo = &context->executionInfo;
+	pypModuleContext.asyncIncludes = NULL;
+
+	// Done
+	Py_INCREF(self);
+	return self;
+}
+
+PyObject*
+pypContext_exit(PyObject* self, PyObject* args) {
+	// Vars
+	PypContextObject* context = (PypContextObject*) self;
+
+	// Must be the current context of this thread
+	if (pypModuleContext.executionInfo != &context->executionInfo) {
+		PyErr_SetString(PyExc_RuntimeError, "Context is not active on this thread");
+		return NULL;
+	}
+
+	// Revert
+	#ifdef PYP_ASYNC_SUPPORTED
+	pypAsyncIncludesFinish(&pypModuleContext);
+	#endif
+	pypCapturesClose(&context->executionInfo);
+	pypModuleContext = context->previousContext;
+	pypContextRelease(context);
+
+	#ifdef PYP_ASYNC_SUPPORTED
+	// The thread's event loop is closed once it leaves its outermost context
+	if (pypModuleContext.executionInfo == NULL) pypAsyncEventLoopClose();
+	#endif
+
+	// Done; exceptions are not suppressed
+	Py_RETURN_FALSE;
+}
+
+PyObject*
+pypContext_getvalue(PyObject* self, PyObject* unused) {
+	// Vars
+	PypContextObject* context = (PypContextObject*) self;
+	PypDataBufferEntry* entry;
+	PyObject* value = NULL;
+
+	// Not while a thread is writing to it
+	if (!pypContextAcquire(context)) return NULL; // error
+
+	// Convert
+	if (!pypDataBufferUnify(context->dataBuffer, PYP_FALSE, &entry)) {
+		// Error
+		PyErr_NoMemory();
+	}
+	else {
+		#if PY_MAJOR_VERSION >= 3
+		value = PyBytes_FromStringAndSize((entry == NULL) ? "" : entry->buffer, context->dataBuffer->totalSize);
+		#else
+		value = PyString_FromStringAndSize((entry == NULL) ? "" : entry->buffer, context->dataBuffer->totalSize);
+		#endif
+	}
+
+	// Done
+	pypContextRelease(context);
+	return value;
+}
+
+void
+pypContext_dealloc(PyObject* self) {
+	// Vars
+	PypContextObject* context = (PypContextObject*) self;
+	#if PY_VERSION_HEX >= 0x03080000
+	PyTypeObject* type = Py_TYPE(self);
+	#endif
+
+	// Clean
+	if (context->executionInfo.inputFilename != NULL) pypModuleExecutionInfoClean(&context->executionInfo);
+	if (context->dataBuffer != NULL) pypDataBufferDelete(context->dataBuffer);
+	threadMutexDestroy(&context->mutex);
+
+	// Delete
+	PyObject_Del(self);
+	#if PY_VERSION_HEX >= 0x03080000
+	Py_DECREF(type); // heap type instances hold a reference to their type
+	#endif
+}
+
+
+
+// Capture methods
+PyObject*
+pypCapture_enter(PyObject* self, PyObject* unused) {
+	// Vars
+	PypCaptureObject* capture = (PypCaptureObject*) self;
+
+	// Must be inside a template, and not already capturing
+	if (pypModuleContext.dataBuffer == NULL || pypModuleContext.executionInfo == NULL) {
+		PyErr_SetString(PyExc_RuntimeError, "No template is currently being rendered");
+		return NULL;
+	}
+	if (capture->active) {
+		PyErr_SetString(PyExc_RuntimeError, "Capture is already in use");
+		return NULL;
+	}
+
+	// Switch; the output is only redirected, so writes, includes and template renders all land here
+	capture->previousDataBuffer = pypModuleContext.dataBuffer;
+	pypModuleContext.dataBuffer = capture->dataBuffer;
+	capture->active = PYP_TRUE;
+
+	// Innermost of the render's captures until it's exited
+	capture->executionInfo = pypModuleContext.executionInfo;
+	capture->outer = capture->executionInfo->captures;
+	capture->spanning = PYP_FALSE;
+	capture->executionInfo->captures = capture;
+
+	// Done; the capture is kept alive while it's the current output
+	Py_INCREF(self);
+	Py_INCREF(self);
+	return self;
+}
+
+PyObject*
+pypCapture_exit(PyObject* self, PyObject* args) {
+	// Vars
+	PypCaptureObject* capture = (PypCaptureObject*) self;
+	PypModuleExecutionInfo* executionInfo = capture->executionInfo;
+
+	// Must be the current output; one entered by an earlier tag is, once nothing this tag entered is still open
+	if (
+		!capture->active ||
+		executionInfo->captures != capture ||
+		pypModuleContext.executionInfo != executionInfo ||
+		pypModuleContext.dataBuffer != (capture->spanning ? executionInfo->tagDataBuffer : capture->dataBuffer)
+	) {
+		PyErr_SetString(PyExc_RuntimeError, "Capture is not the current output");
+		return NULL;
+	}
+
+	// Includes started inside the capture are part of it
+	#ifdef PYP_ASYNC_SUPPORTED
+	pypAsyncIncludesFinish(&pypModuleContext);
+	#endif
+
+	// Revert
+	if (capture->spanning) {
+		// What this tag wrote before exiting it was inside it too; the rest of the tag, and the output after it, goes where it went before
+		pypDataBufferExtendWithDataBufferAndEmpty(capture->dataBuffer, executionInfo->tagDataBuffer);
+		executionInfo->captureOutput = capture->outer;
+	}
+	else {
+		pypModuleContext.dataBuffer = capture->previousDataBuffer;
+	}
+	pypCapturePop(capture);
+
+	// Done; exceptions are not suppressed
+	Py_RETURN_FALSE;
+}
+
+PyObject*
+pypCapture_getvalue(PyObject* self, PyObject* unused) {
+	// Vars
+	PypCaptureObject* capture = (PypCaptureObject*) self;
+	PypDataBufferEntry* entry;
+
+	// Unified in place, so later calls and emit() don't copy it again
+	if (!pypDataBufferUnify(capture->dataBuffer, PYP_FALSE, &entry)) return PyErr_NoMemory(); // error
+
+	// Convert
+	#if PY_MAJOR_VERSION >= 3
+	return PyBytes_FromStringAndSize((entry == NULL) ? "" : entry->buffer, capture->dataBuffer->totalSize);
+	#else
+	return PyString_FromStringAndSize((entry == NULL) ? "" : entry->buffer, capture->dataBuffer->totalSize);
+	#endif
+}
+
+PyObject*
+pypCapture_emit(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	static char* keywordNames[] = { "clear", NULL };
+	PypCaptureObject* capture = (PypCaptureObject*) self;
+	PypDataBufferEntry* entry;
+	int clear = 0;
+
+	// Arguments
+	if (!PyArg_ParseTupleAndKeywords(args, keywords, "|i:emit", keywordNames, &clear)) return NULL; // error
+
+	// Not into itself
+	if (capture->active) {
+		PyErr_SetString(PyExc_RuntimeError, "Capture is still the current output");
+		return NULL;
+	}
+	if (pypModuleContext.dataBuffer == NULL || pypModuleContext.executionInfo == NULL) {
+		PyErr_SetString(PyExc_RuntimeError, "No template is currently being rendered");
+		return NULL;
+	}
+
+	// The captured entries are moved, and the capture starts over
+	if (clear) {
+		pypDataBufferExtendWithDataBufferAndEmpty(pypModuleContext.dataBuffer, capture->dataBuffer);
+		Py_RETURN_NONE;
+	}
+
+	// Copied, so it can be emitted again; a slot's position can't be copied
+	for (entry = capture->dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+		if (entry->reference != NULL) {
+			PyErr_SetString(PyExc_RuntimeError, "Capture holds a slot, so it can only be emitted with clear=True");
+			return NULL;
+		}
+	}
+	if (!pypDataBufferUnify(capture->dataBuffer, PYP_FALSE, &entry)) return PyErr_NoMemory(); // error
+	if (capture->dataBuffer->totalSize > 0 && pypDataBufferExtendWithData(pypModuleContext.dataBuffer, entry->buffer, capture->dataBuffer->totalSize) == NULL) return PyErr_NoMemory(); // error
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+void
+pypCapture_dealloc(PyObject* self) {
+	// Vars
+	PypCaptureObject* capture = (PypCaptureObject*) self;
+	#if PY_VERSION_HEX >= 0x03080000
+	PyTypeObject* type = Py_TYPE(self);
+	#endif
+
+	// Clean
+	if (capture->dataBuffer != NULL) pypDataBufferDelete(capture->dataBuffer);
+
+	// Delete
+	PyObject_Del(self);
+	#if PY_VERSION_HEX >= 0x03080000
+	Py_DECREF(type); // heap type instances hold a reference to their type
+	#endif
+}
+
+void
+pypCapturePop(PypCaptureObject* capture) {
+	// Assertions
+	assert(capture->active);
+	assert(capture->executionInfo->captures == capture);
+
+	// Unlink; its output is left as it is
+	capture->executionInfo->captures = capture->outer;
+	capture->executionInfo = NULL;
+	capture->outer = NULL;
+	capture->previousDataBuffer = NULL;
+	capture->spanning = PYP_FALSE;
+	capture->active = PYP_FALSE;
+	Py_DECREF((PyObject*) capture);
+}
+
+void
+pypCapturesTagEnd(PypModuleExecutionInfo* executionInfo) {
+	// Vars
+	PypCaptureObject* capture;
+	PypDataBuffer* dataBuffer = pypModuleContext.dataBuffer;
+
+	// Assertions
+	assert(executionInfo != NULL);
+
+	// Nothing the tag entered is still open
+	if (executionInfo->captures == NULL || executionInfo->captures->spanning) return;
+
+	// Followed from the current output back to the tag's own
+	for (capture = executionInfo->captures; capture != NULL && !capture->spanning; capture = capture->outer) {
+		if (capture->dataBuffer != dataBuffer) break;
+		dataBuffer = capture->previousDataBuffer;
+	}
+
+	if ((capture == NULL || capture->spanning) && dataBuffer == executionInfo->tagDataBuffer) {
+		// Properly nested, so they stay open; the tag's own output still goes where it went before them
+		for (capture = executionInfo->captures; capture != NULL && !capture->spanning; capture = capture->outer) {
+			capture->spanning = PYP_TRUE;
+			capture->previousDataBuffer = NULL;
+		}
+		executionInfo->captureOutputPending = PYP_TRUE;
+	}
+	else {
+		// Something else was entered in between, so they end with the tag
+		while (executionInfo->captures != NULL && !executionInfo->captures->spanning) pypCapturePop(executionInfo->captures);
+	}
+}
+
+void
+pypCapturesClose(PypModuleExecutionInfo* executionInfo) {
+	// Assertions
+	assert(executionInfo != NULL);
+
+	// Captures still open when the render ends keep what they collected
+	while (executionInfo->captures != NULL) pypCapturePop(executionInfo->captures);
+	executionInfo->captureOutput = NULL;
+	executionInfo->captureOutputPending = PYP_FALSE;
+}
+
+
+
+// Output methods
+PyObject*
+pypOutput_enter(PyObject* self, PyObject* unused) {
+	// Vars
+	PypOutputObject* output = (PypOutputObject*) self;
+
+	// Must be inside a template, and not already in use
+	if (pypModuleContext.dataBuffer == NULL || pypModuleContext.executionInfo == NULL) {
+		PyErr_SetString(PyExc_RuntimeError, "No template is currently being rendered");
+		return NULL;
+	}
+	if (output->active) {
+		PyErr_SetString(PyExc_RuntimeError, "Output is already in use");
+		return NULL;
+	}
+
+	// Opened now, so a bad path fails before anything is rendered for it
+	if ((output->dataBuffer = pypDataBufferCreate()) == NULL) return PyErr_NoMemory(); // error
+	if (fileOutputOpen(output->filename, output->onlyIfChanged, pypModuleContext.executionInfo->outputSync, &output->output) != FILE_OPEN_OKAY) {
+		// Error
+		pypDataBufferDelete(output->dataBuffer);
+		output->dataBuffer = NULL;
+		PyErr_SetString(PyExc_IOError, "Error opening output file");
+		return NULL;
+	}
+
+	// The render cache only restores the main output, so a render which writes others can't be cached
+	pypStatsAdd(PYP_STATS_SIDE_OUTPUTS, 1);
+	if (pypModuleContext.executionInfo->dependencies != NULL) threadAtomicAdd(&pypModuleContext.executionInfo->dependencies->sideOutputCount, 1);
+
+	// Switch, as a capture does
+	output->previousDataBuffer = pypModuleContext.dataBuffer;
+	pypModuleContext.dataBuffer = output->dataBuffer;
+	output->active = PYP_TRUE;
+
+	// Done; the output is kept alive while it's the current output
+	Py_INCREF(self);
+	Py_INCREF(self);
+	return self;
+}
+
+PyObject*
+pypOutput_exit(PyObject* self, PyObject* args) {
+	// Vars
+	PypOutputObject* output = (PypOutputObject*) self;
+	PypDataBufferEntry* entry;
+	FileOutputStatus fs;
+	PypBool okay = PYP_TRUE;
+
+	// Must be the current output
+	if (!output->active || pypModuleContext.dataBuffer != output->dataBuffer) {
+		PyErr_SetString(PyExc_RuntimeError, "Output is not the current output");
+		return NULL;
+	}
+
+	// Includes started inside the output are part of it
+	#ifdef PYP_ASYNC_SUPPORTED
+	pypAsyncIncludesFinish(&pypModuleContext);
+	#endif
+
+	// Revert
+	pypModuleContext.dataBuffer = output->previousDataBuffer;
+	output->previousDataBuffer = NULL;
+	output->active = PYP_FALSE;
+
+	// Write; output from a region which raised is still written, as code errors don't stop a render
+	for (entry = output->dataBuffer->firstChild; okay && entry != NULL; entry = entry->nextSibling) {
+		okay = (fwrite(entry->buffer, sizeof(PypChar), entry->bufferLength, output->output.stream) == entry->bufferLength);
+	}
+	pypDataBufferDelete(output->dataBuffer);
+	output->dataBuffer = NULL;
+
+	fs = fileOutputClose(&output->output);
+	if (fs == FILE_OUTPUT_UNCHANGED) pypStatsAdd(PYP_STATS_OUTPUTS_UNCHANGED, 1);
+	Py_DECREF(self);
+
+	if (!okay || fs == FILE_OUTPUT_ERROR) {
+		// Error
+		PyErr_SetString(PyExc_IOError, "Error writing output file");
+		return NULL;
+	}
+
+	// Done; exceptions are not suppressed
+	Py_RETURN_FALSE;
+}
+
+void
+pypOutput_dealloc(PyObject* self) {
+	// Vars
+	PypOutputObject* output = (PypOutputObject*) self;
+	#if PY_VERSION_HEX >= 0x03080000
+	PyTypeObject* type = Py_TYPE(self);
+	#endif
+
+	// Clean
+	if (output->output.stream != NULL) fileOutputClose(&output->output);
+	if (output->dataBuffer != NULL) pypDataBufferDelete(output->dataBuffer);
+	memFree(output->filename);
+
+	// Delete
+	PyObject_Del(self);
+	#if PY_VERSION_HEX >= 0x03080000
+	Py_DECREF(type); // heap type instances hold a reference to their type
+	#endif
+}
+
+
+
+// Fragment methods
+PyObject*
+pypFragment_enter(PyObject* self, PyObject* unused) {
+	// Start
+	if (!pypFragmentBegin((PypFragmentObject*) self)) return NULL; // error
+
+	// Done
+	return PyBool_FromLong(((PypFragmentObject*) self)->hit);
+}
+
+PyObject*
+pypFragment_exit(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* errorType = Py_None;
+	PyObject* errorValue = Py_None;
+	PyObject* errorTraceback = Py_None;
+
+	// Arguments
+	if (!PyArg_UnpackTuple(args, "__exit__", 0, 3, &errorType, &errorValue, &errorTraceback)) return NULL; // error
+
+	// End
+	if (!pypFragmentEnd((PypFragmentObject*) self, (errorType != Py_None))) return NULL; // error
+
+	// Done; exceptions are not suppressed
+	Py_RETURN_FALSE;
+}
+
+void
+pypFragment_dealloc(PyObject* self) {
+	// Vars
+	PypFragmentObject* fragment = (PypFragmentObject*) self;
+	#if PY_VERSION_HEX >= 0x03080000
+	PyTypeObject* type = Py_TYPE(self);
+	#endif
+
+	// Clean
+	if (fragment->dataBuffer != NULL) pypDataBufferDelete(fragment->dataBuffer);
+
+	// Delete
+	PyObject_Del(self);
+	#if PY_VERSION_HEX >= 0x03080000
+	Py_DECREF(type); // heap type instances hold a reference to their type
+	#endif
+}
+
+PypBool
+pypFragmentBegin(PypFragmentObject* fragment) {
+	// Must be inside a template, and not already in use
+	if (pypModuleContext.dataBuffer == NULL || pypModuleContext.executionInfo == NULL) {
+		PyErr_SetString(PyExc_RuntimeError, "No template is currently being rendered");
+		return PYP_FALSE;
+	}
+	if (fragment->active) {
+		PyErr_SetString(PyExc_RuntimeError, "Fragment is already in use");
+		return PYP_FALSE;
+	}
+	if ((fragment->dataBuffer = pypDataBufferCreate()) == NULL) {
+		// Error
+		PyErr_NoMemory();
+		return PYP_FALSE;
+	}
+
+	// Spliced in where the region is; the region still runs as a context manager, so its output is collected either way, and dropped on a hit
+	fragment->hit = (fragment->fragments != NULL && pypFragmentsFetch(fragment->fragments, fragment->digest, pypModuleContext.dataBuffer));
+	fragment->codeErrorCount = pypStatsGet(PYP_STATS_CODE_ERRORS);
+
+	// Switch, as a capture does
+	fragment->previousDataBuffer = pypModuleContext.dataBuffer;
+	pypModuleContext.dataBuffer = fragment->dataBuffer;
+	fragment->active = PYP_TRUE;
+
+	// Done; the fragment is kept alive while it's the current output
+	Py_INCREF((PyObject*) fragment);
+	return PYP_TRUE;
+}
+
+PypBool
+pypFragmentEnd(PypFragmentObject* fragment, PypBool raised) {
+	// Must be the current output
+	if (!fragment->active || pypModuleContext.dataBuffer != fragment->dataBuffer) {
+		PyErr_SetString(PyExc_RuntimeError, "Fragment is not the current output");
+		return PYP_FALSE;
+	}
+
+	// Includes started inside the region are part of it
+	#ifdef PYP_ASYNC_SUPPORTED
+	pypAsyncIncludesFinish(&pypModuleContext);
+	#endif
+
+	// Revert
+	pypModuleContext.dataBuffer = fragment->previousDataBuffer;
+	fragment->previousDataBuffer = NULL;
+	fragment->active = PYP_FALSE;
+
+	if (fragment->hit) {
+		// Already added
+		pypDataBufferDelete(fragment->dataBuffer);
+	}
+	else {
+		// Code errors, even ones shown inline, may not happen again, so that output isn't kept
+		if (fragment->fragments != NULL && !raised && pypStatsGet(PYP_STATS_CODE_ERRORS) == fragment->codeErrorCount) {
+			pypFragmentsStore(fragment->fragments, fragment->digest, fragment->dataBuffer);
+		}
+		pypDataBufferExtendWithDataBufferAndDelete(pypModuleContext.dataBuffer, fragment->dataBuffer);
+	}
+	fragment->dataBuffer = NULL;
+	Py_DECREF((PyObject*) fragment);
+
+	// Done
+	return PYP_TRUE;
+}
+
+
+
+// Template methods
+PyObject*
+pypTemplate_render(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Vars
+	PypDataBuffer* dataBuffer;
+	PypDataBufferEntry* entry;
+	PyObject* value = NULL;
+
+	// Render into a new buffer
+	if ((dataBuffer = pypDataBufferCreate()) == NULL) return PyErr_NoMemory(); // error
+
+	if (pypTemplateRender((PypTemplateObject*) self, args, keywords, dataBuffer)) {
+		// Convert
+		if (!pypDataBufferUnify(dataBuffer, PYP_FALSE, &entry)) {
+			// Error
+			PyErr_NoMemory();
+		}
+		else {
+			#if PY_MAJOR_VERSION >= 3
+			value = PyBytes_FromStringAndSize((entry == NULL) ? "" : entry->buffer, dataBuffer->totalSize);
+			#else
+			value = PyString_FromStringAndSize((entry == NULL) ? "" : entry->buffer, dataBuffer->totalSize);
+			#endif
+		}
+	}
+
+	// Done
+	pypDataBufferDelete(dataBuffer);
+	return value;
+}
+
+PyObject*
+pypTemplate_render_into(PyObject* self, PyObject* args, PyObject* keywords) {
+	// Render into the current output
+	if (!pypTemplateRender((PypTemplateObject*) self, args, keywords, NULL)) return NULL; // error
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+void
+pypTemplate_dealloc(PyObject* self) {
+	// Vars
+	PypTemplateObject* template = (PypTemplateObject*) self;
+	#if PY_VERSION_HEX >= 0x03080000
+	PyTypeObject* type = Py_TYPE(self);
+	#endif
+	size_t i;
+
+	// Clean
+	for (i = 0; i < template->segmentCount; ++i) {
+		if (template->segments[i].code != NULL) Py_DECREF(template->segments[i].code);
+		if (template->segments[i].text != NULL) memFree(template->segments[i].text);
+	}
+	if (template->segments != NULL) memFree(template->segments);
+	if (template->executionInfo.inputFilename != NULL) pypModuleExecutionInfoClean(&template->executionInfo);
+
+	// Delete
+	PyObject_Del(self);
+	#if PY_VERSION_HEX >= 0x03080000
+	Py_DECREF(type); // heap type instances hold a reference to their type
+	#endif
+}
+
+
+
+// Template helpers
+PypBool
+pypTemplateSegmentAdd(PypTemplateObject* template, PypTemplateSegment** segment) {
+	// Vars
+	PypTemplateSegment* segmentsNew;
+	size_t capacityNew;
+
+	// Assertions
+	assert(template != NULL);
+	assert(segment != NULL);
+
+	// Extend
+	if (template->segmentCount == template->segmentCapacity) {
+		capacityNew = (template->segmentCapacity == 0) ? 8 : template->segmentCapacity * 2;
+		segmentsNew = (template->segments == NULL) ? memAllocArray(PypTemplateSegment, capacityNew) : memReallocArray(template->segments, PypTemplateSegment, capacityNew);
+		if (segmentsNew == NULL) return PYP_FALSE; // error
+
+		template->segments = segmentsNew;
+		template->segmentCapacity = capacityNew;
+	}
+
+	// Add
+	*segment = &template->segments[template->segmentCount++];
+	(*segment)->code = NULL;
+	(*segment)->expression = PYP_FALSE;
+	(*segment)->text = NULL;
+	(*segment)->textLength = 0;
+	(*segment)->placeholder = NULL;
+
+	// Done
+	return PYP_TRUE;
+}
+
+PyObject*
+pypTemplateCompile(PyObject* module, PypModuleExecutionInfo* currentExecutionInfo, FILE* inputStream, const unicode_char* filename, PypBool fromFile) {
+	// Vars
+	PyObject* errorType;
+	const char* errorMessage;
+	PypTemplateObject* template;
+	PypDataBuffer* dataBuffer = NULL;
+	PypReadStatus rs;
+
+	// Assertions
+	assert(module != NULL);
+	assert(currentExecutionInfo != NULL);
+	assert(inputStream != NULL);
+	assert(filename != NULL);
+
+	// Create
+	template = PyObject_New(PypTemplateObject, (PyTypeObject*) GETSTATE(module)->templateType);
+	if (template == NULL) return NULL; // error
+
+	template->executionInfo.inputFilename = NULL;
+	template->segments = NULL;
+	template->segmentCount = 0;
+	template->segmentCapacity = 0;
+	template->fromFile = fromFile;
+
+	if (
+		(dataBuffer = pypDataBufferCreate()) == NULL ||
+		pypModuleExecutionInfoCreate(
+			&template->executionInfo,
+			currentExecutionInfo->readSettings,
+			currentExecutionInfo->piMain,
+			currentExecutionInfo->piCodeBlock,
+			currentExecutionInfo->piCodeExpression,
+			currentExecutionInfo->optimizedTags,
+			inputStream,
+			currentExecutionInfo->outputStream,
+			currentExecutionInfo->errorStream,
+			dataBuffer,
+			filename,
+			currentExecutionInfo->encoding,
+			currentExecutionInfo->encodingErrorMode,
+			currentExecutionInfo->pythonState
+		) == NULL
+	) {
+		// Error
+		template->executionInfo.inputFilename = NULL;
+		PyErr_NoMemory();
+		goto cleanup;
+	}
+
+	// Tags are compiled instead of executed, leaving a placeholder between the text around them
+	template->executionInfo.compileTemplate = template;
+	rs = pypReadFromStream(inputStream, currentExecutionInfo->outputStream, currentExecutionInfo->errorStream, dataBuffer, currentExecutionInfo->piMain, currentExecutionInfo->optimizedTags, currentExecutionInfo->readSettings, &template->executionInfo);
+	template->executionInfo.compileTemplate = NULL;
+
+	if (rs != PYP_READ_OKAY) {
+		// Syntax errors are raised as they are
+		if (PyErr_Occurred() == NULL) {
+			errorType = pypIncludeErrorType(rs, &errorMessage);
+			PyErr_SetString(errorType, errorMessage);
+		}
+		goto cleanup;
+	}
+	if (!pypTemplateSegmentsBuild(template, dataBuffer)) {
+		// Error
+		PyErr_NoMemory();
+		goto cleanup;
+	}
+
+	// Done
+	pypDataBufferDelete(dataBuffer);
+	return (PyObject*) template;
+
+
+	// Cleanup
+	cleanup:
+	Py_DECREF(template);
+	if (dataBuffer != NULL) pypDataBufferDelete(dataBuffer);
+	return NULL;
+}
+
+PypReadStatus
+pypTemplateCompileTag(PypModuleExecutionInfo* executionInfo, const PypStreamLocation* streamLocation, const char* sourceCode, PypBool expression, PypDataBuffer** outputDataBuffer) {
+	// Vars
+	PypTemplateSegment* segment;
+	PyObject* code;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(executionInfo->compileTemplate != NULL);
+	assert(outputDataBuffer != NULL);
+	assert(*outputDataBuffer == NULL);
+
+	// The first syntax error stops reading, and is raised by pyp.compile
+	if ((code = pypCompileCode(NULL, executionInfo, streamLocation, sourceCode, expression)) == NULL) return PYP_READ_ERROR; // error
+
+	if (!pypTemplateSegmentAdd(executionInfo->compileTemplate, &segment)) {
+		// Error
+		Py_DECREF(code);
+		return PYP_READ_ERROR_MEMORY;
+	}
+	segment->code = code;
+	segment->expression = expression;
+	segment->location = *streamLocation;
+	segment->location.nextSibling = NULL;
+
+	// Only a placeholder is output, which marks where the tag is among the text
+	if ((*outputDataBuffer = pypDataBufferCreate()) == NULL) return PYP_READ_ERROR_MEMORY; // error
+	if ((segment->placeholder = pypDataBufferExtendPlaceholder(*outputDataBuffer)) == NULL) {
+		// Error
+		pypDataBufferDelete(*outputDataBuffer);
+		*outputDataBuffer = NULL;
+		return PYP_READ_ERROR_MEMORY;
+	}
+
+	// Done
+	return PYP_READ_OKAY;
+}
+
+PypBool
+pypTemplateSegmentsBuild(PypTemplateObject* template, PypDataBuffer* dataBuffer) {
+	// Vars
+	PypTemplateSegment* tagSegments;
+	PypTemplateSegment* segment;
+	PypDataBufferEntry* entry;
+	PypDataBufferEntry* textStart;
+	PypSize textLength = 0;
+	size_t tagCount;
+	size_t tagIndex = 0;
+	PypChar* pos;
+
+	// Assertions
+	assert(template != NULL);
+	assert(dataBuffer != NULL);
+
+	// The tags compiled so far are interleaved with the text; there's at most one text segment before each tag, and one after the last
+	tagSegments = template->segments;
+	tagCount = template->segmentCount;
+	template->segments = memAllocArray(PypTemplateSegment, tagCount * 2 + 1);
+	if (template->segments == NULL) {
+		// Error
+		template->segments = tagSegments;
+		return PYP_FALSE;
+	}
+	template->segmentCount = 0;
+	template->segmentCapacity = tagCount * 2 + 1;
+
+	// Split the text at each placeholder
+	textStart = dataBuffer->firstChild;
+	for (entry = dataBuffer->firstChild; ; entry = entry->nextSibling) {
+		if (entry != NULL && (tagIndex == tagCount || entry != tagSegments[tagIndex].placeholder)) {
+			textLength += entry->bufferLength;
+			continue;
+		}
+
+		// Text before the placeholder, joined
+		if (textLength > 0) {
+			segment = &template->segments[template->segmentCount];
+			if ((segment->text = memAllocArray(PypChar, textLength)) == NULL) goto cleanup; // error
+			segment->code = NULL;
+			segment->expression = PYP_FALSE;
+			segment->textLength = textLength;
+			segment->placeholder = NULL;
+			++template->segmentCount;
+
+			for (pos = segment->text; textStart != entry; textStart = textStart->nextSibling) {
+				memcpy(pos, textStart->buffer, sizeof(PypChar) * textStart->bufferLength);
+				pos += textStart->bufferLength;
+			}
+		}
+		if (entry == NULL) break;
+
+		// The tag; moved, so it's only released once
+		segment = &template->segments[template->segmentCount++];
+		*segment = tagSegments[tagIndex];
+		segment->placeholder = NULL;
+		tagSegments[tagIndex++].code = NULL;
+
+		textStart = entry->nextSibling;
+		textLength = 0;
+	}
+	assert(tagIndex == tagCount);
+
+	// Done
+	if (tagSegments != NULL) memFree(tagSegments);
+	return PYP_TRUE;
+
+
+	// Cleanup
+	cleanup:
+	for (; tagIndex < tagCount; ++tagIndex) Py_DECREF(tagSegments[tagIndex].code);
+	if (tagSegments != NULL) memFree(tagSegments);
+	return PYP_FALSE;
+}
+
+PypBool
+pypTemplateRender(PypTemplateObject* template, PyObject* args, PyObject* keywords, PypDataBuffer* target) {
+	// Vars
+	PypModuleExecutionInfo executionInfo;
+	PypModuleExecutionInfo* currentExecutionInfo;
+	PypModuleContext previousContext;
+	PypTemplateSegment* segment;
+	PypDataBuffer* segmentBuffer;
+	PypDataBuffer* modifiedBuffer;
+	PypDataBuffer* outputBuffer;
+	PyObject* globalsDict;
+	PypReadStatus status;
+	PypBool okay = PYP_TRUE;
+	size_t i;
+
+	// Assertions
+	assert(template != NULL);
+	assert(args != NULL);
+
+	// Context
+	if (pypModuleContext.dataBuffer == NULL || pypModuleContext.executionInfo == NULL) {
+		// Error
+		PyErr_SetString(PyExc_RuntimeError, "No template is currently being rendered");
+		return PYP_FALSE;
+	}
+	currentExecutionInfo = pypModuleContext.executionInfo;
+	if (target == NULL) target = pypModuleContext.dataBuffer;
+
+	// Names only
+	if (PyTuple_GET_SIZE(args) != 0) {
+		// Error
+		PyErr_SetString(PyExc_TypeError, "Templates are rendered with keyword arguments only");
+		return PYP_FALSE;
+	}
+
+	// The render being recorded may not be the one which compiled it
+	if (template->fromFile && currentExecutionInfo->dependencies != NULL && !pypDependenciesAdd(currentExecutionInfo->dependencies, template->executionInfo.inputFilename)) {
+		// Error
+		PyErr_NoMemory();
+		return PYP_FALSE;
+	}
+
+	// Recursion start
+	if (Py_EnterRecursiveCall(" in template render")) {
+		// Recursion limit
+		Py_LeaveRecursiveCall();
+		return PYP_FALSE;
+	}
+
+	// A copy of the shared globals with the names added, so functions and comprehensions see them too; anything the template assigns stays here
+	globalsDict = PyDict_Copy(currentExecutionInfo->pythonState->globalsDict);
+	if (globalsDict == NULL || (keywords != NULL && PyDict_Update(globalsDict, keywords) != 0)) {
+		// Error
+		Py_XDECREF(globalsDict);
+		Py_LeaveRecursiveCall();
+		return PYP_FALSE;
+	}
+
+	// The settings it was compiled with, and everything tied to the current render
+	executionInfo = template->executionInfo;
+	executionInfo.inputStream = currentExecutionInfo->inputStream;
+	executionInfo.outputStream = currentExecutionInfo->outputStream;
+	executionInfo.errorStream = currentExecutionInfo->errorStream;
+	executionInfo.outputDataBuffer = target;
+	executionInfo.changeWorkingDirectory = currentExecutionInfo->changeWorkingDirectory;
+	executionInfo.dependencies = currentExecutionInfo->dependencies;
+	executionInfo.includeLookups = currentExecutionInfo->includeLookups;
+	executionInfo.errorLog = currentExecutionInfo->errorLog;
+	executionInfo.slots = currentExecutionInfo->slots;
+	executionInfo.outputSync = currentExecutionInfo->outputSync;
+
+	previousContext = pypModuleContext;
+	pypModuleContext.executionInfo = &executionInfo;
+	pypStatsAdd(PYP_STATS_TEMPLATE_RENDERS, 1);
+
+	// Segments
+	for (i = 0; i < template->segmentCount; ++i) {
+		segment = &template->segments[i];
+
+		// Text; captures left open by a tag collect it, as they do between tags in a file
+		if (segment->code == NULL) {
+			if ((outputBuffer = pypModuleReaderRedirect(&executionInfo)) == NULL) outputBuffer = target;
+			if (pypDataBufferExtendWithData(outputBuffer, segment->text, segment->textLength) == NULL) {
+				// Error
+				okay = PYP_FALSE;
+				break;
+			}
+			continue;
+		}
+
+		// Tags run like pypDataBufferModifyExecute runs them, minus the compiling
+		if ((segmentBuffer = pypDataBufferCreate()) == NULL) {
+			// Error
+			okay = PYP_FALSE;
+			break;
+		}
+		pypStatsAdd(PYP_STATS_CODE_EXECUTIONS, 1);
+		pypModuleContext.dataBuffer = segmentBuffer;
+		pypModuleContext.asyncIncludes = NULL;
+		executionInfo.tagDataBuffer = segmentBuffer;
+		executionInfo.tagLine = segment->location.start.lineNumber;
+
+		status = pypExecuteCode(segmentBuffer, &executionInfo, segment->code, globalsDict, segment->expression);
+
+		#ifdef PYP_ASYNC_SUPPORTED
+		pypAsyncIncludesFinish(&pypModuleContext);
+		#endif
+		pypCapturesTagEnd(&executionInfo);
+		executionInfo.tagDataBuffer = NULL;
+
+		if (status != PYP_READ_OKAY) {
+			pypStatsAdd(PYP_STATS_CODE_ERRORS, 1);
+			if (executionInfo.dependencies != NULL) threadAtomicAdd(&executionInfo.dependencies->codeErrorCount, 1);
+
+			// Error output is escaped as it is for any other tag
+			if (executionInfo.piMain->childFailureModifier != NULL) {
+				modifiedBuffer = NULL;
+				(executionInfo.piMain->childFailureModifier)(segmentBuffer, &modifiedBuffer, &segment->location, &executionInfo);
+				pypDataBufferDelete(segmentBuffer);
+				if ((segmentBuffer = modifiedBuffer) == NULL) {
+					// Error
+					okay = PYP_FALSE;
+					break;
+				}
+			}
+		}
+
+		if ((outputBuffer = pypModuleReaderRedirect(&executionInfo)) == NULL) outputBuffer = target;
+		pypDataBufferExtendWithDataBufferAndDelete(outputBuffer, segmentBuffer);
+	}
+
+	// Revert
+	pypCapturesClose(&executionInfo);
+	pypModuleContext = previousContext;
+	Py_DECREF(globalsDict);
+	Py_LeaveRecursiveCall();
+
+	// Done
+	if (!okay) PyErr_NoMemory();
+	return okay;
+}
+
+
+
+// Include helpers
+PypBool
+pypIncludeResolve(PypModuleExecutionInfo* executionInfo, PyObject* object, unicode_char** filename) {
+	// Vars
+	unicode_char* path;
+	PypSize directoryLength;
+	PypBool okay;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(filename != NULL);
+
+	// Relative to the including file's directory, or else the search directories
+	if (!pypPathFromObject(object, &path)) {
+		// Error
+		PyErr_BadArgument();
+		return PYP_FALSE;
+	}
+	directoryLength = (executionInfo->inputFilenameStart > 1) ? executionInfo->inputFilenameStart - 1 : executionInfo->inputFilenameStart;
+	okay = pypIncludePathResolve(executionInfo->includeLookups, executionInfo->inputFilename, directoryLength, path, filename);
+	memFree(path);
+
+	if (!okay) {
+		// Error
+		PyErr_NoMemory();
+		return PYP_FALSE;
+	}
+
+	// Done
+	return PYP_TRUE;
+}
+
+PypReadStatus
+pypIncludeRender(PypModuleExecutionInfo* executionInfo, const unicode_char* filename, PypDataBuffer* outputDataBuffer) {
+	// Vars
+	PypModuleExecutionInfo exeInfo;
+	PypReadStatus rs;
+	FILE* inputStream;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(filename != NULL);
+	assert(outputDataBuffer != NULL);
+
+	pypStatsAdd(PYP_STATS_INCLUDES, 1);
+
+	// Recorded even if it can't be opened, since creating it changes the output
+	if (executionInfo->dependencies != NULL && !pypDependenciesAdd(executionInfo->dependencies, filename)) return PYP_READ_ERROR_MEMORY; // error
+
+	// Open file
+	if (fileOpenUnicode(filename, "rb", &inputStream) != FILE_OPEN_OKAY) return PYP_READ_ERROR_OPEN; // error
+
+	// Setup execution info
+	if (pypModuleExecutionInfoCreate(
+		&exeInfo,
+		executionInfo->readSettings,
+		executionInfo->piMain,
+		executionInfo->piCodeBlock,
+		executionInfo->piCodeExpression,
+		executionInfo->optimizedTags,
+		inputStream,
+		executionInfo->outputStream,
+		executionInfo->errorStream,
+		outputDataBuffer,
+		filename,
+		executionInfo->encoding,
+		executionInfo->encodingErrorMode,
+		executionInfo->pythonState
+	) == NULL) {
+		// Error
+		fclose(inputStream);
+		return PYP_READ_ERROR_MEMORY;
+	}
+	exeInfo.changeWorkingDirectory = executionInfo->changeWorkingDirectory;
+	exeInfo.dependencies = executionInfo->dependencies;
+	exeInfo.includeLookups = executionInfo->includeLookups;
+	exeInfo.errorLog = executionInfo->errorLog;
+	exeInfo.slots = executionInfo->slots;
+	exeInfo.outputSync = executionInfo->outputSync;
+
+	// If necessary: https://docs.python.org/2.7/c-api/reflection.html
+	rs = pypIncludeFromExecutionInfo(&exeInfo);
+
+	// Clean
+	pypModuleExecutionInfoClean(&exeInfo);
+	fclose(inputStream);
+
+	// Done
+	return rs;
+}
+
+PyObject*
+pypIncludeErrorType(PypReadStatus status, const char** message) {
+	// Assertions
+	assert(message != NULL);
+
+	switch (status) {
+		case PYP_READ_ERROR_MEMORY:
+			*message = "Memory error";
+			return PyExc_MemoryError;
+		case PYP_READ_ERROR_OPEN:
+			*message = "Error opening include file";
+			#if PY_MAJOR_VERSION >= 3
+			return PyExc_FileNotFoundError;
+			#else
+			return PyExc_IOError;
+			#endif
+		case PYP_READ_ERROR_READ:
+			*message = "Read error";
+			#if PY_MAJOR_VERSION >= 3
+			return PyExc_PermissionError;
+			#else
+			return PyExc_IOError;
+			#endif
+		case PYP_READ_ERROR_WRITE:
+			*message = "Write error";
+			#if PY_MAJOR_VERSION >= 3
+			return PyExc_PermissionError;
+			#else
+			return PyExc_IOError;
+			#endif
+		case PYP_READ_ERROR_DIRECTORY:
+			*message = "Directory error";
+			#if PY_MAJOR_VERSION >= 3
+			return PyExc_FileNotFoundError;
+			#else
+			return PyExc_IOError;
+			#endif
+		default:
+			*message = "Error";
+			return PyExc_Exception;
+	}
+}
+
+PypBool
+pypGlobalsOverride(PyObject* globalsDict, PyObject* overrides, PyObject** previous) {
+	// Vars
+	PyObject* key;
+	PyObject* value;
+	PyObject* old;
+	PyObject* entry;
+	Py_ssize_t pos = 0;
+
+	// Assertions
+	assert(globalsDict != NULL);
+	assert(overrides != NULL && PyDict_Check(overrides));
+	assert(previous != NULL);
+
+	// Previous values are kept as (key, value) tuples, or (key,) if the key was not set
+	if ((*previous = PyList_New(0)) == NULL) return PYP_FALSE; // error
+
+	while (PyDict_Next(overrides, &pos, &key, &value)) {
+		old = PyDict_GetItem(globalsDict, key); // borrowed
+		entry = (old != NULL) ? PyTuple_Pack(2, key, old) : PyTuple_Pack(1, key);
+		if (
+			entry == NULL ||
+			PyList_Append(*previous, entry) != 0 ||
+			PyDict_SetItem(globalsDict, key, value) != 0
+		) {
+			// Error
+			Py_XDECREF(entry);
+			pypGlobalsRestore(globalsDict, *previous);
+			return PYP_FALSE;
+		}
+		Py_DECREF(entry);
+	}
+
+	// Done
+	return PYP_TRUE;
+}
+
+void
+pypGlobalsRestore(PyObject* globalsDict, PyObject* previous) {
+	// Vars
+	PyObject* entry;
+	Py_ssize_t i;
+
+	// Assertions
+	assert(globalsDict != NULL);
+	assert(previous != NULL && PyList_Check(previous));
+
+	// Reverse order, in case a key was overridden more than once
+	for (i = PyList_GET_SIZE(previous); i > 0; --i) {
+		entry = PyList_GET_ITEM(previous, i - 1);
+		if (PyTuple_GET_SIZE(entry) == 2) {
+			PyDict_SetItem(globalsDict, PyTuple_GET_ITEM(entry, 0), PyTuple_GET_ITEM(entry, 1));
+		}
+		else if (PyDict_DelItem(globalsDict, PyTuple_GET_ITEM(entry, 0)) != 0) {
+			PyErr_Clear(); // already removed by the include
+		}
+	}
+
+	// Clean
+	Py_DECREF(previous);
+}
+
+size_t
+pypIncludeParallelWorkerCount(Py_ssize_t jobs, size_t count) {
+	// Vars
+	size_t workerCount;
+
+	#ifdef _WIN32
+	// Workers are forked processes
+	workerCount = 1;
+	#else
+	if (jobs > 0) {
+		workerCount = (size_t) jobs;
+	}
+	else {
+		long processors = sysconf(_SC_NPROCESSORS_ONLN);
+		workerCount = (processors > 0) ? (size_t) processors : 1;
+	}
+	#endif
+
+	// No more workers than files
+	if (workerCount > count) workerCount = count;
+	return workerCount;
+}
+
+#ifndef _WIN32
+void
+pypIncludeParallelFork(PypModuleExecutionInfo* executionInfo, const unicode_char** filenames, PyObject* globalsList, size_t count, size_t workerCount, PypDataBuffer** buffers, PypReadStatus* statuses, PypIncludeState* states) {
+	// Vars
+	PypIncludeResultHeader header;
+	PypDataBufferEntry* entry;
+	struct pollfd* pollFds;
+	pid_t* pids;
+	int resultPipe[2];
+	size_t activeCount = 0;
+	size_t i;
+	size_t j;
+	pid_t pid;
+	int status;
+
+	// Assertions
+	assert(workerCount > 1);
+
+	pollFds = memAllocArray(struct pollfd, workerCount);
+	pids = memAllocArray(pid_t, workerCount);
+	if (pollFds == NULL || pids == NULL) {
+		// Error; everything is rendered serially instead
+		if (pollFds != NULL) memFree(pollFds);
+		if (pids != NULL) memFree(pids);
+		return;
+	}
+
+	// Start workers; each one renders every workerCount-th file
+	pypPythonStreamsFlush();
+	fflush(NULL);
+	for (i = 0; i < workerCount; ++i) {
+		pollFds[i].fd = -1;
+		pollFds[i].events = POLLIN;
+		pollFds[i].revents = 0;
+		pids[i] = -1;
+
+		if (pipe(resultPipe) != 0) continue; // rendered serially
+
+		#if PY_VERSION_HEX >= 0x03070000
+		PyOS_BeforeFork();
+		#endif
+		pid = fork();
+		if (pid == 0) {
+			// Child
+			#if PY_VERSION_HEX >= 0x03070000
+			PyOS_AfterFork_Child();
+			#else
+			PyOS_AfterFork();
+			#endif
+
+			// Siblings' pipes must be closed, otherwise the parent never sees end-of-file
+			for (j = 0; j < i; ++j) {
+				if (pollFds[j].fd >= 0) close(pollFds[j].fd);
+			}
+			close(resultPipe[0]);
+
+			#ifdef PYP_ASYNC_SUPPORTED
+			// The parent's event loop shares its file descriptors, so it isn't used here
+			pypAsyncEventLoop = NULL;
+			#endif
+
+			pypIncludeParallelWorkerMain(executionInfo, filenames, globalsList, count, workerCount, i, resultPipe[1]);
+			_exit(0);
+		}
+		#if PY_VERSION_HEX >= 0x03070000
+		PyOS_AfterFork_Parent();
+		#endif
+
+		// Parent
+		close(resultPipe[1]);
+		if (pid < 0) {
+			// Error
+			close(resultPipe[0]);
+			continue;
+		}
+
+		pids[i] = pid;
+		pollFds[i].fd = resultPipe[0];
+		++activeCount;
+	}
+
+	// Collect results; the interpreter isn't used until all workers are done
+	Py_BEGIN_ALLOW_THREADS
+	while (activeCount > 0) {
+		if (poll(pollFds, workerCount, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		for (i = 0; i < workerCount; ++i) {
+			if (pollFds[i].fd < 0 || pollFds[i].revents == 0) continue;
+
+			// Read result
+			if (
+				fileDescriptorRead(pollFds[i].fd, &header, sizeof(header)) &&
+				header.index < count &&
+				header.index % workerCount == i &&
+				states[header.index] == PYP_INCLUDE_PENDING &&
+				(header.length == 0 || (
+					(entry = pypDataBufferExtend(buffers[header.index], (PypSize) header.length)) != NULL &&
+					fileDescriptorRead(pollFds[i].fd, entry->buffer, sizeof(PypChar) * (size_t) header.length)
+				)) &&
+				pypIncludeParallelDependenciesRead(pollFds[i].fd, (size_t) header.dependenciesLength, executionInfo->dependencies)
+			) {
+				statuses[header.index] = (PypReadStatus) header.status;
+				states[header.index] = PYP_INCLUDE_DONE;
+				pypStatsMerge(header.stats);
+				if (executionInfo->dependencies != NULL && header.stats[PYP_STATS_CODE_ERRORS] > 0) {
+					threadAtomicAdd(&executionInfo->dependencies->codeErrorCount, header.stats[PYP_STATS_CODE_ERRORS]);
+				}
+				if (executionInfo->dependencies != NULL && header.stats[PYP_STATS_SIDE_OUTPUTS] > 0) {
+					threadAtomicAdd(&executionInfo->dependencies->sideOutputCount, header.stats[PYP_STATS_SIDE_OUTPUTS]);
+				}
+				continue;
+			}
+
+			// Done or failed
+			close(pollFds[i].fd);
+			pollFds[i].fd = -1;
+			--activeCount;
+		}
+	}
+
+	// Wait for workers
+	for (i = 0; i < workerCount; ++i) {
+		if (pollFds[i].fd >= 0) close(pollFds[i].fd);
+		if (pids[i] < 0) continue;
+
+		while (waitpid(pids[i], &status, 0) < 0 && errno == EINTR);
+
+		// Anything the worker didn't send is lost
+		for (j = i; j < count; j += workerCount) {
+			if (states[j] == PYP_INCLUDE_PENDING) states[j] = PYP_INCLUDE_LOST;
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	// Clean
+	memFree(pollFds);
+	memFree(pids);
+}
+
+void
+pypIncludeParallelWorkerMain(PypModuleExecutionInfo* executionInfo, const unicode_char** filenames, PyObject* globalsList, size_t count, size_t workerCount, size_t workerId, int resultFd) {
+	// Vars
+	PypIncludeResultHeader header;
+	PypDataBuffer* outputDataBuffer;
+	PypDataBufferEntry* entry;
+	PypStatsValue statsReported[PYP_STATS_COUNTER_COUNT];
+	PypDependencies* dependencies = executionInfo->dependencies;
+	size_t dependenciesReported = (dependencies == NULL) ? 0 : dependencies->count;
+	PyObject* overrides;
+	PyObject* previous;
+	PypReadStatus rs;
+	PypBool okay;
+	size_t i;
+	size_t j;
+
+	// Counts and dependencies inherited from the parent are not sent back, and slots belong to the parent's output
+	pypStatsSnapshot(statsReported);
+	executionInfo->slots = NULL;
+
+	for (i = workerId; i < count; i += workerCount) {
+		// Render
+		if ((outputDataBuffer = pypDataBufferCreate()) == NULL) break; // error
+
+		overrides = (globalsList == NULL) ? Py_None : PySequence_Fast_GET_ITEM(globalsList, i);
+		if (overrides != Py_None && !pypGlobalsOverride(executionInfo->pythonState->globalsDict, overrides, &previous)) {
+			// Error
+			PyErr_Clear();
+			rs = PYP_READ_ERROR;
+		}
+		else {
+			rs = pypIncludeRender(executionInfo, filenames[i], outputDataBuffer);
+			if (overrides != Py_None) pypGlobalsRestore(executionInfo->pythonState->globalsDict, previous);
+		}
+
+		// Send result
+		header.index = (uint32_t) i;
+		header.status = (uint32_t) rs;
+		header.length = (uint64_t) outputDataBuffer->totalSize;
+		header.dependenciesLength = 0;
+		for (j = dependenciesReported; dependencies != NULL && j < dependencies->count; ++j) {
+			header.dependenciesLength += wcslen(dependencies->filenames[j]) + 1;
+		}
+		pypStatsSnapshot(header.stats);
+		for (j = 0; j < PYP_STATS_COUNTER_COUNT; ++j) {
+			header.stats[j] -= statsReported[j];
+			statsReported[j] += header.stats[j];
+		}
+
+		okay = fileDescriptorWrite(resultFd, &header, sizeof(header));
+		for (entry = outputDataBuffer->firstChild; okay && entry != NULL; entry = entry->nextSibling) {
+			okay = fileDescriptorWrite(resultFd, entry->buffer, sizeof(PypChar) * entry->bufferLength);
+		}
+		for (j = dependenciesReported; okay && dependencies != NULL && j < dependencies->count; ++j) {
+			okay = fileDescriptorWrite(resultFd, dependencies->filenames[j], sizeof(unicode_char) * (wcslen(dependencies->filenames[j]) + 1));
+		}
+		if (dependencies != NULL) dependenciesReported = dependencies->count;
+
+		// Clean
+		pypDataBufferDelete(outputDataBuffer);
+		if (!okay) break;
+	}
+
+	// Python's own buffered streams are not flushed by _exit
+	pypPythonStreamsFlush();
+	fflush(NULL);
+
+	close(resultFd);
+}
+
+PypBool
+pypIncludeParallelDependenciesRead(int fd, size_t length, PypDependencies* dependencies) {
+	// Vars
+	unicode_char* buffer;
+	size_t start;
+	size_t i;
+	PypBool okay;
+
+	if (length == 0) return PYP_TRUE;
+
+	// Read all of them
+	if ((buffer = memAllocArray(unicode_char, length)) == NULL) return PYP_FALSE; // error
+	okay = fileDescriptorRead(fd, buffer, sizeof(unicode_char) * length) && buffer[length - 1] == '\x00';
+
+	// Add each
+	for (start = 0, i = 0; okay && i < length; ++i) {
+		if (buffer[i] != '\x00') continue;
+
+		if (dependencies != NULL) okay = pypDependenciesAdd(dependencies, &buffer[start]);
+		start = i + 1;
+	}
+
+	// Done
+	memFree(buffer);
+	return okay;
+}
+
+void
+pypPythonStreamsFlush() {
+	// Vars
+	PyObject* stream;
+
+	if ((stream = PySys_GetObject("stdout")) != NULL) Py_XDECREF(PyObject_CallMethod(stream, "flush", NULL));
+	if ((stream = PySys_GetObject("stderr")) != NULL) Py_XDECREF(PyObject_CallMethod(stream, "flush", NULL));
+	PyErr_Clear();
+}
+#endif
+
+
+// Async
+#ifdef PYP_ASYNC_SUPPORTED
+PyObject*
+pypAsyncEventLoopGet() {
+	// Vars
+	PyObject* module;
+
+	// Create
+	if (pypAsyncEventLoop == NULL) {
+		if ((module = PyImport_ImportModule("asyncio")) == NULL) return NULL; // error
+		pypAsyncEventLoop = PyObject_CallMethod(module, "new_event_loop", NULL);
+		Py_DECREF(module);
+	}
+
+	// Done; borrowed
+	return pypAsyncEventLoop;
+}
+
+void
+pypAsyncEventLoopClose() {
+	// Vars
+	PyObject* loop = pypAsyncEventLoop;
+	PyObject* coroutine;
+	PyObject* errorType;
+	PyObject* errorValue;
+	PyObject* errorTraceback;
+
+	if (loop == NULL) return;
+	pypAsyncEventLoop = NULL;
+
+	// Any error that is already set is kept
+	PyErr_Fetch(&errorType, &errorValue, &errorTraceback);
+
+	// Finish async generators, then close
+	if ((coroutine = PyObject_CallMethod(loop, "shutdown_asyncgens", NULL)) != NULL) {
+		Py_XDECREF(PyObject_CallMethod(loop, "run_until_complete", "(O)", coroutine));
+		Py_DECREF(coroutine);
+	}
+	Py_XDECREF(PyObject_CallMethod(loop, "close", NULL));
+	Py_DECREF(loop);
+
+	PyErr_Clear();
+	PyErr_Restore(errorType, errorValue, errorTraceback);
+}
+
+PyObject*
+pypAsyncRunCoroutine(PyObject* coroutine) {
+	// Vars
+	PyObject* module;
+	PyObject* loop;
+	PypAsyncRun run;
+	PypBool started = PYP_FALSE;
+
+	// Assertions
+	assert(coroutine != NULL);
+
+	// Find if an event loop is already running on this thread
+	if ((module = PyImport_ImportModule("asyncio")) == NULL) return NULL; // error
+	loop = PyObject_CallMethod(module, "_get_running_loop", NULL);
+	Py_DECREF(module);
+	if (loop == NULL) return NULL; // error
+
+	if (loop == Py_None) {
+		// Run on this thread's loop
+		Py_DECREF(loop);
+		if ((loop = pypAsyncEventLoopGet()) == NULL) return NULL; // error
+		return PyObject_CallMethod(loop, "run_until_complete", "(O)", coroutine);
+	}
+	Py_DECREF(loop);
+
+	// Included from a running coroutine, which can't be re-entered, so it is run to completion on a new thread
+	if ((run.threadState = pypAsyncThreadStateCreate()) == NULL) return NULL; // error
+	run.context = pypModuleContext;
+	run.context.asyncIncludes = NULL;
+	run.coroutine = coroutine;
+	run.result = NULL;
+	run.errorType = NULL;
+	run.errorValue = NULL;
+	run.errorTraceback = NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	if (threadCreate(&run.thread, pypAsyncRunThreadMain, &run) == THREAD_OKAY) {
+		threadJoin(&run.thread);
+		started = PYP_TRUE;
+	}
+	Py_END_ALLOW_THREADS
+
+	if (!started) {
+		// Error
+		pypAsyncThreadStateDelete(run.threadState);
+		PyErr_SetString(PyExc_RuntimeError, "Could not start a thread for the coroutine");
+		return NULL;
+	}
+
+	// Done
+	if (run.result == NULL) PyErr_Restore(run.errorType, run.errorValue, run.errorTraceback);
+	return run.result;
+}
+
+void
+pypAsyncRunThreadMain(void* data) {
+	// Vars
+	PypAsyncRun* run = (PypAsyncRun*) data;
+	PyObject* loop;
+
+	// Setup
+	PyEval_RestoreThread(run->threadState);
+	pypModuleContext = run->context;
+
+	// Run
+	if ((loop = pypAsyncEventLoopGet()) != NULL) {
+		run->result = PyObject_CallMethod(loop, "run_until_complete", "(O)", run->coroutine);
+	}
+	if (run->result == NULL) PyErr_Fetch(&run->errorType, &run->errorValue, &run->errorTraceback);
+
+	// Clean
+	pypAsyncIncludesFinish(&pypModuleContext);
+	pypAsyncEventLoopClose();
+	pypModuleContext.dataBuffer = NULL;
+	pypModuleContext.executionInfo = NULL;
+
+	pypAsyncThreadExit(run->threadState);
+}
+
+PyThreadState*
+pypAsyncThreadStateCreate() {
+	// Vars
+	PyThreadState* threadState;
+
+	// For the interpreter of the calling thread; the new thread takes it over once it starts
+	if ((threadState = PyThreadState_New(PyThreadState_Get()->interp)) == NULL) {
+		// Error
+		if (!PyErr_Occurred()) PyErr_SetString(PyExc_RuntimeError, "Could not create a thread state");
+		return NULL;
+	}
+
+	// Done
+	return threadState;
+}
+
+void
+pypAsyncThreadStateDelete(PyThreadState* threadState) {
+	// Never used by a thread
+	PyThreadState_Clear(threadState);
+	PyThreadState_Delete(threadState);
+}
+
+void
+pypAsyncThreadExit(PyThreadState* threadState) {
+	PyThreadState_Clear(threadState);
+	PyThreadState_DeleteCurrent();
+}
+
+void
+pypAsyncIncludeThreadMain(void* data) {
+	// Vars
+	PypAsyncInclude* include = (PypAsyncInclude*) data;
+	PyObject* errorType;
+	PyObject* exception = NULL;
+	PyObject* complete;
+	const char* errorMessage;
+
+	// Setup
+	PyEval_RestoreThread(include->threadState);
+	pypModuleContext.dataBuffer = include->dataBuffer;
+	pypModuleContext.executionInfo = &include->executionInfo;
+	pypModuleContext.asyncIncludes = NULL;
+
+	// Render
+	include->status = pypIncludeRender(&include->executionInfo, include->filename, include->dataBuffer);
+
+	pypAsyncEventLoopClose();
+	pypModuleContext.dataBuffer = NULL;
+	pypModuleContext.executionInfo = NULL;
+
+	// Complete the future on the loop that is waiting for it
+	if (include->status != PYP_READ_OKAY) {
+		errorType = pypIncludeErrorType(include->status, &errorMessage);
+		exception = PyObject_CallFunction(errorType, "s", errorMessage);
+	}
+	if ((complete = PyCFunction_New(&pypAsyncFutureCompleteMethod, NULL)) != NULL) {
+		Py_XDECREF(PyObject_CallMethod(include->loop, "call_soon_threadsafe", "(OOO)", complete, include->future, (exception == NULL) ? Py_None : exception));
+		Py_DECREF(complete);
+	}
+	Py_XDECREF(exception);
+	PyErr_Clear(); // the loop may already be closed, if the result was never awaited
+
+	// Done
+	pypAsyncThreadExit(include->threadState);
+}
+
+PyObject*
+pypAsyncFutureComplete(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* future;
+	PyObject* exception;
+	PyObject* done;
+	int isDone;
+
+	if (!PyArg_UnpackTuple(args, "_complete", 2, 2, &future, &exception)) return NULL; // error
+
+	// A cancelled future is left as it is
+	if ((done = PyObject_CallMethod(future, "done", NULL)) == NULL) return NULL; // error
+	isDone = PyObject_IsTrue(done);
+	Py_DECREF(done);
+	if (isDone < 0) return NULL; // error
+
+	if (!isDone) {
+		if (exception == Py_None) {
+			done = PyObject_CallMethod(future, "set_result", "(O)", Py_None);
+		}
+		else {
+			done = PyObject_CallMethod(future, "set_exception", "(O)", exception);
+		}
+		if (done == NULL) return NULL; // error
+		Py_DECREF(done);
+	}
+
+	// Done
+	Py_RETURN_NONE;
+}
+
+void
+pypAsyncIncludesFinish(PypModuleContext* context) {
+	// Vars
+	PypAsyncInclude* include;
+	PypAsyncInclude* next;
+
+	// Assertions
+	assert(context != NULL);
+
+	if (context->asyncIncludes == NULL) return;
+
+	// Wait for all of them; the GIL is released so they can run
+	Py_BEGIN_ALLOW_THREADS
+	for (include = context->asyncIncludes; include != NULL; include = include->nextSibling) {
+		threadJoin(&include->thread);
+	}
+	Py_END_ALLOW_THREADS
+
+	// Output each one where it was started
+	for (include = context->asyncIncludes; include != NULL; include = next) {
+		next = include->nextSibling;
+
+		pypDataBufferPlaceholderFillAndDelete(include->targetDataBuffer, include->placeholder, include->dataBuffer);
+		Py_DECREF(include->loop);
+		Py_DECREF(include->future);
+		memFree(include->filename);
+		memFree(include);
+	}
+
+	context->asyncIncludes = NULL;
+}
+#endif
+
+
+
+// Visible methods
+PypReadStatus
+pypIncludeFromExecutionInfo(PypModuleExecutionInfo* executionInfo) {
+	// Vars
+	PypReadStatus readStatus;
+	PypModuleExecutionInfo* previousExecutionInfo;
+	unicode_char* previousCwd = NULL;
+	size_t previousCwdLength;
+	PypSize directoryEnd;
+	unicode_char directoryEndChar;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(executionInfo->pythonState != NULL);
+	assert(executionInfo->pythonState->mainModule != NULL);
+	assert(executionInfo->pythonState->pypModule != NULL);
+	assert(executionInfo->pythonState->globalsDict != NULL);
+
+	// Includes are resolved from the file name, so the working directory is only changed for compatibility
+	if (executionInfo->changeWorkingDirectory) {
+		if (pathGetCurrentWorkingDirectoryUnicode(&previousCwd, &previousCwdLength) != PATH_OKAY) return PYP_READ_ERROR_DIRECTORY; // error
+
+		// The file name is cut at its last separator, keeping the root
+		directoryEnd = (executionInfo->inputFilenameStart > 1) ? executionInfo->inputFilenameStart - 1 : executionInfo->inputFilenameStart;
+		directoryEndChar = executionInfo->inputFilename[directoryEnd];
+		executionInfo->inputFilename[directoryEnd] = '\x00';
+		pathSetCurrentWorkingDirectoryUnicode(executionInfo->inputFilename);
+		executionInfo->inputFilename[directoryEnd] = directoryEndChar;
+	}
+
+	// Process
+	previousExecutionInfo = pypModuleContext.executionInfo;
+	pypModuleContext.executionInfo = executionInfo;
+	if (executionInfo->inputRead != NULL) {
+		readStatus = pypReadFromSource(executionInfo->inputRead, executionInfo->inputSource, executionInfo->outputStream, executionInfo->errorStream, executionInfo->outputDataBuffer, executionInfo->piMain, executionInfo->optimizedTags, executionInfo->readSettings, executionInfo);
+	}
+	else {
+		readStatus = pypReadFromStream(executionInfo->inputStream, executionInfo->outputStream, executionInfo->errorStream, executionInfo->outputDataBuffer, executionInfo->piMain, executionInfo->optimizedTags, executionInfo->readSettings, executionInfo);
+	}
+	pypCapturesClose(executionInfo);
+	pypModuleContext.executionInfo = previousExecutionInfo;
+
+	// Revert
+	if (previousCwd != NULL) {
+		pathSetCurrentWorkingDirectoryUnicode(previousCwd);
+		memFree(previousCwd);
+	}
+
+	// Done
+	return readStatus;
+}
+
+PyObject*
+pypModuleTemplateCompile(PypModuleExecutionInfo* executionInfo) {
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(executionInfo->inputStream != NULL);
+	assert(executionInfo->pythonState != NULL);
+	assert(executionInfo->pythonState->pypModule != NULL);
+
+	// The same as pyp.compile with a path, minus the resolving
+	return pypTemplateCompile(executionInfo->pythonState->pypModule, executionInfo, executionInfo->inputStream, executionInfo->inputFilename, PYP_TRUE);
+}
+
+PypBool
+pypModuleTemplateRender(PypModuleExecutionInfo* executionInfo, PyObject* template, PyObject* names, PypDataBuffer* dataBuffer) {
+	// Vars
+	PypModuleContext previousContext;
+	PyObject* args;
+	PypBool okay;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(template != NULL);
+	assert(dataBuffer != NULL);
+
+	if ((args = PyTuple_New(0)) == NULL) return PYP_FALSE; // error
+
+	// Rendered as if called from a template which is rendering into dataBuffer
+	previousContext = pypModuleContext;
+	pypModuleContext.executionInfo = executionInfo;
+	pypModuleContext.dataBuffer = dataBuffer;
+	pypModuleContext.asyncIncludes = NULL;
+	okay = pypTemplateRender((PypTemplateObject*) template, args, names, dataBuffer);
+	pypModuleContext = previousContext;
+
+	// Done
+	Py_DECREF(args);
+	return okay;
+}
+
+PypModuleExecutionInfo*
+pypModuleExecutionInfoCreate(PypModuleExecutionInfo* info, PypReaderSettings* readSettings, PypProcessingInfo* piMain, PypProcessingInfo* piCodeBlock, PypProcessingInfo* piCodeExpression, PypTagGroup* optimizedTags, FILE* inputStream, FILE* outputStream, FILE* errorStream, PypDataBuffer* outputDataBuffer, const cmd_char* inputFilename, const char* encoding, const char* encodingErrorMode, PypPythonState* pythonState) {
+	// Vars
+	PypBool created = PYP_FALSE;
+	size_t i;
+
+	// Assertions
+	assert(readSettings != NULL);
+	assert(piMain != NULL);
+	assert(piCodeBlock != NULL || piCodeExpression != NULL);
+	assert(optimizedTags != NULL);
+	assert(outputStream != NULL || outputDataBuffer != NULL); // the input stream may be replaced by a read function after
+	assert(inputFilename != NULL);
+	assert(encoding != NULL);
+	assert(encodingErrorMode != NULL);
+	assert(pythonState != NULL);
+
+	// Create
+	if (info == NULL) {
+		info = memAlloc(PypModuleExecutionInfo);
+		if (info == NULL) return NULL;
+		created = PYP_TRUE;
+	}
+
+	// Set
+	info->readSettings = readSettings;
+
+	info->piMain = piMain;
+	info->piCodeBlock = piCodeBlock;
+	info->piCodeExpression = piCodeExpression;
+
+	info->optimizedTags = optimizedTags;
+
+	info->inputStream = inputStream;
+	info->outputStream = outputStream;
+	info->errorStream = errorStream;
+	info->outputDataBuffer = outputDataBuffer;
+	info->inputRead = NULL;
+	info->inputSource = NULL;
+
+	// Copy file name
+	if (pathAbsoluteUnicode(inputFilename, &info->inputFilename, &info->inputFilenameLength) != PATH_OKAY) goto cleanup; // error
+	info->inputFilenameStart = 0;
+	for (i = info->inputFilenameLength; i > 0; ) {
+		--i;
+
+		if (pathCharIsSeparatorUnicode(info->inputFilename[i])) {
+			// Done
+			info->inputFilenameStart = i + 1;
+			break;
+		}
+	}
+
+	info->encoding = encoding;
+	info->encodingErrorMode = encodingErrorMode;
+
+	info->changeWorkingDirectory = pythonState->changeWorkingDirectory;
+	info->dependencies = NULL;
+	info->includeLookups = NULL;
+	info->compileTemplate = NULL;
+	info->errorLog = NULL;
+	info->slots = NULL;
+	info->outputSync = FILE_OUTPUT_SYNC_NONE;
+	info->captures = NULL;
+	info->captureOutput = NULL;
+	info->captureOutputPending = PYP_FALSE;
+	info->tagDataBuffer = NULL;
+	info->tagLine = 0;
+	info->tagWriteThrough = PYP_FALSE;
+
+	info->pythonState = pythonState;
+
+	// Done
+	return info;
+
+	// Cleanup
+	cleanup:
+	if (created) memFree(info);
+	return NULL;
+}
+
+void
+pypModuleExecutionInfoClean(PypModuleExecutionInfo* executionInfo) {
+	assert(executionInfo != NULL);
+	assert(executionInfo->inputFilename != NULL);
+
+	memFree(executionInfo->inputFilename);
+}
+
+void
+pypModulePythonSettingsInit(PypPythonSettings* settings) {
+	assert(settings != NULL);
+
+	settings->isolated = PYP_FALSE;
+	settings->noSite = PYP_FALSE;
+	settings->importTime = PYP_FALSE;
+	settings->home = NULL;
+	settings->path = NULL;
+	pypModuleGcSettingsInit(&settings->gc);
+	settings->memoizeExpressions = PYP_FALSE;
+}
+
+PypPythonState*
+pypModulePythonSetup(const cmd_char* applicationPath, const PypPythonSettings* settings) {
+	// Vars
+	PypPythonState* state;
+	size_t applicationPathLength;
+	size_t outputCharacterCount;
+	size_t errorCount;
+	PypStatsValue timerStart;
+	#if PY_VERSION_HEX >= 0x03080000
+	PyConfig config;
+	PyStatus status;
+	const cmd_char* pathStart;
+	const cmd_char* pathEnd;
+	unicode_char* pathEntry;
+	#else
+	size_t homeLength;
+	#endif
+	#if PY_MAJOR_VERSION < 3
+	char* path;
+	#endif
+
+	// Assertions
+	assert(applicationPath != NULL);
+	assert(settings != NULL);
+
+	// Create state
+	state = memAlloc(PypPythonState);
+	if (state == NULL) return NULL; // error
+
+	// Vars
+	state->interpreterThreadState = NULL;
+	state->changeWorkingDirectory = PYP_FALSE;
+	state->allowTopLevelAwait = PYP_FALSE;
+	pypModuleGcSettingsInit(&state->gc);
+	state->gcRenderDisabled = PYP_FALSE;
+	state->fragments = NULL;
+
+	state->mainModule = NULL;
+	state->pypModule = NULL;
+	state->globalsDict = NULL;
+	state->localsDict = NULL;
+	state->baseGlobalsDict = NULL;
+
+	state->exceptionHandlerCompiledCode = NULL;
+	state->exceptionHandlerGlobalsDict = NULL;
+
+	state->memoizeAnalyzer = NULL;
+	state->memoizedExpressions = NULL;
+
+	state->statusFunction = NULL;
+	state->statusMessage = NULL;
+
+
+	// Setup paths
+	state->applicationName = NULL;
+	state->applicationNameUnicode = NULL;
+	state->home = NULL;
+	state->homeUnicode = NULL;
+
+	applicationPathLength = getUnicodeCharStringLength(applicationPath);
+	state->applicationNameUnicode = memAllocArray(cmd_char, applicationPathLength + 1);
+	if (state->applicationNameUnicode == NULL) {
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
+		return state; // error
+	}
+	memcpy(state->applicationNameUnicode, applicationPath, sizeof(cmd_char) * (applicationPathLength + 1));
+
+	if (unicodeUTF8EncodeLength(applicationPath, applicationPathLength, &state->applicationName, &outputCharacterCount, &errorCount) != UNICODE_OKAY) {
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
+		return state; // error
+	}
+
+	// Add the module to be initialized
+	if (PyImport_AppendInittab("pyp", pypModuleInit) != 0) {
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return state; // error
+	}
+
+	// Setup python
+	timerStart = pypStatsClock();
+	#if PY_VERSION_HEX >= 0x03080000
+	// Isolated mode starts from a configuration which ignores the environment
+	if (settings->isolated) {
+		PyConfig_InitIsolatedConfig(&config);
+		config.install_signal_handlers = 1;
+	}
+	else {
+		PyConfig_InitPythonConfig(&config);
+	}
+	config.parse_argv = 0;
+	if (settings->noSite) config.site_import = 0;
+	if (settings->importTime) config.import_time = 1;
+
+	status = PyConfig_SetString(&config, &config.program_name, state->applicationNameUnicode);
+	if (!PyStatus_Exception(status) && settings->home != NULL) status = PyConfig_SetString(&config, &config.home, settings->home);
+
+	// An explicit sys.path skips the search for it
+	if (!PyStatus_Exception(status) && settings->path != NULL) {
+		config.module_search_paths_set = 1;
+		for (pathStart = settings->path; ; pathStart = pathEnd + 1) {
+			for (pathEnd = pathStart; *pathEnd != PYP_MODULE_PATH_SEPARATOR && *pathEnd != '\x00'; ++pathEnd);
+
+			if (pathEnd > pathStart) {
+				if ((pathEntry = memAllocArray(unicode_char, (pathEnd - pathStart) + 1)) == NULL) {
+					// Error
+					PyConfig_Clear(&config);
+					state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
+					return state;
+				}
+				memcpy(pathEntry, pathStart, sizeof(unicode_char) * (pathEnd - pathStart));
+				pathEntry[pathEnd - pathStart] = '\x00';
+				status = PyWideStringList_Append(&config.module_search_paths, pathEntry);
+				memFree(pathEntry);
+				if (PyStatus_Exception(status)) break; // error
+			}
+
+			if (*pathEnd == '\x00') break;
+		}
+	}
+
+	if (!PyStatus_Exception(status)) status = Py_InitializeFromConfig(&config);
+	PyConfig_Clear(&config);
+	if (PyStatus_Exception(status)) {
+		// Error; python may ask for the process to exit, as it would when started on its own
+		if (PyStatus_IsExit(status)) Py_ExitStatusException(status);
+		state->statusFunction = status.func;
+		state->statusMessage = status.err_msg;
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return state;
+	}
+	#else
+	// Legacy flags, which must be set before initializing
+	if (settings->isolated) {
+		Py_IgnoreEnvironmentFlag = 1;
+		Py_NoUserSiteDirectory = 1;
+		#if PY_VERSION_HEX >= 0x03040000
+		Py_IsolatedFlag = 1;
+		#endif
+	}
+	if (settings->noSite) Py_NoSiteFlag = 1;
+	#if PY_VERSION_HEX >= 0x03070000
+	if (settings->importTime) PySys_AddXOption(L"importtime");
+	#endif
+
+	// The home is referenced, not copied, so it's kept with the state
+	if (settings->home != NULL) {
+		homeLength = getUnicodeCharStringLength(settings->home);
+		if (
+			(state->homeUnicode = memAllocArray(unicode_char, homeLength + 1)) == NULL ||
+			unicodeUTF8EncodeLength(settings->home, homeLength, &state->home, &outputCharacterCount, &errorCount) != UNICODE_OKAY
+		) {
+			// Error
+			state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
+			return state;
+		}
+		memcpy(state->homeUnicode, settings->home, sizeof(unicode_char) * (homeLength + 1));
+		#if PY_MAJOR_VERSION >= 3
+		Py_SetPythonHome(state->homeUnicode);
+		#else
+		Py_SetPythonHome(state->home);
+		#endif
+	}
+
+	#if PY_MAJOR_VERSION >= 3
+	if (settings->path != NULL) Py_SetPath(settings->path);
+	Py_SetProgramName(state->applicationNameUnicode);
+	#else
+	Py_SetProgramName(state->applicationName);
+	#endif
+	Py_Initialize();
+
+	// Python 2 only allows sys.path to be replaced once it's running
+	#if PY_MAJOR_VERSION < 3
+	if (settings->path != NULL) {
+		if (unicodeUTF8Encode(settings->path, &path, &outputCharacterCount, &errorCount) != UNICODE_OKAY) {
+			// Error
+			state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
+			return state;
+		}
+		PySys_SetPath(path);
+		memFree(path);
+	}
+	#endif
+	#endif
+	pypStatsTimerAdd(PYP_STATS_TIMER_PYTHON_INIT, pypStatsClock() - timerStart);
+
+	// Collector
+	if (pypModuleGcSetup(state, &settings->gc) != PYP_MODULE_SETUP_STATUS_OKAY) {
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return state; // error
+	}
+
+	// Expression memoization
+	#ifdef PYP_MEMOIZE_SUPPORTED
+	if (settings->memoizeExpressions && pypModuleMemoizeSetup(state) != PYP_MODULE_SETUP_STATUS_OKAY) {
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return state; // error
+	}
+	#endif
+
+	// Okay
+	state->status = PYP_MODULE_SETUP_STATUS_OKAY;
+	return state;
+}
+
+void
+pypModulePythonFinalize(PypPythonState* pythonState) {
+	// Vars
+	PypStatsValue timerStart;
+
+	// Assertions
+	assert(pythonState != NULL);
+
+	// Finish
+	timerStart = pypStatsClock();
+	#ifdef PYP_MEMOIZE_SUPPORTED
+	if (Py_IsInitialized()) pypModuleMemoizeDeinit(pythonState);
+	#endif
+	if (Py_IsInitialized()) Py_Finalize();
+	pypStatsTimerAdd(PYP_STATS_TIMER_PYTHON_FINALIZE, pypStatsClock() - timerStart);
+
+	// Delete paths
+	if (pythonState->applicationName != NULL) memFree(pythonState->applicationName);
+	if (pythonState->applicationNameUnicode != NULL) memFree(pythonState->applicationNameUnicode);
+	if (pythonState->home != NULL) memFree(pythonState->home);
+	if (pythonState->homeUnicode != NULL) memFree(pythonState->homeUnicode);
+	memFree(pythonState);
+}
+
+#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+PypPythonState*
+pypModulePythonSubinterpreterSetup() {
+	// Vars
+	PypPythonState* state;
+	PyInterpreterConfig config;
+	PyStatus status;
+
+	// Isolated configuration
+	memset(&config, 0, sizeof(PyInterpreterConfig));
+	config.use_main_obmalloc = 0;
+	config.allow_fork = 0;
+	config.allow_exec = 0;
+	config.allow_threads = 1;
+	config.allow_daemon_threads = 0;
+	config.check_multi_interp_extensions = 1;
+	config.gil = PyInterpreterConfig_OWN_GIL;
+
+	// Create state
+	state = memAlloc(PypPythonState);
+	if (state == NULL) return NULL; // error
+
+	state->applicationName = NULL;
+	state->applicationNameUnicode = NULL;
+	state->home = NULL;
+	state->homeUnicode = NULL;
+
+	state->interpreterThreadState = NULL;
+	state->changeWorkingDirectory = PYP_FALSE;
+	state->allowTopLevelAwait = PYP_FALSE;
+	pypModuleGcSettingsInit(&state->gc);
+	state->gcRenderDisabled = PYP_FALSE;
+	state->fragments = NULL;
+
+	state->mainModule = NULL;
+	state->pypModule = NULL;
+	state->globalsDict = NULL;
+	state->localsDict = NULL;
+	state->baseGlobalsDict = NULL;
+
+	state->exceptionHandlerCompiledCode = NULL;
+	state->exceptionHandlerGlobalsDict = NULL;
+
+	state->memoizeAnalyzer = NULL;
+	state->memoizedExpressions = NULL;
+
+	state->statusFunction = NULL;
+	state->statusMessage = NULL;
+
+
+	// Create an interpreter with its own GIL; it becomes current for the calling thread
+	status = Py_NewInterpreterFromConfig(&state->interpreterThreadState, &config);
+	if (PyStatus_Exception(status) || state->interpreterThreadState == NULL) {
+		state->interpreterThreadState = NULL;
+		state->statusFunction = status.func;
+		state->statusMessage = status.err_msg;
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return state; // error
+	}
+
+	// Okay
+	state->status = PYP_MODULE_SETUP_STATUS_OKAY;
+	return state;
+}
+
+void
+pypModulePythonSubinterpreterFinalize(PypPythonState* pythonState) {
+	assert(pythonState != NULL);
+
+	// Finish
+	if (pythonState->interpreterThreadState != NULL) {
+		pypModuleMemoizeDeinit(pythonState);
+		Py_EndInterpreter(pythonState->interpreterThreadState);
+	}
+
+	memFree(pythonState);
+}
+#endif
+
+#ifdef PYP_EXTENSION_MODULE
+PypPythonState*
+pypModulePythonAttach(void) {
+	// Vars
+	PypPythonState* state;
+	PyObject* name;
+	PypBool okay;
+
+	// Create state
+	state = memAlloc(PypPythonState);
+	if (state == NULL) return NULL; // error
+
+	state->applicationName = NULL;
+	state->applicationNameUnicode = NULL;
+	state->home = NULL;
+	state->homeUnicode = NULL;
+
+	state->interpreterThreadState = NULL;
+	state->changeWorkingDirectory = PYP_FALSE;
+	state->allowTopLevelAwait = PYP_FALSE;
+	pypModuleGcSettingsInit(&state->gc);
+	state->gcRenderDisabled = PYP_FALSE;
+	state->fragments = NULL;
+
+	state->mainModule = NULL;
+	state->pypModule = NULL;
+	state->globalsDict = NULL;
+	state->localsDict = NULL;
+	state->baseGlobalsDict = NULL;
+
+	state->exceptionHandlerCompiledCode = NULL;
+	state->exceptionHandlerGlobalsDict = NULL;
+
+	state->memoizeAnalyzer = NULL;
+	state->memoizedExpressions = NULL;
+
+	state->statusFunction = NULL;
+	state->statusMessage = NULL;
+
+
+	// The host's __main__ belongs to the host, so renders start from globals of their own, named like the command line's
+	#if PY_MAJOR_VERSION >= 3
+	name = PyUnicode_FromString("__main__");
+	#else
+	name = PyString_FromString("__main__");
+	#endif
+	okay = (
+		name != NULL &&
+		(state->baseGlobalsDict = PyDict_New()) != NULL &&
+		PyDict_SetItemString(state->baseGlobalsDict, "__builtins__", PyEval_GetBuiltins()) == 0 &&
+		PyDict_SetItemString(state->baseGlobalsDict, "__name__", name) == 0
+	);
+	Py_XDECREF(name);
+	if (!okay) {
+		PyErr_Clear();
+		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return state; // error
+	}
+
+	// Okay
+	state->status = PYP_MODULE_SETUP_STATUS_OKAY;
+	return state;
+}
+
+void
+pypModulePythonDetach(PypPythonState* pythonState) {
+	assert(pythonState != NULL);
+
+	// The interpreter keeps running
+	if (pythonState->baseGlobalsDict != NULL) Py_DECREF(pythonState->baseGlobalsDict);
+	memFree(pythonState);
+}
+
+PyObject*
+pypModuleErrorType(PyObject* module) {
+	assert(module != NULL);
+
+	return GETSTATE(module)->error;
+}
+#endif
+
+PypModuleSetupStatus
+pypModulePythonInit(PypModuleExecutionInfo* executionInfo) {
+	// Vars
+	PypPythonState* pyState;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(executionInfo->pythonState != NULL);
+	assert(executionInfo->pythonState->mainModule == NULL);
+	assert(executionInfo->pythonState->pypModule == NULL);
+	assert(executionInfo->pythonState->globalsDict == NULL);
+	assert(executionInfo->pythonState->localsDict == NULL);
+
+	// Module importing
+	pyState = executionInfo->pythonState;
+	if (
+		(pyState->gc.disableDuringRender && !pypGcRenderDisable(pyState)) ||
+		(pyState->mainModule = PyImport_AddModule("__main__")) == NULL ||
+		(pyState->pypModule = PyImport_ImportModule(pypModuleName)) == NULL ||
+		(pyState->globalsDict = PyDict_Copy((pyState->baseGlobalsDict != NULL) ? pyState->baseGlobalsDict : PyModule_GetDict(pyState->mainModule))) == NULL ||
+		PyDict_SetItemString(pyState->globalsDict, pypModuleName, pyState->pypModule) != 0
+	) {
+		// Error
+		pypModulePythonDeinit(executionInfo);
+		return PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+	}
+
+	// Okay
+	return PYP_MODULE_SETUP_STATUS_OKAY;
+}
+
+void
+pypModulePythonDeinit(PypModuleExecutionInfo* executionInfo) {
+	// Vars
+	PypPythonState* pyState;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(executionInfo->pythonState != NULL);
+
+	// Clear
+	pyState = executionInfo->pythonState;
+	if (pyState->globalsDict != NULL) {
+		Py_DECREF(pyState->globalsDict);
+		pyState->globalsDict = NULL;
+	}
+	if (pyState->localsDict != NULL) {
+		Py_DECREF(pyState->localsDict);
+		pyState->localsDict = NULL;
+	}
+	if (pyState->pypModule != NULL) {
+		Py_DECREF(pyState->pypModule);
+		pyState->pypModule = NULL;
+	}
+	if (pyState->mainModule != NULL) {
+		pyState->mainModule = NULL;
+	}
+
+	#ifdef PYP_ASYNC_SUPPORTED
+	pypAsyncEventLoopClose();
+	#endif
+
+	pypModuleExceptionHandlingDeinit(pyState);
 
-	// Get and modift
-	if (
-		!PyArg_UnpackTuple(args, "write", 1, 1, &object) ||
-		!pypStringObjectExtendDataBuffer(pypCurrentDataBuffer, object, pypCurrentExecutionInfo->encoding, pypCurrentExecutionInfo->encodingErrorMode)
-	) {
-		// Error
-		PyErr_BadArgument();
-		return NULL;
+	// Garbage left by the render is collected once the collector next runs
+	if (pyState->gcRenderDisabled) {
+		if (!pypGcCall("enable")) PyErr_Clear();
+		pyState->gcRenderDisabled = PYP_FALSE;
 	}
-
-	// Done
-	Py_RETURN_NONE;
 }
 
 
 
-// Visible methods
-PypReadStatus
-pypIncludeFromExecutionInfo(PypModuleExecutionInfo* executionInfo) {
+// Garbage collection
+void
+pypModuleGcSettingsInit(PypGcSettings* settings) {
+	assert(settings != NULL);
+
+	settings->disableDuringRender = PYP_FALSE;
+	settings->freeze = PYP_FALSE;
+	settings->timed = PYP_FALSE;
+	settings->thresholds[0] = -1;
+	settings->thresholds[1] = -1;
+	settings->thresholds[2] = -1;
+}
+
+PypModuleSetupStatus
+pypModuleGcSetup(PypPythonState* pythonState, const PypGcSettings* settings) {
 	// Vars
-	PypReadStatus readStatus;
-	PypModuleExecutionInfo* previousExecutionInfo;
-	unicode_char* applicationCwd = NULL;
-	unicode_char* pythonCwd = NULL;
-	cmd_char* newCwd = NULL;
-	size_t applicationCwdLength;
-	size_t pythonCwdLength;
+	PyObject* gcModule;
+	PyObject* result = NULL;
+	#ifdef PYP_GC_CALLBACKS_SUPPORTED
+	PyObject* callbacks = NULL;
+	PyObject* callback = NULL;
+	#endif
+	long int thresholds[3];
+	size_t i;
+	PypModuleSetupStatus status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
 
 	// Assertions
-	assert(executionInfo != NULL);
-	assert(executionInfo->pythonState != NULL);
-	assert(executionInfo->pythonState->mainModule != NULL);
-	assert(executionInfo->pythonState->pypModule != NULL);
-	assert(executionInfo->pythonState->globalsDict != NULL);
+	assert(pythonState != NULL);
+	assert(settings != NULL);
 
-	// Get the current directory
-	previousExecutionInfo = pypCurrentExecutionInfo;
-	if (
-		pathGetCurrentWorkingDirectoryUnicode(&applicationCwd, &applicationCwdLength) != PATH_OKAY ||
-		!pypPathCurrentDirectoryGet(executionInfo->pythonState, &pythonCwd, &pythonCwdLength) ||
-		(newCwd = memAllocArray(cmd_char, executionInfo->inputFilenameStart)) == NULL
-	) {
-		// Error
-		if (applicationCwd != NULL) memFree(applicationCwd);
-		if (pythonCwd != NULL) memFree(pythonCwd);
-		return PYP_READ_ERROR_DIRECTORY;
+	// Each interpreter has its own collector
+	pythonState->gc = *settings;
+	if ((gcModule = PyImport_ImportModule("gc")) == NULL) goto cleanup; // error
+
+	// Thresholds which aren't set are kept
+	if (settings->thresholds[0] >= 0 || settings->thresholds[1] >= 0 || settings->thresholds[2] >= 0) {
+		if (
+			(result = PyObject_CallMethod(gcModule, "get_threshold", NULL)) == NULL ||
+			!PyArg_ParseTuple(result, "lll", &thresholds[0], &thresholds[1], &thresholds[2])
+		) {
+			goto cleanup; // error
+		}
+		Py_DECREF(result);
+		for (i = 0; i < 3; ++i) {
+			if (settings->thresholds[i] >= 0) thresholds[i] = settings->thresholds[i];
+		}
+		if ((result = PyObject_CallMethod(gcModule, "set_threshold", "lll", thresholds[0], thresholds[1], thresholds[2])) == NULL) goto cleanup; // error
 	}
 
-	// Setup
-	memcpy(newCwd, executionInfo->inputFilename, sizeof(cmd_char) * (executionInfo->inputFilenameStart - 1));
-	newCwd[executionInfo->inputFilenameStart - 1] = '\x00';
+	// Pauses are measured by python's own start and stop callbacks
+	#ifdef PYP_GC_CALLBACKS_SUPPORTED
+	if (settings->timed) {
+		if (
+			(callbacks = PyObject_GetAttrString(gcModule, "callbacks")) == NULL ||
+			(callback = PyCFunction_New(&pypGcCallbackMethod, NULL)) == NULL ||
+			PyList_Append(callbacks, callback) != 0
+		) {
+			goto cleanup; // error
+		}
+	}
+	#endif
 
-	pypCurrentExecutionInfo = executionInfo;
-	pathSetCurrentWorkingDirectoryUnicode(newCwd);
-	pypPathCurrentDirectorySet(executionInfo->pythonState, newCwd);
+	// Whatever startup created
+	pypModuleGcFreeze(pythonState);
+	status = PYP_MODULE_SETUP_STATUS_OKAY;
 
+	// Clean
+	cleanup:
+	if (status != PYP_MODULE_SETUP_STATUS_OKAY) PyErr_Print();
+	#ifdef PYP_GC_CALLBACKS_SUPPORTED
+	Py_XDECREF(callback);
+	Py_XDECREF(callbacks);
+	#endif
+	Py_XDECREF(result);
+	Py_XDECREF(gcModule);
+	return status;
+}
 
-	// Process
-	readStatus = pypReadFromStream(executionInfo->inputStream, executionInfo->outputStream, executionInfo->errorStream, executionInfo->outputDataBuffer, executionInfo->piMain, executionInfo->optimizedTags, executionInfo->readSettings, executionInfo);
+void
+pypModuleGcFreeze(PypPythonState* pythonState) {
+	assert(pythonState != NULL);
 
+	// Moves every object currently tracked into a generation which is never collected
+	#ifdef PYP_GC_FREEZE_SUPPORTED
+	if (pythonState->gc.freeze && !pypGcCall("freeze")) PyErr_Clear();
+	#endif
+}
 
-	// Revert current directory
-	pypPathCurrentDirectorySet(executionInfo->pythonState, pythonCwd);
-	pathSetCurrentWorkingDirectoryUnicode(applicationCwd);
-	memFree(newCwd);
-	memFree(pythonCwd);
-	memFree(applicationCwd);
+void
+pypModuleGcCollect(PypPythonState* pythonState) {
+	assert(pythonState != NULL);
 
-	// Revert
-	pypCurrentExecutionInfo = previousExecutionInfo;
+	if (!pypGcCall("collect")) PyErr_Clear();
+}
 
-	// Don
-	return readStatus;
+PypBool
+pypGcCall(const char* methodName) {
+	// Vars
+	PyObject* gcModule;
+	PyObject* result;
+
+	// Assertions
+	assert(methodName != NULL);
+
+	// Call without arguments
+	if ((gcModule = PyImport_ImportModule("gc")) == NULL) return PYP_FALSE; // error
+	result = PyObject_CallMethod(gcModule, (char*) methodName, NULL); // not const on python 2
+	Py_DECREF(gcModule);
+	if (result == NULL) return PYP_FALSE; // error
+
+	Py_DECREF(result);
+	return PYP_TRUE;
 }
 
-PypModuleExecutionInfo*
-pypModuleExecutionInfoCreate(PypModuleExecutionInfo* info, PypReaderSettings* readSettings, PypProcessingInfo* piMain, PypProcessingInfo* piCodeBlock, PypProcessingInfo* piCodeExpression, PypTagGroup* optimizedTags, FILE* inputStream, FILE* outputStream, FILE* errorStream, PypDataBuffer* outputDataBuffer, const cmd_char* inputFilename, const char* encoding, const char* encodingErrorMode, PypPythonState* pythonState) {
+PypBool
+pypGcRenderDisable(PypPythonState* pyState) {
 	// Vars
-	PypBool created = PYP_FALSE;
-	size_t i;
+	PyObject* gcModule;
+	PyObject* result;
+	int enabled;
 
 	// Assertions
-	assert(readSettings != NULL);
-	assert(piMain != NULL);
-	assert(piCodeBlock != NULL || piCodeExpression != NULL);
-	assert(optimizedTags != NULL);
-	assert(inputStream != NULL);
-	assert(outputStream != NULL);
-	assert(errorStream != NULL);
-	assert(inputFilename != NULL);
-	assert(encoding != NULL);
-	assert(encodingErrorMode != NULL);
-	assert(pythonState != NULL);
+	assert(pyState != NULL);
 
-	// Create
-	if (info == NULL) {
-		info = memAlloc(PypModuleExecutionInfo);
-		if (info == NULL) return NULL;
-		created = PYP_TRUE;
+	if (pyState->gcRenderDisabled) return PYP_TRUE;
+
+	// If it's already off, it's left for whatever turned it off to turn back on
+	if ((gcModule = PyImport_ImportModule("gc")) == NULL) return PYP_FALSE; // error
+	result = PyObject_CallMethod(gcModule, "isenabled", NULL);
+	enabled = (result != NULL) ? PyObject_IsTrue(result) : -1;
+	Py_XDECREF(result);
+	if (enabled > 0) {
+		if ((result = PyObject_CallMethod(gcModule, "disable", NULL)) != NULL) {
+			Py_DECREF(result);
+			pyState->gcRenderDisabled = PYP_TRUE;
+		}
+		else {
+			enabled = -1;
+		}
 	}
+	Py_DECREF(gcModule);
 
-	// Set
-	info->readSettings = readSettings;
+	return (enabled >= 0);
+}
 
-	info->piMain = piMain;
-	info->piCodeBlock = piCodeBlock;
-	info->piCodeExpression = piCodeExpression;
+#ifdef PYP_GC_CALLBACKS_SUPPORTED
+PyObject*
+pypGcCallback(PyObject* self, PyObject* args) {
+	// Vars
+	PyObject* phase;
+	PyObject* info;
 
-	info->optimizedTags = optimizedTags;
+	// Called as callback(phase, info), where phase is "start" or "stop"
+	if (!PyArg_UnpackTuple(args, "_gc_callback", 2, 2, &phase, &info)) return NULL; // error
 
-	info->inputStream = inputStream;
-	info->outputStream = outputStream;
-	info->errorStream = errorStream;
-	info->outputDataBuffer = outputDataBuffer;
+	if (PyUnicode_Check(phase) && PyUnicode_CompareWithASCIIString(phase, "start") == 0) {
+		pypGcCollectionStart = pypStatsClock();
+	}
+	else if (pypGcCollectionStart != 0) {
+		pypStatsAdd(PYP_STATS_GC_COLLECTIONS, 1);
+		pypStatsAdd(PYP_STATS_GC_PAUSE, pypStatsClock() - pypGcCollectionStart);
+		pypGcCollectionStart = 0;
+	}
 
-	// Copy file name
-	if (pathAbsoluteUnicode(inputFilename, &info->inputFilename, &info->inputFilenameLength) != PATH_OKAY) goto cleanup; // error
-	info->inputFilenameStart = 0;
-	for (i = info->inputFilenameLength; i > 0; ) {
-		--i;
+	Py_RETURN_NONE;
+}
+#endif
 
-		if (pathCharIsSeparatorUnicode(info->inputFilename[i])) {
-			// Done
-			info->inputFilenameStart = i + 1;
-			break;
-		}
-	}
 
-	info->encoding = encoding;
-	info->encodingErrorMode = encodingErrorMode;
+// Expression memoization
+#ifdef PYP_MEMOIZE_SUPPORTED
+PypModuleSetupStatus
+pypModuleMemoizeSetup(PypPythonState* pythonState) {
+	// Vars
+	PyObject* globalsDict = NULL;
+	PyObject* code = NULL;
+	PyObject* result = NULL;
+	PypModuleSetupStatus status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+	const char* const sourceCode =
+		"import dis\n"
+		"skipped = frozenset(('CACHE', 'EXTENDED_ARG'))\n"
+		"pure = frozenset((\n"
+			"'LOAD_CONST', 'LOAD_SMALL_INT', 'RETURN_VALUE', 'RETURN_CONST', 'RESUME', 'NOP', 'NOT_TAKEN',\n"
+			"'POP_TOP', 'COPY', 'SWAP', 'DUP_TOP', 'ROT_TWO', 'ROT_THREE', 'TO_BOOL',\n"
+			"'COMPARE_OP', 'IS_OP', 'CONTAINS_OP', 'BUILD_TUPLE', 'BUILD_SLICE', 'BUILD_STRING',\n"
+			"'FORMAT_VALUE', 'FORMAT_SIMPLE', 'FORMAT_WITH_SPEC', 'CONVERT_VALUE', 'JUMP_FORWARD',\n"
+		"))\n"
+		"prefixes = ('BINARY_', 'UNARY_', 'POP_JUMP_', 'JUMP_IF_')\n"
+		"def analyze(code):\n"
+			"\tfor const in code.co_consts:\n"
+				"\t\tif isinstance(const, type(code)): return None\n"
+			"\tchains = []\n"
+			"\tchained = False\n"
+			"\tfor instruction in dis.get_instructions(code):\n"
+				"\t\tname = instruction.opname\n"
+				"\t\tif name in skipped: continue\n"
+				"\t\tif name == 'LOAD_NAME' or name == 'LOAD_GLOBAL':\n"
+					"\t\t\tchains.append((instruction.argval,))\n"
+					"\t\t\tchained = True\n"
+				"\t\telif name == 'LOAD_ATTR' and chained:\n"
+					"\t\t\tchains[-1] += (instruction.argval,)\n"
+				"\t\telif name in pure or name.startswith(prefixes):\n"
+					"\t\t\tchained = False\n"
+				"\t\telse:\n"
+					"\t\t\treturn None\n"
+			"\treturn tuple(chains)\n";
 
-	info->pythonState = pythonState;
+	// Assertions
+	assert(pythonState != NULL);
+	assert(pythonState->memoizeAnalyzer == NULL);
+	assert(pythonState->memoizedExpressions == NULL);
 
-	// Done
-	return info;
+	// Instructions are read by name, since the bytecode itself changes between versions
+	if (
+		(globalsDict = PyDict_New()) == NULL ||
+		PyDict_SetItemString(globalsDict, "__builtins__", PyEval_GetBuiltins()) != 0 ||
+		(code = Py_CompileString(sourceCode, pypModuleName, Py_file_input)) == NULL ||
+		(result = PyEval_EvalCode(code, globalsDict, globalsDict)) == NULL ||
+		(pythonState->memoizeAnalyzer = PyDict_GetItemString(globalsDict, "analyze")) == NULL
+	) {
+		goto cleanup; // error
+	}
+	Py_INCREF(pythonState->memoizeAnalyzer);
+	if ((pythonState->memoizedExpressions = PyDict_New()) == NULL) goto cleanup; // error
+	status = PYP_MODULE_SETUP_STATUS_OKAY;
 
-	// Cleanup
+	// Clean
 	cleanup:
-	if (created) memFree(info);
-	return NULL;
+	if (status != PYP_MODULE_SETUP_STATUS_OKAY) {
+		if (PyErr_Occurred() != NULL) PyErr_Print();
+		pypModuleMemoizeDeinit(pythonState);
+	}
+	Py_XDECREF(result);
+	Py_XDECREF(code);
+	Py_XDECREF(globalsDict);
+	return status;
 }
 
 void
-pypModuleExecutionInfoClean(PypModuleExecutionInfo* executionInfo) {
-	assert(executionInfo != NULL);
-	assert(executionInfo->inputFilename != NULL);
+pypModuleMemoizeDeinit(PypPythonState* pyState) {
+	assert(pyState != NULL);
 
-	memFree(executionInfo->inputFilename);
+	// Clear
+	if (pyState->memoizedExpressions != NULL) {
+		Py_DECREF(pyState->memoizedExpressions);
+		pyState->memoizedExpressions = NULL;
+	}
+	if (pyState->memoizeAnalyzer != NULL) {
+		Py_DECREF(pyState->memoizeAnalyzer);
+		pyState->memoizeAnalyzer = NULL;
+	}
 }
 
-PypPythonState*
-pypModulePythonSetup(const cmd_char* applicationPath) {
+PypBool
+pypMemoizeFetch(PypPythonState* pyState, PyObject* key, PyObject** entry, PypDataBuffer* output) {
 	// Vars
-	PypPythonState* state;
-	size_t applicationPathLength;
-	size_t outputCharacterCount;
-	size_t errorCount;
+	PyObject* leaves;
+	PyObject* storedLeaves;
+	PyObject* storedOutput;
+	Py_ssize_t i;
+	PypBool same;
 
 	// Assertions
-	assert(applicationPath != NULL);
+	assert(pyState != NULL);
+	assert(pyState->memoizedExpressions != NULL);
+	assert(key != NULL);
+	assert(entry != NULL);
+	assert(output != NULL);
 
-	// Create state
-	state = memAlloc(PypPythonState);
-	if (state == NULL) return NULL; // error
+	// Entries are (chains, leaves, output), or None if the expression can't be memoized
+	*entry = PyDict_GetItem(pyState->memoizedExpressions, key);
+	if (*entry == NULL) return PYP_FALSE;
+	Py_INCREF(*entry);
+	if (*entry == Py_None) return PYP_FALSE;
+
+	// Resolved again on every use, since names can be rebound and attributes set
+	storedLeaves = PyTuple_GET_ITEM(*entry, 1);
+	storedOutput = PyTuple_GET_ITEM(*entry, 2);
+	leaves = pypMemoizeResolve(pyState, PyTuple_GET_ITEM(*entry, 0));
+	same = (leaves != NULL);
+	for (i = 0; same && i < PyTuple_GET_SIZE(leaves); ++i) {
+		same = pypMemoizeValueSame(PyTuple_GET_ITEM(leaves, i), PyTuple_GET_ITEM(storedLeaves, i));
+	}
+	Py_XDECREF(leaves);
 
-	// Vars
-	state->mainModule = NULL;
-	state->pypModule = NULL;
-	state->globalsDict = NULL;
-	state->localsDict = NULL;
+	// Output
+	if (
+		!same ||
+		(PyBytes_GET_SIZE(storedOutput) > 0 && pypDataBufferExtendWithData(output, PyBytes_AS_STRING(storedOutput), (PypSize) PyBytes_GET_SIZE(storedOutput)) == NULL)
+	) {
+		return PYP_FALSE;
+	}
 
-	state->exceptionHandlerCompiledCode = NULL;
-	state->exceptionHandlerGlobalsDict = NULL;
+	// Done
+	pypStatsAdd(PYP_STATS_MEMOIZED_HITS, 1);
+	return PYP_TRUE;
+}
 
-	state->includeFunctionOsModule = NULL;
-	state->includeFunctionOsPathModule = NULL;
+void
+pypMemoizeStore(PypPythonState* pyState, PyObject* key, PyObject* code, PyObject* entry, const PypDataBuffer* output) {
+	// Vars
+	PyObject* chains;
+	PyObject* leaves = NULL;
+	PyObject* data = NULL;
+	PyObject* newEntry = NULL;
+	PypDataBufferEntry* bufferEntry;
+	char* target;
+	Py_ssize_t i;
+	PypBool immutable = PYP_FALSE;
 
-	// Setup paths
-	state->applicationName = NULL;
-	state->applicationNameUnicode = NULL;
+	// Assertions
+	assert(pyState != NULL);
+	assert(pyState->memoizedExpressions != NULL);
+	assert(key != NULL);
+	assert(code != NULL);
+	assert(entry != Py_None);
+	assert(output != NULL);
 
-	applicationPathLength = getUnicodeCharStringLength(applicationPath);
-	state->applicationNameUnicode = memAllocArray(cmd_char, applicationPathLength + 1);
-	if (state->applicationNameUnicode == NULL) {
-		state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
-		return state; // error
+	// Analyzed the first time it's evaluated
+	if (entry == NULL) {
+		if ((chains = PyObject_CallFunctionObjArgs(pyState->memoizeAnalyzer, code, NULL)) == NULL) goto cleanup; // error
+	}
+	else {
+		chains = PyTuple_GET_ITEM(entry, 0);
+		Py_INCREF(chains);
 	}
-	memcpy(state->applicationNameUnicode, applicationPath, sizeof(cmd_char) * (applicationPathLength + 1));
 
-	if (unicodeUTF8EncodeLength(applicationPath, applicationPathLength, &state->applicationName, &outputCharacterCount, &errorCount) != UNICODE_OKAY) {
-		state->status = PYP_MODULE_SETUP_STATUS_ERROR_MEMORY;
-		return state; // error
+	// Expressions which call anything, or read a value which could change in place, are never memoized
+	if (chains != Py_None) {
+		pypStatsAdd(PYP_STATS_MEMOIZED_MISSES, 1);
+		if ((leaves = pypMemoizeResolve(pyState, chains)) != NULL) {
+			immutable = PYP_TRUE;
+			for (i = 0; immutable && i < PyTuple_GET_SIZE(leaves); ++i) {
+				immutable = pypMemoizeValueImmutable(PyTuple_GET_ITEM(leaves, i));
+			}
+		}
+	}
+	if (!immutable) {
+		PyDict_SetItem(pyState->memoizedExpressions, key, Py_None);
+		goto cleanup;
 	}
 
-	// Add the module to be initialized
-	if (PyImport_AppendInittab("pyp", pypModuleInit) != 0) {
-		state->status = PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
-		return state; // error
+	// Copied into one string; an expression which calls nothing can't leave slot placeholders
+	if ((data = PyBytes_FromStringAndSize(NULL, (Py_ssize_t) output->totalSize)) == NULL) goto cleanup; // error
+	target = PyBytes_AS_STRING(data);
+	for (bufferEntry = output->firstChild; bufferEntry != NULL; bufferEntry = bufferEntry->nextSibling) {
+		memcpy(target, bufferEntry->buffer, sizeof(PypChar) * bufferEntry->bufferLength);
+		target += bufferEntry->bufferLength;
 	}
 
-	// Setup python
-	#if PY_MAJOR_VERSION >= 3
-	Py_SetProgramName(state->applicationNameUnicode);
-	#else
-	Py_SetProgramName(state->applicationName);
-	#endif
-	Py_Initialize();
+	// Replaces what was stored for older values
+	if ((newEntry = PyTuple_Pack(3, chains, leaves, data)) == NULL) goto cleanup; // error
+	PyDict_SetItem(pyState->memoizedExpressions, key, newEntry);
 
-	// Okay
-	state->status = PYP_MODULE_SETUP_STATUS_OKAY;
-	return state;
+	// Clean; failing to store only means it's evaluated next time
+	cleanup:
+	if (PyErr_Occurred() != NULL) PyErr_Clear();
+	Py_XDECREF(newEntry);
+	Py_XDECREF(data);
+	Py_XDECREF(leaves);
+	Py_XDECREF(chains);
 }
 
-void
-pypModulePythonFinalize(PypPythonState* pythonState) {
-	assert(pythonState != NULL);
+PyObject*
+pypMemoizeResolve(PypPythonState* pyState, PyObject* chains) {
+	// Vars
+	PyObject* leaves;
+	PyObject* chain;
+	PyObject* value;
+	PyObject* next;
+	Py_ssize_t i;
+	Py_ssize_t j;
 
-	// Finish
-	Py_Finalize();
+	// Assertions
+	assert(pyState != NULL);
+	assert(pyState->globalsDict != NULL);
+	assert(chains != NULL);
 
-	// Delete paths
-	if (pythonState->applicationName != NULL) memFree(pythonState->applicationName);
-	if (pythonState->applicationNameUnicode != NULL) memFree(pythonState->applicationNameUnicode);
-	memFree(pythonState);
-}
+	// Create
+	if ((leaves = PyTuple_New(PyTuple_GET_SIZE(chains))) == NULL) {
+		// Error
+		PyErr_Clear();
+		return NULL;
+	}
 
-PypModuleSetupStatus
-pypModulePythonInit(PypModuleExecutionInfo* executionInfo) {
-	// Vars
-	PypPythonState* pyState;
+	for (i = 0; i < PyTuple_GET_SIZE(chains); ++i) {
+		chain = PyTuple_GET_ITEM(chains, i);
+
+		// Looked up where the expression looks; names only found in builtins are left unresolved
+		value = NULL;
+		if (pyState->localsDict != NULL) value = PyDict_GetItem(pyState->localsDict, PyTuple_GET_ITEM(chain, 0));
+		if (value == NULL) value = PyDict_GetItem(pyState->globalsDict, PyTuple_GET_ITEM(chain, 0));
+		if (value == NULL) {
+			// Error
+			Py_DECREF(leaves);
+			return NULL;
+		}
+		Py_INCREF(value);
 
-	// Assertions
-	assert(executionInfo != NULL);
-	assert(executionInfo->pythonState != NULL);
-	assert(executionInfo->pythonState->mainModule == NULL);
-	assert(executionInfo->pythonState->pypModule == NULL);
-	assert(executionInfo->pythonState->globalsDict == NULL);
-	assert(executionInfo->pythonState->localsDict == NULL);
+		// Attributes
+		for (j = 1; j < PyTuple_GET_SIZE(chain); ++j) {
+			next = PyObject_GetAttr(value, PyTuple_GET_ITEM(chain, j));
+			Py_DECREF(value);
+			if ((value = next) == NULL) {
+				// Error
+				PyErr_Clear();
+				Py_DECREF(leaves);
+				return NULL;
+			}
+		}
+
+		PyTuple_SET_ITEM(leaves, i, value);
+	}
+
+	// Done
+	return leaves;
+}
 
-	// Module importing
-	pyState = executionInfo->pythonState;
+PypBool
+pypMemoizeValueImmutable(PyObject* value) {
+	// Vars
+	Py_ssize_t i;
+
+	// Assertions
+	assert(value != NULL);
+
+	// Exact types only, since a subclass can format itself however it likes
 	if (
-		(pyState->mainModule = PyImport_AddModule("__main__")) == NULL ||
-		(pyState->pypModule = PyImport_ImportModule(pypModuleName)) == NULL ||
-		(pyState->globalsDict = PyDict_Copy(PyModule_GetDict(pyState->mainModule))) == NULL ||
-		PyDict_SetItemString(pyState->globalsDict, pypModuleName, pyState->pypModule) != 0
+		value == Py_None ||
+		PyBool_Check(value) ||
+		PyLong_CheckExact(value) ||
+		PyFloat_CheckExact(value) ||
+		PyComplex_CheckExact(value) ||
+		PyUnicode_CheckExact(value) ||
+		PyBytes_CheckExact(value)
 	) {
-		// Error
-		pypModulePythonDeinit(executionInfo);
-		return PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		return PYP_TRUE;
 	}
 
-	// Okay
-	return PYP_MODULE_SETUP_STATUS_OKAY;
+	// Tuples of the above
+	if (PyTuple_CheckExact(value)) {
+		for (i = 0; i < PyTuple_GET_SIZE(value); ++i) {
+			if (!pypMemoizeValueImmutable(PyTuple_GET_ITEM(value, i))) return PYP_FALSE;
+		}
+		return PYP_TRUE;
+	}
+
+	// Anything else
+	return PYP_FALSE;
 }
 
-void
-pypModulePythonDeinit(PypModuleExecutionInfo* executionInfo) {
+PypBool
+pypMemoizeValueSame(PyObject* value1, PyObject* value2) {
 	// Vars
-	PypPythonState* pyState;
+	double float1;
+	double float2;
+	Py_complex complex1;
+	Py_complex complex2;
+	Py_ssize_t i;
+	int result;
 
 	// Assertions
-	assert(executionInfo != NULL);
-	assert(executionInfo->pythonState != NULL);
-
-	// Clear
-	pyState = executionInfo->pythonState;
-	if (pyState->globalsDict != NULL) {
-		Py_DECREF(pyState->globalsDict);
-		pyState->globalsDict = NULL;
+	assert(value1 != NULL);
+	assert(value2 != NULL);
+
+	// Usually the same object, since most globals aren't rebound between renders
+	if (value1 == value2) return PYP_TRUE;
+	if (Py_TYPE(value1) != Py_TYPE(value2)) return PYP_FALSE;
+
+	// Compared bit for bit, since 0.0 and -0.0 are equal but don't format the same
+	if (PyFloat_CheckExact(value1)) {
+		float1 = PyFloat_AS_DOUBLE(value1);
+		float2 = PyFloat_AS_DOUBLE(value2);
+		return (memcmp(&float1, &float2, sizeof(double)) == 0);
 	}
-	if (pyState->localsDict != NULL) {
-		Py_DECREF(pyState->localsDict);
-		pyState->localsDict = NULL;
+	if (PyComplex_CheckExact(value1)) {
+		complex1 = PyComplex_AsCComplex(value1);
+		complex2 = PyComplex_AsCComplex(value2);
+		return (memcmp(&complex1, &complex2, sizeof(Py_complex)) == 0);
 	}
-	if (pyState->pypModule != NULL) {
-		Py_DECREF(pyState->pypModule);
-		pyState->pypModule = NULL;
+
+	// Tuples
+	if (PyTuple_CheckExact(value1)) {
+		if (PyTuple_GET_SIZE(value1) != PyTuple_GET_SIZE(value2)) return PYP_FALSE;
+		for (i = 0; i < PyTuple_GET_SIZE(value1); ++i) {
+			if (!pypMemoizeValueSame(PyTuple_GET_ITEM(value1, i), PyTuple_GET_ITEM(value2, i))) return PYP_FALSE;
+		}
+		return PYP_TRUE;
 	}
-	if (pyState->mainModule != NULL) {
-		pyState->mainModule = NULL;
+
+	// Strings and integers
+	if (PyUnicode_CheckExact(value1) || PyBytes_CheckExact(value1) || PyLong_CheckExact(value1)) {
+		result = PyObject_RichCompareBool(value1, value2, Py_EQ);
+		if (result < 0) PyErr_Clear();
+		return (result > 0);
 	}
 
-	pypModuleExceptionHandlingDeinit(pyState);
-	pypModuleIncludeFunctionsDeinit(pyState);
+	// Anything else
+	return PYP_FALSE;
 }
+#endif
 
 
 
@@ -750,207 +4657,340 @@ pypStringObjectExtendDataBuffer(PypDataBuffer* dataBuffer, PyObject* object, con
 }
 
 
+PypBool
+pypIteratorExtendDataBuffer(PypDataBuffer* dataBuffer, PyObject* iterator, const char* encoding, const char* encodingErrorMode) {
+	// Vars
+	PyObject* chunk;
+	PypBool okay;
 
-// Python cwd interaction
-PypModuleSetupStatus
-pypModuleIncludeFunctionsInit(PypPythonState* pyState) {
+	// Assertions
+	assert(dataBuffer != NULL);
+	assert(iterator != NULL);
+
+	// Each chunk is copied into the buffer and released, so the whole result never exists at once
+	while ((chunk = PyIter_Next(iterator)) != NULL) {
+		okay = pypStringObjectExtendDataBuffer(dataBuffer, chunk, encoding, encodingErrorMode);
+		if (okay && dataBuffer->totalSize >= PYP_MODULE_WRITE_THROUGH_SIZE) okay = pypIteratorWriteThrough(dataBuffer);
+		else if (!okay && PyErr_Occurred() == NULL) {
+			#if PY_MAJOR_VERSION >= 3
+			if (PyUnicode_Check(chunk) || PyBytes_Check(chunk)) {
+			#else
+			if (PyUnicode_Check(chunk) || PyString_Check(chunk)) {
+			#endif
+				PyErr_NoMemory();
+			}
+			else {
+				PyErr_Format(PyExc_TypeError, "Output chunks must be strings, not %.100s", Py_TYPE(chunk)->tp_name);
+			}
+		}
+		Py_DECREF(chunk);
+		if (!okay) return PYP_FALSE; // error
+	}
+
+	// Done, unless the iterator raised
+	return (PyErr_Occurred() == NULL);
+}
+
+PypBool
+pypIteratorWriteThrough(PypDataBuffer* dataBuffer) {
 	// Vars
-	const char* const osModuleName = "os";
+	PypModuleExecutionInfo* executionInfo = pypModuleContext.executionInfo;
+	PypDataBufferEntry* entry;
 
 	// Assertions
-	assert(pyState != NULL);
-	assert(pyState->includeFunctionOsModule == NULL);
-	assert(pyState->includeFunctionOsPathModule == NULL);
+	assert(dataBuffer != NULL);
 
-	// Module importing
+	// Only the running tag's own output, with nothing around it which would still change it or hold it back
 	if (
-		(pyState->includeFunctionOsModule = PyImport_ImportModule(osModuleName)) == NULL ||
-		(pyState->includeFunctionOsPathModule = PyObject_GetAttrString(pyState->includeFunctionOsModule, "path")) == NULL
+		executionInfo == NULL ||
+		!executionInfo->tagWriteThrough ||
+		dataBuffer != executionInfo->tagDataBuffer ||
+		pypModuleContext.dataBuffer != dataBuffer ||
+		pypModuleContext.asyncIncludes != NULL ||
+		(executionInfo->slots != NULL && executionInfo->slots->firstChild != NULL)
 	) {
+		return PYP_TRUE;
+	}
+
+	// Everything before the tag was already written, so it follows in order
+	for (entry = dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+		if (fwrite(entry->buffer, sizeof(PypChar), entry->bufferLength, executionInfo->outputStream) != entry->bufferLength) {
+			// Error
+			PyErr_SetString(PyExc_IOError, "Error writing output");
+			return PYP_FALSE;
+		}
+	}
+	if (fflush(executionInfo->outputStream) != 0) {
 		// Error
-		pypModuleIncludeFunctionsDeinit(pyState);
-		return PYP_MODULE_SETUP_STATUS_ERROR_PYTHON;
+		PyErr_SetString(PyExc_IOError, "Error writing output");
+		return PYP_FALSE;
 	}
+	pypDataBufferEmpty(dataBuffer);
 
-	// Okay
-	return PYP_MODULE_SETUP_STATUS_OKAY;
+	// Done
+	return PYP_TRUE;
 }
 
-void
-pypModuleIncludeFunctionsDeinit(PypPythonState* pyState) {
-	assert(pyState != NULL);
 
-	// Clear
-	pyState->includeFunctionOsPathModule = NULL;
-	if (pyState->includeFunctionOsModule != NULL) {
-		Py_DECREF(pyState->includeFunctionOsModule);
-		pyState->includeFunctionOsModule = NULL;
-	}
-}
 
+// Paths
 PypBool
-pypPathAbsolute(PypPythonState* pyState, PyObject* pathObject, unicode_char** outputBuffer, size_t* outputBufferLength) {
+pypPathFromObject(PyObject* object, unicode_char** path) {
 	// Vars
-	PyObject* absPath = NULL;
-	PyObject* methodName = NULL;
 	PyObject* newObject = NULL;
-	#if PY_MAJOR_VERSION < 3
-	PyObject* pathObjectNew = NULL;
+	#if PY_VERSION_HEX >= 0x03060000
+	PyObject* pathObject;
 	#endif
 	char* buffer;
 	Py_ssize_t bufferLength;
 	size_t outputCharacterCount;
+	size_t pathLength;
 	size_t errorCount;
+	PypBool okay;
 
 	// Assertions
-	assert(pyState != NULL);
-	assert(pathObject != NULL);
-	assert(outputBuffer != NULL);
-	assert(outputBufferLength != NULL);
+	assert(object != NULL);
+	assert(path != NULL);
 
-	// Setup
-	if (
-		pyState->includeFunctionOsModule == NULL &&
-		pypModuleIncludeFunctionsInit(pyState) != PYP_MODULE_SETUP_STATUS_OKAY
-	) {
+	// str, bytes, or anything with __fspath__
+	#if PY_VERSION_HEX >= 0x03060000
+	if ((pathObject = PyOS_FSPath(object)) == NULL) {
 		// Error
+		PyErr_Clear();
 		return PYP_FALSE;
 	}
-
-	// Convert to unicode if python 2
-	#if PY_MAJOR_VERSION < 3
-	if (!PyUnicode_Check(pathObject) && PyString_Check(pathObject)) {
-		pathObjectNew = PyUnicode_FromObject(pathObject);
-		if (pathObjectNew == NULL) return PYP_FALSE; // error
-		pathObject = pathObjectNew;
-	}
+	object = pathObject;
 	#endif
 
-	// os.path.abspath(p);
-	if (
-		(methodName = PyUnicode_FromString("abspath")) == NULL ||
-		(absPath = PyObject_CallMethodObjArgs(pyState->includeFunctionOsPathModule, methodName, pathObject, NULL)) == NULL ||
-		!pypStringObjectSetup(absPath, "utf-8", "strict", &newObject, &buffer, &bufferLength) ||
-		unicodeUTF8DecodeLength(buffer, bufferLength, outputBuffer, &outputCharacterCount, outputBufferLength, &errorCount) != UNICODE_OKAY
-	) {
-		// Error
-		goto cleanup;
-	}
+	// Decode
+	okay = (
+		pypStringObjectSetup(object, "utf-8", "strict", &newObject, &buffer, &bufferLength) &&
+		unicodeUTF8DecodeLength(buffer, bufferLength, path, &outputCharacterCount, &pathLength, &errorCount) == UNICODE_OKAY
+	);
+	if (!okay) PyErr_Clear();
 
 	// Done
-	#if PY_MAJOR_VERSION < 3
-	if (pathObjectNew != NULL) Py_DECREF(pathObjectNew);
-	#endif
-	Py_DECREF(methodName);
-	Py_DECREF(absPath);
 	if (newObject != NULL) Py_DECREF(newObject);
-	return PYP_TRUE;
+	#if PY_VERSION_HEX >= 0x03060000
+	Py_DECREF(pathObject);
+	#endif
+	return okay;
+}
 
 
-	// Cleanup
-	cleanup:
-	PyErr_Clear();
-	#if PY_MAJOR_VERSION < 3
-	if (pathObjectNew != NULL) Py_DECREF(pathObjectNew);
-	#endif
-	if (methodName != NULL) Py_DECREF(methodName);
-	if (absPath != NULL) Py_DECREF(absPath);
-	if (newObject != NULL) Py_DECREF(newObject);
-	return PYP_FALSE;
+
+// Error log
+void
+pypModuleErrorLogInit(PypModuleErrorLog* errorLog) {
+	assert(errorLog != NULL);
+
+	errorLog->firstChild = NULL;
+	errorLog->lastChild = NULL;
+	threadMutexInit(&errorLog->mutex);
 }
 
-PypBool
-pypPathCurrentDirectoryGet(PypPythonState* pyState, unicode_char** path, size_t* pathLength) {
+void
+pypModuleErrorLogClean(PypModuleErrorLog* errorLog) {
 	// Vars
-	PyObject* absPath = NULL;
-	PyObject* newObject = NULL;
-	char* buffer;
-	Py_ssize_t bufferLength;
-	size_t outputCharacterCount;
+	PypModuleError* error;
+	PypModuleError* nextSibling;
+
+	// Assertions
+	assert(errorLog != NULL);
+
+	// Delete
+	for (error = errorLog->firstChild; error != NULL; error = nextSibling) {
+		nextSibling = error->nextSibling;
+		if (error->name != NULL) memFree(error->name);
+		if (error->message != NULL) memFree(error->message);
+		if (error->traceback != NULL) memFree(error->traceback);
+		if (error->filename != NULL) memFree(error->filename);
+		memFree(error);
+	}
+	errorLog->firstChild = NULL;
+	errorLog->lastChild = NULL;
+	threadMutexDestroy(&errorLog->mutex);
+}
+
+void
+pypModuleReaderError(PypSize errorId, const PypStreamLocation* location, void* data) {
+	// Vars
+	PypModuleExecutionInfo* executionInfo = (PypModuleExecutionInfo*) data;
+	const PypChar* errorMessage;
+	char* message;
+	size_t messageLength;
+
+	// Assertions
+	assert(location != NULL);
+	assert(executionInfo != NULL);
+
+	if (executionInfo->errorLog == NULL) return;
+
+	// The reader's message, without its trailing newline
+	errorMessage = executionInfo->readSettings->errorMessages[errorId];
+	if (errorMessage == NULL) errorMessage = "Tag syntax error";
+	for (messageLength = strlen(errorMessage); messageLength > 0 && (errorMessage[messageLength - 1] == '\n' || errorMessage[messageLength - 1] == '\r'); --messageLength);
+	if ((message = memAllocArray(char, messageLength + 1)) == NULL) return; // error
+	memcpy(message, errorMessage, sizeof(char) * messageLength);
+	message[messageLength] = '\x00';
+
+	// Add
+	pypModuleErrorLogAdd(executionInfo, PYP_MODULE_ERROR_SYNTAX, NULL, message, NULL, location->start.lineNumber + 1);
+}
+
+PypReadStatus
+pypModuleReaderHold(PypDataBuffer** dataBuffer, const PypChar* buffer, PypSize bufferLength, PypBool* taken, void* data) {
+	// Vars
+	PypModuleExecutionInfo* executionInfo = (PypModuleExecutionInfo*) data;
+
+	// Assertions
+	assert(taken != NULL);
+	assert(executionInfo != NULL);
+
+	// Only renders which reserved a slot hold anything back
+	if (executionInfo->slots == NULL || executionInfo->slots->firstChild == NULL) {
+		*taken = PYP_FALSE;
+		return PYP_READ_OKAY;
+	}
+
+	return pypSlotsOutput(executionInfo->slots, dataBuffer, buffer, bufferLength, taken);
+}
+
+PypDataBuffer*
+pypModuleReaderRedirect(void* data) {
+	// Vars
+	PypModuleExecutionInfo* executionInfo = (PypModuleExecutionInfo*) data;
+	PypCaptureObject* capture;
+
+	// Assertions
+	assert(executionInfo != NULL);
+
+	// The output of a tag which left captures open goes where it went before them; only what follows goes into them
+	capture = executionInfo->captureOutput;
+	if (executionInfo->captureOutputPending) {
+		executionInfo->captureOutput = executionInfo->captures;
+		executionInfo->captureOutputPending = PYP_FALSE;
+	}
+	return (capture == NULL) ? NULL : capture->dataBuffer;
+}
+
+void
+pypModuleErrorLogAdd(PypModuleExecutionInfo* executionInfo, PypModuleErrorType type, char* name, char* message, char* traceback, PypSize line) {
+	// Vars
+	PypModuleErrorLog* errorLog = executionInfo->errorLog;
+	PypModuleError* error;
+	size_t filenameLength;
 	size_t errorCount;
 
 	// Assertions
-	assert(pyState != NULL);
-	assert(path != NULL);
-	assert(pathLength != NULL);
+	assert(errorLog != NULL);
 
-	// Setup
-	if (
-		pyState->includeFunctionOsModule == NULL &&
-		pypModuleIncludeFunctionsInit(pyState) != PYP_MODULE_SETUP_STATUS_OKAY
-	) {
+	// Create; the strings are owned by the error, or freed here if it can't be created
+	if ((error = memAlloc(PypModuleError)) == NULL) {
 		// Error
-		return PYP_FALSE;
+		if (name != NULL) memFree(name);
+		if (message != NULL) memFree(message);
+		if (traceback != NULL) memFree(traceback);
+		return;
 	}
+	error->type = type;
+	error->name = name;
+	error->message = message;
+	error->traceback = traceback;
+	error->line = line;
+	error->nextSibling = NULL;
+	if (unicodeUTF8Encode(executionInfo->inputFilename, &error->filename, &filenameLength, &errorCount) != UNICODE_OKAY) error->filename = NULL;
+
+	// Add
+	threadMutexLock(&errorLog->mutex);
+	if (errorLog->lastChild == NULL) {
+		errorLog->firstChild = error;
+	}
+	else {
+		errorLog->lastChild->nextSibling = error;
+	}
+	errorLog->lastChild = error;
+	threadMutexUnlock(&errorLog->mutex);
+}
 
-	// os.getcwd();
-	if (
+void
+pypModuleErrorLogAddException(PypModuleExecutionInfo* executionInfo, PyObject* exception, PyObject* value, PyObject* traceback, PyObject* tracebackText) {
+	// Vars
+	PyObject* messageObject;
+	PyObject* lineObject = NULL;
+	const char* typeName;
+	char* name;
+	size_t nameLength;
+	char* message = NULL;
+	PypSize line = 0;
+
+	// Assertions
+	assert(executionInfo != NULL);
+	assert(exception != NULL);
+	assert(value != NULL);
+	assert(traceback != NULL);
+
+	// Type name
+	typeName = PyExceptionClass_Name(exception);
+	if (typeName == NULL) typeName = "";
+	#if PY_MAJOR_VERSION < 3
+	if (strncmp(typeName, "exceptions.", 11) == 0) typeName += 11; // builtins are named as python 3 names them
+	#endif
+	nameLength = strlen(typeName);
+	if ((name = memAllocArray(char, nameLength + 1)) != NULL) memcpy(name, typeName, sizeof(char) * (nameLength + 1));
+
+	// Message
+	if ((messageObject = PyObject_Str(value)) != NULL) {
+		message = pypStringObjectCopyUTF8(messageObject);
+		Py_DECREF(messageObject);
+	}
+
+	// The line is that of the outermost frame, which is the tag's code; syntax errors have no frames. Either is counted within the tag
+	if (traceback != Py_None) {
+		lineObject = PyObject_GetAttrString(traceback, "tb_lineno");
+	}
+	else if (PyErr_GivenExceptionMatches(exception, PyExc_SyntaxError)) {
+		lineObject = PyObject_GetAttrString(value, "lineno");
+	}
+	if (lineObject != NULL) {
 		#if PY_MAJOR_VERSION >= 3
-		(absPath = PyObject_CallMethod(pyState->includeFunctionOsModule, "getcwd", NULL)) == NULL ||
+		if (PyLong_Check(lineObject)) line = (PypSize) PyLong_AsSsize_t(lineObject);
 		#else
-		(absPath = PyObject_CallMethod(pyState->includeFunctionOsModule, "getcwdu", NULL)) == NULL ||
+		if (PyInt_Check(lineObject)) line = (PypSize) PyInt_AsSsize_t(lineObject);
 		#endif
-		!pypStringObjectSetup(absPath, "utf-8", "strict", &newObject, &buffer, &bufferLength) ||
-		unicodeUTF8DecodeLength(buffer, bufferLength, path, &outputCharacterCount, pathLength, &errorCount) != UNICODE_OKAY
-	) {
-		// Error
-		goto cleanup;
+		Py_DECREF(lineObject);
 	}
+	if (PyErr_Occurred() != NULL) PyErr_Clear();
+	if (line > 0) line += executionInfo->tagLine;
 
-	// Done
-	Py_DECREF(absPath);
-	if (newObject != NULL) Py_DECREF(newObject);
-	return PYP_TRUE;
-
-
-	// Cleanup
-	cleanup:
-	PyErr_Clear();
-	if (absPath != NULL) Py_DECREF(absPath);
-	if (newObject != NULL) Py_DECREF(newObject);
-	return PYP_FALSE;
+	// Add
+	pypModuleErrorLogAdd(executionInfo, PYP_MODULE_ERROR_CODE, name, message, (tracebackText != NULL ? pypStringObjectCopyUTF8(tracebackText) : NULL), line);
 }
 
-PypBool
-pypPathCurrentDirectorySet(PypPythonState* pyState, const unicode_char* path) {
+char*
+pypStringObjectCopyUTF8(PyObject* object) {
 	// Vars
-	PyObject* result = NULL;
-	PyObject* pathObject = NULL;
+	PyObject* newObject = NULL;
+	char* buffer;
+	Py_ssize_t bufferLength;
+	char* copy = NULL;
 
 	// Assertions
-	assert(pyState != NULL);
-	assert(path != NULL);
-
-	// Setup
-	if (
-		pyState->includeFunctionOsModule == NULL &&
-		pypModuleIncludeFunctionsInit(pyState) != PYP_MODULE_SETUP_STATUS_OKAY
-	) {
-		// Error
-		return PYP_FALSE;
-	}
+	assert(object != NULL);
 
-	// os.chdir(p);
+	// Copy
 	if (
-		(pathObject = PyUnicode_FromWideChar(path, getUnicodeCharStringLength(path))) == NULL ||
-		(result = PyObject_CallMethod(pyState->includeFunctionOsModule, "chdir", NULL)) == NULL
+		pypStringObjectSetup(object, "utf-8", "replace", &newObject, &buffer, &bufferLength) &&
+		(copy = memAllocArray(char, bufferLength + 1)) != NULL
 	) {
-		// Error
-		goto cleanup;
+		memcpy(copy, buffer, sizeof(char) * bufferLength);
+		copy[bufferLength] = '\x00';
 	}
 
 	// Done
-	Py_DECREF(result);
-	Py_DECREF(pathObject);
-	return PYP_TRUE;
-
-
-	// Cleanup
-	cleanup:
-	PyErr_Clear();
-	if (result != NULL) Py_DECREF(result);
-	if (pathObject != NULL) Py_DECREF(pathObject);
-	return PYP_FALSE;
+	if (newObject != NULL) Py_DECREF(newObject);
+	if (PyErr_Occurred() != NULL) PyErr_Clear();
+	return copy;
 }
 
 
@@ -1126,6 +5166,9 @@ pypPythonExceptionDisplay(PypDataBuffer* output, PypModuleExecutionInfo* executi
 		}
 	}
 
+	// Record
+	if (executionInfo->errorLog != NULL) pypModuleErrorLogAddException(executionInfo, exception, value, traceback, exceptionValue);
+
 	// Clear error
 	if (PyErr_Occurred() != NULL) PyErr_Clear(); // this shouldn't happen, but just in case
 
@@ -1166,7 +5209,6 @@ pypCompileCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, con
 	char* fullBuffer;
 
 	// Assertions
-	assert(output != NULL);
 	assert(executionInfo != NULL);
 	assert(streamLocation != NULL);
 	assert(sourceCode != NULL);
@@ -1174,6 +5216,12 @@ pypCompileCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, con
 
 	// Create new
 	compileFlags.cf_flags = 0;
+	#if PY_VERSION_HEX >= 0x03080000
+	compileFlags.cf_feature_version = PY_MINOR_VERSION;
+	#endif
+	#ifdef PYP_ASYNC_SUPPORTED
+	if (executionInfo->pythonState->allowTopLevelAwait) compileFlags.cf_flags |= PyCF_ALLOW_TOP_LEVEL_AWAIT;
+	#endif
 
 	// Setup filename
 	if (unicodeUTF8Encode(&executionInfo->inputFilename[executionInfo->inputFilenameStart], &suffixBuffer, &newFilenameLengthSuffix, &errorCount) != UNICODE_OKAY) return NULL; // error
@@ -1198,8 +5246,8 @@ pypCompileCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, con
 
 	// Check
 	if (compiledCode == NULL) {
-		// Should be a PyExc_SyntaxError
-		if (PyErr_Occurred() != NULL) {
+		// Should be a PyExc_SyntaxError; left set if there's nowhere to display it
+		if (PyErr_Occurred() != NULL && output != NULL) {
 			// Display
 			pypPythonExceptionDisplay(output, executionInfo);
 		}
@@ -1213,9 +5261,13 @@ pypCompileCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, con
 }
 
 PypReadStatus
-pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyObject* code, PypBool outputResult) {
+pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyObject* code, PyObject* globalsDict, PypBool outputResult) {
 	// Vars
+	PyObject* localsDict;
 	PyObject* returnObj;
+	#ifdef PYP_ASYNC_SUPPORTED
+	PyObject* coroutine;
+	#endif
 
 	// Assertions
 	assert(output != NULL);
@@ -1223,12 +5275,20 @@ pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyO
 	assert(code != NULL);
 	assert(PyErr_Occurred() == NULL);
 
+	// The shared globals, unless the code has its own, which are its locals too so nested scopes see every name
+	if (globalsDict == NULL) {
+		globalsDict = executionInfo->pythonState->globalsDict;
+		localsDict = executionInfo->pythonState->localsDict;
+	}
+	else {
+		localsDict = globalsDict;
+	}
 
 	// Create new
 	#if PY_MAJOR_VERSION >= 3
 	returnObj = PyEval_EvalCodeEx(
 		code,
-		executionInfo->pythonState->globalsDict, executionInfo->pythonState->localsDict,
+		globalsDict, localsDict,
 		NULL, 0,
 		NULL, 0,
 		NULL, 0,
@@ -1237,7 +5297,7 @@ pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyO
 	#else
 	returnObj = PyEval_EvalCodeEx(
 		(PyCodeObject*) code,
-		executionInfo->pythonState->globalsDict, executionInfo->pythonState->localsDict,
+		globalsDict, localsDict,
 		NULL, 0,
 		NULL, 0,
 		NULL, 0,
@@ -1245,6 +5305,15 @@ pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyO
 	);
 	#endif
 
+	#ifdef PYP_ASYNC_SUPPORTED
+	// Code using top-level await returns a coroutine, which is run to completion here
+	if (returnObj != NULL && (((PyCodeObject*) code)->co_flags & CO_COROUTINE) != 0) {
+		coroutine = returnObj;
+		returnObj = pypAsyncRunCoroutine(coroutine);
+		Py_DECREF(coroutine);
+	}
+	#endif
+
 	if (returnObj == NULL) {
 		if (PyErr_Occurred() != NULL) {
 			// Display
@@ -1255,9 +5324,20 @@ pypExecuteCode(PypDataBuffer* output, PypModuleExecutionInfo* executionInfo, PyO
 	else if (outputResult) {
 		// Output?
 		if (returnObj != Py_None) {
-			// Output
-			pypStringObjectExtendDataBuffer(output, returnObj, executionInfo->encoding, executionInfo->encodingErrorMode);
-			// Errors not checked; if an error occurs, that's okay
+			if (PyIter_Check(returnObj)) {
+				// Generators run as their output is written, so what they raise is the tag's error
+				if (!pypIteratorExtendDataBuffer(output, returnObj, executionInfo->encoding, executionInfo->encodingErrorMode)) {
+					// Display
+					Py_DECREF(returnObj);
+					pypPythonExceptionDisplay(output, executionInfo);
+					return PYP_READ_ERROR_CODE_EXECUTION;
+				}
+			}
+			else {
+				// Output
+				pypStringObjectExtendDataBuffer(output, returnObj, executionInfo->encoding, executionInfo->encodingErrorMode);
+				// Errors not checked; if an error occurs, that's okay
+			}
 		}
 	}
 
@@ -1280,8 +5360,15 @@ pypDataBufferModifyExecute(PypDataBuffer* input, PypDataBuffer** outputDataBuffe
 	PypDataBufferEntry* entryNew;
 	PyObject* code;
 	PypModuleExecutionInfo* executionInfo = (PypModuleExecutionInfo*) data;
-	PypDataBuffer* pypPreviousDataBuffer = pypCurrentDataBuffer;
+	PypDataBuffer* pypPreviousDataBuffer;
+	PypDataBuffer* pypPreviousTagDataBuffer;
+	PypSize pypPreviousTagLine;
+	struct PypAsyncInclude_* pypPreviousAsyncIncludes;
 	PypReadStatus status;
+	#ifdef PYP_MEMOIZE_SUPPORTED
+	PyObject* memoizeKey = NULL;
+	PyObject* memoizeEntry = NULL;
+	#endif
 
 	// Assertions
 	assert(input != NULL);
@@ -1291,6 +5378,7 @@ pypDataBufferModifyExecute(PypDataBuffer* input, PypDataBuffer** outputDataBuffe
 
 	// Setup
 	*outputDataBuffer = NULL;
+	pypPreviousDataBuffer = pypModuleContext.dataBuffer;
 
 	// Unify
 	if (!pypDataBufferUnify(input, PYP_TRUE, &entryNew)) {
@@ -1309,6 +5397,17 @@ pypDataBufferModifyExecute(PypDataBuffer* input, PypDataBuffer** outputDataBuffe
 		++sourceBufferOffset;
 	}
 
+	// Compiled for pyp.compile; run when the template is rendered
+	if (executionInfo->compileTemplate != NULL) return pypTemplateCompileTag(executionInfo, streamLocation, sourceBuffer, expression, outputDataBuffer);
+	pypStatsAdd(PYP_STATS_CODE_EXECUTIONS, 1);
+
+	// Async includes started by this tag are completed when it ends
+	pypPreviousAsyncIncludes = pypModuleContext.asyncIncludes;
+	pypModuleContext.asyncIncludes = NULL;
+	pypPreviousTagDataBuffer = executionInfo->tagDataBuffer;
+	pypPreviousTagLine = executionInfo->tagLine;
+	executionInfo->tagLine = streamLocation->start.lineNumber;
+
 	// Create new
 	*outputDataBuffer = pypDataBufferCreate();
 	if (*outputDataBuffer == NULL) {
@@ -1316,7 +5415,30 @@ pypDataBufferModifyExecute(PypDataBuffer* input, PypDataBuffer** outputDataBuffe
 		status = PYP_READ_ERROR_MEMORY;
 		goto cleanup;
 	}
-	pypCurrentDataBuffer = *outputDataBuffer;
+	pypModuleContext.dataBuffer = *outputDataBuffer;
+	executionInfo->tagDataBuffer = *outputDataBuffer;
+
+	// Large iterator output may go straight to the output stream, when the tag's output would be written there unchanged
+	executionInfo->tagWriteThrough = (
+		executionInfo->outputDataBuffer == NULL &&
+		executionInfo->outputStream != NULL &&
+		executionInfo->captureOutput == NULL &&
+		executionInfo->piMain->childSuccessModifier == NULL
+	);
+
+	#ifdef PYP_MEMOIZE_SUPPORTED
+	// Expressions are keyed by their source, and skip compiling too while what they read is unchanged
+	if (expression && executionInfo->pythonState->memoizedExpressions != NULL) {
+		executionInfo->tagWriteThrough = PYP_FALSE; // the whole output may be kept
+		if ((memoizeKey = PyBytes_FromStringAndSize(sourceBuffer, (Py_ssize_t) (sourceBufferLength - sourceBufferOffset))) == NULL) {
+			PyErr_Clear();
+		}
+		else if (pypMemoizeFetch(executionInfo->pythonState, memoizeKey, &memoizeEntry, *outputDataBuffer)) {
+			status = PYP_READ_OKAY;
+			goto cleanup;
+		}
+	}
+	#endif
 
 	// Compile
 	code = pypCompileCode(*outputDataBuffer, executionInfo, streamLocation, sourceBuffer, expression);
@@ -1327,14 +5449,35 @@ pypDataBufferModifyExecute(PypDataBuffer* input, PypDataBuffer** outputDataBuffe
 	}
 
 	// Execute
-	status = pypExecuteCode(*outputDataBuffer, executionInfo, code, expression); // error check
+	status = pypExecuteCode(*outputDataBuffer, executionInfo, code, NULL, expression); // error check
+
+	#ifdef PYP_MEMOIZE_SUPPORTED
+	// Expressions which failed are evaluated again, so their error is displayed again
+	if (memoizeKey != NULL && memoizeEntry != Py_None && status == PYP_READ_OKAY) pypMemoizeStore(executionInfo->pythonState, memoizeKey, code, memoizeEntry, *outputDataBuffer);
+	#endif
 
 	// Clean code
 	Py_DECREF(code);
 
 	// Done
 	cleanup:
-	pypCurrentDataBuffer = pypPreviousDataBuffer;
+	#ifdef PYP_MEMOIZE_SUPPORTED
+	Py_XDECREF(memoizeEntry);
+	Py_XDECREF(memoizeKey);
+	#endif
+	#ifdef PYP_ASYNC_SUPPORTED
+	pypAsyncIncludesFinish(&pypModuleContext);
+	#endif
+	pypCapturesTagEnd(executionInfo);
+	executionInfo->tagDataBuffer = pypPreviousTagDataBuffer;
+	executionInfo->tagLine = pypPreviousTagLine;
+	executionInfo->tagWriteThrough = PYP_FALSE;
+	pypModuleContext.dataBuffer = pypPreviousDataBuffer;
+	pypModuleContext.asyncIncludes = pypPreviousAsyncIncludes;
+	if (status != PYP_READ_OKAY) {
+		pypStatsAdd(PYP_STATS_CODE_ERRORS, 1);
+		if (executionInfo->dependencies != NULL) threadAtomicAdd(&executionInfo->dependencies->codeErrorCount, 1);
+	}
 	return status;
 }
 
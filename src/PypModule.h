@@ -10,10 +10,34 @@
 #include "PypProcessing.h"
 #include "PypReader.h"
 #include "Unicode.h"
+#include "Thread.h"
+#include "File.h"
 #include "CommandLineChar.h"
 
 
 struct PypPythonState_;
+struct PypFragments_;
+
+typedef enum PypModuleErrorType_ {
+	PYP_MODULE_ERROR_CODE = 0x0, // raised by a tag's code
+	PYP_MODULE_ERROR_SYNTAX = 0x1, // a tag which isn't closed, or continued properly
+} PypModuleErrorType;
+
+typedef struct PypModuleError_ {
+	PypModuleErrorType type;
+	char* name; // the exception's type; NULL for tag syntax errors
+	char* message;
+	char* traceback; // as python prints it; NULL for tag syntax errors
+	char* filename; // of the template the error is in
+	PypSize line; // counted from 1; 0 if not known
+	struct PypModuleError_* nextSibling;
+} PypModuleError; // strings are UTF-8
+
+typedef struct PypModuleErrorLog_ {
+	PypModuleError* firstChild;
+	PypModuleError* lastChild;
+	ThreadMutex mutex; // includes may render on other threads
+} PypModuleErrorLog;
 
 typedef struct PypModuleExecutionInfo_ {
 	PypReaderSettings* readSettings;
@@ -28,6 +52,8 @@ typedef struct PypModuleExecutionInfo_ {
 	FILE* outputStream;
 	FILE* errorStream;
 	PypDataBuffer* outputDataBuffer;
+	PypReadFunction inputRead; // if not NULL, the input is read from inputSource with it, and inputStream isn't used
+	void* inputSource;
 
 	cmd_char* inputFilename;
 	PypSize inputFilenameLength;
@@ -36,6 +62,20 @@ typedef struct PypModuleExecutionInfo_ {
 	const char* encoding;
 	const char* encodingErrorMode;
 
+	PypBool changeWorkingDirectory; // the process working directory is the including file's directory while it renders; only for older templates which open files relative to it
+	struct PypDependencies_* dependencies; // if not NULL, every file included is added to it
+	struct PypIncludeLookups_* includeLookups; // if not NULL, include paths not found next to the including file are searched for
+	struct PypTemplateObject_* compileTemplate; // if not NULL, tags are compiled into it by pyp.compile instead of being executed
+	PypModuleErrorLog* errorLog; // if not NULL, errors are recorded in it as well as being shown
+	struct PypSlots_* slots; // if not NULL, pyp.slot can reserve positions in the render's output
+	FileOutputSync outputSync; // how files opened by pyp.output are made crash safe
+	struct PypCaptureObject_* captures; // captures entered during the render and not exited yet, innermost first
+	struct PypCaptureObject_* captureOutput; // if not NULL, the capture output between tags goes into
+	PypBool captureOutputPending; // captures were left open by the tag which just ended; its own output still goes to captureOutput
+	PypDataBuffer* tagDataBuffer; // output of the tag being executed
+	PypSize tagLine; // where the tag being executed starts, counted from 0; lines of its code are counted from there
+	PypBool tagWriteThrough; // the tag's output reaches the output stream unchanged, so large iterator output can be written before the tag ends
+
 	struct PypPythonState_* pythonState;
 } PypModuleExecutionInfo;
 
@@ -45,42 +85,117 @@ typedef enum PypModuleSetupStatus_ {
 	PYP_MODULE_SETUP_STATUS_ERROR_PYTHON = 0x2,
 } PypModuleSetupStatus;
 
+typedef struct PypGcSettings_ {
+	PypBool disableDuringRender; // no automatic collections while a template renders; garbage is left for the next one after
+	PypBool freeze; // objects which exist after setup and the prelude are never scanned again; needs python 3.7
+	PypBool timed; // collections and their pauses are added to the stats; needs python 3.3
+	long int thresholds[3]; // negative leaves that generation's threshold as is
+} PypGcSettings;
+
+typedef struct PypPythonSettings_ {
+	PypBool isolated; // ignore PYTHON* environment variables and the user site directory
+	PypBool noSite; // skip importing site, which scans sys.path for .pth files
+	PypBool importTime; // python reports how long each import takes; needs python 3.7
+	const cmd_char* home; // if not NULL, the standard library prefix, so it isn't searched for
+	const cmd_char* path; // if not NULL, the entire sys.path, separated like PYTHONPATH
+	PypGcSettings gc;
+	PypBool memoizeExpressions; // expression tags which only read immutable values reuse their output until one changes; needs python 3.4
+} PypPythonSettings;
+
 typedef struct PypPythonState_ {
 	char* applicationName;
 	unicode_char* applicationNameUnicode;
+	char* home; // kept for python versions which don't copy it
+	unicode_char* homeUnicode;
 	PypModuleSetupStatus status;
+	const char* statusFunction; // if not NULL, the python function which failed to start it
+	const char* statusMessage; // if not NULL, why python couldn't be started
+
+	PyThreadState* interpreterThreadState; // sub-interpreters only
+	PypBool changeWorkingDirectory; // default for new execution info
+	PypBool allowTopLevelAwait; // tags may use await; their coroutines run on the thread's event loop
+	PypGcSettings gc;
+	PypBool gcRenderDisabled; // automatic collection was turned off for the current render, and is turned back on after
+	struct PypFragments_* fragments; // if not NULL, where pyp.cache keeps the output of its regions; not owned
 
 	PyObject* mainModule;
 	PyObject* pypModule;
 	PyObject* globalsDict;
 	PyObject* localsDict;
+	PyObject* baseGlobalsDict; // if not NULL, each render's globals are copied from it instead of from __main__
 
 	PyObject* exceptionHandlerCompiledCode;
 	PyObject* exceptionHandlerGlobalsDict;
 
-	PyObject* includeFunctionOsModule;
-	PyObject* includeFunctionOsPathModule;
+	PyObject* memoizeAnalyzer; // returns the names an expression's code reads, or None if it can't be memoized
+	PyObject* memoizedExpressions; // if not NULL, expression source to what it read and output; kept between renders
 } PypPythonState;
 
 
 
+// Sub-interpreters with their own GIL
+#if PY_VERSION_HEX >= 0x030C0000
+#define PYP_SUBINTERPRETERS_SUPPORTED
+#endif
+
+// Top-level await in tags
+#if PY_VERSION_HEX >= 0x03080000
+#define PYP_ASYNC_SUPPORTED
+#endif
+
+// Garbage collector callbacks and freezing
+#if PY_VERSION_HEX >= 0x03030000
+#define PYP_GC_CALLBACKS_SUPPORTED
+#endif
+#if PY_VERSION_HEX >= 0x03070000
+#define PYP_GC_FREEZE_SUPPORTED
+#endif
+
+// Expression memoization, which reads bytecode with dis.get_instructions
+#if PY_VERSION_HEX >= 0x03040000
+#define PYP_MEMOIZE_SUPPORTED
+#endif
+
+
+
+// Exported, so the same function initializes the importable module build
 #if PY_MAJOR_VERSION >= 3
 #define pypModuleInit PyInit_pyp
-PyObject* pypModuleInit(void);
 #else
 #define pypModuleInit initpyp
-void pypModuleInit(void);
 #endif
+PyMODINIT_FUNC pypModuleInit(void);
 
 
 
 // Non-module methods
-PypPythonState* pypModulePythonSetup(const cmd_char* applicationPath);
+void pypModulePythonSettingsInit(PypPythonSettings* settings);
+PypPythonState* pypModulePythonSetup(const cmd_char* applicationPath, const PypPythonSettings* settings);
 void pypModulePythonFinalize(PypPythonState* pythonState);
+#ifdef PYP_SUBINTERPRETERS_SUPPORTED
+PypPythonState* pypModulePythonSubinterpreterSetup();
+void pypModulePythonSubinterpreterFinalize(PypPythonState* pythonState);
+#endif
+#ifdef PYP_EXTENSION_MODULE
+PypPythonState* pypModulePythonAttach(void);
+void pypModulePythonDetach(PypPythonState* pythonState);
+PyObject* pypModuleErrorType(PyObject* module);
+#endif
 PypModuleSetupStatus pypModulePythonInit(PypModuleExecutionInfo* pypState);
 void pypModulePythonDeinit(PypModuleExecutionInfo* pypState);
 
+void pypModuleGcSettingsInit(PypGcSettings* settings);
+PypModuleSetupStatus pypModuleGcSetup(PypPythonState* pythonState, const PypGcSettings* settings);
+void pypModuleGcFreeze(PypPythonState* pythonState);
+void pypModuleGcCollect(PypPythonState* pythonState);
+
+#ifdef PYP_MEMOIZE_SUPPORTED
+PypModuleSetupStatus pypModuleMemoizeSetup(PypPythonState* pythonState);
+#endif
+
 PypReadStatus pypIncludeFromExecutionInfo(PypModuleExecutionInfo* executionInfo);
+PyObject* pypModuleTemplateCompile(PypModuleExecutionInfo* executionInfo);
+PypBool pypModuleTemplateRender(PypModuleExecutionInfo* executionInfo, PyObject* template, PyObject* names, PypDataBuffer* dataBuffer);
 
 PypModuleExecutionInfo* pypModuleExecutionInfoCreate(
 	PypModuleExecutionInfo* info,
@@ -100,6 +215,15 @@ PypModuleExecutionInfo* pypModuleExecutionInfoCreate(
 );
 void pypModuleExecutionInfoClean(PypModuleExecutionInfo* executionInfo);
 
+void pypModuleErrorLogInit(PypModuleErrorLog* errorLog);
+void pypModuleErrorLogClean(PypModuleErrorLog* errorLog);
+void pypModuleReaderError(PypSize errorId, const PypStreamLocation* location, void* data);
+PypReadStatus pypModuleReaderHold(PypDataBuffer** dataBuffer, const PypChar* buffer, PypSize bufferLength, PypBool* taken, void* data);
+PypDataBuffer* pypModuleReaderRedirect(void* data);
+
+PypBool pypPathFromObject(PyObject* object, unicode_char** path);
+char* pypStringObjectCopyUTF8(PyObject* object);
+
 PypReadStatus pypDataBufferModifyExecuteCode(PypDataBuffer* input, PypDataBuffer** outputDataBuffer, const PypStreamLocation* streamLocation, void* data);
 PypReadStatus pypDataBufferModifyExecuteExpression(PypDataBuffer* input, PypDataBuffer** outputDataBuffer, const PypStreamLocation* streamLocation, void* data);
 
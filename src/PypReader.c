@@ -123,6 +123,7 @@ static void pypProcessingStackTailUpdateEndPositionExcludingTag(PypReader* reade
 
 static void pypUpdateStreamPosition(PypStreamPosition* streamPosition, PypChar c);
 
+static PypDataBuffer* pypProcessingStackOutputDataBuffer(PypReader* reader);
 static PypBool pypProcessingStackPopProcess(PypReader* reader, PypProcessingStackEntry* source);
 static PypBool pypProcessingStackModifyDataBuffer(PypReader* reader, PypProcessingStackEntry* source);
 static PypBool pypProcessingStackModifyDataBufferUsingParent(PypReader* reader, PypProcessingStackEntry* source, PypBool success);
@@ -134,9 +135,11 @@ static PypBool pypReadPerformAction(PypReader* reader);
 static PypBool pypReadRollback(PypReader* reader);
 static PypBool pypReadTagMatched(PypReader* reader, PypBool allowArbitraryChars);
 
-static void pypReaderInit(PypReader* reader, FILE* inputStream, FILE* outputStream, FILE* errorStream, PypDataBuffer* dataBuffer, const PypProcessingInfo* processingInfo, const PypTagGroup* group, const PypReaderSettings* settings, PypReadBlock** ptrCurrentBlock, PypSize* ptrCurrentBlockPosition, PypSize* ptrArbitraryChars, void* data);
+static void pypReaderInit(PypReader* reader, FILE* outputStream, FILE* errorStream, PypDataBuffer* dataBuffer, const PypProcessingInfo* processingInfo, const PypTagGroup* group, const PypReaderSettings* settings, PypReadBlock** ptrCurrentBlock, PypSize* ptrCurrentBlockPosition, PypSize* ptrArbitraryChars, void* data);
 static void pypReaderClean(PypReader* reader);
 
+static PypSize pypReadStreamFunction(void* source, PypChar* buffer, PypSize bufferSize);
+
 
 
 // Create a circular list of stream reading blocks
@@ -587,9 +590,27 @@ pypProcessingStackModifyDataBufferUsingParent(PypReader* reader, PypProcessingSt
 	return PYP_TRUE;
 }
 
+PypDataBuffer*
+pypProcessingStackOutputDataBuffer(PypReader* reader) {
+	// Vars
+	PypDataBuffer* dataBuffer;
+
+	// Assertions
+	assert(reader != NULL);
+	assert(reader->processingStack.tail != NULL);
+
+	// Top level output may be redirected; NULL means the output stream
+	if (reader->processingStack.tail->parent == NULL && reader->settings->redirectFunction != NULL) {
+		dataBuffer = (reader->settings->redirectFunction)(reader->data);
+		if (dataBuffer != NULL) return dataBuffer;
+	}
+	return reader->processingStack.tail->dataBuffer;
+}
+
 PypBool
 pypProcessingStackPopProcess(PypReader* reader, PypProcessingStackEntry* source) {
 	// Vars
+	PypDataBuffer* outputDataBuffer;
 
 	// Assertions
 	assert(reader != NULL);
@@ -606,6 +627,9 @@ pypProcessingStackPopProcess(PypReader* reader, PypProcessingStackEntry* source)
 		if (!pypProcessingStackModifyDataBuffer(reader, source)) return PYP_FALSE;
 	}
 	else {
+		// Reported wherever the message ends up
+		if (reader->settings->errorFunction != NULL) (reader->settings->errorFunction)(source->errorId, &source->streamPositionFirst, reader->data);
+
 		// Overwrite
 		if (reader->errorStream == NULL) {
 			// Delete contents
@@ -644,12 +668,26 @@ pypProcessingStackPopProcess(PypReader* reader, PypProcessingStackEntry* source)
 
 
 	// Process and feed data back into parent
-	if (reader->processingStack.tail->dataBuffer == NULL) {
+	outputDataBuffer = pypProcessingStackOutputDataBuffer(reader);
+	if (outputDataBuffer == NULL) {
 		PypSize writeLength;
 		PypDataBufferEntry* bufferEntry;
+		PypReadStatus status;
+		PypBool taken;
 
 		assert(reader->outputStream != NULL);
 
+		// It may be held back instead
+		if (reader->settings->holdFunction != NULL) {
+			status = (reader->settings->holdFunction)(&source->dataBuffer, NULL, 0, &taken, reader->data);
+			if (status != PYP_READ_OKAY) {
+				// Error
+				reader->status = status;
+				return PYP_FALSE;
+			}
+			if (taken) return PYP_TRUE;
+		}
+
 		// Add to the output stream
 		for (bufferEntry = source->dataBuffer->firstChild; bufferEntry != NULL; bufferEntry = bufferEntry->nextSibling) {
 			// Output
@@ -663,7 +701,7 @@ pypProcessingStackPopProcess(PypReader* reader, PypProcessingStackEntry* source)
 	}
 	else {
 		// Add to the buffer
-		pypDataBufferExtendWithDataBufferAndDelete(reader->processingStack.tail->dataBuffer, source->dataBuffer);
+		pypDataBufferExtendWithDataBufferAndDelete(outputDataBuffer, source->dataBuffer);
 		source->dataBuffer = NULL;
 	}
 
@@ -676,6 +714,7 @@ pypReadProcessBlock(PypReader* reader, PypSize positionStart, PypSize positionEn
 	// Vars
 	PypSize bufferLength;
 	const PypChar* buffer;
+	PypDataBuffer* outputDataBuffer;
 
 	// Assertions
 	assert(reader != NULL);
@@ -689,11 +728,25 @@ pypReadProcessBlock(PypReader* reader, PypSize positionStart, PypSize positionEn
 	buffer = &(block->buffer[positionStart]);
 
 	// Process the data
-	if (reader->processingStack.tail->dataBuffer == NULL) {
+	outputDataBuffer = pypProcessingStackOutputDataBuffer(reader);
+	if (outputDataBuffer == NULL) {
 		PypSize writeLength;
+		PypReadStatus status;
+		PypBool taken;
 
 		assert(reader->outputStream != NULL);
 
+		// It may be held back instead
+		if (reader->settings->holdFunction != NULL) {
+			status = (reader->settings->holdFunction)(NULL, buffer, bufferLength, &taken, reader->data);
+			if (status != PYP_READ_OKAY) {
+				// Error
+				reader->status = status;
+				return PYP_FALSE;
+			}
+			if (taken) return PYP_TRUE;
+		}
+
 		// Add to the output stream
 		writeLength = fwrite(buffer, sizeof(PypChar), bufferLength, reader->outputStream);
 		if (writeLength != bufferLength) {
@@ -704,7 +757,7 @@ pypReadProcessBlock(PypReader* reader, PypSize positionStart, PypSize positionEn
 	}
 	else {
 		// Add to the buffer
-		PypDataBufferEntry* entry = pypDataBufferExtendWithData(reader->processingStack.tail->dataBuffer, buffer, bufferLength);
+		PypDataBufferEntry* entry = pypDataBufferExtendWithData(outputDataBuffer, buffer, bufferLength);
 		if (entry == NULL) {
 			// Error
 			reader->status = PYP_READ_ERROR_MEMORY;
@@ -960,6 +1013,10 @@ pypReadRollback(PypReader* reader) {
 	*reader->ptrCurrentBlock = reader->rollback.mostRecent.block;
 	*reader->ptrArbitraryChars = reader->rollback.mostRecent.arbitraryChars;
 
+	// Chars after it are read again, so they mustn't be counted twice
+	reader->streamPosition = reader->rollback.mostRecent.streamPosition;
+	reader->mostRecentChar = (*reader->ptrCurrentBlock)->buffer[*reader->ptrCurrentBlockPosition];
+
 	// Rollback continuation
 	if ((*reader->ptrArbitraryChars) == 0) {
 		if (reader->rollback.mostRecent.tag != NULL) {
@@ -993,6 +1050,7 @@ pypReadTagMatched(PypReader* reader, PypBool allowArbitraryChars) {
 		reader->rollback.mostRecent.tag = reader->tagStack.tail->tag;
 		reader->rollback.mostRecent.blockPosition = *reader->ptrCurrentBlockPosition;
 		reader->rollback.mostRecent.block = *reader->ptrCurrentBlock;
+		reader->rollback.mostRecent.streamPosition = reader->streamPosition;
 		if (allowArbitraryChars) reader->rollback.mostRecent.arbitraryChars = reader->rollback.mostRecent.tag->arbitraryChars;
 	}
 
@@ -1027,14 +1085,13 @@ pypReadTagMatched(PypReader* reader, PypBool allowArbitraryChars) {
 
 // Setup a reader object
 void
-pypReaderInit(PypReader* reader, FILE* inputStream, FILE* outputStream, FILE* errorStream, PypDataBuffer* dataBuffer, const PypProcessingInfo* processingInfo, const PypTagGroup* group, const PypReaderSettings* settings, PypReadBlock** ptrCurrentBlock, PypSize* ptrCurrentBlockPosition, PypSize* ptrArbitraryChars, void* data) {
+pypReaderInit(PypReader* reader, FILE* outputStream, FILE* errorStream, PypDataBuffer* dataBuffer, const PypProcessingInfo* processingInfo, const PypTagGroup* group, const PypReaderSettings* settings, PypReadBlock** ptrCurrentBlock, PypSize* ptrCurrentBlockPosition, PypSize* ptrArbitraryChars, void* data) {
 	// Vars
 	PypSize i;
 
 	// Assertions
 	assert(reader != NULL);
-	assert(inputStream != NULL);
-	assert(outputStream != NULL);
+	assert(outputStream != NULL || dataBuffer != NULL);
 	assert(processingInfo != NULL);
 	assert(settings != NULL);
 	assert(group != NULL);
@@ -1128,8 +1185,21 @@ pypReaderClean(PypReader* reader) {
 
 
 // Read from a stream
+PypSize
+pypReadStreamFunction(void* source, PypChar* buffer, PypSize bufferSize) {
+	return fread(buffer, sizeof(PypChar), bufferSize, (FILE*) source);
+}
+
 PypReadStatus
 pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, PypDataBuffer* dataBuffer, const PypProcessingInfo* processingInfo, const PypTagGroup* group, const PypReaderSettings* settings, void* data) {
+	assert(inputStream != NULL);
+
+	return pypReadFromSource(pypReadStreamFunction, inputStream, outputStream, errorStream, dataBuffer, processingInfo, group, settings, data);
+}
+
+// Read from any source
+PypReadStatus
+pypReadFromSource(PypReadFunction inputRead, void* inputSource, FILE* outputStream, FILE* errorStream, PypDataBuffer* dataBuffer, const PypProcessingInfo* processingInfo, const PypTagGroup* group, const PypReaderSettings* settings, void* data) {
 	// Vars
 	PypSize arbitraryChars = 0;
 	PypSize tagPos = 0;
@@ -1141,8 +1211,8 @@ pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, PypD
 	PypReader reader;
 
 	// Assertions
-	assert(inputStream != NULL);
-	assert(outputStream != NULL);
+	assert(inputRead != NULL);
+	assert(outputStream != NULL || dataBuffer != NULL);
 	assert(processingInfo != NULL);
 	assert(group != NULL);
 	assert(settings != NULL);
@@ -1154,7 +1224,7 @@ pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, PypD
 	lastReadBlock = currentBlock->previousSibling;
 
 	// Reader
-	pypReaderInit(&reader, inputStream, outputStream, errorStream, dataBuffer, processingInfo, group, settings, &currentBlock, &i, &arbitraryChars, data);
+	pypReaderInit(&reader, outputStream, errorStream, dataBuffer, processingInfo, group, settings, &currentBlock, &i, &arbitraryChars, data);
 
 
 	// Read loop
@@ -1163,7 +1233,7 @@ pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, PypD
 
 		// Read block
 		if (currentBlock->previousSibling == lastReadBlock) {
-			currentBlock->readLength = fread(currentBlock->buffer, sizeof(PypChar), currentBlock->bufferSize, inputStream);
+			currentBlock->readLength = inputRead(inputSource, currentBlock->buffer, currentBlock->bufferSize);
 			lastReadBlock = currentBlock;
 		}
 		DEBUG_PRINT(
@@ -1206,7 +1276,7 @@ pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, PypD
 							reader.rollback.mostRecent.block = currentBlock;
 							reader.rollback.mostRecent.arbitraryChars = 0;
 							reader.rollback.mostRecent.tag = NULL;
-							reader.rollback.start.streamPosition = reader.streamPosition;
+							reader.rollback.mostRecent.streamPosition = reader.streamPosition;
 						}
 						if (tagPos >= reader.tagStack.tail->tag->textLength) {
 							// This tag has been matched (so far)
@@ -1260,8 +1330,8 @@ pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, PypD
 				}
 			}
 
-			// Position updating
-			pypUpdateStreamPosition(&reader.streamPosition, c);
+			// Position updating; after a rollback, this is the char it went back to
+			pypUpdateStreamPosition(&reader.streamPosition, reader.mostRecentChar);
 
 			// Next
 			++i;
@@ -1355,6 +1425,9 @@ pypReaderSettingsCreate(PypReaderFlags flags, PypSize readBlockCount, PypSize re
 	for (i = 0; i < PYP_READER_ERROR_ID_COUNT; ++i) {
 		readSettings->errorMessages[i] = NULL;
 	}
+	readSettings->errorFunction = NULL;
+	readSettings->holdFunction = NULL;
+	readSettings->redirectFunction = NULL;
 
 	return readSettings;
 }
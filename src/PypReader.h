@@ -78,8 +78,21 @@ typedef enum PypReadStatus_ {
 struct PypTagGroup_;
 struct PypProcessingInfo_;
 struct PypDataBuffer_;
+struct PypStreamLocation_;
 typedef uint32_t PypReaderFlags;
 
+// Reads up to bufferSize characters; fewer are only returned once the input has ended
+typedef PypSize (*PypReadFunction)(void* source, PypChar* buffer, PypSize bufferSize);
+
+// Called for each tag syntax error, with the data given to the read
+typedef void (*PypReaderErrorFunction)(PypSize errorId, const struct PypStreamLocation_* location, void* data);
+
+// Called before output is written to the output stream, with either a buffer it may take (setting it to NULL) or text; taken is set if it shouldn't be written
+typedef PypReadStatus (*PypReaderHoldFunction)(struct PypDataBuffer_** dataBuffer, const PypChar* buffer, PypSize bufferLength, PypBool* taken, void* data);
+
+// Called before top level output is written, returning a buffer it's added to instead, or NULL; takes precedence over the hold function
+typedef struct PypDataBuffer_* (*PypReaderRedirectFunction)(void* data);
+
 
 
 typedef struct PypReaderSettings_ {
@@ -87,6 +100,9 @@ typedef struct PypReaderSettings_ {
 	PypSize readBlockCount;
 	PypSize readBlockSize;
 	const PypChar* errorMessages[PYP_READER_ERROR_ID_COUNT];
+	PypReaderErrorFunction errorFunction; // may be NULL
+	PypReaderHoldFunction holdFunction; // may be NULL
+	PypReaderRedirectFunction redirectFunction; // may be NULL
 } PypReaderSettings;
 
 typedef struct PypStreamPosition_ {
@@ -110,6 +126,7 @@ typedef struct PypStreamLocation_ {
 
 
 PypReadStatus pypReadFromStream(FILE* inputStream, FILE* outputStream, FILE* errorStream, struct PypDataBuffer_* dataBuffer, const struct PypProcessingInfo_* processingInfo, const struct PypTagGroup_* group, const PypReaderSettings* settings, void* data);
+PypReadStatus pypReadFromSource(PypReadFunction inputRead, void* inputSource, FILE* outputStream, FILE* errorStream, struct PypDataBuffer_* dataBuffer, const struct PypProcessingInfo_* processingInfo, const struct PypTagGroup_* group, const PypReaderSettings* settings, void* data);
 
 PypReaderSettings* pypReaderSettingsCreate(PypReaderFlags flags, PypSize readBlockCount, PypSize readBlockSize);
 void pypReaderSettingsDelete(PypReaderSettings* readSettings);
@@ -0,0 +1,617 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <Python.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+#include "PypServer.h"
+#include "Memory.h"
+#include "File.h"
+#include "Path.h"
+
+
+
+// Headers
+#ifndef _WIN32
+#define PYP_SERVER_MAGIC 0x31505950 // "PYP1"
+#define PYP_SERVER_FILENAME_LENGTH_MAX 0x10000
+#define PYP_SERVER_GLOBALS_LENGTH_MAX 0x1000000
+#define PYP_SERVER_COPY_BLOCK_SIZE 0x10000
+
+typedef enum PypServerRequestFlags_ {
+	PYP_SERVER_REQUEST_FLAGS_NONE = 0x0,
+	PYP_SERVER_REQUEST_FLAG_INPUT_INLINE = 0x1, // the input follows the request instead of being read from the input path
+	PYP_SERVER_REQUEST_FLAG_OUTPUT_RETURN = 0x2, // the output follows the response instead of being written to the output path
+} PypServerRequestFlags;
+
+// Request: header, input path, output path, globals, inline input; paths and globals are UTF-8
+typedef struct PypServerRequestHeader_ {
+	uint64_t inputLength;
+	uint64_t globalsLength;
+	uint32_t magic;
+	uint32_t flags;
+	uint32_t inputFilenameLength;
+	uint32_t outputFilenameLength;
+} PypServerRequestHeader;
+
+// Response: header, error text, returned output
+typedef struct PypServerResponseHeader_ {
+	uint64_t outputLength;
+	uint32_t status;
+	uint32_t errorTextLength;
+} PypServerResponseHeader;
+
+static volatile sig_atomic_t pypServerStopRequested = 0;
+
+static void pypServerSignalStop(int signalNumber);
+static void pypServerConnectionHandle(PypEngine* engine, int fd);
+static PypBool pypServerSocketAddress(const unicode_char* socketPath, struct sockaddr_un* address);
+static PypBool pypServerStringRead(int fd, size_t length, char** string);
+static PypBool pypServerFilenameEncode(const unicode_char* filename, char** filenameUTF8, size_t* filenameUTF8Length);
+static PypBool pypServerStreamFromDescriptor(int fd, FILE* stream, uint64_t length);
+static PypBool pypServerStreamToDescriptor(FILE* stream, int fd, uint64_t length);
+static uint64_t pypServerStreamLength(FILE* stream);
+#endif
+
+
+
+// Settings
+void
+pypServerSettingsInit(PypServerSettings* settings) {
+	assert(settings != NULL);
+
+	settings->forkPerRequest = PYP_FALSE;
+}
+
+
+
+// Server
+#ifdef _WIN32
+PypServerStatus
+pypServerRun(PypEngine* engine, const unicode_char* socketPath, const PypServerSettings* settings, FILE* logStream) {
+	return PYP_SERVER_ERROR_UNSUPPORTED;
+}
+#else
+PypServerStatus
+pypServerRun(PypEngine* engine, const unicode_char* socketPath, const PypServerSettings* settings, FILE* logStream) {
+	// Vars
+	struct sockaddr_un address;
+	struct sigaction action;
+	struct sigaction previousInterrupt;
+	struct sigaction previousTerminate;
+	struct sigaction previousPipe;
+	struct stat socketStat;
+	PypServerStatus ss = PYP_SERVER_OKAY;
+	PyObject* stream;
+	int listenFd;
+	int probeFd;
+	int probeError;
+	int fd;
+	int status;
+	pid_t pid;
+
+	// Assertions
+	assert(engine != NULL);
+	assert(socketPath != NULL);
+	assert(settings != NULL);
+
+	// Listen
+	if (!pypServerSocketAddress(socketPath, &address)) return PYP_SERVER_ERROR_SOCKET; // error
+
+	// A socket left behind by a server that didn't exit cleanly is replaced; one that still accepts connections isn't
+	if (lstat(address.sun_path, &socketStat) == 0 && S_ISSOCK(socketStat.st_mode)) {
+		if ((probeFd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return PYP_SERVER_ERROR_SOCKET; // error
+		status = connect(probeFd, (struct sockaddr*) &address, sizeof(address));
+		probeError = errno;
+		close(probeFd);
+
+		if (status == 0) return PYP_SERVER_ERROR_RUNNING; // error
+		if (probeError != ECONNREFUSED) return PYP_SERVER_ERROR_SOCKET; // error
+		unlink(address.sun_path);
+	}
+
+	if ((listenFd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return PYP_SERVER_ERROR_SOCKET; // error
+	if (
+		bind(listenFd, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+		listen(listenFd, 16) != 0
+	) {
+		// Error
+		close(listenFd);
+		return PYP_SERVER_ERROR_SOCKET;
+	}
+
+	// Stop on SIGINT or SIGTERM; no SA_RESTART, so accept is interrupted
+	pypServerStopRequested = 0;
+	memset(&action, 0, sizeof(action));
+	sigemptyset(&action.sa_mask);
+	action.sa_handler = pypServerSignalStop;
+	sigaction(SIGINT, &action, &previousInterrupt);
+	sigaction(SIGTERM, &action, &previousTerminate);
+
+	// Clients that disconnect early must not stop the server
+	action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &action, &previousPipe);
+
+	if (logStream != NULL) {
+		fprintf(logStream, "Listening on %s\n", address.sun_path);
+		fflush(logStream);
+	}
+
+	// Requests
+	while (!pypServerStopRequested) {
+		// Finished request processes
+		if (settings->forkPerRequest) {
+			while (waitpid(-1, &status, WNOHANG) > 0);
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		fd = accept(listenFd, NULL, NULL);
+		Py_END_ALLOW_THREADS
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+
+			// Error
+			ss = PYP_SERVER_ERROR_SOCKET;
+			break;
+		}
+
+		if (!settings->forkPerRequest) {
+			// Render in the server process
+			pypServerConnectionHandle(engine, fd);
+			continue;
+		}
+
+		// Render in a copy of the server, so templates can't change the server's state
+		fflush(NULL);
+		#if PY_VERSION_HEX >= 0x03070000
+		PyOS_BeforeFork();
+		#endif
+		pid = fork();
+		if (pid == 0) {
+			// Child
+			#if PY_VERSION_HEX >= 0x03070000
+			PyOS_AfterFork_Child();
+			#else
+			PyOS_AfterFork();
+			#endif
+
+			close(listenFd);
+			sigaction(SIGINT, &previousInterrupt, NULL);
+			sigaction(SIGTERM, &previousTerminate, NULL);
+
+			pypServerConnectionHandle(engine, fd);
+
+			// Python's own buffered streams are not flushed by _exit
+			if ((stream = PySys_GetObject("stdout")) != NULL) Py_XDECREF(PyObject_CallMethod(stream, "flush", NULL));
+			if ((stream = PySys_GetObject("stderr")) != NULL) Py_XDECREF(PyObject_CallMethod(stream, "flush", NULL));
+			PyErr_Clear();
+			fflush(NULL);
+			_exit(0);
+		}
+		#if PY_VERSION_HEX >= 0x03070000
+		PyOS_AfterFork_Parent();
+		#endif
+
+		// Parent
+		if (pid < 0) {
+			// Fork failed; render in the server process instead
+			pypServerConnectionHandle(engine, fd);
+			continue;
+		}
+		close(fd);
+	}
+
+	// Stop
+	close(listenFd);
+	unlink(address.sun_path);
+
+	sigaction(SIGINT, &previousInterrupt, NULL);
+	sigaction(SIGTERM, &previousTerminate, NULL);
+	sigaction(SIGPIPE, &previousPipe, NULL);
+
+	if (settings->forkPerRequest) {
+		while (waitpid(-1, &status, 0) > 0 || errno == EINTR);
+	}
+
+	// Done
+	return ss;
+}
+
+void
+pypServerSignalStop(int signalNumber) {
+	pypServerStopRequested = 1;
+}
+
+void
+pypServerConnectionHandle(PypEngine* engine, int fd) {
+	// Vars
+	PypServerRequestHeader header;
+	PypServerResponseHeader response;
+	char* inputFilenameUTF8 = NULL;
+	char* outputFilenameUTF8 = NULL;
+	char* globalsSource = NULL;
+	unicode_char* inputFilename = NULL;
+	unicode_char* outputFilename = NULL;
+	PyObject* globals = NULL;
+	FILE* inputStream = NULL;
+	FILE* outputStream = NULL;
+	FILE* errorStream = NULL;
+	FileOutput output;
+	PypReadStatus rs = PYP_READ_OKAY;
+	const char* errorMessage = NULL;
+	uint64_t errorTextLength;
+	size_t characterCount;
+	size_t bufferLength;
+	size_t errorCount;
+
+	// Assertions
+	assert(engine != NULL);
+
+	// Read the whole request first; anything malformed is dropped without a response
+	if (
+		!fileDescriptorRead(fd, &header, sizeof(header)) ||
+		header.magic != PYP_SERVER_MAGIC ||
+		header.inputFilenameLength == 0 ||
+		header.inputFilenameLength > PYP_SERVER_FILENAME_LENGTH_MAX ||
+		header.outputFilenameLength > PYP_SERVER_FILENAME_LENGTH_MAX ||
+		header.globalsLength > PYP_SERVER_GLOBALS_LENGTH_MAX ||
+		(header.outputFilenameLength == 0 && (header.flags & PYP_SERVER_REQUEST_FLAG_OUTPUT_RETURN) == 0) ||
+		!pypServerStringRead(fd, header.inputFilenameLength, &inputFilenameUTF8) ||
+		!pypServerStringRead(fd, header.outputFilenameLength, &outputFilenameUTF8) ||
+		!pypServerStringRead(fd, (size_t) header.globalsLength, &globalsSource)
+	) {
+		goto cleanup;
+	}
+
+	if ((errorStream = tmpfile()) == NULL) {
+		// Error
+		rs = PYP_READ_ERROR_MEMORY;
+		errorMessage = "Error creating temporary file";
+	}
+	else if ((header.flags & PYP_SERVER_REQUEST_FLAG_INPUT_INLINE) != 0) {
+		if ((inputStream = tmpfile()) == NULL) {
+			// Error
+			rs = PYP_READ_ERROR_MEMORY;
+			errorMessage = "Error creating temporary file";
+		}
+		if (!pypServerStreamFromDescriptor(fd, inputStream, header.inputLength)) goto cleanup; // error
+		if (inputStream != NULL) rewind(inputStream);
+	}
+
+	// Setup
+	if (rs == PYP_READ_OKAY) {
+		if (
+			unicodeUTF8Decode(inputFilenameUTF8, &inputFilename, &characterCount, &bufferLength, &errorCount) != UNICODE_OKAY ||
+			(header.outputFilenameLength > 0 && unicodeUTF8Decode(outputFilenameUTF8, &outputFilename, &characterCount, &bufferLength, &errorCount) != UNICODE_OKAY)
+		) {
+			// Error
+			rs = PYP_READ_ERROR_MEMORY;
+			errorMessage = "Memory error";
+		}
+		else if (inputStream == NULL && fileOpenUnicode(inputFilename, "rb", &inputStream) != FILE_OPEN_OKAY) {
+			// Error
+			rs = PYP_READ_ERROR_OPEN;
+			errorMessage = "Error opening input file";
+		}
+		else if (header.globalsLength > 0 && pypEngineGlobalsParse(engine, globalsSource, &globals) != PYP_ENGINE_OKAY) {
+			// Error
+			rs = PYP_READ_ERROR;
+			errorMessage = "Invalid globals; expected a dict literal";
+		}
+		else if (
+			((header.flags & PYP_SERVER_REQUEST_FLAG_OUTPUT_RETURN) != 0) ?
+			(outputStream = tmpfile()) == NULL :
+			pypEngineOutputOpen(engine, outputFilename, &output) != FILE_OPEN_OKAY || (outputStream = output.stream) == NULL
+		) {
+			// Error
+			rs = PYP_READ_ERROR_OPEN;
+			errorMessage = "Error opening output file";
+		}
+	}
+
+	// Render
+	if (rs == PYP_READ_OKAY) {
+		rs = pypEngineRenderWithGlobals(engine, inputStream, outputStream, errorStream, inputFilename, globals, NULL);
+
+		if ((header.flags & PYP_SERVER_REQUEST_FLAG_OUTPUT_RETURN) == 0) {
+			rs = pypEngineOutputClose(&output, rs);
+			outputStream = NULL;
+		}
+	}
+	if (errorMessage != NULL && errorStream != NULL) fprintf(errorStream, "%s\n", errorMessage);
+
+	// Respond
+	errorTextLength = (errorStream != NULL) ? pypServerStreamLength(errorStream) : 0;
+	response.status = (uint32_t) rs;
+	response.errorTextLength = (uint32_t) ((errorTextLength > 0xFFFFFFFF) ? 0xFFFFFFFF : errorTextLength);
+	response.outputLength = (outputStream != NULL) ? pypServerStreamLength(outputStream) : 0;
+	if (
+		fileDescriptorWrite(fd, &response, sizeof(response)) &&
+		(response.errorTextLength == 0 || pypServerStreamToDescriptor(errorStream, fd, response.errorTextLength))
+	) {
+		if (response.outputLength > 0) pypServerStreamToDescriptor(outputStream, fd, response.outputLength);
+	}
+
+
+	// Cleanup
+	cleanup:
+	close(fd);
+	if (inputFilenameUTF8 != NULL) memFree(inputFilenameUTF8);
+	if (outputFilenameUTF8 != NULL) memFree(outputFilenameUTF8);
+	if (globalsSource != NULL) memFree(globalsSource);
+	if (inputFilename != NULL) memFree(inputFilename);
+	if (outputFilename != NULL) memFree(outputFilename);
+	if (globals != NULL) Py_DECREF(globals);
+	if (inputStream != NULL) fclose(inputStream);
+	if (outputStream != NULL) fclose(outputStream);
+	if (errorStream != NULL) fclose(errorStream);
+}
+#endif
+
+
+
+// Client
+#ifdef _WIN32
+PypServerStatus
+pypServerSend(const unicode_char* socketPath, const PypServerRequest* request, FILE* errorStream, PypReadStatus* readStatus) {
+	return PYP_SERVER_ERROR_UNSUPPORTED;
+}
+#else
+PypServerStatus
+pypServerSend(const unicode_char* socketPath, const PypServerRequest* request, FILE* errorStream, PypReadStatus* readStatus) {
+	// Vars
+	struct sockaddr_un address;
+	PypServerRequestHeader header;
+	PypServerResponseHeader response;
+	PypServerStatus ss = PYP_SERVER_OKAY;
+	char* inputFilenameUTF8 = NULL;
+	char* outputFilenameUTF8 = NULL;
+	size_t inputFilenameUTF8Length = 0;
+	size_t outputFilenameUTF8Length = 0;
+	FILE* inputCopy = NULL;
+	char* buffer = NULL;
+	size_t length;
+	int fd = -1;
+
+	// Assertions
+	assert(socketPath != NULL);
+	assert(request != NULL);
+	assert(request->inputFilename != NULL);
+	assert(request->outputFilename != NULL || request->outputStream != NULL);
+	assert(readStatus != NULL);
+
+	// Paths are made absolute here, since the server has its own working directory
+	if (
+		!pypServerFilenameEncode(request->inputFilename, &inputFilenameUTF8, &inputFilenameUTF8Length) ||
+		(request->outputStream == NULL && !pypServerFilenameEncode(request->outputFilename, &outputFilenameUTF8, &outputFilenameUTF8Length))
+	) {
+		// Error
+		ss = PYP_SERVER_ERROR_MEMORY;
+		goto cleanup;
+	}
+
+	// The length of an inline input must be known before it is sent
+	header.inputLength = 0;
+	if (request->inputStream != NULL) {
+		if ((inputCopy = tmpfile()) == NULL || (buffer = memAllocArray(char, PYP_SERVER_COPY_BLOCK_SIZE)) == NULL) {
+			// Error
+			ss = PYP_SERVER_ERROR_MEMORY;
+			goto cleanup;
+		}
+		while ((length = fread(buffer, sizeof(char), PYP_SERVER_COPY_BLOCK_SIZE, request->inputStream)) > 0) {
+			if (fwrite(buffer, sizeof(char), length, inputCopy) != length) break;
+		}
+		if (ferror(request->inputStream) || ferror(inputCopy)) {
+			// Error
+			ss = PYP_SERVER_ERROR_INPUT;
+			goto cleanup;
+		}
+		header.inputLength = pypServerStreamLength(inputCopy);
+	}
+
+	// Connect
+	if (
+		!pypServerSocketAddress(socketPath, &address) ||
+		(fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+		connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0
+	) {
+		// Error
+		ss = PYP_SERVER_ERROR_SOCKET;
+		goto cleanup;
+	}
+
+	// Request
+	header.magic = PYP_SERVER_MAGIC;
+	header.flags = PYP_SERVER_REQUEST_FLAGS_NONE;
+	if (request->inputStream != NULL) header.flags |= PYP_SERVER_REQUEST_FLAG_INPUT_INLINE;
+	if (request->outputStream != NULL) header.flags |= PYP_SERVER_REQUEST_FLAG_OUTPUT_RETURN;
+	header.inputFilenameLength = (uint32_t) inputFilenameUTF8Length;
+	header.outputFilenameLength = (uint32_t) outputFilenameUTF8Length;
+	header.globalsLength = (request->globals != NULL) ? strlen(request->globals) : 0;
+	if (
+		!fileDescriptorWrite(fd, &header, sizeof(header)) ||
+		!fileDescriptorWrite(fd, inputFilenameUTF8, inputFilenameUTF8Length) ||
+		!fileDescriptorWrite(fd, outputFilenameUTF8, outputFilenameUTF8Length) ||
+		!fileDescriptorWrite(fd, request->globals, (size_t) header.globalsLength) ||
+		(header.inputLength > 0 && !pypServerStreamToDescriptor(inputCopy, fd, header.inputLength))
+	) {
+		// Error
+		ss = PYP_SERVER_ERROR_PROTOCOL;
+		goto cleanup;
+	}
+
+	// Response
+	if (
+		!fileDescriptorRead(fd, &response, sizeof(response)) ||
+		!pypServerStreamFromDescriptor(fd, errorStream, response.errorTextLength) ||
+		(response.outputLength > 0 && (
+			request->outputStream == NULL ||
+			!pypServerStreamFromDescriptor(fd, request->outputStream, response.outputLength)
+		))
+	) {
+		// Error
+		ss = PYP_SERVER_ERROR_PROTOCOL;
+		goto cleanup;
+	}
+	*readStatus = (PypReadStatus) response.status;
+
+
+	// Cleanup
+	cleanup:
+	if (fd >= 0) close(fd);
+	if (inputFilenameUTF8 != NULL) memFree(inputFilenameUTF8);
+	if (outputFilenameUTF8 != NULL) memFree(outputFilenameUTF8);
+	if (inputCopy != NULL) fclose(inputCopy);
+	if (buffer != NULL) memFree(buffer);
+	return ss;
+}
+#endif
+
+
+
+// Status info
+const char*
+pypServerStatusDescription(PypServerStatus status) {
+	switch (status) {
+		case PYP_SERVER_OKAY:
+			return "Okay";
+		case PYP_SERVER_ERROR_MEMORY:
+			return "Memory error";
+		case PYP_SERVER_ERROR_SOCKET:
+			return "Socket error";
+		case PYP_SERVER_ERROR_PROTOCOL:
+			return "Connection closed unexpectedly";
+		case PYP_SERVER_ERROR_INPUT:
+			return "Error reading input";
+		case PYP_SERVER_ERROR_UNSUPPORTED:
+			return "Not supported on this platform";
+		case PYP_SERVER_ERROR_RUNNING:
+			return "A server is already running on the socket";
+		default:
+			return "Error";
+	}
+}
+
+
+
+// Helpers
+#ifndef _WIN32
+PypBool
+pypServerSocketAddress(const unicode_char* socketPath, struct sockaddr_un* address) {
+	// Vars
+	char* path;
+	size_t pathLength;
+	size_t errorCount;
+
+	// Assertions
+	assert(socketPath != NULL);
+	assert(address != NULL);
+
+	if (unicodeUTF8Encode(socketPath, &path, &pathLength, &errorCount) != UNICODE_OKAY) return PYP_FALSE; // error
+	if (pathLength == 0 || pathLength >= sizeof(address->sun_path)) {
+		// Error; too long for a socket address
+		memFree(path);
+		return PYP_FALSE;
+	}
+
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	memcpy(address->sun_path, path, pathLength + 1);
+
+	// Done
+	memFree(path);
+	return PYP_TRUE;
+}
+
+PypBool
+pypServerStringRead(int fd, size_t length, char** string) {
+	// Assertions
+	assert(string != NULL);
+
+	if ((*string = memAllocArray(char, length + 1)) == NULL) return PYP_FALSE; // error
+	(*string)[length] = '\x00';
+
+	return fileDescriptorRead(fd, *string, length);
+}
+
+PypBool
+pypServerFilenameEncode(const unicode_char* filename, char** filenameUTF8, size_t* filenameUTF8Length) {
+	// Vars
+	unicode_char* absoluteFilename;
+	size_t absoluteFilenameLength;
+	size_t errorCount;
+	UnicodeStatus us;
+
+	if (pathAbsoluteUnicode(filename, &absoluteFilename, &absoluteFilenameLength) != PATH_OKAY) return PYP_FALSE; // error
+	us = unicodeUTF8Encode(absoluteFilename, filenameUTF8, filenameUTF8Length, &errorCount);
+	memFree(absoluteFilename);
+
+	return (us == UNICODE_OKAY);
+}
+
+PypBool
+pypServerStreamFromDescriptor(int fd, FILE* stream, uint64_t length) {
+	// Vars
+	char buffer[PYP_SERVER_COPY_BLOCK_SIZE];
+	size_t blockLength;
+	PypBool okay = PYP_TRUE;
+
+	// The data is always consumed, even if the stream can't be written to
+	while (length > 0) {
+		blockLength = (length < sizeof(buffer)) ? (size_t) length : sizeof(buffer);
+		if (!fileDescriptorRead(fd, buffer, blockLength)) return PYP_FALSE; // error
+		if (okay && stream != NULL && fwrite(buffer, sizeof(char), blockLength, stream) != blockLength) okay = PYP_FALSE;
+		length -= blockLength;
+	}
+
+	return PYP_TRUE;
+}
+
+PypBool
+pypServerStreamToDescriptor(FILE* stream, int fd, uint64_t length) {
+	// Vars
+	char buffer[PYP_SERVER_COPY_BLOCK_SIZE];
+	size_t blockLength;
+
+	// Assertions
+	assert(stream != NULL);
+
+	rewind(stream);
+	while (length > 0) {
+		blockLength = (length < sizeof(buffer)) ? (size_t) length : sizeof(buffer);
+		if (fread(buffer, sizeof(char), blockLength, stream) != blockLength) {
+			// Stream ended early; pad, so the other side stays in sync
+			memset(buffer, 0, blockLength);
+		}
+		if (!fileDescriptorWrite(fd, buffer, blockLength)) return PYP_FALSE; // error
+		length -= blockLength;
+	}
+
+	return PYP_TRUE;
+}
+
+uint64_t
+pypServerStreamLength(FILE* stream) {
+	// Vars
+	long int length;
+
+	// Assertions
+	assert(stream != NULL);
+
+	fflush(stream);
+	if (fseek(stream, 0, SEEK_END) != 0 || (length = ftell(stream)) < 0) return 0; // error
+	return (uint64_t) length;
+}
+#endif
+
@@ -0,0 +1,48 @@
+#ifndef __PYP_SERVER_H
+#define __PYP_SERVER_H
+
+
+
+#include <stdio.h>
+#include "PypTypes.h"
+#include "PypReader.h"
+#include "PypEngine.h"
+#include "Unicode.h"
+
+
+
+typedef enum PypServerStatus_ {
+	PYP_SERVER_OKAY = 0x0,
+	PYP_SERVER_ERROR_MEMORY = 0x1,
+	PYP_SERVER_ERROR_SOCKET = 0x2,
+	PYP_SERVER_ERROR_PROTOCOL = 0x3,
+	PYP_SERVER_ERROR_INPUT = 0x4,
+	PYP_SERVER_ERROR_UNSUPPORTED = 0x5,
+	PYP_SERVER_ERROR_RUNNING = 0x6, // another server is listening on the socket
+} PypServerStatus;
+
+typedef struct PypServerSettings_ {
+	PypBool forkPerRequest; // each request is rendered in a forked copy of the server
+} PypServerSettings;
+
+typedef struct PypServerRequest_ {
+	const unicode_char* inputFilename;
+	const unicode_char* outputFilename;
+	FILE* inputStream; // if not NULL, its contents are sent instead of reading inputFilename on the server
+	FILE* outputStream; // if not NULL, the output is sent back to it instead of being written to outputFilename
+	const char* globals; // python dict literal, or NULL
+} PypServerRequest;
+
+
+
+void pypServerSettingsInit(PypServerSettings* settings);
+
+PypServerStatus pypServerRun(PypEngine* engine, const unicode_char* socketPath, const PypServerSettings* settings, FILE* logStream);
+PypServerStatus pypServerSend(const unicode_char* socketPath, const PypServerRequest* request, FILE* errorStream, PypReadStatus* readStatus);
+
+const char* pypServerStatusDescription(PypServerStatus status);
+
+
+
+#endif
+
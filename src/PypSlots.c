@@ -0,0 +1,432 @@
+#include <assert.h>
+#include <string.h>
+#include "PypSlots.h"
+#include "PypStats.h"
+#include "Memory.h"
+
+
+
+// Headers
+static PypSlot* pypSlotsFind(PypSlots* slots, const char* name, PypSize nameLength);
+static PypSlotsSegment* pypSlotsSegmentAdd(PypSlots* slots, PypSlot* slot);
+static PypSlotsStatus pypSlotsFlush(PypSlots* slots, PypBool all);
+static PypSlotsStatus pypSlotsSpill(PypSlots* slots);
+static PypBool pypSlotsWriteDataBuffer(FILE* stream, const PypDataBuffer* dataBuffer);
+static PypBool pypSlotsWriteSpilled(PypSlots* slots, long start, PypSize length);
+
+
+
+// Setup for a single render
+void
+pypSlotsInit(PypSlots* slots, FILE* outputStream) {
+	assert(slots != NULL);
+
+	slots->firstChild = NULL;
+	slots->firstSegment = NULL;
+	slots->lastSegment = NULL;
+	slots->heldSize = 0;
+	slots->spillStream = NULL;
+	slots->spillEnd = 0;
+	slots->outputStream = outputStream;
+	threadMutexInit(&slots->mutex);
+}
+
+PypSlotsStatus
+pypSlotsFinish(PypSlots* slots, PypDataBuffer* outputDataBuffer) {
+	// Vars
+	PypSlotsStatus status = PYP_SLOTS_OKAY;
+	PypSlotsSegment* segment;
+	PypSlotsSegment* nextSegment;
+	PypDataBufferEntry* entry;
+	PypSlot* slot;
+	PypSlot* next;
+
+	// Assertions
+	assert(slots != NULL);
+
+	// Everything still held is written; slots which were never filled are left empty
+	if (slots->firstSegment != NULL) {
+		status = pypSlotsFlush(slots, PYP_TRUE);
+	}
+	else if (slots->outputStream == NULL && outputDataBuffer != NULL && slots->firstChild != NULL) {
+		// Nothing was written yet, so the slots are filled in place
+		for (entry = outputDataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+			if (entry->reference == NULL) continue;
+
+			slot = (PypSlot*) entry->reference;
+			if (slot->content != NULL) {
+				pypDataBufferPlaceholderFillAndDelete(outputDataBuffer, entry, slot->content);
+				slot->content = NULL;
+			}
+		}
+	}
+
+	// Delete held output, if it couldn't be written
+	for (segment = slots->firstSegment; segment != NULL; segment = nextSegment) {
+		nextSegment = segment->nextSibling;
+		pypDataBufferDelete(segment->dataBuffer);
+		memFree(segment);
+	}
+	if (slots->spillStream != NULL) fclose(slots->spillStream);
+
+	// Placeholders may outlive the render, in output which was never written
+	for (slot = slots->firstChild; slot != NULL; slot = next) {
+		next = slot->nextSibling;
+		if (slot->placeholder != NULL) slot->placeholder->reference = NULL;
+		if (slot->content != NULL) pypDataBufferDelete(slot->content);
+		memFree(slot->name);
+		memFree(slot);
+	}
+
+	threadMutexDestroy(&slots->mutex);
+
+	// Done
+	return status;
+}
+
+
+
+// Slots
+PypSlotsStatus
+pypSlotsReserve(PypSlots* slots, PypDataBuffer* dataBuffer, const char* name, PypSize nameLength) {
+	// Vars
+	PypSlotsStatus status = PYP_SLOTS_ERROR_MEMORY;
+	PypSlot* slot;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(dataBuffer != NULL);
+	assert(name != NULL);
+
+	threadMutexLock(&slots->mutex);
+
+	// Names are unique for the whole render
+	if (pypSlotsFind(slots, name, nameLength) != NULL) {
+		// Error
+		threadMutexUnlock(&slots->mutex);
+		return PYP_SLOTS_ERROR_EXISTS;
+	}
+
+	// Create
+	if ((slot = memAlloc(PypSlot)) == NULL) goto cleanup; // error
+	if ((slot->name = memAllocArray(char, nameLength + 1)) == NULL) {
+		// Error
+		memFree(slot);
+		goto cleanup;
+	}
+	memcpy(slot->name, name, sizeof(char) * nameLength);
+	slot->name[nameLength] = '\x00';
+	slot->nameLength = nameLength;
+	slot->content = NULL;
+
+	// The placeholder travels with the output it's in, until it reaches the top
+	if ((slot->placeholder = pypDataBufferExtendPlaceholder(dataBuffer)) == NULL) {
+		// Error
+		memFree(slot->name);
+		memFree(slot);
+		goto cleanup;
+	}
+	slot->placeholder->reference = &slot->placeholder;
+
+	// Link
+	slot->nextSibling = slots->firstChild;
+	slots->firstChild = slot;
+	status = PYP_SLOTS_OKAY;
+
+	// Done
+	cleanup:
+	threadMutexUnlock(&slots->mutex);
+	return status;
+}
+
+PypSlotsStatus
+pypSlotsFill(PypSlots* slots, const char* name, PypSize nameLength, PypDataBuffer* content) {
+	// Vars
+	PypSlotsStatus status = PYP_SLOTS_OKAY;
+	PypSlot* slot;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(name != NULL);
+	assert(content != NULL);
+
+	threadMutexLock(&slots->mutex);
+
+	// Find; the content is owned by the slot from here on, or deleted
+	if ((slot = pypSlotsFind(slots, name, nameLength)) == NULL) {
+		// Error
+		status = PYP_SLOTS_ERROR_NOT_FOUND;
+		pypDataBufferDelete(content);
+	}
+	else if (slot->content != NULL) {
+		// Error
+		status = PYP_SLOTS_ERROR_FILLED;
+		pypDataBufferDelete(content);
+	}
+	else {
+		// Output which was waiting on it is written now
+		slot->content = content;
+		if (slots->firstSegment != NULL) status = pypSlotsFlush(slots, PYP_FALSE);
+	}
+
+	// Done
+	threadMutexUnlock(&slots->mutex);
+	return status;
+}
+
+PypSlot*
+pypSlotsFind(PypSlots* slots, const char* name, PypSize nameLength) {
+	// Vars
+	PypSlot* slot;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(name != NULL);
+
+	// A page only has a few
+	for (slot = slots->firstChild; slot != NULL; slot = slot->nextSibling) {
+		if (slot->nameLength == nameLength && memcmp(slot->name, name, sizeof(char) * nameLength) == 0) return slot;
+	}
+
+	// Not found
+	return NULL;
+}
+
+
+
+// Output
+PypReadStatus
+pypSlotsOutput(PypSlots* slots, PypDataBuffer** dataBuffer, const PypChar* buffer, PypSize bufferLength, PypBool* taken) {
+	// Vars
+	PypSlotsStatus status = PYP_SLOTS_OKAY;
+	PypDataBuffer* source;
+	PypDataBufferEntry* entry;
+	PypDataBufferEntry* next;
+	PypSlot* slot;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(taken != NULL);
+	assert(slots->outputStream != NULL);
+
+	*taken = PYP_FALSE;
+	threadMutexLock(&slots->mutex);
+
+	if (dataBuffer != NULL) {
+		// Output without any placeholders is written as usual while nothing is held
+		assert(*dataBuffer != NULL);
+		source = *dataBuffer;
+		if (slots->firstSegment == NULL) {
+			for (entry = source->firstChild; entry != NULL && entry->reference == NULL; entry = entry->nextSibling);
+			if (entry == NULL) {
+				threadMutexUnlock(&slots->mutex);
+				return PYP_READ_OKAY;
+			}
+		}
+
+		// Taken apart at each slot
+		*taken = PYP_TRUE;
+		*dataBuffer = NULL;
+		for (entry = source->firstChild; entry != NULL; entry = next) {
+			next = entry->nextSibling;
+			entry->nextSibling = NULL;
+
+			if (status != PYP_SLOTS_OKAY) {
+				// Anything after an error is dropped
+				pypDataBufferEntryDelete(entry);
+			}
+			else if (entry->reference != NULL) {
+				// Everything after an unfilled slot waits for it
+				slot = (PypSlot*) entry->reference;
+				pypDataBufferEntryDelete(entry);
+
+				if (slots->firstSegment == NULL && slot->content != NULL) {
+					if (!pypSlotsWriteDataBuffer(slots->outputStream, slot->content)) status = PYP_SLOTS_ERROR_WRITE; // error
+				}
+				else if (pypSlotsSegmentAdd(slots, slot) == NULL) {
+					// Error
+					status = PYP_SLOTS_ERROR_MEMORY;
+				}
+			}
+			else if (slots->firstSegment == NULL) {
+				// Written
+				if (fwrite(entry->buffer, sizeof(PypChar), entry->bufferLength, slots->outputStream) != entry->bufferLength) status = PYP_SLOTS_ERROR_WRITE; // error
+				pypDataBufferEntryDelete(entry);
+			}
+			else {
+				// Held
+				*slots->lastSegment->dataBuffer->lastChild = entry;
+				slots->lastSegment->dataBuffer->lastChild = &entry->nextSibling;
+				slots->lastSegment->dataBuffer->totalSize += entry->bufferLength;
+				slots->heldSize += entry->bufferLength;
+			}
+		}
+		memFree(source);
+	}
+	else if (slots->firstSegment != NULL) {
+		// Text between tags
+		*taken = PYP_TRUE;
+		if (pypDataBufferExtendWithData(slots->lastSegment->dataBuffer, buffer, bufferLength) == NULL) {
+			status = PYP_SLOTS_ERROR_MEMORY; // error
+		}
+		else {
+			slots->heldSize += bufferLength;
+		}
+	}
+
+	// Large output waits on disk instead
+	if (status == PYP_SLOTS_OKAY && slots->heldSize > PYP_SLOTS_SPILL_SIZE) status = pypSlotsSpill(slots);
+
+	// Done
+	threadMutexUnlock(&slots->mutex);
+	if (status == PYP_SLOTS_ERROR_MEMORY) return PYP_READ_ERROR_MEMORY;
+	if (status != PYP_SLOTS_OKAY) return PYP_READ_ERROR_WRITE;
+	return PYP_READ_OKAY;
+}
+
+PypSlotsSegment*
+pypSlotsSegmentAdd(PypSlots* slots, PypSlot* slot) {
+	// Vars
+	PypSlotsSegment* segment;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(slot != NULL);
+
+	// Create
+	if ((segment = memAlloc(PypSlotsSegment)) == NULL) return NULL; // error
+	if ((segment->dataBuffer = pypDataBufferCreate()) == NULL) {
+		// Error
+		memFree(segment);
+		return NULL;
+	}
+	segment->slot = slot;
+	segment->spillStart = 0;
+	segment->spillLength = 0;
+	segment->nextSibling = NULL;
+
+	// Link
+	if (slots->lastSegment == NULL) {
+		slots->firstSegment = segment;
+	}
+	else {
+		slots->lastSegment->nextSibling = segment;
+	}
+	slots->lastSegment = segment;
+
+	// Done
+	return segment;
+}
+
+PypSlotsStatus
+pypSlotsFlush(PypSlots* slots, PypBool all) {
+	// Vars
+	PypSlotsSegment* segment;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(slots->outputStream != NULL);
+
+	// Up to the first slot which isn't filled yet
+	while ((segment = slots->firstSegment) != NULL && (all || segment->slot->content != NULL)) {
+		if (
+			(segment->slot->content != NULL && !pypSlotsWriteDataBuffer(slots->outputStream, segment->slot->content)) ||
+			(segment->spillLength > 0 && !pypSlotsWriteSpilled(slots, segment->spillStart, segment->spillLength)) ||
+			!pypSlotsWriteDataBuffer(slots->outputStream, segment->dataBuffer)
+		) {
+			// Error
+			return PYP_SLOTS_ERROR_WRITE;
+		}
+
+		// Unlink
+		slots->heldSize -= segment->dataBuffer->totalSize;
+		slots->firstSegment = segment->nextSibling;
+		if (slots->firstSegment == NULL) slots->lastSegment = NULL;
+		pypDataBufferDelete(segment->dataBuffer);
+		memFree(segment);
+	}
+
+	// The spill file is reused from the start once nothing is held
+	if (slots->firstSegment == NULL) slots->spillEnd = 0;
+
+	// Done
+	return PYP_SLOTS_OKAY;
+}
+
+PypSlotsStatus
+pypSlotsSpill(PypSlots* slots) {
+	// Vars
+	PypSlotsSegment* segment;
+
+	// Assertions
+	assert(slots != NULL);
+
+	// If there's nowhere to spill to, it stays in memory
+	if (slots->spillStream == NULL && (slots->spillStream = tmpfile()) == NULL) return PYP_SLOTS_OKAY;
+	if (fseek(slots->spillStream, slots->spillEnd, SEEK_SET) != 0) return PYP_SLOTS_ERROR_WRITE; // error
+
+	// Only the last segment grows, so each segment's spilled output stays in one piece
+	for (segment = slots->firstSegment; segment != NULL; segment = segment->nextSibling) {
+		if (segment->dataBuffer->totalSize == 0) continue;
+
+		if (segment->spillLength == 0) segment->spillStart = slots->spillEnd;
+		assert(segment->spillStart + (long) segment->spillLength == slots->spillEnd);
+
+		if (!pypSlotsWriteDataBuffer(slots->spillStream, segment->dataBuffer)) return PYP_SLOTS_ERROR_WRITE; // error
+		segment->spillLength += segment->dataBuffer->totalSize;
+		slots->spillEnd += (long) segment->dataBuffer->totalSize;
+		pypDataBufferEmpty(segment->dataBuffer);
+	}
+	slots->heldSize = 0;
+	pypStatsAdd(PYP_STATS_SLOT_SPILLS, 1);
+
+	// Done
+	return PYP_SLOTS_OKAY;
+}
+
+PypBool
+pypSlotsWriteDataBuffer(FILE* stream, const PypDataBuffer* dataBuffer) {
+	// Vars
+	const PypDataBufferEntry* entry;
+
+	// Assertions
+	assert(stream != NULL);
+	assert(dataBuffer != NULL);
+
+	// Write
+	for (entry = dataBuffer->firstChild; entry != NULL; entry = entry->nextSibling) {
+		if (fwrite(entry->buffer, sizeof(PypChar), entry->bufferLength, stream) != entry->bufferLength) return PYP_FALSE; // error
+	}
+
+	// Done
+	return PYP_TRUE;
+}
+
+PypBool
+pypSlotsWriteSpilled(PypSlots* slots, long start, PypSize length) {
+	// Vars
+	char buffer[16384];
+	size_t readLength;
+
+	// Assertions
+	assert(slots != NULL);
+	assert(slots->spillStream != NULL);
+
+	// Copy
+	if (fseek(slots->spillStream, start, SEEK_SET) != 0) return PYP_FALSE; // error
+	while (length > 0) {
+		readLength = (length < sizeof(buffer)) ? (size_t) length : sizeof(buffer);
+		if (
+			fread(buffer, sizeof(char), readLength, slots->spillStream) != readLength ||
+			fwrite(buffer, sizeof(char), readLength, slots->outputStream) != readLength
+		) {
+			// Error
+			return PYP_FALSE;
+		}
+		length -= readLength;
+	}
+
+	// Done
+	return PYP_TRUE;
+}
+
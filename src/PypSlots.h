@@ -0,0 +1,66 @@
+#ifndef __PYP_SLOTS_H
+#define __PYP_SLOTS_H
+
+
+
+#include <stdio.h>
+#include "PypTypes.h"
+#include "PypDataBuffer.h"
+#include "PypReader.h"
+#include "Thread.h"
+
+
+
+// Output held back for unfilled slots is moved to a temporary file past this size
+#define PYP_SLOTS_SPILL_SIZE (4 * 1024 * 1024)
+
+typedef enum PypSlotsStatus_ {
+	PYP_SLOTS_OKAY = 0x0,
+	PYP_SLOTS_ERROR_MEMORY = 0x1,
+	PYP_SLOTS_ERROR_WRITE = 0x2,
+	PYP_SLOTS_ERROR_EXISTS = 0x3, // a slot with the same name was already reserved
+	PYP_SLOTS_ERROR_NOT_FOUND = 0x4,
+	PYP_SLOTS_ERROR_FILLED = 0x5, // slots are only filled once
+} PypSlotsStatus;
+
+typedef struct PypSlot_ {
+	PypDataBufferEntry* placeholder; // first, so the placeholder's reference leads back to the slot; NULL once it reached the output or was deleted
+	char* name; // UTF-8
+	PypSize nameLength;
+	PypDataBuffer* content; // NULL until filled
+	struct PypSlot_* nextSibling;
+} PypSlot;
+
+typedef struct PypSlotsSegment_ {
+	PypSlot* slot; // the output can't be written before the slot is filled
+	long spillStart;
+	PypSize spillLength; // spilled output comes before what's still in dataBuffer
+	PypDataBuffer* dataBuffer;
+	struct PypSlotsSegment_* nextSibling;
+} PypSlotsSegment;
+
+typedef struct PypSlots_ {
+	PypSlot* firstChild;
+	PypSlotsSegment* firstSegment; // output held back, in order; NULL while output streams
+	PypSlotsSegment* lastSegment;
+	PypSize heldSize; // in memory
+	FILE* spillStream; // NULL until held output first gets too large
+	long spillEnd;
+	FILE* outputStream; // NULL if the render's output is a buffer, which is complete before anything is written
+	ThreadMutex mutex; // slots may be filled from includes on other threads
+} PypSlots;
+
+
+
+void pypSlotsInit(PypSlots* slots, FILE* outputStream);
+PypSlotsStatus pypSlotsFinish(PypSlots* slots, PypDataBuffer* outputDataBuffer);
+
+PypSlotsStatus pypSlotsReserve(PypSlots* slots, PypDataBuffer* dataBuffer, const char* name, PypSize nameLength);
+PypSlotsStatus pypSlotsFill(PypSlots* slots, const char* name, PypSize nameLength, PypDataBuffer* content);
+
+PypReadStatus pypSlotsOutput(PypSlots* slots, PypDataBuffer** dataBuffer, const PypChar* buffer, PypSize bufferLength, PypBool* taken);
+
+
+
+#endif
+
@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <stdio.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "PypStats.h"
+
+
+
+// Counters; updated atomically, since templates may render on several threads at once
+static volatile PypStatsValue pypStatsCounters[PYP_STATS_COUNTER_COUNT] = { 0 };
+
+static const char* const pypStatsCounterNames[PYP_STATS_COUNTER_COUNT] = {
+	"renders",
+	"render errors",
+	"includes",
+	"code executions",
+	"code errors",
+	"unchanged outputs",
+	"cache hits",
+	"cache misses",
+	"tag-free copies",
+	"gc collections",
+	"gc pause microseconds",
+	"template renders",
+	"slot spills",
+	"fragment cache hits",
+	"fragment cache misses",
+	"fragment cache bytes saved",
+	"memoized expression hits",
+	"memoized expression misses",
+	"side outputs",
+};
+
+static volatile PypStatsValue pypStatsTimers[PYP_STATS_TIMER_COUNT] = { 0 };
+
+static const char* const pypStatsTimerNames[PYP_STATS_TIMER_COUNT] = {
+	"python initialization",
+	"engine setup",
+	"prelude imports",
+	"first render",
+	"python finalization",
+};
+
+
+
+// Counter access
+void
+pypStatsAdd(PypStatsCounter counter, PypStatsValue amount) {
+	assert(counter < PYP_STATS_COUNTER_COUNT);
+
+	threadAtomicAdd(&pypStatsCounters[counter], amount);
+}
+
+PypStatsValue
+pypStatsGet(PypStatsCounter counter) {
+	assert(counter < PYP_STATS_COUNTER_COUNT);
+
+	return threadAtomicGet(&pypStatsCounters[counter]);
+}
+
+
+
+// Bulk access, used to move counts out of worker processes
+void
+pypStatsSnapshot(PypStatsValue* values) {
+	size_t i;
+
+	assert(values != NULL);
+
+	for (i = 0; i < PYP_STATS_COUNTER_COUNT; ++i) {
+		values[i] = threadAtomicGet(&pypStatsCounters[i]);
+	}
+}
+
+void
+pypStatsMerge(const PypStatsValue* values) {
+	size_t i;
+
+	assert(values != NULL);
+
+	for (i = 0; i < PYP_STATS_COUNTER_COUNT; ++i) {
+		if (values[i] != 0) threadAtomicAdd(&pypStatsCounters[i], values[i]);
+	}
+}
+
+
+
+// Output
+void
+pypStatsPrint(FILE* stream) {
+	PypStatsValue hits;
+	PypStatsValue total;
+	size_t i;
+
+	assert(stream != NULL);
+
+	fprintf(stream, "Stats:\n");
+	for (i = 0; i < PYP_STATS_COUNTER_COUNT; ++i) {
+		fprintf(stream, "  %s: %lld\n", pypStatsCounterNames[i], (long long int) threadAtomicGet(&pypStatsCounters[i]));
+	}
+
+	// Only when pyp.cache was used
+	hits = threadAtomicGet(&pypStatsCounters[PYP_STATS_FRAGMENT_HITS]);
+	total = hits + threadAtomicGet(&pypStatsCounters[PYP_STATS_FRAGMENT_MISSES]);
+	if (total > 0) fprintf(stream, "  fragment cache hit rate: %.1f%%\n", hits * 100.0 / total);
+
+	// Only when expressions were memoized
+	hits = threadAtomicGet(&pypStatsCounters[PYP_STATS_MEMOIZED_HITS]);
+	total = hits + threadAtomicGet(&pypStatsCounters[PYP_STATS_MEMOIZED_MISSES]);
+	if (total > 0) fprintf(stream, "  memoized expression hit rate: %.1f%%\n", hits * 100.0 / total);
+}
+
+
+
+// Startup timing
+PypStatsValue
+pypStatsClock() {
+	#ifdef _WIN32
+	// Vars
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (PypStatsValue) (counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+	#else
+	// Vars
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (PypStatsValue) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+	#endif
+}
+
+void
+pypStatsTimerAdd(PypStatsTimer timer, PypStatsValue microseconds) {
+	assert(timer < PYP_STATS_TIMER_COUNT);
+
+	threadAtomicAdd(&pypStatsTimers[timer], microseconds);
+}
+
+PypStatsValue
+pypStatsTimerGet(PypStatsTimer timer) {
+	assert(timer < PYP_STATS_TIMER_COUNT);
+
+	return threadAtomicGet(&pypStatsTimers[timer]);
+}
+
+void
+pypStatsTimersPrint(FILE* stream, PypStatsValue total) {
+	// Vars
+	PypStatsValue value;
+	PypStatsValue accounted = 0;
+	size_t i;
+
+	// Assertions
+	assert(stream != NULL);
+
+	// Phases which didn't happen in this process are left out
+	fprintf(stream, "Startup profile:\n");
+	for (i = 0; i < PYP_STATS_TIMER_COUNT; ++i) {
+		if ((value = threadAtomicGet(&pypStatsTimers[i])) == 0) continue;
+		fprintf(stream, "  %s: %.3f ms\n", pypStatsTimerNames[i], value / 1000.0);
+		accounted += value;
+	}
+	fprintf(stream, "  rest of the run: %.3f ms\n", (total > accounted ? total - accounted : 0) / 1000.0);
+	fprintf(stream, "  total: %.3f ms\n", total / 1000.0);
+
+	// Collections happen within the phases above, and include those of worker processes
+	if ((value = threadAtomicGet(&pypStatsCounters[PYP_STATS_GC_COLLECTIONS])) > 0) {
+		fprintf(stream, "  gc pauses: %.3f ms over %lld collections\n", threadAtomicGet(&pypStatsCounters[PYP_STATS_GC_PAUSE]) / 1000.0, (long long int) value);
+	}
+}
+
+
+
@@ -0,0 +1,66 @@
+#ifndef __PYP_STATS_H
+#define __PYP_STATS_H
+
+
+
+#include <stdio.h>
+#include "PypTypes.h"
+#include "Thread.h"
+
+
+
+typedef enum PypStatsCounter_ {
+	PYP_STATS_RENDERS = 0x0,
+	PYP_STATS_RENDER_ERRORS = 0x1,
+	PYP_STATS_INCLUDES = 0x2,
+	PYP_STATS_CODE_EXECUTIONS = 0x3,
+	PYP_STATS_CODE_ERRORS = 0x4,
+	PYP_STATS_OUTPUTS_UNCHANGED = 0x5,
+	PYP_STATS_CACHE_HITS = 0x6,
+	PYP_STATS_CACHE_MISSES = 0x7,
+	PYP_STATS_TAG_FREE_COPIES = 0x8,
+	PYP_STATS_GC_COLLECTIONS = 0x9,
+	PYP_STATS_GC_PAUSE = 0xA, // in microseconds
+	PYP_STATS_TEMPLATE_RENDERS = 0xB, // of templates compiled by pyp.compile
+	PYP_STATS_SLOT_SPILLS = 0xC, // output held for a pyp.slot moved to a temporary file
+	PYP_STATS_FRAGMENT_HITS = 0xD, // regions of pyp.cache taken from the fragment cache
+	PYP_STATS_FRAGMENT_MISSES = 0xE,
+	PYP_STATS_FRAGMENT_BYTES_SAVED = 0xF, // output spliced in from the fragment cache instead of rendered
+	PYP_STATS_MEMOIZED_HITS = 0x10, // expression tags whose output was reused instead of evaluated
+	PYP_STATS_MEMOIZED_MISSES = 0x11,
+	PYP_STATS_SIDE_OUTPUTS = 0x12, // files opened by pyp.output
+	PYP_STATS_COUNTER_COUNT = 0x13,
+} PypStatsCounter;
+
+typedef enum PypStatsTimer_ {
+	PYP_STATS_TIMER_PYTHON_INIT = 0x0,
+	PYP_STATS_TIMER_ENGINE_SETUP = 0x1,
+	PYP_STATS_TIMER_PRELUDE = 0x2,
+	PYP_STATS_TIMER_FIRST_RENDER = 0x3,
+	PYP_STATS_TIMER_PYTHON_FINALIZE = 0x4,
+	PYP_STATS_TIMER_COUNT = 0x5,
+} PypStatsTimer;
+
+typedef ThreadAtomic PypStatsValue;
+
+
+
+void pypStatsAdd(PypStatsCounter counter, PypStatsValue amount);
+PypStatsValue pypStatsGet(PypStatsCounter counter);
+
+void pypStatsSnapshot(PypStatsValue* values);
+void pypStatsMerge(const PypStatsValue* values);
+
+void pypStatsPrint(FILE* stream);
+
+// Startup timing; in microseconds, and only for the current process
+PypStatsValue pypStatsClock();
+void pypStatsTimerAdd(PypStatsTimer timer, PypStatsValue microseconds);
+PypStatsValue pypStatsTimerGet(PypStatsTimer timer);
+void pypStatsTimersPrint(FILE* stream, PypStatsValue total);
+
+
+
+#endif
+
+
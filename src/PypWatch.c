@@ -0,0 +1,380 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Python.h>
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+#include "PypWatch.h"
+#include "PypDependencies.h"
+#include "Memory.h"
+#include "Path.h"
+
+
+
+// Headers
+#ifdef __linux__
+#define PYP_WATCH_EVENT_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE)
+#define PYP_WATCH_EVENT_BUFFER_SIZE 0x10000
+
+typedef struct PypWatchTarget_ {
+	PypBatchJob* job;
+	PypDependencies* dependencies;
+	int* watchIds; // watch descriptor of each dependency's directory, or -1
+	PypBool changed;
+} PypWatchTarget;
+
+static volatile sig_atomic_t pypWatchStopRequested = 0;
+
+static void pypWatchSignalStop(int signalNumber);
+static PypBool pypWatchTargetRender(PypWatchTarget* target, PypEngine* engine, int notifyFd, FILE* reportStream);
+static PypBool pypWatchTargetWatch(PypWatchTarget* target, int notifyFd);
+static void pypWatchTargetReport(PypWatchTarget* target, FILE* reportStream);
+static PypBool pypWatchEventsRead(int notifyFd, char* buffer, PypWatchTarget* targets, size_t targetCount);
+static void pypWatchEventApply(int watchId, const char* name, PypWatchTarget* targets, size_t targetCount);
+static size_t pypWatchFilenameStart(const unicode_char* filename);
+static unsigned long pypWatchMilliseconds();
+#endif
+
+
+
+// Settings
+void
+pypWatchSettingsInit(PypWatchSettings* settings) {
+	assert(settings != NULL);
+
+	settings->debounceMilliseconds = 100;
+}
+
+
+
+// Watching
+#ifndef __linux__
+PypWatchStatus
+pypWatchRun(PypBatch* batch, PypEngine* engine, const PypWatchSettings* settings, FILE* reportStream) {
+	return PYP_WATCH_ERROR_UNSUPPORTED;
+}
+#else
+PypWatchStatus
+pypWatchRun(PypBatch* batch, PypEngine* engine, const PypWatchSettings* settings, FILE* reportStream) {
+	// Vars
+	struct sigaction action;
+	struct sigaction previousInterrupt;
+	struct sigaction previousTerminate;
+	struct pollfd pollFd;
+	PypWatchStatus ws = PYP_WATCH_OKAY;
+	PypWatchTarget* targets = NULL;
+	char* eventBuffer = NULL;
+	unsigned long timeStart;
+	size_t changedCount;
+	size_t failureCount;
+	size_t fileCount;
+	size_t i;
+	int notifyFd;
+	int pollStatus;
+	PypBool initial = PYP_TRUE;
+
+	// Assertions
+	assert(batch != NULL);
+	assert(engine != NULL);
+	assert(settings != NULL);
+	assert(reportStream != NULL);
+
+	// Setup
+	if ((notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) return PYP_WATCH_ERROR_NOTIFY; // error
+	if (
+		batch->jobCount == 0 ||
+		(targets = memAllocArray(PypWatchTarget, batch->jobCount)) == NULL ||
+		(eventBuffer = memAllocArray(char, PYP_WATCH_EVENT_BUFFER_SIZE)) == NULL
+	) {
+		// Error
+		if (targets != NULL) memFree(targets);
+		close(notifyFd);
+		return PYP_WATCH_ERROR_MEMORY;
+	}
+	for (i = 0; i < batch->jobCount; ++i) {
+		targets[i].job = &batch->jobs[i];
+		targets[i].dependencies = NULL;
+		targets[i].watchIds = NULL;
+		targets[i].changed = PYP_TRUE;
+	}
+
+	// Stop on SIGINT or SIGTERM; no SA_RESTART, so poll is interrupted
+	pypWatchStopRequested = 0;
+	memset(&action, 0, sizeof(action));
+	sigemptyset(&action.sa_mask);
+	action.sa_handler = pypWatchSignalStop;
+	sigaction(SIGINT, &action, &previousInterrupt);
+	sigaction(SIGTERM, &action, &previousTerminate);
+
+	// Render everything once, then only what depends on changed files
+	while (!pypWatchStopRequested) {
+		// Render
+		timeStart = pypWatchMilliseconds();
+		changedCount = 0;
+		failureCount = 0;
+		for (i = 0; i < batch->jobCount; ++i) {
+			if (!targets[i].changed) continue;
+
+			targets[i].changed = PYP_FALSE;
+			++changedCount;
+			if (!pypWatchTargetRender(&targets[i], engine, notifyFd, reportStream)) {
+				// Error
+				ws = PYP_WATCH_ERROR_MEMORY;
+				break;
+			}
+			if (targets[i].job->status != PYP_READ_OKAY) ++failureCount;
+			if (!initial) pypWatchTargetReport(&targets[i], reportStream);
+		}
+		if (ws != PYP_WATCH_OKAY) break;
+
+		// Report
+		if (changedCount > 0) {
+			for (fileCount = 0, i = 0; i < batch->jobCount; ++i) fileCount += targets[i].dependencies->count;
+			fprintf(
+				reportStream,
+				"%s %lu of %lu output%s in %lu ms%s; watching %lu file%s\n",
+				initial ? "Rendered" : "Rebuilt",
+				(unsigned long int) changedCount,
+				(unsigned long int) batch->jobCount,
+				(batch->jobCount == 1) ? "" : "s",
+				pypWatchMilliseconds() - timeStart,
+				(failureCount > 0) ? " with errors" : "",
+				(unsigned long int) fileCount,
+				(fileCount == 1) ? "" : "s"
+			);
+			fflush(reportStream);
+		}
+
+		// Wait for a change
+		pollFd.fd = notifyFd;
+		pollFd.events = POLLIN;
+		Py_BEGIN_ALLOW_THREADS
+		pollStatus = poll(&pollFd, 1, -1);
+		Py_END_ALLOW_THREADS
+		if (pollStatus < 0) {
+			if (errno == EINTR) continue;
+
+			// Error
+			ws = PYP_WATCH_ERROR_NOTIFY;
+			break;
+		}
+
+		// Editors often write several times when saving, so events are collected until they stop
+		do {
+			if (!pypWatchEventsRead(notifyFd, eventBuffer, targets, batch->jobCount)) {
+				// Error
+				ws = PYP_WATCH_ERROR_NOTIFY;
+				break;
+			}
+
+			Py_BEGIN_ALLOW_THREADS
+			pollStatus = poll(&pollFd, 1, (int) settings->debounceMilliseconds);
+			Py_END_ALLOW_THREADS
+		}
+		while (pollStatus > 0 && !pypWatchStopRequested);
+		if (ws != PYP_WATCH_OKAY) break;
+
+		initial = PYP_FALSE;
+	}
+
+	// Restore
+	sigaction(SIGINT, &previousInterrupt, NULL);
+	sigaction(SIGTERM, &previousTerminate, NULL);
+
+	// Clean
+	for (i = 0; i < batch->jobCount; ++i) {
+		if (targets[i].dependencies != NULL) pypDependenciesDelete(targets[i].dependencies);
+		if (targets[i].watchIds != NULL) memFree(targets[i].watchIds);
+	}
+	memFree(targets);
+	memFree(eventBuffer);
+	close(notifyFd);
+
+	// Done
+	return ws;
+}
+
+void
+pypWatchSignalStop(int signalNumber) {
+	pypWatchStopRequested = 1;
+}
+
+PypBool
+pypWatchTargetRender(PypWatchTarget* target, PypEngine* engine, int notifyFd, FILE* reportStream) {
+	// Vars
+	PypBatchJob* job = target->job;
+
+	// Dependencies are recorded again, since they may have changed
+	if (target->dependencies != NULL) pypDependenciesDelete(target->dependencies);
+	if (target->watchIds != NULL) memFree(target->watchIds);
+	target->watchIds = NULL;
+	if ((target->dependencies = pypDependenciesCreate()) == NULL) return PYP_FALSE; // error
+
+	// Render
+	job->status = pypEngineRenderFile(engine, job->inputFilename, job->outputFilename, reportStream, target->dependencies);
+	if (job->status == PYP_READ_OKAY && job->dependencyFilename != NULL && !pypDependenciesWriteMakefile(target->dependencies, job->outputFilename, job->dependencyFilename)) {
+		job->status = PYP_READ_ERROR_WRITE;
+	}
+	if (job->status != PYP_READ_OKAY) {
+		fprintf(reportStream, "Error rendering \"%s\": %s\n", job->inputFilenameUTF8, pypReadStatusDescription(job->status));
+	}
+
+	// Watch
+	return pypWatchTargetWatch(target, notifyFd);
+}
+
+PypBool
+pypWatchTargetWatch(PypWatchTarget* target, int notifyFd) {
+	// Vars
+	PypDependencies* dependencies = target->dependencies;
+	char* directory;
+	size_t directoryLength;
+	size_t errorCount;
+	size_t i;
+
+	// Assertions
+	assert(target->watchIds == NULL);
+
+	if (dependencies->count == 0) return PYP_TRUE;
+	if ((target->watchIds = memAllocArray(int, dependencies->count)) == NULL) return PYP_FALSE; // error
+
+	// Directories are watched rather than files, so replacing or creating a file is seen too
+	for (i = 0; i < dependencies->count; ++i) {
+		if (unicodeUTF8EncodeLength(dependencies->filenames[i], pypWatchFilenameStart(dependencies->filenames[i]), &directory, &directoryLength, &errorCount) != UNICODE_OKAY) return PYP_FALSE; // error
+
+		// A missing directory can't be watched; the file is then never seen to change
+		target->watchIds[i] = inotify_add_watch(notifyFd, (directoryLength == 0) ? "/" : directory, PYP_WATCH_EVENT_MASK);
+		memFree(directory);
+	}
+
+	// Done
+	return PYP_TRUE;
+}
+
+void
+pypWatchTargetReport(PypWatchTarget* target, FILE* reportStream) {
+	// Vars
+	char* outputFilename;
+	size_t outputFilenameLength;
+	size_t errorCount;
+
+	if (unicodeUTF8Encode(target->job->outputFilename, &outputFilename, &outputFilenameLength, &errorCount) != UNICODE_OKAY) return; // error
+
+	fprintf(reportStream, "  %s%s\n", outputFilename, (target->job->status == PYP_READ_OKAY) ? "" : " (failed)");
+	memFree(outputFilename);
+}
+
+PypBool
+pypWatchEventsRead(int notifyFd, char* buffer, PypWatchTarget* targets, size_t targetCount) {
+	// Vars
+	const struct inotify_event* event;
+	ssize_t length;
+	ssize_t offset;
+	size_t i;
+
+	// Read everything available
+	while (1) {
+		length = read(notifyFd, buffer, PYP_WATCH_EVENT_BUFFER_SIZE);
+		if (length < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN) return PYP_TRUE;
+			return PYP_FALSE; // error
+		}
+
+		for (offset = 0; offset < length; offset += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event*) &buffer[offset];
+
+			if ((event->mask & IN_Q_OVERFLOW) != 0) {
+				// Events were lost, so everything is rendered again
+				for (i = 0; i < targetCount; ++i) targets[i].changed = PYP_TRUE;
+			}
+			else if (event->len > 0) {
+				pypWatchEventApply(event->wd, event->name, targets, targetCount);
+			}
+		}
+
+	}
+}
+
+void
+pypWatchEventApply(int watchId, const char* name, PypWatchTarget* targets, size_t targetCount) {
+	// Vars
+	PypDependencies* dependencies;
+	unicode_char* nameUnicode;
+	size_t characterCount;
+	size_t bufferLength;
+	size_t errorCount;
+	size_t i;
+	size_t j;
+
+	if (unicodeUTF8Decode(name, &nameUnicode, &characterCount, &bufferLength, &errorCount) != UNICODE_OKAY) return; // error
+
+	// Any target with a dependency of that name in the watched directory is changed
+	for (i = 0; i < targetCount; ++i) {
+		dependencies = targets[i].dependencies;
+		if (targets[i].changed || targets[i].watchIds == NULL) continue;
+
+		for (j = 0; j < dependencies->count; ++j) {
+			if (
+				targets[i].watchIds[j] == watchId &&
+				wcscmp(&dependencies->filenames[j][pypWatchFilenameStart(dependencies->filenames[j])], nameUnicode) == 0
+			) {
+				targets[i].changed = PYP_TRUE;
+				break;
+			}
+		}
+	}
+
+	memFree(nameUnicode);
+}
+
+size_t
+pypWatchFilenameStart(const unicode_char* filename) {
+	// Vars
+	size_t i;
+	size_t start = 0;
+
+	// After the last separator
+	for (i = 0; filename[i] != '\x00'; ++i) {
+		if (pathCharIsSeparatorUnicode(filename[i])) start = i + 1;
+	}
+
+	return start;
+}
+
+unsigned long
+pypWatchMilliseconds() {
+	// Vars
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long) now.tv_sec * 1000 + (unsigned long) (now.tv_nsec / 1000000);
+}
+#endif
+
+
+
+// Status info
+const char*
+pypWatchStatusDescription(PypWatchStatus status) {
+	switch (status) {
+		case PYP_WATCH_OKAY:
+			return "Okay";
+		case PYP_WATCH_ERROR_MEMORY:
+			return "Memory error";
+		case PYP_WATCH_ERROR_NOTIFY:
+			return "File change notification error";
+		case PYP_WATCH_ERROR_UNSUPPORTED:
+			return "Not supported on this platform";
+		default:
+			return "Error";
+	}
+}
+
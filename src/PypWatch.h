@@ -0,0 +1,35 @@
+#ifndef __PYP_WATCH_H
+#define __PYP_WATCH_H
+
+
+
+#include <stdio.h>
+#include "PypTypes.h"
+#include "PypEngine.h"
+#include "PypBatch.h"
+
+
+
+typedef enum PypWatchStatus_ {
+	PYP_WATCH_OKAY = 0x0,
+	PYP_WATCH_ERROR_MEMORY = 0x1,
+	PYP_WATCH_ERROR_NOTIFY = 0x2,
+	PYP_WATCH_ERROR_UNSUPPORTED = 0x3,
+} PypWatchStatus;
+
+typedef struct PypWatchSettings_ {
+	unsigned long debounceMilliseconds; // changes are collected until none happen for this long
+} PypWatchSettings;
+
+
+
+void pypWatchSettingsInit(PypWatchSettings* settings);
+
+PypWatchStatus pypWatchRun(PypBatch* batch, PypEngine* engine, const PypWatchSettings* settings, FILE* reportStream);
+
+const char* pypWatchStatusDescription(PypWatchStatus status);
+
+
+
+#endif
+
@@ -0,0 +1,166 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "Thread.h"
+
+
+
+// Headers
+typedef struct ThreadStart_ {
+	ThreadFunction function;
+	void* data;
+} ThreadStart;
+
+#ifdef _WIN32
+static DWORD WINAPI threadEntry(LPVOID data);
+#else
+static void* threadEntry(void* data);
+#endif
+
+
+
+// Entry point; the start info is allocated with plain malloc, since the debug allocator locks
+#ifdef _WIN32
+DWORD WINAPI
+threadEntry(LPVOID data)
+#else
+void*
+threadEntry(void* data)
+#endif
+{
+	// Vars
+	ThreadStart start = *((ThreadStart*) data);
+
+	// Run
+	free(data);
+	start.function(start.data);
+
+	// Done
+	#ifdef _WIN32
+	return 0;
+	#else
+	return NULL;
+	#endif
+}
+
+
+
+// Threads
+ThreadStatus
+threadCreate(Thread* thread, ThreadFunction function, void* data) {
+	// Vars
+	ThreadStart* start;
+
+	// Assertions
+	assert(thread != NULL);
+	assert(function != NULL);
+
+	// Setup
+	start = malloc(sizeof(ThreadStart));
+	if (start == NULL) return THREAD_ERROR; // error
+	start->function = function;
+	start->data = data;
+
+	// Create
+	#ifdef _WIN32
+	*thread = CreateThread(NULL, 0, threadEntry, start, 0, NULL);
+	if (*thread == NULL) {
+		// Error
+		free(start);
+		return THREAD_ERROR;
+	}
+	#else
+	if (pthread_create(thread, NULL, threadEntry, start) != 0) {
+		// Error
+		free(start);
+		return THREAD_ERROR;
+	}
+	#endif
+
+	// Okay
+	return THREAD_OKAY;
+}
+
+void
+threadJoin(Thread* thread) {
+	assert(thread != NULL);
+
+	#ifdef _WIN32
+	WaitForSingleObject(*thread, INFINITE);
+	CloseHandle(*thread);
+	#else
+	pthread_join(*thread, NULL);
+	#endif
+}
+
+
+
+// Mutexes
+void
+threadMutexInit(ThreadMutex* mutex) {
+	assert(mutex != NULL);
+
+	#ifdef _WIN32
+	InitializeSRWLock(mutex);
+	#else
+	pthread_mutex_init(mutex, NULL);
+	#endif
+}
+
+void
+threadMutexDestroy(ThreadMutex* mutex) {
+	assert(mutex != NULL);
+
+	#ifndef _WIN32
+	pthread_mutex_destroy(mutex);
+	#endif
+}
+
+void
+threadMutexLock(ThreadMutex* mutex) {
+	assert(mutex != NULL);
+
+	#ifdef _WIN32
+	AcquireSRWLockExclusive(mutex);
+	#else
+	pthread_mutex_lock(mutex);
+	#endif
+}
+
+void
+threadMutexUnlock(ThreadMutex* mutex) {
+	assert(mutex != NULL);
+
+	#ifdef _WIN32
+	ReleaseSRWLockExclusive(mutex);
+	#else
+	pthread_mutex_unlock(mutex);
+	#endif
+}
+
+
+
+// Atomics; both return the new value
+ThreadAtomic
+threadAtomicAdd(volatile ThreadAtomic* target, ThreadAtomic value) {
+	assert(target != NULL);
+
+	#ifdef _WIN32
+	return InterlockedExchangeAdd64(target, value) + value;
+	#else
+	return __sync_add_and_fetch(target, value);
+	#endif
+}
+
+ThreadAtomic
+threadAtomicGet(volatile ThreadAtomic* target) {
+	assert(target != NULL);
+
+	#ifdef _WIN32
+	return InterlockedCompareExchange64(target, 0, 0);
+	#else
+	return __sync_add_and_fetch(target, 0);
+	#endif
+}
+
+
+
@@ -0,0 +1,61 @@
+#ifndef __THREAD_H
+#define __THREAD_H
+
+
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+
+
+typedef enum ThreadStatus_ {
+	THREAD_OKAY = 0x0,
+	THREAD_ERROR = 0x1,
+} ThreadStatus;
+
+typedef void (*ThreadFunction)(void* data);
+
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef SRWLOCK ThreadMutex;
+#define THREAD_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t ThreadMutex;
+#define THREAD_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+#ifdef _WIN32
+typedef LONG64 ThreadAtomic;
+#else
+typedef long long ThreadAtomic;
+#endif
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+
+
+ThreadStatus threadCreate(Thread* thread, ThreadFunction function, void* data);
+void threadJoin(Thread* thread);
+
+void threadMutexInit(ThreadMutex* mutex);
+void threadMutexDestroy(ThreadMutex* mutex);
+void threadMutexLock(ThreadMutex* mutex);
+void threadMutexUnlock(ThreadMutex* mutex);
+
+ThreadAtomic threadAtomicAdd(volatile ThreadAtomic* target, ThreadAtomic value);
+ThreadAtomic threadAtomicGet(volatile ThreadAtomic* target);
+
+
+
+#endif
+
+
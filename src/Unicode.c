@@ -92,10 +92,11 @@ unicodeUTF8EncodeLength(const unicode_char* input, size_t inputLength, char** ou
 			*output = memAllocArray(char, inputLength + 1);
 			if (*output == NULL) return UNICODE_ERROR_MEMORY; // error
 
-			// Copy
-			for (j = 0; j <= inputLength; ++j) {
+			// Copy; the input may not be null terminated at inputLength
+			for (j = 0; j < inputLength; ++j) {
 				(*output)[j] = input[j];
 			}
+			(*output)[inputLength] = '\x00';
 
 			// Final
 			*outputLength = inputLength;